@@ -46,6 +46,12 @@ public:
         RegisterCommand("ping"_h, &PingCommand);
         RegisterCommand("reload"_h, &ReloadCommand);
         RegisterCommand("loadmap"_h, &LoadMapCommand);
+        RegisterCommand("benchmarkmapload"_h, &BenchmarkMapLoadCommand);
+        RegisterCommand("benchmarkheightqueries"_h, &BenchmarkHeightQueriesCommand);
+        RegisterCommand("benchmarkterrainraycast"_h, &BenchmarkTerrainRaycastCommand);
+        RegisterCommand("benchmarkterrainsweep"_h, &BenchmarkTerrainSweepCommand);
+        RegisterCommand("benchmarkterraincull"_h, &BenchmarkTerrainCullCommand);
+        RegisterCommand("stressrenderresources"_h, &StressRenderResourcesCommand);
     }
 
     void HandleCommand(EngineLoop& engineLoop, std::string& command)
@@ -31,7 +31,16 @@
 #include "../Rendering/ClientRenderer.h"
 #include "../Rendering/TerrainRenderer.h"
 #include "../Rendering/CameraFreelook.h"
+#include "../Rendering/RendererStressTest.h"
+#include "../Rendering/TerrainCulling.h"
+#include "../Loaders/Map/MapLoader.h"
+#include "../Gameplay/Map/HeightfieldQueries.h"
+#include "../Gameplay/Map/HeightfieldRaycast.h"
+#include "../Gameplay/Map/HeightfieldSweep.h"
 #include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
 
 void ReloadCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
 {
@@ -70,4 +79,72 @@ void LoadMapCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands
     loadMapMessage.code = MSG_IN_LOAD_MAP;
     loadMapMessage.object = loadMapInfo;
     engineLoop.PassMessage(loadMapMessage);
+}
+
+void BenchmarkMapLoadCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
+{
+    if (subCommands.size() == 0)
+        return;
+
+    // Runs right here on the console thread, the benchmark loads into its own containers and leaves the current map alone
+    MapLoader::BenchmarkLoad(subCommands[0]);
+}
+
+void BenchmarkHeightQueriesCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
+{
+    if (subCommands.size() == 0)
+        return;
+
+    // Same as benchmarkmapload, it queries a heightfield of its own so the current map can keep running on the main thread
+    Terrain::BenchmarkHeightQueries(subCommands[0]);
+}
+
+void BenchmarkTerrainRaycastCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
+{
+    if (subCommands.size() == 0)
+        return;
+
+    Terrain::BenchmarkRaycasts(subCommands[0]);
+}
+
+void BenchmarkTerrainSweepCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
+{
+    if (subCommands.size() == 0)
+        return;
+
+    Terrain::BenchmarkSweeps(subCommands[0]);
+}
+
+// benchmarkterraincull [chunks]
+void BenchmarkTerrainCullCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
+{
+    u32 numChunks = 1024;
+
+    if (subCommands.size() > 0)
+    {
+        numChunks = static_cast<u32>(std::strtoul(subCommands[0].c_str(), nullptr, 10));
+    }
+
+    // The bounds are made up, so this needs neither a map nor the renderer
+    Terrain::Culling::Benchmark(numChunks);
+}
+
+// stressrenderresources [workers] [resources per worker]
+void StressRenderResourcesCommand(EngineLoop& engineLoop, std::vector<std::string> subCommands)
+{
+    u32 numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+    u32 numResourcesPerWorker = 64;
+
+    if (subCommands.size() > 0)
+    {
+        numWorkers = std::max(static_cast<u32>(std::strtoul(subCommands[0].c_str(), nullptr, 10)), 1u);
+    }
+
+    if (subCommands.size() > 1)
+    {
+        numResourcesPerWorker = static_cast<u32>(std::strtoul(subCommands[1].c_str(), nullptr, 10));
+    }
+
+    // Runs on the console thread while the render thread keeps creating and looking up resources of its own
+    RendererStressTest::Run(ServiceLocator::GetRenderer(), numWorkers, numResourcesPerWorker);
 }
\ No newline at end of file
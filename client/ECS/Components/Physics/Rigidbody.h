@@ -3,5 +3,5 @@
 
 struct Rigidbody
 {
-    
-};
\ No newline at end of file
+    bool isWaitingForTerrain = false; // Set by TerrainResidencySystem while a chunk under the body hasn't been read back yet, the body holds still until it has
+};
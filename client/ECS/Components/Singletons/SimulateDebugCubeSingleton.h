@@ -0,0 +1,35 @@
+#pragma once
+#include <NovusTypes.h>
+#include <entity/fwd.hpp>
+#include <Utils/Timer.h>
+#include <vector>
+
+struct SimulateDebugCubeSingleton
+{
+    struct DebugBoxDraw
+    {
+        vec3 min;
+        vec3 max;
+        u32 color;
+    };
+
+    u32 numBodies = 0;
+    u32 numLanded = 0;
+    u32 numDebugBoxes = 0;
+    u32 numBatches = 0;
+    f32 solveTime = 0.0f; // Seconds spent moving and sweeping the bodies this frame
+    f32 drawTime = 0.0f;
+
+    // The batches run in a subflow after SimulateDebugCubeSystem::Update returned, so everything they share lives here
+    f32 fallDistance = 0.0f;
+    Timer solveTimer;
+    Timer drawTimer;
+
+    // Kept between frames so they only allocate when the number of bodies grows
+    std::vector<entt::entity> bodies;
+    std::vector<u8> landed; // Not a vector<bool>, workers write next to each other
+    std::vector<entt::entity> debugBoxes;
+
+    // Every batch gathers its draws into its own buffer, they are submitted in batch order so the debug renderer sees the same order no matter which worker ran what
+    std::vector<std::vector<DebugBoxDraw>> debugBoxDraws;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <NovusTypes.h>
+#include <memory>
+#include <Containers/StringTable.h>
+#include "../../../Gameplay/Map/Chunk.h"
+
+struct TerrainResidencySingleton
+{
+    TerrainResidencySingleton() : scratchChunk(std::make_unique<Terrain::Chunk>()) {}
+
+    u32 residentChunks = 0;
+    size_t residentBytes = 0;
+    u32 pinnedChunks = 0;
+    u32 waitingBodies = 0; // Rigidbodies held still this frame because a chunk under them is still evicted
+
+    u32 faultsThisFrame = 0;
+    u32 pinFaultsThisFrame = 0;
+    u32 evictionsThisFrame = 0;
+    u32 totalFaults = 0;
+    u32 totalEvictions = 0;
+
+    // Re-faulted chunks are read into these and only their heights are kept, a Chunk is too big to live on the stack
+    std::unique_ptr<Terrain::Chunk> scratchChunk;
+    StringTable scratchStringTable;
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <NovusTypes.h>
+
+// TerrainResidencySystem keeps the heightfield resident around entities with this and the camera, like the local player
+struct TerrainResidencyAnchor
+{
+
+};
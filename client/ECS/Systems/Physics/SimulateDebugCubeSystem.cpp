@@ -6,18 +6,130 @@
 #include <Renderer/Renderer.h>
 #include <InputManager.h>
 #include <Math/Geometry.h>
+#include <Utils/Timer.h>
 #include "../../../Utils/ServiceLocator.h"
-#include "../../../Utils/MapUtils.h"
+#include "../../../Gameplay/Map/HeightfieldSweep.h"
 #include "../../../Rendering/DebugRenderer.h"
 #include "../../../Rendering/Camera.h"
+#include "CVar/CVarSystem.h"
 
 #include "../../Components/Singletons/TimeSingleton.h"
+#include "../../Components/Singletons/MapSingleton.h"
+#include "../../Components/Singletons/SimulateDebugCubeSingleton.h"
 #include "../../Components/Transform.h"
 #include "../../Components/Physics/Rigidbody.h"
 #include "../../Components/Rendering/DebugBox.h"
 
+AutoCVar_Int CVAR_PhysicsParallel("physics.parallel", "move rigidbodies and sweep them against the terrain on worker threads", 1, CVarFlags::EditCheckbox);
+
+// Small enough that a few thousand bodies keep every worker busy, big enough that a batch is worth scheduling
+constexpr u32 BODIES_PER_BATCH = 64;
+
+namespace
+{
+    u32 GetNumBatches(size_t count)
+    {
+        return static_cast<u32>((count + BODIES_PER_BATCH - 1) / BODIES_PER_BATCH);
+    }
+
+    void SolveBatch(entt::registry& registry, SimulateDebugCubeSingleton& simulation, const Terrain::Heightfield& heightfield, u32 batch)
+    {
+        const vec3 direction = vec3(0, -1, 0);
+        const u32 numBodies = static_cast<u32>(simulation.bodies.size());
+
+        const u32 end = glm::min((batch + 1) * BODIES_PER_BATCH, numBodies);
+        for (u32 i = batch * BODIES_PER_BATCH; i < end; i++)
+        {
+            Transform& transform = registry.get<Transform>(simulation.bodies[i]);
+
+            Geometry::AABoundingBox box;
+            box.min = transform.position;
+            box.min.x -= transform.scale.x;
+            box.min.z -= transform.scale.z;
+
+            box.max = transform.position + transform.scale;
+
+            Terrain::SweepHit hit;
+            const bool didHit = Terrain::SweepAABB(heightfield, box, direction, simulation.fallDistance, hit);
+            if (didHit)
+                transform.position += hit.distance * direction;
+            else
+                transform.position.y -= simulation.fallDistance;
+
+            simulation.landed[i] = didHit;
+        }
+    }
+
+    // Components can only be removed from one thread, going through the bodies in view order keeps the registry the same from run to run
+    void RemoveLandedBodies(entt::registry& registry, SimulateDebugCubeSingleton& simulation)
+    {
+        u32 numLanded = 0;
+        for (u32 i = 0; i < simulation.bodies.size(); i++)
+        {
+            if (simulation.landed[i])
+            {
+                registry.remove<Rigidbody>(simulation.bodies[i]);
+                numLanded++;
+            }
+        }
+
+        simulation.numLanded = numLanded;
+        simulation.solveTime = simulation.solveTimer.GetLifeTime();
+        simulation.drawTimer.Reset();
+    }
+
+    void GatherDrawBatch(entt::registry& registry, SimulateDebugCubeSingleton& simulation, u32 batch)
+    {
+        std::vector<SimulateDebugCubeSingleton::DebugBoxDraw>& draws = simulation.debugBoxDraws[batch];
+        draws.clear();
+
+        const u32 numDebugBoxes = static_cast<u32>(simulation.debugBoxes.size());
+
+        const u32 end = glm::min((batch + 1) * BODIES_PER_BATCH, numDebugBoxes);
+        for (u32 i = batch * BODIES_PER_BATCH; i < end; i++)
+        {
+            const entt::entity entity = simulation.debugBoxes[i];
+            const Transform& transform = registry.get<Transform>(entity);
+
+            SimulateDebugCubeSingleton::DebugBoxDraw& draw = draws.emplace_back();
+            draw.min = transform.position;
+            draw.min.x -= transform.scale.x;
+            draw.min.z -= transform.scale.z;
+            draw.max = transform.position + transform.scale;
+
+            draw.color = 0xff0000ff; // Red if it doesn't have a rigidbody
+            if (registry.has<Rigidbody>(entity))
+            {
+                draw.color = 0xff00ff00; // Green if it does
+            }
+        }
+    }
+
+    // The debug renderer isn't thread safe, so the gathered draws are submitted from one task in batch order
+    void SubmitDraws(SimulateDebugCubeSingleton& simulation, DebugRenderer* debugRenderer)
+    {
+        const u32 numDrawBatches = GetNumBatches(simulation.debugBoxes.size());
+        for (u32 batch = 0; batch < numDrawBatches; batch++)
+        {
+            for (const SimulateDebugCubeSingleton::DebugBoxDraw& draw : simulation.debugBoxDraws[batch])
+            {
+                // This registers the model to be rendered THIS frame.
+                debugRenderer->DrawAABB3D(draw.min, draw.max, draw.color);
+            }
+        }
+
+        simulation.drawTime = simulation.drawTimer.GetLifeTime();
+
+        TracyPlot("Rigidbodies", static_cast<i64>(simulation.numBodies));
+        TracyPlot("Rigidbody Solve ms", static_cast<f64>(simulation.solveTime) * 1000.0);
+        TracyPlot("Debug Box Draw ms", static_cast<f64>(simulation.drawTime) * 1000.0);
+    }
+}
+
 void SimulateDebugCubeSystem::Init(entt::registry& registry)
 {
+    SimulateDebugCubeSingleton& simulation = registry.set<SimulateDebugCubeSingleton>();
+
     InputManager* inputManager = ServiceLocator::GetInputManager();
 
     inputManager->RegisterKeybind("SpawnDebugBox", GLFW_KEY_B, KEYBIND_ACTION_PRESS, KEYBIND_MOD_ANY, [&registry](Window* window, std::shared_ptr<Keybind> keybind)
@@ -41,52 +153,94 @@ void SimulateDebugCubeSystem::Init(entt::registry& registry)
     });
 }
 
-void SimulateDebugCubeSystem::Update(entt::registry& registry, DebugRenderer* debugRenderer)
+void SimulateDebugCubeSystem::Update(entt::registry& registry, DebugRenderer* debugRenderer, tf::SubflowBuilder& subflow)
 {
     TimeSingleton& timeSingleton = registry.ctx<TimeSingleton>();
+    MapSingleton& mapSingleton = registry.ctx<MapSingleton>();
+    SimulateDebugCubeSingleton& simulation = registry.ctx<SimulateDebugCubeSingleton>();
 
-    auto rigidbodyView = registry.view<Transform, Rigidbody>();
-    rigidbodyView.each([&](const auto entity, Transform& transform)
+    // TerrainResidencySystem ran before us and pinned the chunks under every body, nothing changes the heightfield while the workers read it
+    const Terrain::Heightfield& heightfield = mapSingleton.currentMap.heightfield;
+
+    // Make all rigidbodies "fall"
+    simulation.fallDistance = GRAVITY_SCALE * timeSingleton.deltaTime;
+    simulation.solveTimer.Reset();
+
+    simulation.bodies.clear();
+    // Bodies over a chunk that isn't read back yet would fall through it
+    registry.view<Transform, Rigidbody>().each([&](const auto entity, Transform& transform, Rigidbody& rigidbody)
     {
-        // Make all rigidbodies "fall"
-        f32 dist = GRAVITY_SCALE * timeSingleton.deltaTime;
+        if (!rigidbody.isWaitingForTerrain)
+        {
+            simulation.bodies.push_back(entity);
+        }
+    });
 
-        Geometry::AABoundingBox box;
-        box.min = transform.position;
-        box.min.x -= transform.scale.x;
-        box.min.z -= transform.scale.z;
+    // Removing Rigidbody doesn't change which entities have a DebugBox, so both lists are known before anything runs
+    simulation.debugBoxes.clear();
+    registry.view<Transform, DebugBox>().each([&](const auto entity, Transform& transform)
+    {
+        simulation.debugBoxes.push_back(entity);
+    });
 
-        box.max = transform.position + transform.scale;
+    const u32 numBodies = static_cast<u32>(simulation.bodies.size());
+    simulation.landed.resize(numBodies);
 
-        Geometry::Triangle triangle;
-        f32 height = 0;
+    const u32 numBodyBatches = GetNumBatches(numBodies);
+    const u32 numDrawBatches = GetNumBatches(simulation.debugBoxes.size());
+    if (simulation.debugBoxDraws.size() < numDrawBatches)
+    {
+        simulation.debugBoxDraws.resize(numDrawBatches);
+    }
 
-        vec3 distToCollision;
-        if (Terrain::MapUtils::Intersect_AABB_TERRAIN_SWEEP(box, triangle, vec3(0, -1, 0), height, dist, distToCollision))
+    simulation.numBodies = numBodies;
+    simulation.numDebugBoxes = static_cast<u32>(simulation.debugBoxes.size());
+    simulation.numBatches = numBodyBatches;
+
+    if (!CVAR_PhysicsParallel.Get() || (numBodyBatches <= 1 && numDrawBatches <= 1))
+    {
+        for (u32 batch = 0; batch < numBodyBatches; batch++)
         {
-            transform.position += distToCollision;
-            registry.remove<Rigidbody>(entity);
+            SolveBatch(registry, simulation, heightfield, batch);
         }
-        else
-            transform.position.y -= dist;
 
+        RemoveLandedBodies(registry, simulation);
+
+        for (u32 batch = 0; batch < numDrawBatches; batch++)
+        {
+            GatherDrawBatch(registry, simulation, batch);
+        }
+
+        SubmitDraws(simulation, debugRenderer);
+        return;
+    }
+
+    // The subflow runs once this returns and is joined before the systems after this one, so its tasks only hold on to what outlives this scope
+    entt::registry* registryPtr = &registry;
+    SimulateDebugCubeSingleton* simulationPtr = &simulation;
+    const Terrain::Heightfield* heightfieldPtr = &heightfield;
+
+    std::pair<tf::Task, tf::Task> solveTasks = subflow.parallel_for(0u, numBodyBatches, 1u, [registryPtr, simulationPtr, heightfieldPtr](u32 batch)
+    {
+        SolveBatch(*registryPtr, *simulationPtr, *heightfieldPtr, batch);
     });
 
-    auto debugCubeView = registry.view<Transform, DebugBox>();
-    debugCubeView.each([&](const auto entity, Transform& transform)
+    tf::Task removeLandedTask = subflow.emplace([registryPtr, simulationPtr]()
     {
-        vec3 min = transform.position;
-        min.x -= transform.scale.x;
-        min.z -= transform.scale.z;
-        vec3 max = transform.position + transform.scale;
+        RemoveLandedBodies(*registryPtr, *simulationPtr);
+    });
 
-        u32 color = 0xff0000ff; // Red if it doesn't have a rigidbody
-        if (registry.has<Rigidbody>(entity))
-        {
-            color = 0xff00ff00; // Green if it does
-        }
+    std::pair<tf::Task, tf::Task> drawTasks = subflow.parallel_for(0u, numDrawBatches, 1u, [registryPtr, simulationPtr](u32 batch)
+    {
+        GatherDrawBatch(*registryPtr, *simulationPtr, batch);
+    });
 
-        // This registers the model to be rendered THIS frame.
-        debugRenderer->DrawAABB3D(min, max, color);
+    tf::Task submitTask = subflow.emplace([simulationPtr, debugRenderer]()
+    {
+        SubmitDraws(*simulationPtr, debugRenderer);
     });
-}
\ No newline at end of file
+
+    solveTasks.second.precede(removeLandedTask);
+    removeLandedTask.precede(drawTasks.first);
+    drawTasks.second.precede(submitTask);
+}
@@ -1,13 +1,15 @@
 #pragma once
 #include <entity/fwd.hpp>
+#include <taskflow/taskflow.hpp>
 
 class DebugRenderer;
 
 constexpr f32 GRAVITY_SCALE = 10.0f;
 
+// Bodies are moved and swept against the terrain in batches on the update framework's workers, every body only touches its own Transform so the result doesn't depend on how the batches are scheduled
 class SimulateDebugCubeSystem
 {
 public:
     static void Init(entt::registry& registry);
-    static void Update(entt::registry& registry, DebugRenderer* debugRenderer);
-};
\ No newline at end of file
+    static void Update(entt::registry& registry, DebugRenderer* debugRenderer, tf::SubflowBuilder& subflow);
+};
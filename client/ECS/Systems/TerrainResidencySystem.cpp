@@ -0,0 +1,176 @@
+#include "TerrainResidencySystem.h"
+#include <entt.hpp>
+#include <tracy/Tracy.hpp>
+#include "../../Utils/ServiceLocator.h"
+#include "../../Utils/MapUtils.h"
+#include "../../Rendering/Camera.h"
+#include "../../Loaders/Map/MapLoader.h"
+#include "../Components/Singletons/MapSingleton.h"
+#include "../Components/Singletons/TerrainResidencySingleton.h"
+#include "../Components/Transform.h"
+#include "../Components/TerrainResidencyAnchor.h"
+#include "../Components/Physics/Rigidbody.h"
+#include "CVar/CVarSystem.h"
+
+AutoCVar_Float CVAR_ResidencyBudgetMB("map.residency.budgetMB", "how many MB of heightfield chunks stay resident before the least recently used ones get evicted", 128.0f);
+AutoCVar_Int CVAR_ResidencyKeepRadius("map.residency.keepRadius", "chunks within this many chunks of the camera or a residency anchor are kept resident", 1);
+AutoCVar_Int CVAR_ResidencyMaxFaultsPerFrame("map.residency.maxFaultsPerFrame", "how many evicted chunks near the camera or a residency anchor are read back per frame", 2);
+AutoCVar_Int CVAR_ResidencyMaxPinFaultsPerFrame("map.residency.maxPinFaultsPerFrame", "how many evicted chunks under rigidbodies are read back per frame, bodies over the rest hold still until theirs are back", 4);
+
+namespace
+{
+    // Reads the chunk through the normal loader path and keeps only its heights
+    bool FaultChunk(Terrain::Map& map, u16 chunkID, TerrainResidencySingleton& residency)
+    {
+        auto locationItr = map.chunkLocations.find(chunkID);
+        if (locationItr == map.chunkLocations.end())
+            return false;
+
+        residency.scratchStringTable.Clear();
+        if (!MapLoader::LoadChunk(locationItr->second, map.archiveFile, *residency.scratchChunk, residency.scratchStringTable))
+            return false;
+
+        map.heightfield.SetChunk(chunkID, *residency.scratchChunk);
+
+        residency.faultsThisFrame++;
+        residency.totalFaults++;
+        return true;
+    }
+
+    void KeepChunksAround(Terrain::Map& map, const vec3& position, i32 radius, u32 faultLimit, TerrainResidencySingleton& residency)
+    {
+        const vec2 chunkPos = Terrain::MapUtils::GetChunkFromAdtPosition(Terrain::MapUtils::WorldPositionToADTCoordinates(position));
+        const i32 chunkX = Math::FloorToInt(chunkPos.x);
+        const i32 chunkY = Math::FloorToInt(chunkPos.y);
+
+        for (i32 y = glm::max(chunkY - radius, 0); y <= glm::min(chunkY + radius, static_cast<i32>(Terrain::MAP_CHUNKS_PER_MAP_STRIDE) - 1); y++)
+        {
+            for (i32 x = glm::max(chunkX - radius, 0); x <= glm::min(chunkX + radius, static_cast<i32>(Terrain::MAP_CHUNKS_PER_MAP_STRIDE) - 1); x++)
+            {
+                const u16 chunkID = static_cast<u16>(x + (y * Terrain::MAP_CHUNKS_PER_MAP_STRIDE));
+
+                if (map.heightfield.HasChunk(chunkID))
+                {
+                    map.heightfield.Touch(chunkID);
+                }
+                else if (residency.faultsThisFrame < faultLimit)
+                {
+                    FaultChunk(map, chunkID, residency);
+                }
+            }
+        }
+    }
+
+    // Returns false if a chunk under the box is still evicted once the pin faults of this frame ran out
+    bool PinChunksUnder(Terrain::Map& map, const vec3& min, const vec3& max, TerrainResidencySingleton& residency)
+    {
+        const vec2 minChunkPos = Terrain::MapUtils::GetChunkFromAdtPosition(Terrain::MapUtils::WorldPositionToADTCoordinates(min));
+        const vec2 maxChunkPos = Terrain::MapUtils::GetChunkFromAdtPosition(Terrain::MapUtils::WorldPositionToADTCoordinates(max));
+
+        // The world to ADT remap flips the axes, so min and max can end up swapped
+        const i32 startX = glm::max(Math::FloorToInt(glm::min(minChunkPos.x, maxChunkPos.x)), 0);
+        const i32 startY = glm::max(Math::FloorToInt(glm::min(minChunkPos.y, maxChunkPos.y)), 0);
+        const i32 endX = glm::min(Math::FloorToInt(glm::max(minChunkPos.x, maxChunkPos.x)), static_cast<i32>(Terrain::MAP_CHUNKS_PER_MAP_STRIDE) - 1);
+        const i32 endY = glm::min(Math::FloorToInt(glm::max(minChunkPos.y, maxChunkPos.y)), static_cast<i32>(Terrain::MAP_CHUNKS_PER_MAP_STRIDE) - 1);
+
+        const i32 maxPinFaults = CVAR_ResidencyMaxPinFaultsPerFrame.Get();
+
+        bool isResident = true;
+        for (i32 y = startY; y <= endY; y++)
+        {
+            for (i32 x = startX; x <= endX; x++)
+            {
+                const u16 chunkID = static_cast<u16>(x + (y * Terrain::MAP_CHUNKS_PER_MAP_STRIDE));
+                if (map.heightfield.IsPinned(chunkID))
+                    continue;
+
+                if (!map.heightfield.HasChunk(chunkID))
+                {
+                    // A chunk the map doesn't have can't be read back, bodies past the edge of the map keep falling
+                    if (map.chunkLocations.find(chunkID) == map.chunkLocations.end())
+                        continue;
+
+                    if (static_cast<i32>(residency.pinFaultsThisFrame) >= maxPinFaults)
+                    {
+                        isResident = false;
+                        continue;
+                    }
+
+                    residency.pinFaultsThisFrame++;
+                    if (!FaultChunk(map, chunkID, residency))
+                        continue;
+                }
+
+                map.heightfield.Pin(chunkID);
+                residency.pinnedChunks++;
+            }
+        }
+
+        return isResident;
+    }
+}
+
+void TerrainResidencySystem::Init(entt::registry& registry)
+{
+    registry.set<TerrainResidencySingleton>();
+}
+
+void TerrainResidencySystem::Update(entt::registry& registry)
+{
+    MapSingleton& mapSingleton = registry.ctx<MapSingleton>();
+    TerrainResidencySingleton& residency = registry.ctx<TerrainResidencySingleton>();
+
+    Terrain::Map& map = mapSingleton.currentMap;
+
+    residency.faultsThisFrame = 0;
+    residency.pinFaultsThisFrame = 0;
+    residency.evictionsThisFrame = 0;
+    residency.pinnedChunks = 0;
+    residency.waitingBodies = 0;
+
+    if (map.chunkLocations.empty())
+    {
+        residency.residentChunks = 0;
+        residency.residentBytes = 0;
+        return;
+    }
+
+    map.heightfield.BeginResidencyFrame();
+
+    // Pinning goes first and has a fault limit of its own, so the anchors can't use up the faults the bodies need
+    auto rigidbodyView = registry.view<Transform, Rigidbody>();
+    rigidbodyView.each([&](const auto entity, Transform& transform, Rigidbody& rigidbody)
+    {
+        vec3 min = transform.position;
+        min.x -= transform.scale.x;
+        min.z -= transform.scale.z;
+        vec3 max = transform.position + transform.scale;
+
+        rigidbody.isWaitingForTerrain = !PinChunksUnder(map, min, max, residency);
+        residency.waitingBodies += rigidbody.isWaitingForTerrain;
+    });
+
+    const i32 keepRadius = glm::max(CVAR_ResidencyKeepRadius.Get(), 0);
+
+    const u32 faultLimit = residency.faultsThisFrame + static_cast<u32>(glm::max(CVAR_ResidencyMaxFaultsPerFrame.Get(), 0));
+
+    Camera* camera = ServiceLocator::GetCamera();
+    KeepChunksAround(map, camera->GetPosition(), keepRadius, faultLimit, residency);
+
+    auto anchorView = registry.view<Transform, TerrainResidencyAnchor>();
+    anchorView.each([&](const auto entity, Transform& transform)
+    {
+        KeepChunksAround(map, transform.position, keepRadius, faultLimit, residency);
+    });
+
+    const size_t budgetBytes = static_cast<size_t>(glm::max(CVAR_ResidencyBudgetMB.GetFloat(), 0.0f) * 1024.0f * 1024.0f);
+    residency.evictionsThisFrame = map.heightfield.EvictLeastRecentlyUsed(budgetBytes);
+    residency.totalEvictions += residency.evictionsThisFrame;
+
+    residency.residentChunks = map.heightfield.GetNumChunks();
+    residency.residentBytes = map.heightfield.GetResidentBytes();
+
+    TracyPlot("Heightfield Resident MB", static_cast<f64>(residency.residentBytes) / (1024.0 * 1024.0));
+    TracyPlot("Heightfield Evictions", static_cast<i64>(residency.evictionsThisFrame));
+    TracyPlot("Heightfield Faults", static_cast<i64>(residency.faultsThisFrame));
+}
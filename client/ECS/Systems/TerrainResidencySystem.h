@@ -0,0 +1,13 @@
+#pragma once
+#include <NovusTypes.h>
+#include <entity/fwd.hpp>
+
+// Keeps the CPU side heightfield of the current map within map.residency.budgetMB
+// Chunks near the camera or a TerrainResidencyAnchor are kept, chunks under a rigidbody are pinned, and whatever was used least recently gets evicted
+// Evicted chunks are read back synchronously, so both kinds of faults are limited per frame
+class TerrainResidencySystem
+{
+public:
+    static void Init(entt::registry& registry);
+    static void Update(entt::registry& registry);
+};
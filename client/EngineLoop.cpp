@@ -10,6 +10,7 @@
 #include <Memory/MemoryTracker.h>
 #include "Rendering/ClientRenderer.h"
 #include "Rendering/TerrainRenderer.h"
+#include "Rendering/TerrainClipmap.h"
 #include "Rendering/CameraFreelook.h"
 #include "Rendering/CameraOrbital.h"
 #include "Loaders/Texture/TextureLoader.h"
@@ -23,6 +24,8 @@
 #include "ECS/Components/Singletons/ScriptSingleton.h"
 #include "ECS/Components/Singletons/DataStorageSingleton.h"
 #include "ECS/Components/Singletons/SceneManagerSingleton.h"
+#include "ECS/Components/Singletons/TerrainResidencySingleton.h"
+#include "ECS/Components/Singletons/SimulateDebugCubeSingleton.h"
 #include "ECS/Components/Network/ConnectionSingleton.h"
 #include "ECS/Components/Network/AuthenticationSingleton.h"
 #include "ECS/Components/LocalplayerSingleton.h"
@@ -31,6 +34,7 @@
 
 // Components
 #include "ECS/Components/Transform.h"
+#include "ECS/Components/TerrainResidencyAnchor.h"
 #include "ECS/Components/Physics/Rigidbody.h"
 #include "ECS/Components/Rendering/DebugBox.h"
 
@@ -40,6 +44,7 @@
 #include "ECS/Systems/Rendering/RenderModelSystem.h"
 #include "ECS/Systems/Physics/SimulateDebugCubeSystem.h"
 #include "ECS/Systems/MovementSystem.h"
+#include "ECS/Systems/TerrainResidencySystem.h"
 
 // Handlers
 #include "Network/Handlers/AuthSocket/AuthHandlers.h"
@@ -134,7 +139,8 @@ void EngineLoop::Run()
     sceneManager->SetAvailableScenes({ "LoginScreen"_h, "CharacterSelection"_h, "CharacterCreation"_h });
     ServiceLocator::SetSceneManager(sceneManager);
 
-    _clientRenderer = new ClientRenderer();
+    // The renderer updates once the update framework is done with the frame, so it runs its workers on the same executor
+    _clientRenderer = new ClientRenderer(&_updateFramework.taskflow);
 
     CameraFreeLook* cameraFreeLook = new CameraFreeLook(vec3(-8000.0f, 100.0f, 1600.0f)); // Stormwind Harbor
     //CameraFreeLook* cameraFreeLook = new CameraFreeLook(vec3(300.0f, 0.0f, -4700.0f)); // Razor Hill
@@ -186,6 +192,7 @@ void EngineLoop::Run()
     transform.scale = vec3(0.5f, 2.f, 0.5f); // "Ish" scale for humans
 
     _updateFramework.gameRegistry.emplace<DebugBox>(localplayerSingleton.entity);
+    _updateFramework.gameRegistry.emplace<TerrainResidencyAnchor>(localplayerSingleton.entity);
     Model& model = EntityUtils::CreateModelComponent(_updateFramework.gameRegistry, localplayerSingleton.entity, "Data/models/Cube.novusmodel");
 
     // Load Scripts
@@ -204,6 +211,7 @@ void EngineLoop::Run()
 
     MovementSystem::Init(_updateFramework.gameRegistry);
     SimulateDebugCubeSystem::Init(_updateFramework.gameRegistry);
+    TerrainResidencySystem::Init(_updateFramework.gameRegistry);
 
     f32 targetDelta = 1.0f / 60.f;
 
@@ -372,14 +380,23 @@ void EngineLoop::SetupUpdateFramework()
     });
     movementSystemTask.gather(connectionUpdateSystemTask);
 
+    // TerrainResidencySystem
+    tf::Task terrainResidencySystemTask = framework.emplace([&gameRegistry]()
+    {
+        ZoneScopedNC("TerrainResidencySystem::Update", tracy::Color::Blue2)
+            TerrainResidencySystem::Update(gameRegistry);
+        gameRegistry.ctx<ScriptSingleton>().CompleteSystem();
+    });
+    terrainResidencySystemTask.gather(movementSystemTask);
+
     // SimulateDebugCubeSystem
-    tf::Task simulateDebugCubeSystemTask = framework.emplace([this, &gameRegistry]()
+    tf::Task simulateDebugCubeSystemTask = framework.emplace([this, &gameRegistry](tf::SubflowBuilder& subflow)
     {
         ZoneScopedNC("SimulateDebugCubeSystem::Update", tracy::Color::Blue2)
-            SimulateDebugCubeSystem::Update(gameRegistry, _clientRenderer->GetDebugRenderer());
+            SimulateDebugCubeSystem::Update(gameRegistry, _clientRenderer->GetDebugRenderer(), subflow);
         gameRegistry.ctx<ScriptSingleton>().CompleteSystem();
     });
-    simulateDebugCubeSystemTask.gather(movementSystemTask);
+    simulateDebugCubeSystemTask.gather(terrainResidencySystemTask);
 
     // RenderModelSystem
     tf::Task renderModelSystemTask = framework.emplace([this, &gameRegistry]()
@@ -461,6 +478,91 @@ void EngineLoop::DrawEngineStats(EngineStatsSingleton* stats)
     ImGui::Text("Cell  Remainder : %f x, %f y", cellRemainder.x, cellRemainder.y);
     ImGui::Text("Patch Remainder : %f x, %f y", patchRemainder.x, patchRemainder.y);
 
+    TerrainRenderer* terrainRenderer = ServiceLocator::GetClientRenderer()->GetTerrainRenderer();
+    if (terrainRenderer->IsStreaming())
+    {
+        const TerrainRenderer::StreamingStats& streamingStats = terrainRenderer->GetStreamingStats();
+
+        ImGui::Spacing();
+        ImGui::Text("Terrain Chunks : %u resident, %u queued", streamingStats.residentChunks, streamingStats.queueDepth);
+        ImGui::Text("Terrain Upload : %.1f KB this frame", static_cast<f32>(streamingStats.bytesUploaded) / 1024.0f);
+    }
+
+    const TerrainRenderer::CullingStats& cullingStats = terrainRenderer->GetCullingStats();
+    if (cullingStats.cullingTime > 0.0f)
+    {
+        ImGui::Spacing();
+        ImGui::Text("Terrain Culling : %.3f ms, %u cells in %u chunks", cullingStats.cullingTime * 1000, cullingStats.visibleCells, cullingStats.visibleChunks);
+
+        if (cullingStats.scalarCullingTime > 0.0f)
+        {
+            ImGui::Text("Terrain Culling (scalar) : %.3f ms, %u cells", cullingStats.scalarCullingTime * 1000, cullingStats.scalarVisibleCells);
+        }
+
+        if (cullingStats.sortTime > 0.0f)
+        {
+            ImGui::Text("Terrain Front To Back Sort : %.3f ms", cullingStats.sortTime * 1000);
+        }
+
+        // The GPU time of every class shows up as the TerrainSingleLayerCells, TerrainTwoLayerCells and TerrainFullLayerCells GPU zones
+        ImGui::Text("Terrain Layer Classes : %u single, %u two, %u full layer cells", cullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_SINGLE], cullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_TWO], cullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_FULL]);
+    }
+
+    // These come from the GPU a couple of frames late
+    const TerrainRenderer::GPUCullingStats& gpuCullingStats = terrainRenderer->GetGPUCullingStats();
+    if (gpuCullingStats.isValid)
+    {
+        ImGui::Spacing();
+        ImGui::Text("Terrain GPU Culling : %u drawn, %u newly visible, %u frustum culled, %u occluded", gpuCullingStats.mainCells, gpuCullingStats.newlyVisibleCells, gpuCullingStats.frustumCulledCells, gpuCullingStats.occlusionCulledCells);
+        ImGui::Text("Terrain Layer Classes : %u single, %u two, %u full layer cells", gpuCullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_SINGLE], gpuCullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_TWO], gpuCullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_FULL]);
+    }
+
+    const TerrainClipmap::Stats& clipmapStats = terrainRenderer->GetClipmap()->GetStats();
+    const u32 clipmapPagesInRange = clipmapStats.residentPages + clipmapStats.missingPages;
+    if (clipmapPagesInRange > 0)
+    {
+        // The bake itself shows up as the TerrainClipmapBake GPU zone
+        const f32 hitRate = (static_cast<f32>(clipmapStats.residentPages) / clipmapPagesInRange) * 100.0f;
+
+        ImGui::Spacing();
+        ImGui::Text("Terrain Clipmap : %.1f%% of %u pages resident, %u baked (%u total), %.3f ms update", hitRate, clipmapPagesInRange, clipmapStats.bakedPages, clipmapStats.totalBakedPages, clipmapStats.updateTime * 1000);
+    }
+
+    const TerrainRenderer::VertexMemoryStats vertexMemoryStats = terrainRenderer->GetVertexMemoryStats();
+    if (vertexMemoryStats.vertexBufferBytes > 0)
+    {
+        ImGui::Spacing();
+        ImGui::Text("Terrain Vertices : %.1f MB at %u bytes per vertex (%.1f MB at %u with stored normals)", static_cast<f32>(vertexMemoryStats.vertexBufferBytes) / (1024.0f * 1024.0f), vertexMemoryStats.vertexSize, static_cast<f32>(vertexMemoryStats.vertexBufferBytesWithNormals) / (1024.0f * 1024.0f), vertexMemoryStats.vertexSizeWithNormals);
+    }
+
+    const TerrainRenderer::AlphaMapStats alphaMapStats = terrainRenderer->GetAlphaMapStats();
+    if (alphaMapStats.numAlphaMaps > 0)
+    {
+        ImGui::Spacing();
+        ImGui::Text("Terrain Alpha Maps : %u loaded, %.1f MB (%.1f MB uncompressed)", alphaMapStats.numAlphaMaps, static_cast<f32>(alphaMapStats.residentBytes) / (1024.0f * 1024.0f), static_cast<f32>(alphaMapStats.uncompressedBytes) / (1024.0f * 1024.0f));
+
+        if (alphaMapStats.numCooked > 0)
+        {
+            ImGui::Text("Terrain Alpha Map Cooking : %u cooked, worst error %u (%.2f RMS)", alphaMapStats.numCooked, alphaMapStats.maxCookError, alphaMapStats.maxCookRmsError);
+        }
+    }
+
+    const TerrainResidencySingleton& residency = _updateFramework.gameRegistry.ctx<TerrainResidencySingleton>();
+    if (residency.residentChunks > 0)
+    {
+        ImGui::Spacing();
+        ImGui::Text("Terrain Heightfield : %u chunks, %.1f MB resident, %u pinned", residency.residentChunks, static_cast<f32>(residency.residentBytes) / (1024.0f * 1024.0f), residency.pinnedChunks);
+        ImGui::Text("Terrain Heightfield Residency : %u faults, %u evictions, %u bodies waiting for terrain", residency.totalFaults, residency.totalEvictions, residency.waitingBodies);
+    }
+
+    const SimulateDebugCubeSingleton& simulation = _updateFramework.gameRegistry.ctx<SimulateDebugCubeSingleton>();
+    if (simulation.numBodies > 0 || simulation.numDebugBoxes > 0)
+    {
+        ImGui::Spacing();
+        ImGui::Text("Rigidbodies : %u simulated in %u batches, %u landed this frame", simulation.numBodies, simulation.numBatches, simulation.numLanded);
+        ImGui::Text("Rigidbody Solve : %.3f ms, %u debug boxes gathered in %.3f ms", simulation.solveTime * 1000.0f, simulation.numDebugBoxes, simulation.drawTime * 1000.0f);
+    }
+
     static bool advancedStats = false;
     ImGui::Checkbox("Advanced Stats", &advancedStats);
 
@@ -0,0 +1,61 @@
+#include "Chunk.h"
+#include <cstring>
+
+namespace Terrain
+{
+    bool ChunkView::Parse(const u8* data, size_t size)
+    {
+        size_t offset = 0;
+        auto Take = [&](size_t bytes) -> const u8*
+        {
+            if (bytes > size - offset)
+                return nullptr;
+
+            const u8* section = data + offset;
+            offset += bytes;
+            return section;
+        };
+
+        chunkHeader = reinterpret_cast<const ChunkHeader*>(Take(sizeof(ChunkHeader)));
+        heightHeader = reinterpret_cast<const HeightHeader*>(Take(sizeof(HeightHeader)));
+        heightBox = reinterpret_cast<const HeightBox*>(Take(sizeof(HeightBox)));
+        cells = reinterpret_cast<const Cell*>(Take(sizeof(Cell) * MAP_CELLS_PER_CHUNK));
+
+        const u8* alphaMapStringIDData = Take(sizeof(u32));
+        const u8* numMapObjectPlacementsData = Take(sizeof(u32));
+        if (chunkHeader == nullptr || heightHeader == nullptr || heightBox == nullptr || cells == nullptr || alphaMapStringIDData == nullptr || numMapObjectPlacementsData == nullptr)
+            return false;
+
+        // These two aren't packed structs, so read them through memcpy instead of unaligned pointers
+        memcpy(&alphaMapStringID, alphaMapStringIDData, sizeof(u32));
+        memcpy(&numMapObjectPlacements, numMapObjectPlacementsData, sizeof(u32));
+
+        mapObjectPlacements = nullptr;
+        if (numMapObjectPlacements > 0)
+        {
+            if (numMapObjectPlacements > (size - offset) / sizeof(MapObjectPlacement))
+                return false;
+
+            mapObjectPlacements = reinterpret_cast<const MapObjectPlacement*>(Take(sizeof(MapObjectPlacement) * numMapObjectPlacements));
+        }
+
+        stringTableData = data + offset;
+        stringTableSize = size - offset;
+        return true;
+    }
+
+    void ChunkView::Decode(Chunk& chunk) const
+    {
+        memcpy(&chunk.chunkHeader, chunkHeader, sizeof(ChunkHeader));
+        memcpy(&chunk.heightHeader, heightHeader, sizeof(HeightHeader));
+        memcpy(&chunk.heightBox, heightBox, sizeof(HeightBox));
+        memcpy(&chunk.cells[0], cells, sizeof(Cell) * MAP_CELLS_PER_CHUNK);
+        chunk.alphaMapStringID = alphaMapStringID;
+
+        chunk.mapObjectPlacements.resize(numMapObjectPlacements);
+        if (numMapObjectPlacements > 0)
+        {
+            memcpy(&chunk.mapObjectPlacements[0], mapObjectPlacements, sizeof(MapObjectPlacement) * numMapObjectPlacements);
+        }
+    }
+}
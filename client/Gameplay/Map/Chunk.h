@@ -93,4 +93,29 @@ namespace Terrain
         std::vector<MapObjectPlacement> mapObjectPlacements;
     };
 #pragma pack(pop)
+
+    // Typed view over a .nmap file that is already in memory, like a mapped file, nothing is copied until Decode
+    // The pointers point into that memory, so the view is only valid for as long as it is
+    struct ChunkView
+    {
+        const ChunkHeader* chunkHeader = nullptr;
+
+        const HeightHeader* heightHeader = nullptr;
+        const HeightBox* heightBox = nullptr;
+
+        const Cell* cells = nullptr;
+        u32 alphaMapStringID = 0;
+
+        const MapObjectPlacement* mapObjectPlacements = nullptr;
+        u32 numMapObjectPlacements = 0;
+
+        const u8* stringTableData = nullptr;
+        size_t stringTableSize = 0;
+
+        // Only checks that every section fits in size, the token and version are left to the caller
+        bool Parse(const u8* data, size_t size);
+
+        // Copies everything but the string table into chunk
+        void Decode(Chunk& chunk) const;
+    };
 }
\ No newline at end of file
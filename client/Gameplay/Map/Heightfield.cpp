@@ -0,0 +1,174 @@
+#include "Heightfield.h"
+#include <algorithm>
+#include <limits>
+
+namespace Terrain
+{
+    Heightfield::Heightfield()
+    {
+        Clear();
+    }
+
+    void Heightfield::Clear()
+    {
+        _chunks.clear();
+        _chunks.resize(MAP_CHUNKS_PER_MAP);
+        _lastUsedFrames.assign(MAP_CHUNKS_PER_MAP, 0);
+        _pinnedFrames.assign(MAP_CHUNKS_PER_MAP, 0);
+        _numChunks = 0;
+        _residencyFrame = 1;
+    }
+
+    f32 Heightfield::SetChunk(u16 chunkID, const Chunk& chunk)
+    {
+        std::unique_ptr<HeightfieldChunk>& heightfieldChunkPtr = _chunks[chunkID];
+        if (!heightfieldChunkPtr)
+        {
+            heightfieldChunkPtr = std::make_unique<HeightfieldChunk>();
+            _numChunks++;
+        }
+
+        // A chunk that was just loaded counts as used, otherwise the next eviction could drop it before anyone got to read it
+        _lastUsedFrames[chunkID] = _residencyFrame;
+
+        HeightfieldChunk& heightfieldChunk = *heightfieldChunkPtr;
+
+        f32 minHeight = std::numeric_limits<f32>::max();
+        f32 maxHeight = std::numeric_limits<f32>::lowest();
+        for (u32 i = 0; i < MAP_CELLS_PER_CHUNK; i++)
+        {
+            for (u32 j = 0; j < MAP_CELL_TOTAL_GRID_SIZE; j++)
+            {
+                minHeight = glm::min(minHeight, chunk.cells[i].heightData[j]);
+                maxHeight = glm::max(maxHeight, chunk.cells[i].heightData[j]);
+            }
+        }
+
+        heightfieldChunk.heightOffset = minHeight;
+        heightfieldChunk.heightScale = (maxHeight - minHeight) / 65535.0f;
+
+        const f32 inverseScale = heightfieldChunk.heightScale > 0.0f ? 1.0f / heightfieldChunk.heightScale : 0.0f;
+
+        f32 maxError = 0.0f;
+        for (u32 i = 0; i < MAP_CELLS_PER_CHUNK; i++)
+        {
+            const Cell& cell = chunk.cells[i];
+            for (u32 j = 0; j < MAP_CELL_TOTAL_GRID_SIZE; j++)
+            {
+                const f32 height = cell.heightData[j];
+                heightfieldChunk.heights[i][j] = static_cast<u16>(glm::clamp(glm::round((height - minHeight) * inverseScale), 0.0f, 65535.0f));
+                maxError = glm::max(maxError, glm::abs(heightfieldChunk.GetHeight(i, j) - height));
+            }
+
+            heightfieldChunk.holes[i] = cell.hole;
+        }
+
+        BuildMinMaxTree(heightfieldChunk);
+
+        return maxError;
+    }
+
+    void Heightfield::BuildMinMaxTree(HeightfieldChunk& chunk)
+    {
+        // The last level is built from the patches it covers, every level above it from its 4 children
+        constexpr u32 lastLevel = MIN_MAX_TREE_LEVELS - 1;
+        constexpr u32 lastLevelSide = 1 << lastLevel;
+        constexpr u32 patchesPerNode = MAP_PATCHES_PER_CHUNK_SIDE / lastLevelSide;
+        constexpr u32 patchesPerCell = MAP_CELL_OUTER_GRID_STRIDE - 1;
+
+        for (u32 y = 0; y < lastLevelSide; y++)
+        {
+            for (u32 x = 0; x < lastLevelSide; x++)
+            {
+                u16 minHeight = 0xFFFF;
+                u16 maxHeight = 0;
+
+                for (u32 patchY = y * patchesPerNode; patchY < (y + 1) * patchesPerNode; patchY++)
+                {
+                    for (u32 patchX = x * patchesPerNode; patchX < (x + 1) * patchesPerNode; patchX++)
+                    {
+                        const u16* cellHeights = chunk.heights[((patchY / patchesPerCell) * MAP_CELLS_PER_CHUNK_SIDE) + (patchX / patchesPerCell)];
+                        const u32 topLeft = ((patchY % patchesPerCell) * MAP_CELL_TOTAL_GRID_STRIDE) + (patchX % patchesPerCell);
+                        const u32 vertexIDs[5] = { topLeft, topLeft + 1, topLeft + MAP_CELL_OUTER_GRID_STRIDE, topLeft + MAP_CELL_TOTAL_GRID_STRIDE, topLeft + MAP_CELL_TOTAL_GRID_STRIDE + 1 };
+
+                        for (u32 vertexID : vertexIDs)
+                        {
+                            minHeight = glm::min(minHeight, cellHeights[vertexID]);
+                            maxHeight = glm::max(maxHeight, cellHeights[vertexID]);
+                        }
+                    }
+                }
+
+                u16* node = chunk.minMaxTree[HeightfieldChunk::GetMinMaxNodeIndex(lastLevel, x, y)];
+                node[0] = minHeight;
+                node[1] = maxHeight;
+            }
+        }
+
+        for (i32 level = lastLevel - 1; level >= 0; level--)
+        {
+            const u32 side = 1 << level;
+            for (u32 y = 0; y < side; y++)
+            {
+                for (u32 x = 0; x < side; x++)
+                {
+                    u16 minHeight = 0xFFFF;
+                    u16 maxHeight = 0;
+
+                    for (u32 child = 0; child < 4; child++)
+                    {
+                        const u16* childNode = chunk.minMaxTree[HeightfieldChunk::GetMinMaxNodeIndex(level + 1, (x * 2) + (child & 1), (y * 2) + (child >> 1))];
+                        minHeight = glm::min(minHeight, childNode[0]);
+                        maxHeight = glm::max(maxHeight, childNode[1]);
+                    }
+
+                    u16* node = chunk.minMaxTree[HeightfieldChunk::GetMinMaxNodeIndex(level, x, y)];
+                    node[0] = minHeight;
+                    node[1] = maxHeight;
+                }
+            }
+        }
+    }
+
+    void Heightfield::RemoveChunk(u16 chunkID)
+    {
+        std::unique_ptr<HeightfieldChunk>& heightfieldChunk = _chunks[chunkID];
+        if (!heightfieldChunk)
+            return;
+
+        heightfieldChunk.reset();
+        _numChunks--;
+    }
+
+    u32 Heightfield::EvictLeastRecentlyUsed(size_t budgetBytes)
+    {
+        if (GetResidentBytes() <= budgetBytes)
+            return 0;
+
+        _evictionCandidates.clear();
+        for (u32 i = 0; i < MAP_CHUNKS_PER_MAP; i++)
+        {
+            if (_chunks[i] && _lastUsedFrames[i] != _residencyFrame)
+            {
+                _evictionCandidates.push_back(static_cast<u16>(i));
+            }
+        }
+
+        std::sort(_evictionCandidates.begin(), _evictionCandidates.end(), [this](u16 a, u16 b)
+        {
+            return _lastUsedFrames[a] < _lastUsedFrames[b];
+        });
+
+        u32 numEvicted = 0;
+        for (u16 chunkID : _evictionCandidates)
+        {
+            if (GetResidentBytes() <= budgetBytes)
+                break;
+
+            RemoveChunk(chunkID);
+            numEvicted++;
+        }
+
+        return numEvicted;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <memory>
+
+#include "Chunk.h"
+
+namespace Terrain
+{
+    constexpr u32 MAP_PATCHES_PER_CHUNK_SIDE = MAP_CELLS_PER_CHUNK_SIDE * (MAP_CELL_OUTER_GRID_STRIDE - 1);
+
+    // Levels of the min/max tree of a chunk, level 0 is the whole chunk and every level halves the node size down to 2x2 patches
+    constexpr u32 MIN_MAX_TREE_LEVELS = 7;
+    constexpr u32 MIN_MAX_TREE_NODES = ((1 << (2 * MIN_MAX_TREE_LEVELS)) - 1) / 3;
+
+    // What gameplay needs of a chunk, heights are 16 bit steps of heightScale over heightOffset which is the lowest height of the chunk
+    struct HeightfieldChunk
+    {
+        f32 heightOffset = 0.0f;
+        f32 heightScale = 0.0f;
+
+        u16 heights[MAP_CELLS_PER_CHUNK][MAP_CELL_TOTAL_GRID_SIZE] = { { 0 } };
+        u16 holes[MAP_CELLS_PER_CHUNK] = { 0 }; // Same 4x4 bitmask per cell as Cell::hole
+
+        // Lowest and highest quantized height under every node, the levels are stored one after another with their nodes in rows
+        // The level below the last one would be single patches, their bounds come straight from the 5 heights of the patch instead
+        u16 minMaxTree[MIN_MAX_TREE_NODES][2] = { { 0 } };
+
+        f32 GetHeight(u32 cellID, u32 vertexID) const { return heightOffset + (heights[cellID][vertexID] * heightScale); }
+        f32 Dequantize(u16 height) const { return heightOffset + (height * heightScale); }
+
+        static u32 GetMinMaxNodeIndex(u32 level, u32 x, u32 y) { return (((1 << (2 * level)) - 1) / 3) + (y << level) + x; }
+    };
+
+    // Compact CPU side terrain for gameplay queries like MapUtils, so the full Chunks can be released once the renderer uploaded them
+    // Chunks are found through a flat 64x64 grid instead of a hash map, each one is its own allocation so evicting it gives the memory back
+    class Heightfield
+    {
+    public:
+        Heightfield();
+
+        void Clear();
+
+        // Replaces whatever chunkID had before, returns how far off the quantized heights are at most
+        f32 SetChunk(u16 chunkID, const Chunk& chunk);
+        void RemoveChunk(u16 chunkID);
+
+        const HeightfieldChunk* GetChunk(u32 chunkID) const
+        {
+            if (chunkID >= MAP_CHUNKS_PER_MAP)
+                return nullptr;
+
+            return _chunks[chunkID].get();
+        }
+
+        bool HasChunk(u32 chunkID) const { return GetChunk(chunkID) != nullptr; }
+        u32 GetNumChunks() const { return _numChunks; }
+        size_t GetResidentBytes() const { return (sizeof(std::unique_ptr<HeightfieldChunk>) * _chunks.size()) + (sizeof(HeightfieldChunk) * _numChunks); }
+
+        // Residency, chunks touched or pinned since the last BeginResidencyFrame are never evicted
+        void BeginResidencyFrame() { _residencyFrame++; }
+        void Touch(u16 chunkID) { _lastUsedFrames[chunkID] = _residencyFrame; }
+        void Pin(u16 chunkID) { _lastUsedFrames[chunkID] = _residencyFrame; _pinnedFrames[chunkID] = _residencyFrame; }
+        bool IsPinned(u16 chunkID) const { return _pinnedFrames[chunkID] == _residencyFrame; }
+
+        // Removes the least recently touched chunks until no more than budgetBytes are resident, returns how many it removed
+        u32 EvictLeastRecentlyUsed(size_t budgetBytes);
+
+    private:
+        static void BuildMinMaxTree(HeightfieldChunk& chunk);
+
+        std::vector<std::unique_ptr<HeightfieldChunk>> _chunks; // One per chunk of the map, null if it isn't resident
+        std::vector<u32> _lastUsedFrames;
+        std::vector<u32> _pinnedFrames;
+        std::vector<u16> _evictionCandidates;
+
+        u32 _numChunks = 0;
+        u32 _residencyFrame = 1;
+    };
+}
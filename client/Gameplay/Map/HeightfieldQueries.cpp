@@ -0,0 +1,357 @@
+#include "HeightfieldQueries.h"
+#include <Utils/DebugHandler.h>
+#include <Utils/Timer.h>
+#include <Containers/StringTable.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "../../Utils/MapUtils.h"
+#include "../../Utils/RadixSort.h"
+#include "../../Utils/MappedFile.h"
+#include "../../Loaders/Map/MapLoader.h"
+
+namespace Terrain
+{
+    constexpr u16 CHUNK_ID_INVALID = 0xFFFF; // Sorts after every real chunk
+
+    enum PatchTriangle : u32
+    {
+        PATCH_TRIANGLE_NORTH,
+        PATCH_TRIANGLE_EAST,
+        PATCH_TRIANGLE_SOUTH,
+        PATCH_TRIANGLE_WEST
+    };
+
+    void QueryHeights(const Heightfield& heightfield, const vec3* positions, size_t count, f32* heights, vec3* normals, u32* triangleIDs, HeightQueryScratch& scratch)
+    {
+        if (count == 0)
+            return;
+
+        scratch.chunkIDs.resize(count);
+        scratch.order.resize(count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const vec2 chunkPos = MapUtils::GetChunkFromAdtPosition(MapUtils::WorldPositionToADTCoordinates(positions[i]));
+            const bool isInsideMap = chunkPos.x >= 0.0f && chunkPos.y >= 0.0f && chunkPos.x < MAP_CHUNKS_PER_MAP_STRIDE && chunkPos.y < MAP_CHUNKS_PER_MAP_STRIDE;
+
+            scratch.chunkIDs[i] = isInsideMap ? static_cast<u16>(MapUtils::GetChunkIdFromChunkPos(chunkPos)) : CHUNK_ID_INVALID;
+            scratch.order[i] = static_cast<u32>(i);
+        }
+
+        // Queries of the same chunk end up next to each other, so each chunk is looked up once and its heights stay in cache while they are resolved
+        RadixSort::SortByKey16(scratch.chunkIDs.data(), scratch.order.data(), count, scratch.sortChunkIDs, scratch.sortOrder);
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 chunkSize = _mm_set1_ps(MAP_CHUNK_SIZE);
+        const __m128 cellSize = _mm_set1_ps(MAP_CELL_SIZE);
+        const __m128 patchSize = _mm_set1_ps(MAP_PATCH_SIZE);
+        const __m128 patchHalfSize = _mm_set1_ps(MAP_PATCH_HALF_SIZE);
+        const __m128 cellsToPatches = _mm_set1_ps(MAP_CELL_SIZE / MAP_PATCH_SIZE);
+        const __m128 chunksToCells = _mm_set1_ps(MAP_CHUNK_SIZE / MAP_CELL_SIZE);
+        const __m128 maxCell = _mm_set1_ps(static_cast<f32>(MAP_CELLS_PER_CHUNK_SIDE - 1));
+        const __m128 maxPatch = _mm_set1_ps(static_cast<f32>(MAP_CELL_OUTER_GRID_STRIDE - 2));
+
+        // The center is a and every triangle has the same winding, so the barycentric determinant is the same for all of them
+        const __m128 inverseDeterminant = _mm_set1_ps(2.0f / (MAP_PATCH_SIZE * MAP_PATCH_SIZE));
+
+        u16 cachedChunkID = CHUNK_ID_INVALID;
+        const HeightfieldChunk* cachedChunk = nullptr;
+
+        for (size_t base = 0; base < count; base += 4)
+        {
+            const size_t numLanes = glm::min(count - base, static_cast<size_t>(4));
+
+            alignas(16) f32 chunkPosX[4];
+            alignas(16) f32 chunkPosY[4];
+            u16 laneChunkIDs[4];
+
+            // The last group repeats its final query in the lanes it doesn't have, their results are never written
+            for (u32 lane = 0; lane < 4; lane++)
+            {
+                const size_t index = base + glm::min(static_cast<size_t>(lane), numLanes - 1);
+                const vec2 chunkPos = MapUtils::GetChunkFromAdtPosition(MapUtils::WorldPositionToADTCoordinates(positions[scratch.order[index]]));
+
+                chunkPosX[lane] = chunkPos.x;
+                chunkPosY[lane] = chunkPos.y;
+                laneChunkIDs[lane] = scratch.chunkIDs[index];
+            }
+
+            // Same steps as GetHeightFromWorldPosition, chunk remainder to cell to patch, the positions inside the map are never negative so truncating floors them
+            __m128 chunkX = _mm_load_ps(chunkPosX);
+            __m128 chunkY = _mm_load_ps(chunkPosY);
+            __m128 chunkRemainderX = _mm_sub_ps(chunkX, _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(chunkX, zero))));
+            __m128 chunkRemainderY = _mm_sub_ps(chunkY, _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(chunkY, zero))));
+
+            __m128 cellPosX = _mm_mul_ps(chunkRemainderX, chunksToCells);
+            __m128 cellPosY = _mm_mul_ps(chunkRemainderY, chunksToCells);
+            __m128 cellX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(cellPosX, zero))), maxCell);
+            __m128 cellY = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(cellPosY, zero))), maxCell);
+
+            __m128 patchPosX = _mm_mul_ps(_mm_sub_ps(cellPosX, cellX), cellsToPatches);
+            __m128 patchPosY = _mm_mul_ps(_mm_sub_ps(cellPosY, cellY), cellsToPatches);
+            __m128 patchX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(patchPosX, zero))), maxPatch);
+            __m128 patchY = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_max_ps(patchPosY, zero))), maxPatch);
+
+            // Position inside the patch in yards
+            __m128 u = _mm_mul_ps(_mm_sub_ps(patchPosX, patchX), patchSize);
+            __m128 v = _mm_mul_ps(_mm_sub_ps(patchPosY, patchY), patchSize);
+
+            // The diagonals of the patch split it into 4 triangles around the center, ties go north, east, south, west like in IsPointInTriangle order
+            __m128 diagonal1 = _mm_sub_ps(v, u);
+            __m128 diagonal2 = _mm_sub_ps(_mm_add_ps(u, v), patchSize);
+
+            __m128 isNorth = _mm_and_ps(_mm_cmple_ps(diagonal1, zero), _mm_cmple_ps(diagonal2, zero));
+            __m128 isEast = _mm_andnot_ps(isNorth, _mm_cmple_ps(diagonal1, zero));
+            __m128 isSouth = _mm_andnot_ps(_mm_or_ps(isNorth, isEast), _mm_cmpge_ps(diagonal2, zero));
+            __m128 isWest = _mm_andnot_ps(_mm_or_ps(_mm_or_ps(isNorth, isEast), isSouth), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+            // b and c are corners of the patch, north is top left to top right and the others follow clockwise
+            __m128 bX = _mm_and_ps(_mm_or_ps(isEast, isSouth), patchSize);
+            __m128 bY = _mm_and_ps(_mm_or_ps(isSouth, isWest), patchSize);
+            __m128 cX = _mm_and_ps(_mm_or_ps(isNorth, isEast), patchSize);
+            __m128 cY = bX;
+
+            __m128i triangle = _mm_or_si128(_mm_and_si128(_mm_castps_si128(isEast), _mm_set1_epi32(PATCH_TRIANGLE_EAST)), _mm_and_si128(_mm_castps_si128(isSouth), _mm_set1_epi32(PATCH_TRIANGLE_SOUTH)));
+            triangle = _mm_or_si128(triangle, _mm_and_si128(_mm_castps_si128(isWest), _mm_set1_epi32(PATCH_TRIANGLE_WEST)));
+
+            // SSE2 has no 32 bit multiply, the strides are 16 and 17 so shifts do
+            static_assert(MAP_CELLS_PER_CHUNK_SIDE == 16 && MAP_CELL_TOTAL_GRID_STRIDE == 17, "the cell and vertex strides are multiplied with shifts");
+            const __m128i patchXInt = _mm_cvttps_epi32(patchX);
+            const __m128i patchYInt = _mm_cvttps_epi32(patchY);
+
+            __m128i cellID = _mm_add_epi32(_mm_cvttps_epi32(cellX), _mm_slli_epi32(_mm_cvttps_epi32(cellY), 4));
+            __m128i topLeftVertex = _mm_add_epi32(_mm_add_epi32(patchXInt, patchYInt), _mm_slli_epi32(patchYInt, 4));
+            __m128i patchID = _mm_add_epi32(patchXInt, _mm_slli_epi32(patchYInt, 3));
+
+            alignas(16) u32 laneCellIDs[4];
+            alignas(16) u32 laneTopLeftVertices[4];
+            alignas(16) u32 lanePatchIDs[4];
+            alignas(16) u32 laneTriangles[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(laneCellIDs), cellID);
+            _mm_store_si128(reinterpret_cast<__m128i*>(laneTopLeftVertices), topLeftVertex);
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanePatchIDs), patchID);
+            _mm_store_si128(reinterpret_cast<__m128i*>(laneTriangles), triangle);
+
+            // Fetching the heights is the only part that can't be done 4 wide without a gather
+            alignas(16) f32 heightA[4];
+            alignas(16) f32 heightB[4];
+            alignas(16) f32 heightC[4];
+            bool laneIsValid[4];
+
+            for (u32 lane = 0; lane < 4; lane++)
+            {
+                if (laneChunkIDs[lane] != cachedChunkID)
+                {
+                    cachedChunkID = laneChunkIDs[lane];
+                    cachedChunk = cachedChunkID != CHUNK_ID_INVALID ? heightfield.GetChunk(cachedChunkID) : nullptr;
+                }
+
+                laneIsValid[lane] = cachedChunk != nullptr;
+                if (!laneIsValid[lane])
+                {
+                    heightA[lane] = 0.0f;
+                    heightB[lane] = 0.0f;
+                    heightC[lane] = 0.0f;
+                    continue;
+                }
+
+                const u32 topLeft = laneTopLeftVertices[lane];
+                const u32 topRight = topLeft + 1;
+                const u32 bottomLeft = topLeft + MAP_CELL_TOTAL_GRID_STRIDE;
+                const u32 bottomRight = bottomLeft + 1;
+                const u32 corners[5] = { topLeft, topRight, bottomRight, bottomLeft, topLeft };
+
+                const u32 cell = laneCellIDs[lane];
+                const u32 triangleIndex = laneTriangles[lane];
+
+                heightA[lane] = cachedChunk->GetHeight(cell, topLeft + MAP_CELL_OUTER_GRID_STRIDE);
+                heightB[lane] = cachedChunk->GetHeight(cell, corners[triangleIndex]);
+                heightC[lane] = cachedChunk->GetHeight(cell, corners[triangleIndex + 1]);
+            }
+
+            // Barycentric interpolation like GetHeightFromVertexIds, with a at the center of the patch
+            __m128 uMinusCX = _mm_sub_ps(u, cX);
+            __m128 vMinusCY = _mm_sub_ps(v, cY);
+            __m128 bYMinusCY = _mm_sub_ps(bY, cY);
+            __m128 cXMinusBX = _mm_sub_ps(cX, bX);
+            __m128 cYMinusAY = _mm_sub_ps(cY, patchHalfSize);
+            __m128 aXMinusCX = _mm_sub_ps(patchHalfSize, cX);
+
+            __m128 alpha = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(bYMinusCY, uMinusCX), _mm_mul_ps(cXMinusBX, vMinusCY)), inverseDeterminant);
+            __m128 beta = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cYMinusAY, uMinusCX), _mm_mul_ps(aXMinusCX, vMinusCY)), inverseDeterminant);
+            __m128 gamma = _mm_sub_ps(_mm_sub_ps(one, alpha), beta);
+
+            __m128 a = _mm_load_ps(heightA);
+            __m128 b = _mm_load_ps(heightB);
+            __m128 c = _mm_load_ps(heightC);
+
+            alignas(16) f32 laneHeights[4];
+            _mm_store_ps(laneHeights, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, alpha), _mm_mul_ps(b, beta)), _mm_mul_ps(c, gamma)));
+
+            alignas(16) f32 laneNormalX[4];
+            alignas(16) f32 laneNormalZ[4];
+            alignas(16) f32 laneNormalY[4];
+            if (normals != nullptr)
+            {
+                // The slope of the triangle along the patch axes, world X runs against the patch V axis and world Z against U
+                __m128 aMinusC = _mm_sub_ps(a, c);
+                __m128 bMinusC = _mm_sub_ps(b, c);
+                __m128 slopeU = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(aMinusC, bYMinusCY), _mm_mul_ps(bMinusC, cYMinusAY)), inverseDeterminant);
+                __m128 slopeV = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(aMinusC, cXMinusBX), _mm_mul_ps(bMinusC, aXMinusCX)), inverseDeterminant);
+
+                __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(slopeU, slopeU), _mm_mul_ps(slopeV, slopeV)), one)));
+
+                _mm_store_ps(laneNormalX, _mm_mul_ps(slopeV, inverseLength));
+                _mm_store_ps(laneNormalY, inverseLength);
+                _mm_store_ps(laneNormalZ, _mm_mul_ps(slopeU, inverseLength));
+            }
+
+            for (u32 lane = 0; lane < numLanes; lane++)
+            {
+                const u32 index = scratch.order[base + lane];
+                const bool isValid = laneIsValid[lane];
+
+                heights[index] = isValid ? laneHeights[lane] : 0.0f;
+
+                if (normals != nullptr)
+                {
+                    normals[index] = isValid ? vec3(laneNormalX[lane], laneNormalY[lane], laneNormalZ[lane]) : vec3(0.0f, 1.0f, 0.0f);
+                }
+
+                if (triangleIDs != nullptr)
+                {
+                    triangleIDs[index] = isValid ? MakeTriangleID(laneChunkIDs[lane], laneCellIDs[lane], lanePatchIDs[lane], laneTriangles[lane]) : TRIANGLE_ID_INVALID;
+                }
+            }
+        }
+    }
+
+    bool LoadBenchmarkHeightfield(const std::string& mapInternalName, Heightfield& heightfield, std::vector<u16>& loadedChunkIDs)
+    {
+        ChunkIndex::ChunkLocations locations;
+        MappedFile archiveFile;
+        if (!MapLoader::FindChunkLocations(mapInternalName, locations, archiveFile))
+            return false;
+
+        // A block of up to 8x8 chunks around the middle chunk of the map, that is plenty to fall out of cache without loading the whole map
+        std::vector<u16> chunkIDs;
+        chunkIDs.reserve(locations.size());
+        for (const auto& itr : locations)
+        {
+            chunkIDs.push_back(itr.first);
+        }
+        std::sort(chunkIDs.begin(), chunkIDs.end());
+
+        const u16 centerChunkID = chunkIDs[chunkIDs.size() / 2];
+        const i32 centerX = centerChunkID % MAP_CHUNKS_PER_MAP_STRIDE;
+        const i32 centerY = centerChunkID / MAP_CHUNKS_PER_MAP_STRIDE;
+
+        std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>();
+        StringTable stringTable;
+
+        for (i32 y = glm::max(centerY - 4, 0); y < glm::min(centerY + 4, static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE)); y++)
+        {
+            for (i32 x = glm::max(centerX - 4, 0); x < glm::min(centerX + 4, static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE)); x++)
+            {
+                const u16 chunkID = static_cast<u16>(x + (y * MAP_CHUNKS_PER_MAP_STRIDE));
+
+                auto locationItr = locations.find(chunkID);
+                if (locationItr == locations.end())
+                    continue;
+
+                stringTable.Clear();
+                if (!MapLoader::LoadChunk(locationItr->second, archiveFile, *chunk, stringTable))
+                    continue;
+
+                heightfield.SetChunk(chunkID, *chunk);
+                loadedChunkIDs.push_back(chunkID);
+            }
+        }
+
+        if (loadedChunkIDs.empty())
+        {
+            NC_LOG_ERROR("Failed to load any chunks of %s to benchmark on", mapInternalName.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    vec3 RandomPositionOnChunks(const std::vector<u16>& loadedChunkIDs, std::mt19937& random)
+    {
+        std::uniform_int_distribution<size_t> chunkDistribution(0, loadedChunkIDs.size() - 1);
+        std::uniform_real_distribution<f32> offsetDistribution(0.0f, MAP_CHUNK_SIZE);
+
+        const u16 chunkID = loadedChunkIDs[chunkDistribution(random)];
+        const vec2 adtPosition = vec2(((chunkID % MAP_CHUNKS_PER_MAP_STRIDE) * MAP_CHUNK_SIZE) + offsetDistribution(random), ((chunkID / MAP_CHUNKS_PER_MAP_STRIDE) * MAP_CHUNK_SIZE) + offsetDistribution(random));
+
+        // The inverse of MapUtils::WorldPositionToADTCoordinates
+        return vec3(MAP_HALF_SIZE - adtPosition.y, 0.0f, MAP_HALF_SIZE - adtPosition.x);
+    }
+
+    void BenchmarkHeightQueries(const std::string& mapInternalName)
+    {
+        Heightfield heightfield;
+        std::vector<u16> loadedChunkIDs;
+        if (!LoadBenchmarkHeightfield(mapInternalName, heightfield, loadedChunkIDs))
+            return;
+
+        NC_LOG_MESSAGE("Benchmarking height queries on %u chunks of %s", static_cast<u32>(loadedChunkIDs.size()), mapInternalName.c_str());
+
+        std::mt19937 random(1337);
+        HeightQueryScratch scratch;
+
+        const size_t pointCounts[] = { 1000, 10000, 100000 };
+        for (size_t pointCount : pointCounts)
+        {
+            std::vector<vec3> positions(pointCount);
+            for (vec3& position : positions)
+            {
+                position = RandomPositionOnChunks(loadedChunkIDs, random);
+            }
+
+            std::vector<f32> scalarHeights(pointCount);
+            std::vector<f32> batchedHeights(pointCount);
+            std::vector<vec3> normals(pointCount);
+            std::vector<u32> triangleIDs(pointCount);
+
+            // Every size runs about a million queries so the small ones aren't lost in timer noise, the first run of both only warms up
+            const size_t numRuns = glm::max(static_cast<size_t>(1000000) / pointCount, static_cast<size_t>(1));
+
+            f32 scalarTime = 0.0f;
+            f32 batchedTime = 0.0f;
+            for (size_t run = 0; run <= numRuns; run++)
+            {
+                Timer scalarTimer;
+                for (size_t i = 0; i < pointCount; i++)
+                {
+                    scalarHeights[i] = MapUtils::GetHeightFromWorldPosition(heightfield, positions[i]);
+                }
+                const f32 scalarRunTime = scalarTimer.GetLifeTime();
+
+                Timer batchedTimer;
+                QueryHeights(heightfield, positions.data(), pointCount, batchedHeights.data(), normals.data(), triangleIDs.data(), scratch);
+                const f32 batchedRunTime = batchedTimer.GetLifeTime();
+
+                if (run > 0)
+                {
+                    scalarTime += scalarRunTime;
+                    batchedTime += batchedRunTime;
+                }
+            }
+
+            f32 maxDifference = 0.0f;
+            for (size_t i = 0; i < pointCount; i++)
+            {
+                maxDifference = glm::max(maxDifference, glm::abs(scalarHeights[i] - batchedHeights[i]));
+            }
+
+            const f32 numQueries = static_cast<f32>(pointCount * numRuns);
+            NC_LOG_MESSAGE("%u points: %.1f ns per point scalar, %.1f ns per point batched (%.2fx), heights differ by up to %.5f yards", static_cast<u32>(pointCount), (scalarTime / numQueries) * 1e9f, (batchedTime / numQueries) * 1e9f, scalarTime / glm::max(batchedTime, 1e-9f), maxDifference);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <string>
+#include <random>
+
+#include "Heightfield.h"
+
+namespace Terrain
+{
+    constexpr u32 TRIANGLE_ID_INVALID = 0xFFFFFFFF;
+
+    // Which of the 4 triangles of which patch of which cell, the triangles go north, east, south, west like in MapUtils::GetVertexIDsFromPatchPos
+    inline u32 MakeTriangleID(u32 chunkID, u32 cellID, u32 patchID, u32 triangle) { return (chunkID << 16) | (cellID << 8) | (patchID << 2) | triangle; }
+
+    // Kept by the caller so batches stop allocating once they reached their size
+    struct HeightQueryScratch
+    {
+        std::vector<u16> chunkIDs;
+        std::vector<u32> order;
+        std::vector<u16> sortChunkIDs;
+        std::vector<u32> sortOrder;
+    };
+
+    // Batched MapUtils::GetHeightFromWorldPosition, normals and triangleIDs can be null if they aren't needed
+    // Positions are grouped by chunk first and then resolved 4 at a time, positions without a resident chunk get height 0 and TRIANGLE_ID_INVALID
+    void QueryHeights(const Heightfield& heightfield, const vec3* positions, size_t count, f32* heights, vec3* normals, u32* triangleIDs, HeightQueryScratch& scratch);
+
+    // Loads a block of up to 8x8 chunks around the middle of a map into heightfield, for benchmarks that shouldn't touch the current map
+    bool LoadBenchmarkHeightfield(const std::string& mapInternalName, Heightfield& heightfield, std::vector<u16>& loadedChunkIDs);
+
+    // A random world position on one of loadedChunkIDs with a height of 0, what the benchmarks place their queries at
+    vec3 RandomPositionOnChunks(const std::vector<u16>& loadedChunkIDs, std::mt19937& random);
+
+    // Loads part of a map into its own heightfield and times QueryHeights against GetHeightFromWorldPosition for 1k, 10k and 100k points
+    void BenchmarkHeightQueries(const std::string& mapInternalName);
+}
@@ -0,0 +1,448 @@
+#include "HeightfieldRaycast.h"
+#include <Utils/DebugHandler.h>
+#include <Utils/Timer.h>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Map.h"
+#include "HeightfieldQueries.h"
+#include "../../Utils/MapUtils.h"
+
+namespace Terrain
+{
+    namespace
+    {
+        // Keeps rays that run along a node border from slipping between two nodes, and covers the rounding of the patch positions
+        constexpr f32 BOUNDS_EPSILON = 0.01f;
+
+        constexpr u32 PATCHES_PER_CELL = MAP_CELL_OUTER_GRID_STRIDE - 1;
+
+        // x and y are ADT coordinates like MapUtils::WorldPositionToADTCoordinates gives and z is the height
+        // That is only a rotation of world space, so distances along the ray and cross products carry over unchanged
+        vec3 WorldToLocalPosition(const vec3& position) { return vec3(MAP_HALF_SIZE - position.z, MAP_HALF_SIZE - position.x, position.y); }
+        vec3 WorldToLocalDirection(const vec3& direction) { return vec3(-direction.z, -direction.x, direction.y); }
+        vec3 LocalToWorldDirection(const vec3& direction) { return vec3(-direction.y, direction.z, -direction.x); }
+
+        struct LocalRay
+        {
+            vec3 origin;
+            vec3 direction;
+            vec3 inverseDirection;
+        };
+
+        f32 SafeInverse(f32 value)
+        {
+            return glm::abs(value) > 1e-12f ? 1.0f / value : (value < 0.0f ? -1e30f : 1e30f);
+        }
+
+        bool IntersectBox(const LocalRay& ray, const vec3& min, const vec3& max, f32 tMin, f32 tMax, f32& tEnter)
+        {
+            const vec3 t0 = (min - ray.origin) * ray.inverseDirection;
+            const vec3 t1 = (max - ray.origin) * ray.inverseDirection;
+            const vec3 tNear = glm::min(t0, t1);
+            const vec3 tFar = glm::max(t0, t1);
+
+            tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, tMin));
+            const f32 tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+
+            return tEnter <= tExit;
+        }
+
+        // Moller-Trumbore, both sides of the triangle count as a hit
+        bool IntersectTriangle(const LocalRay& ray, const vec3& a, const vec3& b, const vec3& c, f32& t)
+        {
+            const vec3 edge1 = b - a;
+            const vec3 edge2 = c - a;
+
+            const vec3 p = glm::cross(ray.direction, edge2);
+            const f32 determinant = glm::dot(edge1, p);
+            if (glm::abs(determinant) < 1e-8f)
+                return false;
+
+            const f32 inverseDeterminant = 1.0f / determinant;
+
+            const vec3 s = ray.origin - a;
+            const f32 u = glm::dot(s, p) * inverseDeterminant;
+            if (u < 0.0f || u > 1.0f)
+                return false;
+
+            const vec3 q = glm::cross(s, edge1);
+            const f32 v = glm::dot(ray.direction, q) * inverseDeterminant;
+            if (v < 0.0f || u + v > 1.0f)
+                return false;
+
+            t = glm::dot(edge2, q) * inverseDeterminant;
+            return true;
+        }
+
+        struct ChunkHit
+        {
+            f32 t;
+            vec3 normal; // Local space, not normalized
+            u32 cellID;
+            u32 patchID;
+            u32 triangle;
+        };
+
+        // Tests the 4 triangles of a patch, patchX and patchY go over the whole chunk, tMax shrinks to the closest hit
+        bool IntersectPatch(const HeightfieldChunk& chunk, const LocalRay& ray, u32 patchX, u32 patchY, bool testBounds, f32 tMin, f32& tMax, ChunkHit& hit)
+        {
+            const u32 cellX = patchX / PATCHES_PER_CELL;
+            const u32 cellY = patchY / PATCHES_PER_CELL;
+            const u32 patchXInCell = patchX % PATCHES_PER_CELL;
+            const u32 patchYInCell = patchY % PATCHES_PER_CELL;
+            const u32 cellID = (cellY * MAP_CELLS_PER_CHUNK_SIDE) + cellX;
+
+            // Every bit of the hole mask covers 2x2 patches, the same way IsHoleVertex in terrain.inc.hlsl reads it
+            const u16 hole = chunk.holes[cellID];
+            if (hole != 0 && ((hole >> (((patchYInCell / 2) * 4) + (patchXInCell / 2))) & 1))
+                return false;
+
+            const u32 topLeftVertex = (patchYInCell * MAP_CELL_TOTAL_GRID_STRIDE) + patchXInCell;
+            const u16* cellHeights = chunk.heights[cellID];
+
+            const f32 topLeftHeight = chunk.Dequantize(cellHeights[topLeftVertex]);
+            const f32 topRightHeight = chunk.Dequantize(cellHeights[topLeftVertex + 1]);
+            const f32 centerHeight = chunk.Dequantize(cellHeights[topLeftVertex + MAP_CELL_OUTER_GRID_STRIDE]);
+            const f32 bottomLeftHeight = chunk.Dequantize(cellHeights[topLeftVertex + MAP_CELL_TOTAL_GRID_STRIDE]);
+            const f32 bottomRightHeight = chunk.Dequantize(cellHeights[topLeftVertex + MAP_CELL_TOTAL_GRID_STRIDE + 1]);
+
+            const f32 x = (cellX * MAP_CELL_SIZE) + (patchXInCell * MAP_PATCH_SIZE);
+            const f32 y = (cellY * MAP_CELL_SIZE) + (patchYInCell * MAP_PATCH_SIZE);
+
+            if (testBounds)
+            {
+                const f32 minHeight = glm::min(glm::min(glm::min(topLeftHeight, topRightHeight), glm::min(bottomLeftHeight, bottomRightHeight)), centerHeight);
+                const f32 maxHeight = glm::max(glm::max(glm::max(topLeftHeight, topRightHeight), glm::max(bottomLeftHeight, bottomRightHeight)), centerHeight);
+
+                f32 tEnter;
+                const vec3 min = vec3(x - BOUNDS_EPSILON, y - BOUNDS_EPSILON, minHeight - BOUNDS_EPSILON);
+                const vec3 max = vec3(x + MAP_PATCH_SIZE + BOUNDS_EPSILON, y + MAP_PATCH_SIZE + BOUNDS_EPSILON, maxHeight + BOUNDS_EPSILON);
+                if (!IntersectBox(ray, min, max, tMin, tMax, tEnter))
+                    return false;
+            }
+
+            // Corners in the north, east, south, west order of MapUtils::GetVertexIDsFromPatchPos, every triangle is the center and two neighbouring corners
+            const vec3 center = vec3(x + MAP_PATCH_HALF_SIZE, y + MAP_PATCH_HALF_SIZE, centerHeight);
+            const vec3 corners[5] =
+            {
+                vec3(x, y, topLeftHeight),
+                vec3(x + MAP_PATCH_SIZE, y, topRightHeight),
+                vec3(x + MAP_PATCH_SIZE, y + MAP_PATCH_SIZE, bottomRightHeight),
+                vec3(x, y + MAP_PATCH_SIZE, bottomLeftHeight),
+                vec3(x, y, topLeftHeight)
+            };
+
+            bool didHit = false;
+            for (u32 triangle = 0; triangle < 4; triangle++)
+            {
+                f32 t;
+                if (!IntersectTriangle(ray, center, corners[triangle], corners[triangle + 1], t) || t < tMin || t > tMax)
+                    continue;
+
+                tMax = t;
+
+                hit.t = t;
+                hit.normal = glm::cross(corners[triangle] - center, corners[triangle + 1] - center);
+                hit.cellID = cellID;
+                hit.patchID = (patchYInCell * PATCHES_PER_CELL) + patchXInCell;
+                hit.triangle = triangle;
+                didHit = true;
+            }
+
+            return didHit;
+        }
+
+        bool IntersectChunkTree(const HeightfieldChunk& chunk, const LocalRay& ray, f32 tMin, f32 tMax, ChunkHit& hit)
+        {
+            struct Node
+            {
+                u8 level;
+                u8 x;
+                u8 y;
+                f32 tEnter;
+            };
+
+            // Every node pushes at most 4 children and pops itself, so the stack never holds more than 3 per level plus the last 4
+            Node stack[(MIN_MAX_TREE_LEVELS * 3) + 4];
+            u32 stackSize = 0;
+
+            auto GetNodeBounds = [&chunk](u32 level, u32 x, u32 y, vec3& min, vec3& max)
+            {
+                const f32 nodeSize = MAP_CHUNK_SIZE / static_cast<f32>(1 << level);
+                const u16* node = chunk.minMaxTree[HeightfieldChunk::GetMinMaxNodeIndex(level, x, y)];
+
+                min = vec3((x * nodeSize) - BOUNDS_EPSILON, (y * nodeSize) - BOUNDS_EPSILON, chunk.Dequantize(node[0]) - BOUNDS_EPSILON);
+                max = vec3(((x + 1) * nodeSize) + BOUNDS_EPSILON, ((y + 1) * nodeSize) + BOUNDS_EPSILON, chunk.Dequantize(node[1]) + BOUNDS_EPSILON);
+            };
+
+            vec3 min;
+            vec3 max;
+            f32 tEnter;
+            GetNodeBounds(0, 0, 0, min, max);
+            if (!IntersectBox(ray, min, max, tMin, tMax, tEnter))
+                return false;
+
+            stack[stackSize++] = { 0, 0, 0, tEnter };
+
+            constexpr u32 lastLevel = MIN_MAX_TREE_LEVELS - 1;
+            constexpr u32 patchesPerNode = MAP_PATCHES_PER_CHUNK_SIDE >> lastLevel;
+
+            bool didHit = false;
+            while (stackSize > 0)
+            {
+                const Node node = stack[--stackSize];
+
+                // tMax shrinks with every hit, anything that starts behind the closest hit so far can't have a closer one
+                if (node.tEnter > tMax)
+                    continue;
+
+                if (node.level == lastLevel)
+                {
+                    for (u32 patchY = node.y * patchesPerNode; patchY < (node.y + 1u) * patchesPerNode; patchY++)
+                    {
+                        for (u32 patchX = node.x * patchesPerNode; patchX < (node.x + 1u) * patchesPerNode; patchX++)
+                        {
+                            didHit |= IntersectPatch(chunk, ray, patchX, patchY, true, tMin, tMax, hit);
+                        }
+                    }
+                    continue;
+                }
+
+                Node children[4];
+                u32 numChildren = 0;
+
+                for (u32 child = 0; child < 4; child++)
+                {
+                    const u32 childX = (node.x * 2) + (child & 1);
+                    const u32 childY = (node.y * 2) + (child >> 1);
+
+                    GetNodeBounds(node.level + 1, childX, childY, min, max);
+                    if (IntersectBox(ray, min, max, tMin, tMax, tEnter))
+                    {
+                        children[numChildren++] = { static_cast<u8>(node.level + 1), static_cast<u8>(childX), static_cast<u8>(childY), tEnter };
+                    }
+                }
+
+                // Farthest first onto the stack so the nearest child is popped next
+                std::sort(children, children + numChildren, [](const Node& a, const Node& b) { return a.tEnter > b.tEnter; });
+                for (u32 i = 0; i < numChildren; i++)
+                {
+                    stack[stackSize++] = children[i];
+                }
+            }
+
+            return didHit;
+        }
+
+        bool IntersectChunkBruteForce(const HeightfieldChunk& chunk, const LocalRay& ray, f32 tMin, f32 tMax, ChunkHit& hit)
+        {
+            bool didHit = false;
+            for (u32 patchY = 0; patchY < MAP_PATCHES_PER_CHUNK_SIDE; patchY++)
+            {
+                for (u32 patchX = 0; patchX < MAP_PATCHES_PER_CHUNK_SIDE; patchX++)
+                {
+                    didHit |= IntersectPatch(chunk, ray, patchX, patchY, false, tMin, tMax, hit);
+                }
+            }
+
+            return didHit;
+        }
+
+        // Walks the chunks under the ray in order with a 2D DDA, so the first chunk with a hit has the closest one
+        bool RaycastChunks(const Heightfield& heightfield, const vec3& origin, const vec3& direction, f32 maxDistance, bool bruteForce, RaycastHit& hit)
+        {
+            const f32 length = glm::length(direction);
+            if (length <= 0.0f || maxDistance <= 0.0f)
+                return false;
+
+            const vec3 worldDirection = direction / length;
+            const vec3 localOrigin = WorldToLocalPosition(origin);
+            const vec3 localDirection = WorldToLocalDirection(worldDirection);
+            const vec2 inverseDirection = vec2(SafeInverse(localDirection.x), SafeInverse(localDirection.y));
+
+            // Clip the ray to the map
+            f32 tMin = 0.0f;
+            f32 tMax = maxDistance;
+            for (u32 axis = 0; axis < 2; axis++)
+            {
+                const f32 t0 = (0.0f - localOrigin[axis]) * inverseDirection[axis];
+                const f32 t1 = (MAP_SIZE - localOrigin[axis]) * inverseDirection[axis];
+                tMin = glm::max(tMin, glm::min(t0, t1));
+                tMax = glm::min(tMax, glm::max(t0, t1));
+            }
+
+            if (tMin > tMax)
+                return false;
+
+            const vec2 start = vec2(localOrigin) + (vec2(localDirection) * tMin);
+            i32 chunkX = glm::clamp(static_cast<i32>(start.x / MAP_CHUNK_SIZE), 0, static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE) - 1);
+            i32 chunkY = glm::clamp(static_cast<i32>(start.y / MAP_CHUNK_SIZE), 0, static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE) - 1);
+
+            const i32 stepX = localDirection.x >= 0.0f ? 1 : -1;
+            const i32 stepY = localDirection.y >= 0.0f ? 1 : -1;
+            const f32 tDeltaX = glm::abs(MAP_CHUNK_SIZE * inverseDirection.x);
+            const f32 tDeltaY = glm::abs(MAP_CHUNK_SIZE * inverseDirection.y);
+            f32 tNextX = (((chunkX + (stepX > 0 ? 1 : 0)) * MAP_CHUNK_SIZE) - localOrigin.x) * inverseDirection.x;
+            f32 tNextY = (((chunkY + (stepY > 0 ? 1 : 0)) * MAP_CHUNK_SIZE) - localOrigin.y) * inverseDirection.y;
+
+            f32 tChunkEnter = tMin;
+            while (true)
+            {
+                const f32 tChunkExit = glm::min(glm::min(tNextX, tNextY), tMax);
+                const u16 chunkID = static_cast<u16>(chunkX + (chunkY * MAP_CHUNKS_PER_MAP_STRIDE));
+
+                const HeightfieldChunk* chunk = heightfield.GetChunk(chunkID);
+                if (chunk != nullptr)
+                {
+                    // The triangles are tested relative to the chunk, which keeps the floats small
+                    LocalRay ray;
+                    ray.origin = localOrigin - vec3(chunkX * MAP_CHUNK_SIZE, chunkY * MAP_CHUNK_SIZE, 0.0f);
+                    ray.direction = localDirection;
+                    ray.inverseDirection = vec3(inverseDirection, SafeInverse(localDirection.z));
+
+                    // A little past the chunk on both ends so hits right on a chunk border aren't lost to rounding
+                    const f32 tTestMin = glm::max(tChunkEnter - BOUNDS_EPSILON, tMin);
+                    const f32 tTestMax = glm::min(tChunkExit + BOUNDS_EPSILON, tMax);
+
+                    ChunkHit chunkHit;
+                    const bool didHit = bruteForce ? IntersectChunkBruteForce(*chunk, ray, tTestMin, tTestMax, chunkHit) : IntersectChunkTree(*chunk, ray, tTestMin, tTestMax, chunkHit);
+                    if (didHit)
+                    {
+                        vec3 normal = glm::normalize(LocalToWorldDirection(chunkHit.normal));
+                        if (normal.y < 0.0f)
+                        {
+                            normal = -normal;
+                        }
+
+                        hit.position = origin + (worldDirection * chunkHit.t);
+                        hit.normal = normal;
+                        hit.distance = chunkHit.t;
+                        hit.chunkID = chunkID;
+                        hit.cellID = static_cast<u16>(chunkHit.cellID);
+                        hit.triangleID = MakeTriangleID(chunkID, chunkHit.cellID, chunkHit.patchID, chunkHit.triangle);
+                        return true;
+                    }
+                }
+
+                if (tChunkExit >= tMax)
+                    break;
+
+                if (tNextX < tNextY)
+                {
+                    chunkX += stepX;
+                    tChunkEnter = tNextX;
+                    tNextX += tDeltaX;
+                }
+                else
+                {
+                    chunkY += stepY;
+                    tChunkEnter = tNextY;
+                    tNextY += tDeltaY;
+                }
+
+                if (chunkX < 0 || chunkY < 0 || chunkX >= static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE) || chunkY >= static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE))
+                    break;
+            }
+
+            return false;
+        }
+    }
+
+    bool Raycast(const Heightfield& heightfield, const vec3& origin, const vec3& direction, f32 maxDistance, RaycastHit& hit)
+    {
+        return RaycastChunks(heightfield, origin, direction, maxDistance, false, hit);
+    }
+
+    bool SegmentCast(const Heightfield& heightfield, const vec3& start, const vec3& end, RaycastHit& hit)
+    {
+        const vec3 segment = end - start;
+        return RaycastChunks(heightfield, start, segment, glm::length(segment), false, hit);
+    }
+
+    void BenchmarkRaycasts(const std::string& mapInternalName)
+    {
+        Heightfield heightfield;
+        std::vector<u16> loadedChunkIDs;
+        if (!LoadBenchmarkHeightfield(mapInternalName, heightfield, loadedChunkIDs))
+            return;
+
+        // Rays start a little above the ground and look down at a shallow angle, like picking or line of sight over a few hundred yards would
+        constexpr u32 numRays = 1000;
+        constexpr f32 maxDistance = 1000.0f;
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<f32> heightDistribution(2.0f, 100.0f);
+        std::uniform_real_distribution<f32> yawDistribution(0.0f, glm::two_pi<f32>());
+        std::uniform_real_distribution<f32> pitchDistribution(glm::radians(2.0f), glm::radians(45.0f));
+
+        std::vector<vec3> origins(numRays);
+        std::vector<vec3> directions(numRays);
+        for (u32 i = 0; i < numRays; i++)
+        {
+            vec3 origin = RandomPositionOnChunks(loadedChunkIDs, random);
+            origin.y = MapUtils::GetHeightFromWorldPosition(heightfield, origin) + heightDistribution(random);
+
+            const f32 yaw = yawDistribution(random);
+            const f32 pitch = pitchDistribution(random);
+
+            origins[i] = origin;
+            directions[i] = vec3(glm::cos(yaw) * glm::cos(pitch), -glm::sin(pitch), glm::sin(yaw) * glm::cos(pitch));
+        }
+
+        std::vector<RaycastHit> treeHits(numRays);
+        std::vector<RaycastHit> bruteForceHits(numRays);
+        std::vector<bool> treeDidHit(numRays);
+        std::vector<bool> bruteForceDidHit(numRays);
+
+        // The tree is fast enough that it runs a couple of times to get above timer noise, after a warm up run
+        constexpr u32 numTreeRuns = 10;
+        f32 treeTime = 0.0f;
+        for (u32 run = 0; run <= numTreeRuns; run++)
+        {
+            Timer timer;
+            for (u32 i = 0; i < numRays; i++)
+            {
+                treeDidHit[i] = Raycast(heightfield, origins[i], directions[i], maxDistance, treeHits[i]);
+            }
+
+            if (run > 0)
+            {
+                treeTime += timer.GetLifeTime();
+            }
+        }
+
+        Timer bruteForceTimer;
+        for (u32 i = 0; i < numRays; i++)
+        {
+            bruteForceDidHit[i] = RaycastChunks(heightfield, origins[i], directions[i], maxDistance, true, bruteForceHits[i]);
+        }
+        const f32 bruteForceTime = bruteForceTimer.GetLifeTime();
+
+        u32 numHits = 0;
+        u32 numMismatches = 0;
+        f32 maxDistanceDifference = 0.0f;
+        for (u32 i = 0; i < numRays; i++)
+        {
+            if (treeDidHit[i] != bruteForceDidHit[i])
+            {
+                numMismatches++;
+                continue;
+            }
+
+            if (treeDidHit[i])
+            {
+                numHits++;
+                maxDistanceDifference = glm::max(maxDistanceDifference, glm::abs(treeHits[i].distance - bruteForceHits[i].distance));
+            }
+        }
+
+        const f32 treeTimePerRay = treeTime / (numRays * numTreeRuns);
+        const f32 bruteForceTimePerRay = bruteForceTime / numRays;
+
+        NC_LOG_MESSAGE("%u rays over %u chunks of %s: %.2f us per ray with the min/max tree, %.1f us per ray testing every triangle (%.0fx)", numRays, static_cast<u32>(loadedChunkIDs.size()), mapInternalName.c_str(), treeTimePerRay * 1e6f, bruteForceTimePerRay * 1e6f, bruteForceTimePerRay / glm::max(treeTimePerRay, 1e-12f));
+        NC_LOG_MESSAGE("%u rays hit the terrain, %u disagree on hitting it at all, hit distances differ by up to %.5f yards", numHits, numMismatches, maxDistanceDifference);
+    }
+}
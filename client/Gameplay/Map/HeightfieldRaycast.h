@@ -0,0 +1,27 @@
+#pragma once
+#include <NovusTypes.h>
+#include <string>
+
+#include "Heightfield.h"
+
+namespace Terrain
+{
+    struct RaycastHit
+    {
+        vec3 position = vec3(0.0f);
+        vec3 normal = vec3(0.0f, 1.0f, 0.0f);
+        f32 distance = 0.0f;
+
+        u16 chunkID = 0;
+        u16 cellID = 0;
+        u32 triangleID = 0; // Same packing as Terrain::MakeTriangleID
+    };
+
+    // Finds the first terrain triangle along the ray within maxDistance, chunks that aren't resident and holes are treated as empty
+    // Every chunk the ray crosses is walked through its min/max tree nearest node first, so only the patches close to the ray get their triangles tested
+    bool Raycast(const Heightfield& heightfield, const vec3& origin, const vec3& direction, f32 maxDistance, RaycastHit& hit);
+    bool SegmentCast(const Heightfield& heightfield, const vec3& start, const vec3& end, RaycastHit& hit);
+
+    // Loads part of a map into its own heightfield and times Raycast against testing every triangle of the chunks along the ray
+    void BenchmarkRaycasts(const std::string& mapInternalName);
+}
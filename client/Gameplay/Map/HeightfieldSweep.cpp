@@ -0,0 +1,563 @@
+#include "HeightfieldSweep.h"
+#include <Utils/DebugHandler.h>
+#include <Utils/Timer.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Map.h"
+#include "HeightfieldQueries.h"
+#include "../../Utils/MapUtils.h"
+
+namespace Terrain
+{
+    namespace
+    {
+        // Covers the rounding of the patch positions, a patch this close to the swept box is still tested
+        constexpr f32 BOUNDS_EPSILON = 0.01f;
+
+        constexpr u32 PATCHES_PER_CELL = MAP_CELL_OUTER_GRID_STRIDE - 1;
+        constexpr f32 PATCH_STEP = MAP_CHUNK_SIZE / MAP_PATCHES_PER_CHUNK_SIDE;
+
+        // Triangles wait here until a whole batch can go through TestSeperationAxes4, the vertices are relative to the center of the box
+        constexpr u32 SWEEP_BATCH_CAPACITY = 64;
+        static_assert(SWEEP_BATCH_CAPACITY % 4 == 0, "The batch is tested 4 triangles at a time");
+
+        enum TriangleComponent : u32
+        {
+            VERT1_X, VERT1_Y, VERT1_Z,
+            VERT2_X, VERT2_Y, VERT2_Z,
+            VERT3_X, VERT3_Y, VERT3_Z,
+            TRIANGLE_COMPONENT_COUNT
+        };
+
+        struct SweepBatch
+        {
+            alignas(16) f32 components[TRIANGLE_COMPONENT_COUNT][SWEEP_BATCH_CAPACITY];
+            u32 triangleIDs[SWEEP_BATCH_CAPACITY];
+            u32 count = 0;
+        };
+
+        struct SweepState
+        {
+            vec3 boxScale;
+            vec3 direction;
+            f32 maxDistance;
+
+            SweepBatch batch;
+
+            bool didHit = false;
+            f32 distance = 0.0f;
+            u32 triangleID = 0;
+            f32 triangle[TRIANGLE_COMPONENT_COUNT];
+        };
+
+        // Where 4 triangles stand in MapUtils::TestSeperationAxes, a lane stays alive as long as no axis separated its triangle
+        struct SweepLanes
+        {
+            __m128 alive;
+            __m128 validMTD;
+            __m128 tFirst;
+            __m128 tLast;
+        };
+
+        __m128 Select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        __m128 Abs(__m128 value) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), value); }
+        __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) { return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz)); }
+
+        // MapUtils::TestAxis for 4 triangles, lanes in skip keep their state like the degenerate edge axes TestSeperationAxes leaves out
+        void TestAxis4(const __m128* vertices, const __m128* boxScale, const __m128* direction, __m128 axisX, __m128 axisY, __m128 axisZ, __m128 skip, SweepLanes& lanes)
+        {
+            const __m128 d0t = Dot(vertices[VERT1_X], vertices[VERT1_Y], vertices[VERT1_Z], axisX, axisY, axisZ);
+            const __m128 d1t = Dot(vertices[VERT2_X], vertices[VERT2_Y], vertices[VERT2_Z], axisX, axisY, axisZ);
+            const __m128 d2t = Dot(vertices[VERT3_X], vertices[VERT3_Y], vertices[VERT3_Z], axisX, axisY, axisZ);
+
+            const __m128 triMin = _mm_min_ps(_mm_min_ps(d0t, d1t), d2t);
+            const __m128 triMax = _mm_max_ps(_mm_max_ps(d0t, d1t), d2t);
+
+            const __m128 boxExt = Dot(Abs(axisX), Abs(axisY), Abs(axisZ), boxScale[0], boxScale[1], boxScale[2]);
+
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 d0 = _mm_sub_ps(_mm_sub_ps(zero, boxExt), triMax);
+            const __m128 d1 = _mm_sub_ps(boxExt, triMin);
+            const __m128 intersects = _mm_and_ps(_mm_cmple_ps(d0, zero), _mm_cmpge_ps(d1, zero));
+
+            const __m128 active = _mm_andnot_ps(skip, lanes.alive);
+            lanes.validMTD = _mm_andnot_ps(_mm_andnot_ps(intersects, active), lanes.validMTD);
+
+            const __m128 v = Dot(direction[0], direction[1], direction[2], axisX, axisY, axisZ);
+            const __m128 parallel = _mm_cmplt_ps(Abs(v), _mm_set1_ps(1.0E-6f));
+
+            // Moving along the axis never changes the overlap, so it has to overlap already
+            const __m128 separatedParallel = _mm_andnot_ps(intersects, _mm_and_ps(active, parallel));
+
+            // The parallel lanes divide by almost nothing here, what they get is thrown away below
+            const __m128 oneOverV = _mm_div_ps(_mm_set1_ps(-1.0f), Select(parallel, _mm_set1_ps(1.0f), v));
+            const __m128 t0_ = _mm_mul_ps(d0, oneOverV);
+            const __m128 t1_ = _mm_mul_ps(d1, oneOverV);
+            const __m128 t0 = _mm_min_ps(t0_, t1_);
+            const __m128 t1 = _mm_max_ps(t0_, t1_);
+
+            const __m128 update = _mm_andnot_ps(parallel, active);
+            const __m128 separatedMoving = _mm_and_ps(update, _mm_or_ps(_mm_cmpgt_ps(t0, lanes.tLast), _mm_cmplt_ps(t1, lanes.tFirst)));
+
+            lanes.tLast = Select(update, _mm_min_ps(t1, lanes.tLast), lanes.tLast);
+            lanes.tFirst = Select(update, _mm_max_ps(t0, lanes.tFirst), lanes.tFirst);
+            lanes.alive = _mm_andnot_ps(_mm_or_ps(separatedParallel, separatedMoving), lanes.alive);
+        }
+
+        // MapUtils::Intersect_AABB_TRIANGLE_SWEEP with back face culling for the 4 triangles starting at first, returns a mask of the ones the box hits
+        i32 TestSeperationAxes4(const SweepState& state, u32 first, __m128& outDistance)
+        {
+            __m128 vertices[TRIANGLE_COMPONENT_COUNT];
+            for (u32 i = 0; i < TRIANGLE_COMPONENT_COUNT; i++)
+            {
+                vertices[i] = _mm_load_ps(&state.batch.components[i][first]);
+            }
+
+            const __m128 boxScale[3] = { _mm_set1_ps(state.boxScale.x), _mm_set1_ps(state.boxScale.y), _mm_set1_ps(state.boxScale.z) };
+            const __m128 direction[3] = { _mm_set1_ps(state.direction.x), _mm_set1_ps(state.direction.y), _mm_set1_ps(state.direction.z) };
+
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 none = _mm_setzero_ps();
+            const __m128 all = _mm_cmpeq_ps(zero, zero);
+
+            // Padding lanes past the end of the batch start out dead
+            const __m128 laneIndices = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+            const __m128 validLanes = _mm_cmplt_ps(laneIndices, _mm_set1_ps(static_cast<f32>(state.batch.count - first)));
+
+            // Same winding as Geometry::Triangle::GetNormal, terrain triangles face up
+            const __m128 edge1X = _mm_sub_ps(vertices[VERT2_X], vertices[VERT1_X]);
+            const __m128 edge1Y = _mm_sub_ps(vertices[VERT2_Y], vertices[VERT1_Y]);
+            const __m128 edge1Z = _mm_sub_ps(vertices[VERT2_Z], vertices[VERT1_Z]);
+            const __m128 edge2X = _mm_sub_ps(vertices[VERT3_X], vertices[VERT1_X]);
+            const __m128 edge2Y = _mm_sub_ps(vertices[VERT3_Y], vertices[VERT1_Y]);
+            const __m128 edge2Z = _mm_sub_ps(vertices[VERT3_Z], vertices[VERT1_Z]);
+
+            __m128 normalX = _mm_sub_ps(_mm_mul_ps(edge1Y, edge2Z), _mm_mul_ps(edge1Z, edge2Y));
+            __m128 normalY = _mm_sub_ps(_mm_mul_ps(edge1Z, edge2X), _mm_mul_ps(edge1X, edge2Z));
+            __m128 normalZ = _mm_sub_ps(_mm_mul_ps(edge1X, edge2Y), _mm_mul_ps(edge1Y, edge2X));
+
+            const __m128 normalLengthSquared = Dot(normalX, normalY, normalZ, normalX, normalY, normalZ);
+            const __m128 isDegenerate = _mm_cmplt_ps(normalLengthSquared, _mm_set1_ps(1e-12f));
+            const __m128 inverseNormalLength = _mm_div_ps(one, _mm_sqrt_ps(Select(isDegenerate, one, normalLengthSquared)));
+            normalX = _mm_mul_ps(normalX, inverseNormalLength);
+            normalY = _mm_mul_ps(normalY, inverseNormalLength);
+            normalZ = _mm_mul_ps(normalZ, inverseNormalLength);
+
+            const __m128 isBackFacing = _mm_cmpge_ps(Dot(normalX, normalY, normalZ, direction[0], direction[1], direction[2]), zero);
+
+            SweepLanes lanes;
+            lanes.alive = _mm_andnot_ps(_mm_or_ps(isDegenerate, isBackFacing), validLanes);
+            lanes.validMTD = all;
+            lanes.tFirst = _mm_set1_ps(-MapUtils::f32MaxValue);
+            lanes.tLast = _mm_set1_ps(MapUtils::f32MaxValue);
+
+            if (_mm_movemask_ps(lanes.alive) == 0)
+                return 0;
+
+            // Triangle normal and box normals
+            TestAxis4(vertices, boxScale, direction, normalX, normalY, normalZ, none, lanes);
+            TestAxis4(vertices, boxScale, direction, one, zero, zero, none, lanes);
+            TestAxis4(vertices, boxScale, direction, zero, one, zero, none, lanes);
+            TestAxis4(vertices, boxScale, direction, zero, zero, one, none, lanes);
+
+            // The 9 crosses of the triangle edges with the box normals
+            const __m128 minSeparationSquared = _mm_set1_ps(1.0E-6f);
+            for (u32 i = 0; i < 3; i++)
+            {
+                if (_mm_movemask_ps(lanes.alive) == 0)
+                    return 0;
+
+                const u32 j = (i == 2) ? 0 : i + 1;
+                const __m128 edgeX = _mm_sub_ps(vertices[(j * 3) + 0], vertices[(i * 3) + 0]);
+                const __m128 edgeY = _mm_sub_ps(vertices[(j * 3) + 1], vertices[(i * 3) + 1]);
+                const __m128 edgeZ = _mm_sub_ps(vertices[(j * 3) + 2], vertices[(i * 3) + 2]);
+
+                // Cross100
+                {
+                    const __m128 sepY = _mm_sub_ps(zero, edgeZ);
+                    const __m128 skip = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(sepY, sepY), _mm_mul_ps(edgeY, edgeY)), minSeparationSquared);
+                    TestAxis4(vertices, boxScale, direction, zero, sepY, edgeY, skip, lanes);
+                }
+
+                // Cross010
+                {
+                    const __m128 sepZ = _mm_sub_ps(zero, edgeX);
+                    const __m128 skip = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(edgeZ, edgeZ), _mm_mul_ps(sepZ, sepZ)), minSeparationSquared);
+                    TestAxis4(vertices, boxScale, direction, edgeZ, zero, sepZ, skip, lanes);
+                }
+
+                // Cross001
+                {
+                    const __m128 sepX = _mm_sub_ps(zero, edgeY);
+                    const __m128 skip = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(sepX, sepX), _mm_mul_ps(edgeX, edgeX)), minSeparationSquared);
+                    TestAxis4(vertices, boxScale, direction, sepX, edgeX, zero, skip, lanes);
+                }
+            }
+
+            // Starting out inside the triangle only counts if every axis overlapped, like validMTD in TestSeperationAxes
+            const __m128 isInRange = _mm_and_ps(_mm_cmple_ps(lanes.tFirst, _mm_set1_ps(state.maxDistance)), _mm_cmpge_ps(lanes.tLast, zero));
+            const __m128 isStartValid = _mm_or_ps(_mm_cmpgt_ps(lanes.tFirst, zero), lanes.validMTD);
+            const __m128 hits = _mm_and_ps(lanes.alive, _mm_and_ps(isInRange, isStartValid));
+
+            outDistance = _mm_max_ps(lanes.tFirst, zero);
+            return _mm_movemask_ps(hits);
+        }
+
+        void FlushBatch(SweepState& state)
+        {
+            SweepBatch& batch = state.batch;
+
+            // Zero the padding so the last group doesn't do math on whatever an earlier batch left there
+            const u32 paddedCount = (batch.count + 3) & ~3u;
+            for (u32 component = 0; component < TRIANGLE_COMPONENT_COUNT; component++)
+            {
+                for (u32 i = batch.count; i < paddedCount; i++)
+                {
+                    batch.components[component][i] = 0.0f;
+                }
+            }
+
+            for (u32 first = 0; first < paddedCount; first += 4)
+            {
+                __m128 distances;
+                const i32 hitMask = TestSeperationAxes4(state, first, distances);
+                if (hitMask == 0)
+                    continue;
+
+                alignas(16) f32 laneDistances[4];
+                _mm_store_ps(laneDistances, distances);
+
+                for (u32 lane = 0; lane < 4; lane++)
+                {
+                    if (!((hitMask >> lane) & 1))
+                        continue;
+
+                    if (state.didHit && laneDistances[lane] >= state.distance)
+                        continue;
+
+                    const u32 index = first + lane;
+
+                    state.didHit = true;
+                    state.distance = laneDistances[lane];
+                    state.triangleID = batch.triangleIDs[index];
+                    for (u32 component = 0; component < TRIANGLE_COMPONENT_COUNT; component++)
+                    {
+                        state.triangle[component] = batch.components[component][index];
+                    }
+
+                    // Nothing further away than the closest hit so far can matter anymore
+                    state.maxDistance = state.distance;
+                }
+            }
+
+            batch.count = 0;
+        }
+
+        void AddTriangle(SweepState& state, const vec3& a, const vec3& b, const vec3& c, u32 triangleID)
+        {
+            SweepBatch& batch = state.batch;
+            const u32 index = batch.count++;
+
+            batch.components[VERT1_X][index] = a.x;
+            batch.components[VERT1_Y][index] = a.y;
+            batch.components[VERT1_Z][index] = a.z;
+            batch.components[VERT2_X][index] = b.x;
+            batch.components[VERT2_Y][index] = b.y;
+            batch.components[VERT2_Z][index] = b.z;
+            batch.components[VERT3_X][index] = c.x;
+            batch.components[VERT3_Y][index] = c.y;
+            batch.components[VERT3_Z][index] = c.z;
+            batch.triangleIDs[index] = triangleID;
+
+            if (batch.count == SWEEP_BATCH_CAPACITY)
+            {
+                FlushBatch(state);
+            }
+        }
+
+        // Adds the triangles of every patch of the chunk whose bounds overlap the swept box, min and max are the swept box in ADT coordinates and world heights
+        void GatherChunkTriangles(const HeightfieldChunk& chunk, u32 chunkX, u32 chunkY, const vec3& min, const vec3& max, const vec3& center, SweepState& state)
+        {
+            // The root of the min/max tree rejects chunks the box passes over or under
+            if (chunk.Dequantize(chunk.minMaxTree[0][0]) > max.z + BOUNDS_EPSILON || chunk.Dequantize(chunk.minMaxTree[0][1]) < min.z - BOUNDS_EPSILON)
+                return;
+
+            const f32 chunkOriginX = chunkX * MAP_CHUNK_SIZE;
+            const f32 chunkOriginY = chunkY * MAP_CHUNK_SIZE;
+
+            const vec2 localMin = vec2(min.x - chunkOriginX, min.y - chunkOriginY);
+            const vec2 localMax = vec2(max.x - chunkOriginX, max.y - chunkOriginY);
+
+            // Patches aren't exactly PATCH_STEP apart, one extra patch on each side makes up for that and the bounds test below throws it out again
+            constexpr f32 lastPatch = static_cast<f32>(MAP_PATCHES_PER_CHUNK_SIDE - 1);
+            const u32 firstPatchX = static_cast<u32>(glm::clamp(glm::floor(localMin.x / PATCH_STEP) - 1.0f, 0.0f, lastPatch));
+            const u32 firstPatchY = static_cast<u32>(glm::clamp(glm::floor(localMin.y / PATCH_STEP) - 1.0f, 0.0f, lastPatch));
+            const u32 lastPatchX = static_cast<u32>(glm::clamp(glm::floor(localMax.x / PATCH_STEP) + 1.0f, 0.0f, lastPatch));
+            const u32 lastPatchY = static_cast<u32>(glm::clamp(glm::floor(localMax.y / PATCH_STEP) + 1.0f, 0.0f, lastPatch));
+
+            // ADT x runs against world z and ADT y against world x, see MapUtils::WorldPositionToADTCoordinates
+            const f32 originX = (MAP_HALF_SIZE - chunkOriginY) - center.x;
+            const f32 originZ = (MAP_HALF_SIZE - chunkOriginX) - center.z;
+
+            for (u32 patchY = firstPatchY; patchY <= lastPatchY; patchY++)
+            {
+                const u32 cellY = patchY / PATCHES_PER_CELL;
+                const u32 patchYInCell = patchY % PATCHES_PER_CELL;
+                const f32 y = (cellY * MAP_CELL_SIZE) + (patchYInCell * MAP_PATCH_SIZE);
+
+                if (y > localMax.y + BOUNDS_EPSILON || y + MAP_PATCH_SIZE < localMin.y - BOUNDS_EPSILON)
+                    continue;
+
+                for (u32 patchX = firstPatchX; patchX <= lastPatchX; patchX++)
+                {
+                    const u32 cellX = patchX / PATCHES_PER_CELL;
+                    const u32 patchXInCell = patchX % PATCHES_PER_CELL;
+                    const f32 x = (cellX * MAP_CELL_SIZE) + (patchXInCell * MAP_PATCH_SIZE);
+
+                    if (x > localMax.x + BOUNDS_EPSILON || x + MAP_PATCH_SIZE < localMin.x - BOUNDS_EPSILON)
+                        continue;
+
+                    const u32 cellID = (cellY * MAP_CELLS_PER_CHUNK_SIDE) + cellX;
+                    const u32 topLeftVertex = (patchYInCell * MAP_CELL_TOTAL_GRID_STRIDE) + patchXInCell;
+                    const u16* cellHeights = chunk.heights[cellID];
+
+                    const u16 topLeft = cellHeights[topLeftVertex];
+                    const u16 topRight = cellHeights[topLeftVertex + 1];
+                    const u16 middle = cellHeights[topLeftVertex + MAP_CELL_OUTER_GRID_STRIDE];
+                    const u16 bottomLeft = cellHeights[topLeftVertex + MAP_CELL_TOTAL_GRID_STRIDE];
+                    const u16 bottomRight = cellHeights[topLeftVertex + MAP_CELL_TOTAL_GRID_STRIDE + 1];
+
+                    const u16 minHeight = std::min({ topLeft, topRight, middle, bottomLeft, bottomRight });
+                    const u16 maxHeight = std::max({ topLeft, topRight, middle, bottomLeft, bottomRight });
+                    if (chunk.Dequantize(minHeight) > max.z + BOUNDS_EPSILON || chunk.Dequantize(maxHeight) < min.z - BOUNDS_EPSILON)
+                        continue;
+
+                    // Same vertex order as MapUtils::GetTriangleFromWorldPosition, the center first and then two corners going north, east, south, west
+                    const vec3 centerVertex = vec3(originX - (y + MAP_PATCH_HALF_SIZE), chunk.Dequantize(middle) - center.y, originZ - (x + MAP_PATCH_HALF_SIZE));
+                    const vec3 corners[5] =
+                    {
+                        vec3(originX - y, chunk.Dequantize(topLeft) - center.y, originZ - x),
+                        vec3(originX - y, chunk.Dequantize(topRight) - center.y, originZ - (x + MAP_PATCH_SIZE)),
+                        vec3(originX - (y + MAP_PATCH_SIZE), chunk.Dequantize(bottomRight) - center.y, originZ - (x + MAP_PATCH_SIZE)),
+                        vec3(originX - (y + MAP_PATCH_SIZE), chunk.Dequantize(bottomLeft) - center.y, originZ - x),
+                        vec3(originX - y, chunk.Dequantize(topLeft) - center.y, originZ - x)
+                    };
+
+                    const u32 chunkID = (chunkY * MAP_CHUNKS_PER_MAP_STRIDE) + chunkX;
+                    const u32 patchID = (patchYInCell * PATCHES_PER_CELL) + patchXInCell;
+                    for (u32 triangle = 0; triangle < 4; triangle++)
+                    {
+                        AddTriangle(state, centerVertex, corners[triangle], corners[triangle + 1], MakeTriangleID(chunkID, cellID, patchID, triangle));
+                    }
+                }
+            }
+        }
+    }
+
+    bool SweepAABB(const Heightfield& heightfield, const Geometry::AABoundingBox& box, const vec3& direction, f32 maxDistance, SweepHit& hit)
+    {
+        const vec3 boxScale = (box.max - box.min) / 2.0f;
+        const vec3 center = box.max - boxScale;
+
+        const vec3 offset = direction * maxDistance;
+        const vec3 sweptMin = glm::min(box.min, box.min + offset);
+        const vec3 sweptMax = glm::max(box.max, box.max + offset);
+
+        // The swept box in ADT coordinates, with the height kept in z
+        const vec3 min = vec3(MAP_HALF_SIZE - sweptMax.z, MAP_HALF_SIZE - sweptMax.x, sweptMin.y);
+        const vec3 max = vec3(MAP_HALF_SIZE - sweptMin.z, MAP_HALF_SIZE - sweptMin.x, sweptMax.y);
+
+        constexpr f32 mapSize = MAP_CHUNKS_PER_MAP_STRIDE * MAP_CHUNK_SIZE;
+        if (max.x < 0.0f || max.y < 0.0f || min.x >= mapSize || min.y >= mapSize)
+            return false;
+
+        constexpr f32 lastChunk = static_cast<f32>(MAP_CHUNKS_PER_MAP_STRIDE - 1);
+        const u32 firstChunkX = static_cast<u32>(glm::clamp(glm::floor(min.x / MAP_CHUNK_SIZE), 0.0f, lastChunk));
+        const u32 firstChunkY = static_cast<u32>(glm::clamp(glm::floor(min.y / MAP_CHUNK_SIZE), 0.0f, lastChunk));
+        const u32 lastChunkX = static_cast<u32>(glm::clamp(glm::floor(max.x / MAP_CHUNK_SIZE), 0.0f, lastChunk));
+        const u32 lastChunkY = static_cast<u32>(glm::clamp(glm::floor(max.y / MAP_CHUNK_SIZE), 0.0f, lastChunk));
+
+        SweepState state;
+        state.boxScale = boxScale;
+        state.direction = direction;
+        state.maxDistance = maxDistance;
+
+        for (u32 chunkY = firstChunkY; chunkY <= lastChunkY; chunkY++)
+        {
+            for (u32 chunkX = firstChunkX; chunkX <= lastChunkX; chunkX++)
+            {
+                const HeightfieldChunk* chunk = heightfield.GetChunk((chunkY * MAP_CHUNKS_PER_MAP_STRIDE) + chunkX);
+                if (chunk == nullptr)
+                    continue;
+
+                GatherChunkTriangles(*chunk, chunkX, chunkY, min, max, center, state);
+            }
+        }
+
+        if (state.batch.count > 0)
+        {
+            FlushBatch(state);
+        }
+
+        if (!state.didHit)
+            return false;
+
+        hit.distance = state.distance;
+        hit.triangleID = state.triangleID;
+        hit.triangle.vert1 = vec3(state.triangle[VERT1_X], state.triangle[VERT1_Y], state.triangle[VERT1_Z]) + center;
+        hit.triangle.vert2 = vec3(state.triangle[VERT2_X], state.triangle[VERT2_Y], state.triangle[VERT2_Z]) + center;
+        hit.triangle.vert3 = vec3(state.triangle[VERT3_X], state.triangle[VERT3_Y], state.triangle[VERT3_Z]) + center;
+        hit.normal = glm::normalize(glm::cross(hit.triangle.vert2 - hit.triangle.vert1, hit.triangle.vert3 - hit.triangle.vert1));
+
+        return true;
+    }
+
+    namespace
+    {
+        // What sweeping against the terrain came down to before SweepAABB, every triangle of the cells under the corners of the swept box one at a time
+        bool SweepCellTriangles(const Heightfield& heightfield, const Geometry::AABoundingBox& box, const vec3& direction, f32 maxDistance, f32& outDistance)
+        {
+            const vec3 boxScale = (box.max - box.min) / 2.0f;
+            const vec3 center = box.max - boxScale;
+
+            const vec3 offset = direction * maxDistance;
+            const vec3 sweptMin = glm::min(box.min, box.min + offset);
+            const vec3 sweptMax = glm::max(box.max, box.max + offset);
+
+            const vec3 corners[4] =
+            {
+                vec3(sweptMin.x, center.y, sweptMin.z),
+                vec3(sweptMax.x, center.y, sweptMin.z),
+                vec3(sweptMin.x, center.y, sweptMax.z),
+                vec3(sweptMax.x, center.y, sweptMax.z)
+            };
+
+            // Corners in the same cell would gather the same triangles twice
+            u32 gatheredCells[4];
+            u32 numGatheredCells = 0;
+
+            bool didHit = false;
+            outDistance = MapUtils::f32MaxValue;
+
+            for (const vec3& corner : corners)
+            {
+                const vec2 chunkPos = MapUtils::GetChunkFromAdtPosition(MapUtils::WorldPositionToADTCoordinates(corner));
+                const vec2 cellPos = (chunkPos - glm::floor(chunkPos)) * (MAP_CHUNK_SIZE / MAP_CELL_SIZE);
+                const u32 globalCellID = (MapUtils::GetChunkIdFromChunkPos(chunkPos) * MAP_CELLS_PER_CHUNK) + MapUtils::GetCellIdFromCellPos(cellPos);
+
+                if (std::find(gatheredCells, gatheredCells + numGatheredCells, globalCellID) != gatheredCells + numGatheredCells)
+                    continue;
+
+                gatheredCells[numGatheredCells++] = globalCellID;
+
+                std::vector<Geometry::Triangle> triangles = MapUtils::GetCellTrianglesFromWorldPosition(heightfield, corner);
+                for (Geometry::Triangle& triangle : triangles)
+                {
+                    triangle.vert1 -= center;
+                    triangle.vert2 -= center;
+                    triangle.vert3 -= center;
+
+                    f32 distance = 0.0f;
+                    if (MapUtils::Intersect_AABB_TRIANGLE_SWEEP(boxScale, triangle, direction, maxDistance, distance, true) && distance < outDistance)
+                    {
+                        outDistance = distance;
+                        didHit = true;
+                    }
+                }
+            }
+
+            return didHit;
+        }
+    }
+
+    void BenchmarkSweeps(const std::string& mapInternalName)
+    {
+        Heightfield heightfield;
+        std::vector<u16> loadedChunkIDs;
+        if (!LoadBenchmarkHeightfield(mapInternalName, heightfield, loadedChunkIDs))
+            return;
+
+        // Boxes about the size of a character, falling or moving down a slope like SimulateDebugCubeSystem and movement would sweep them
+        constexpr u32 numSweeps = 10000;
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<f32> heightDistribution(0.0f, 5.0f);
+        std::uniform_real_distribution<f32> extentDistribution(0.25f, 1.0f);
+        std::uniform_real_distribution<f32> horizontalDistribution(-1.0f, 1.0f);
+        std::uniform_real_distribution<f32> distanceDistribution(1.0f, 10.0f);
+
+        std::vector<Geometry::AABoundingBox> boxes(numSweeps);
+        std::vector<vec3> directions(numSweeps);
+        std::vector<f32> maxDistances(numSweeps);
+        for (u32 i = 0; i < numSweeps; i++)
+        {
+            vec3 position = RandomPositionOnChunks(loadedChunkIDs, random);
+            position.y = MapUtils::GetHeightFromWorldPosition(heightfield, position) + heightDistribution(random);
+
+            const vec3 extents = vec3(extentDistribution(random), extentDistribution(random) * 2.0f, extentDistribution(random));
+            boxes[i].min = position - vec3(extents.x, 0.0f, extents.z);
+            boxes[i].max = position + extents;
+
+            directions[i] = glm::normalize(vec3(horizontalDistribution(random), -1.0f, horizontalDistribution(random)));
+            maxDistances[i] = distanceDistribution(random);
+        }
+
+        std::vector<SweepHit> hits(numSweeps);
+        std::vector<bool> didHit(numSweeps);
+        std::vector<f32> cellDistances(numSweeps);
+        std::vector<bool> cellDidHit(numSweeps);
+
+        // SweepAABB runs a couple of times after a warm up run to get above timer noise
+        constexpr u32 numRuns = 10;
+        f32 sweepTime = 0.0f;
+        for (u32 run = 0; run <= numRuns; run++)
+        {
+            Timer timer;
+            for (u32 i = 0; i < numSweeps; i++)
+            {
+                didHit[i] = SweepAABB(heightfield, boxes[i], directions[i], maxDistances[i], hits[i]);
+            }
+
+            if (run > 0)
+            {
+                sweepTime += timer.GetLifeTime();
+            }
+        }
+
+        Timer cellTimer;
+        for (u32 i = 0; i < numSweeps; i++)
+        {
+            cellDidHit[i] = SweepCellTriangles(heightfield, boxes[i], directions[i], maxDistances[i], cellDistances[i]);
+        }
+        const f32 cellTime = cellTimer.GetLifeTime();
+
+        u32 numHits = 0;
+        u32 numMismatches = 0;
+        f32 maxDistanceDifference = 0.0f;
+        for (u32 i = 0; i < numSweeps; i++)
+        {
+            if (didHit[i] != cellDidHit[i])
+            {
+                numMismatches++;
+                continue;
+            }
+
+            if (didHit[i])
+            {
+                numHits++;
+                maxDistanceDifference = glm::max(maxDistanceDifference, glm::abs(hits[i].distance - cellDistances[i]));
+            }
+        }
+
+        const f32 sweepsPerSecond = (numSweeps * numRuns) / glm::max(sweepTime, 1e-9f);
+        const f32 cellSweepsPerSecond = numSweeps / glm::max(cellTime, 1e-9f);
+
+        NC_LOG_MESSAGE("%u box sweeps over %u chunks of %s: %.0f sweeps per second with SweepAABB, %.0f sweeps per second over the cell triangles (%.1fx)", numSweeps, static_cast<u32>(loadedChunkIDs.size()), mapInternalName.c_str(), sweepsPerSecond, cellSweepsPerSecond, sweepsPerSecond / glm::max(cellSweepsPerSecond, 1e-9f));
+        NC_LOG_MESSAGE("%u sweeps hit the terrain, %u disagree on hitting it at all, hit distances differ by up to %.5f yards", numHits, numMismatches, maxDistanceDifference);
+    }
+}
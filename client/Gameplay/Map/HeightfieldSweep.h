@@ -0,0 +1,24 @@
+#pragma once
+#include <NovusTypes.h>
+#include <Math/Geometry.h>
+#include <string>
+
+#include "Heightfield.h"
+
+namespace Terrain
+{
+    struct SweepHit
+    {
+        f32 distance = 0.0f; // In steps of direction, like the outDistToCollision of MapUtils::Intersect_AABB_TERRAIN_SWEEP
+        vec3 normal = vec3(0.0f, 1.0f, 0.0f);
+        Geometry::Triangle triangle; // World space
+        u32 triangleID = 0; // Same packing as Terrain::MakeTriangleID
+    };
+
+    // Sweeps box along direction for up to maxDistance and finds the first terrain triangle it touches, without allocating
+    // Patches whose bounds miss the swept box are skipped, the triangles of the rest go through the same SAT test as MapUtils::Intersect_AABB_TRIANGLE_SWEEP 4 at a time
+    bool SweepAABB(const Heightfield& heightfield, const Geometry::AABoundingBox& box, const vec3& direction, f32 maxDistance, SweepHit& hit);
+
+    // Loads part of a map into its own heightfield and times SweepAABB against sweeping every triangle of the cells under the box one by one
+    void BenchmarkSweeps(const std::string& mapInternalName);
+}
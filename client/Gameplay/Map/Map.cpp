@@ -12,7 +12,7 @@ namespace Terrain
     {
         chunkId = Math::FloorToInt(x) + (Math::FloorToInt(y) * MAP_CHUNKS_PER_MAP_STRIDE);
 
-        return chunks.find(chunkId) != chunks.end();
+        return chunkLocations.find(chunkId) != chunkLocations.end();
     }
 
 }
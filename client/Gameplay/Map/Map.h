@@ -27,6 +27,8 @@
 #include <limits>
 #include <Containers/StringTable.h>
 #include "Chunk.h"
+#include "Heightfield.h"
+#include "../../Utils/MappedFile.h"
 
 // First of all, forget every naming convention wowdev.wiki uses, it's extremely confusing.
 // A Map (e.g. Eastern Kingdoms) consists of 64x64 Chunks which may or may not be used.
@@ -38,14 +40,31 @@ namespace Terrain
     constexpr f32 MAP_SIZE = MAP_CHUNK_SIZE * MAP_CHUNKS_PER_MAP_STRIDE; // yards
     constexpr f32 MAP_HALF_SIZE = MAP_SIZE / 2.0f; // yards
 
+    // Where the .nmap data of a chunk lives, found through the chunk index of the map without walking its folder
+    struct ChunkLocation
+    {
+        std::string path;
+        u64 offset = 0; // Bytes into path the chunk starts at
+        u64 size = 0;
+        u64 contentHash = 0; // 0 when the index was built without hashing
+        u32 unpackedSize = 0; // Only set for chunks in a map archive, those are compressed and need MapArchive to decode them
+
+        // World space bounds of the whole chunk, known before the chunk itself is loaded
+        vec3 boundsMin = vec3(0.0f);
+        vec3 boundsMax = vec3(0.0f);
+    };
+
     struct Map
     {
         Map() {}
 
         u16 id = std::numeric_limits<u16>().max(); // Default Map to Invalid ID
         std::string_view name;
-        robin_hood::unordered_map<u16, Chunk> chunks;
+        robin_hood::unordered_map<u16, Chunk> chunks; // Released again once the renderer uploaded them, unless terrain.keepChunks is set
+        Heightfield heightfield; // What gameplay queries read, TerrainResidencySystem keeps it within map.residency.budgetMB
         robin_hood::unordered_map<u16, StringTable> stringTables;
+        robin_hood::unordered_map<u16, ChunkLocation> chunkLocations; // Every chunk of the map, for streamed maps chunks only has the ones near the camera
+        MappedFile archiveFile; // Only open for maps loaded from their map archive, every chunk of the map is decoded from this one mapping
 
         /*f32 GetHeight(Vector2& pos);
         bool GetAdtIdFromWorldPosition(Vector2& pos, u16& adtId);*/
@@ -57,6 +76,9 @@ namespace Terrain
             id = std::numeric_limits<u16>().max();
 
             chunks.clear();
+            chunkLocations.clear();
+            archiveFile.Close();
+            heightfield.Clear();
 
             for (auto& itr : stringTables)
             {
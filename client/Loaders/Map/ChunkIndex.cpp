@@ -0,0 +1,232 @@
+#include "ChunkIndex.h"
+#include <Utils/DebugHandler.h>
+#include <Utils/StringUtils.h>
+#include <tracy/Tracy.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "../../Gameplay/Map/Map.h"
+#include "../../Utils/MappedFile.h"
+
+namespace fs = std::filesystem;
+
+std::string ChunkIndex::GetPath(const std::string& mapFolder, const std::string& mapInternalName)
+{
+    return (fs::path(mapFolder) / (mapInternalName + ".nidx")).string();
+}
+
+bool ChunkIndex::Read(const std::string& indexPath, const std::string& mapFolder, ChunkLocations& locations)
+{
+    ZoneScoped;
+
+    std::error_code errorCode;
+    const fs::file_time_type indexTime = fs::last_write_time(indexPath, errorCode);
+    if (errorCode)
+        return false;
+
+    // Rerunning the dataextractor rewrites the folder, that is the only way the index can go stale
+    const fs::file_time_type folderTime = fs::last_write_time(mapFolder, errorCode);
+    if (errorCode || folderTime > indexTime)
+        return false;
+
+    MappedFile indexFile;
+    if (!indexFile.Open(indexPath) || indexFile.GetSize() < sizeof(Header))
+        return false;
+
+    Header header;
+    memcpy(&header, indexFile.GetData(), sizeof(Header));
+
+    if (header.token != TOKEN || header.version != VERSION)
+        return false;
+
+    const size_t expectedSize = sizeof(Header) + (sizeof(Entry) * static_cast<size_t>(header.numEntries)) + header.pathDataSize;
+    if (indexFile.GetSize() != expectedSize)
+    {
+        NC_LOG_WARNING("Chunk index (%s) is %u bytes instead of the expected %u, building a new one", indexPath.c_str(), indexFile.GetSize(), expectedSize);
+        return false;
+    }
+
+    const Entry* entries = reinterpret_cast<const Entry*>(indexFile.GetData() + sizeof(Header));
+    const char* pathData = reinterpret_cast<const char*>(indexFile.GetData() + sizeof(Header) + (sizeof(Entry) * header.numEntries));
+
+    locations.clear();
+    locations.reserve(header.numEntries);
+
+    const fs::path folder(mapFolder);
+    for (u32 i = 0; i < header.numEntries; i++)
+    {
+        const Entry& entry = entries[i];
+        if (static_cast<size_t>(entry.pathOffset) + entry.pathLength > header.pathDataSize || entry.chunkID >= Terrain::MAP_CHUNKS_PER_MAP)
+        {
+            NC_LOG_WARNING("Chunk index (%s) has an invalid entry, building a new one", indexPath.c_str());
+            locations.clear();
+            return false;
+        }
+
+        Terrain::ChunkLocation& location = locations[entry.chunkID];
+        location.path = (folder / std::string(pathData + entry.pathOffset, entry.pathLength)).string();
+        location.offset = entry.offset;
+        location.size = entry.size;
+        location.contentHash = entry.contentHash;
+        location.boundsMin = vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        location.boundsMax = vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+    }
+
+    return true;
+}
+
+bool ChunkIndex::Write(const std::string& indexPath, const std::string& mapFolder, const ChunkLocations& locations)
+{
+    std::vector<Entry> entries;
+    entries.reserve(locations.size());
+
+    std::string pathData;
+
+    const fs::path folder(mapFolder);
+    for (const auto& itr : locations)
+    {
+        const Terrain::ChunkLocation& location = itr.second;
+        const std::string relativePath = fs::path(location.path).lexically_relative(folder).generic_string();
+
+        Entry& entry = entries.emplace_back();
+        entry.chunkID = itr.first;
+        entry.pathLength = static_cast<u16>(relativePath.size());
+        entry.pathOffset = static_cast<u32>(pathData.size());
+        entry.offset = location.offset;
+        entry.size = location.size;
+        entry.contentHash = location.contentHash;
+        memcpy(entry.boundsMin, &location.boundsMin, sizeof(entry.boundsMin));
+        memcpy(entry.boundsMax, &location.boundsMax, sizeof(entry.boundsMax));
+
+        pathData += relativePath;
+    }
+
+    Header header;
+    header.token = TOKEN;
+    header.version = VERSION;
+    header.numEntries = static_cast<u32>(entries.size());
+    header.pathDataSize = static_cast<u32>(pathData.size());
+
+    // Written to a temporary path first so a client that gets closed halfway doesn't leave half an index behind
+    const std::string temporaryPath = indexPath + ".tmp";
+    {
+        std::ofstream output(temporaryPath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!output)
+        {
+            NC_LOG_ERROR("Failed to create chunk index (%s)", temporaryPath.c_str());
+            return false;
+        }
+
+        output.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        output.write(reinterpret_cast<const char*>(entries.data()), sizeof(Entry) * entries.size());
+        output.write(pathData.data(), pathData.size());
+
+        if (!output)
+        {
+            NC_LOG_ERROR("Failed to write chunk index (%s)", temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code errorCode;
+    fs::rename(temporaryPath, indexPath, errorCode);
+    if (errorCode)
+    {
+        NC_LOG_ERROR("Failed to move chunk index to (%s): %s", indexPath.c_str(), errorCode.message().c_str());
+        fs::remove(temporaryPath, errorCode);
+        return false;
+    }
+
+    return true;
+}
+
+bool ChunkIndex::Build(const std::string& mapFolder, bool readContents, ChunkLocations& locations)
+{
+    ZoneScoped;
+
+    locations.clear();
+
+    for (const auto& entry : fs::recursive_directory_iterator(mapFolder))
+    {
+        const fs::path& file = entry.path();
+        if (file.extension() != ".nmap")
+            continue;
+
+        // Chunk files are named <map internal name>_<x>_<y>.nmap, where the map name can have underscores of its own
+        std::vector<std::string> splitName = StringUtils::SplitString(file.stem().string(), '_');
+        const size_t numberOfSplits = splitName.size();
+        if (numberOfSplits < 3)
+        {
+            NC_LOG_WARNING("Skipping map chunk with an unexpected name (%s)", file.string().c_str());
+            continue;
+        }
+
+        const u16 x = static_cast<u16>(std::stoi(splitName[numberOfSplits - 2]));
+        const u16 y = static_cast<u16>(std::stoi(splitName[numberOfSplits - 1]));
+        const u16 chunkID = x + (y * Terrain::MAP_CHUNKS_PER_MAP_STRIDE);
+
+        Terrain::ChunkLocation& location = locations[chunkID];
+        location.path = file.string();
+        location.offset = 0;
+        location.size = entry.file_size();
+
+        if (readContents && !ReadContents(location, chunkID))
+        {
+            NC_LOG_ERROR("Failed to read map chunk (%s) for the chunk index", location.path.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+u64 ChunkIndex::HashContent(const u8* data, size_t size)
+{
+    u64 hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool ChunkIndex::ReadContents(Terrain::ChunkLocation& location, u16 chunkID)
+{
+    MappedFile chunkFile;
+    if (!chunkFile.Open(location.path) || location.offset + location.size > chunkFile.GetSize())
+        return false;
+
+    const u8* data = chunkFile.GetData() + location.offset;
+    location.contentHash = HashContent(data, location.size);
+
+    Terrain::ChunkView view;
+    if (!view.Parse(data, location.size))
+        return false;
+
+    f32 minHeight = std::numeric_limits<f32>::max();
+    f32 maxHeight = std::numeric_limits<f32>::lowest();
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        const Terrain::Cell& cell = view.cells[i];
+        for (u32 j = 0; j < Terrain::MAP_CELL_TOTAL_GRID_SIZE; j++)
+        {
+            minHeight = glm::min(minHeight, cell.heightData[j]);
+            maxHeight = glm::max(maxHeight, cell.heightData[j]);
+        }
+    }
+
+    // Same placement as the cell bounding boxes in TerrainRenderer, chunk x runs along -z and chunk y along -x
+    const u16 chunkPosX = chunkID % Terrain::MAP_CHUNKS_PER_MAP_STRIDE;
+    const u16 chunkPosY = chunkID / Terrain::MAP_CHUNKS_PER_MAP_STRIDE;
+
+    const f32 originX = -((chunkPosY * Terrain::MAP_CHUNK_SIZE) - Terrain::MAP_HALF_SIZE);
+    const f32 originZ = ((Terrain::MAP_CHUNKS_PER_MAP_STRIDE - chunkPosX) * Terrain::MAP_CHUNK_SIZE) - Terrain::MAP_HALF_SIZE;
+
+    location.boundsMin = vec3(originX - Terrain::MAP_CHUNK_SIZE, minHeight, originZ - Terrain::MAP_CHUNK_SIZE);
+    location.boundsMax = vec3(originX, maxHeight, originZ);
+    return true;
+}
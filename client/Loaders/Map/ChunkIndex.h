@@ -0,0 +1,56 @@
+#pragma once
+#include <NovusTypes.h>
+#include <robin_hood.h>
+#include <string>
+
+namespace Terrain
+{
+    struct ChunkLocation;
+}
+
+// Cooked list of the chunks of a map, stored as <map>.nidx in the map folder so loading a map doesn't need to walk that folder
+class ChunkIndex
+{
+public:
+    static constexpr u32 TOKEN = 1313424472; // NIDX
+    static constexpr u32 VERSION = 1;
+
+    using ChunkLocations = robin_hood::unordered_map<u16, Terrain::ChunkLocation>;
+
+    static std::string GetPath(const std::string& mapFolder, const std::string& mapInternalName);
+
+    // Fails when the index is missing, from another version or older than the map folder, the caller should Build and Write a new one then
+    static bool Read(const std::string& indexPath, const std::string& mapFolder, ChunkLocations& locations);
+    static bool Write(const std::string& indexPath, const std::string& mapFolder, const ChunkLocations& locations);
+
+    // Walks the map folder for .nmap files, hashing them and calculating their bounds needs every file to be read as well
+    static bool Build(const std::string& mapFolder, bool readContents, ChunkLocations& locations);
+
+    // FNV-1a, only meant to notice chunk files that changed
+    static u64 HashContent(const u8* data, size_t size);
+
+private:
+#pragma pack(push, 1)
+    struct Header
+    {
+        u32 token = 0;
+        u32 version = 0;
+        u32 numEntries = 0;
+        u32 pathDataSize = 0;
+    };
+
+    struct Entry
+    {
+        u16 chunkID = 0;
+        u16 pathLength = 0;
+        u32 pathOffset = 0; // Into the path data after the entries, relative to the map folder
+        u64 offset = 0;
+        u64 size = 0;
+        u64 contentHash = 0;
+        f32 boundsMin[3] = { 0 };
+        f32 boundsMax[3] = { 0 };
+    };
+#pragma pack(pop)
+
+    static bool ReadContents(Terrain::ChunkLocation& location, u16 chunkID);
+};
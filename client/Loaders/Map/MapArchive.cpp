@@ -0,0 +1,396 @@
+#include "MapArchive.h"
+#include <Utils/ByteBuffer.h>
+#include <Utils/DebugHandler.h>
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "../../Gameplay/Map/Map.h"
+#include "../../Utils/MappedFile.h"
+#include "../../Utils/LZCompression.h"
+
+namespace fs = std::filesystem;
+
+// What a chunk looks like before it gets compressed, every field of the cells is stored for all cells at once since the same field of neighbouring cells compresses far better than the next field of the same cell
+#pragma pack(push, 1)
+struct EncodedChunkHeader
+{
+    Terrain::ChunkHeader chunkHeader;
+    Terrain::HeightHeader heightHeader;
+    Terrain::HeightBox heightBox;
+
+    f32 heightBase = 0.0f;
+    f32 heightStep = 0.0f;
+
+    u32 alphaMapStringID = 0;
+    u32 numMapObjectPlacements = 0;
+    u32 stringTableSize = 0;
+};
+#pragma pack(pop)
+
+constexpr u32 NUM_CELL_HEIGHTS = Terrain::MAP_CELLS_PER_CHUNK * Terrain::MAP_CELL_TOTAL_GRID_SIZE;
+
+static void Append(std::vector<u8>& encoded, const void* data, size_t size)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    encoded.insert(encoded.end(), bytes, bytes + size);
+}
+
+static const u8* Take(const std::vector<u8>& decoded, size_t& offset, size_t size)
+{
+    if (size > decoded.size() - offset)
+        return nullptr;
+
+    const u8* data = decoded.data() + offset;
+    offset += size;
+    return data;
+}
+
+std::string MapArchive::GetPath(const std::string& mapFolder, const std::string& mapInternalName)
+{
+    return (fs::path(mapFolder) / (mapInternalName + ".narc")).string();
+}
+
+bool MapArchive::ReadTableOfContents(const std::string& archivePath, MappedFile& archiveFile, ChunkIndex::ChunkLocations& locations)
+{
+    ZoneScoped;
+
+    if (!archiveFile.Open(archivePath))
+        return false;
+
+    if (archiveFile.GetSize() < sizeof(Header))
+    {
+        archiveFile.Close();
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, archiveFile.GetData(), sizeof(Header));
+
+    if (header.token != TOKEN)
+    {
+        NC_LOG_ERROR("Map archive (%s) has the wrong token", archivePath.c_str());
+        archiveFile.Close();
+        return false;
+    }
+
+    if (header.version != VERSION)
+    {
+        NC_LOG_ERROR("Map archive (%s) has version %u instead of the expected version %u, pack the map again", archivePath.c_str(), header.version, VERSION);
+        archiveFile.Close();
+        return false;
+    }
+
+    if (header.numChunks > (archiveFile.GetSize() - sizeof(Header)) / sizeof(TableEntry))
+    {
+        NC_LOG_ERROR("Map archive (%s) is too small for its table of contents", archivePath.c_str());
+        archiveFile.Close();
+        return false;
+    }
+
+    const TableEntry* entries = reinterpret_cast<const TableEntry*>(archiveFile.GetData() + sizeof(Header));
+
+    locations.clear();
+    locations.reserve(header.numChunks);
+
+    for (u32 i = 0; i < header.numChunks; i++)
+    {
+        const TableEntry& entry = entries[i];
+        if (entry.chunkID >= Terrain::MAP_CHUNKS_PER_MAP || entry.offset > archiveFile.GetSize() || entry.size > archiveFile.GetSize() - entry.offset || entry.unpackedSize == 0)
+        {
+            NC_LOG_ERROR("Map archive (%s) has an invalid entry for chunk %u", archivePath.c_str(), entry.chunkID);
+            locations.clear();
+            archiveFile.Close();
+            return false;
+        }
+
+        Terrain::ChunkLocation& location = locations[entry.chunkID];
+        location.path = archivePath;
+        location.offset = entry.offset;
+        location.size = entry.size;
+        location.contentHash = entry.contentHash;
+        location.unpackedSize = entry.unpackedSize;
+        location.boundsMin = vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        location.boundsMax = vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+    }
+
+    return true;
+}
+
+bool MapArchive::Pack(const std::string& mapFolder, const std::string& archivePath, PackStats& stats)
+{
+    ZoneScoped;
+
+    stats = PackStats();
+
+    ChunkIndex::ChunkLocations locations;
+    if (!ChunkIndex::Build(mapFolder, true, locations))
+        return false;
+
+    if (locations.empty())
+    {
+        NC_LOG_ERROR("0 maps found in (%s)", mapFolder.c_str());
+        return false;
+    }
+
+    // Sorted so the archive comes out the same every time it is packed from the same files
+    std::vector<u16> chunkIDs;
+    chunkIDs.reserve(locations.size());
+    for (const auto& itr : locations)
+    {
+        chunkIDs.push_back(itr.first);
+    }
+    std::sort(chunkIDs.begin(), chunkIDs.end());
+
+    const std::string temporaryPath = archivePath + ".tmp";
+    std::ofstream output(temporaryPath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!output)
+    {
+        NC_LOG_ERROR("Failed to create map archive (%s)", temporaryPath.c_str());
+        return false;
+    }
+
+    // Everything that fails from here on leaves a partly written archive behind, it is closed before removing it since it can't be removed while open on Windows
+    std::error_code errorCode;
+
+    Header header;
+    header.token = TOKEN;
+    header.version = VERSION;
+    header.numChunks = static_cast<u32>(chunkIDs.size());
+
+    // The table of contents is written last, once the offsets and sizes of the blocks are known
+    std::vector<TableEntry> entries(chunkIDs.size());
+    output.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    output.write(reinterpret_cast<const char*>(entries.data()), sizeof(TableEntry) * entries.size());
+
+    u64 offset = sizeof(Header) + sizeof(TableEntry) * entries.size();
+    std::vector<u8> encoded;
+    std::vector<u8> compressed;
+
+    for (size_t i = 0; i < chunkIDs.size(); i++)
+    {
+        const Terrain::ChunkLocation& location = locations[chunkIDs[i]];
+
+        MappedFile chunkFile;
+        Terrain::ChunkView view;
+        if (!chunkFile.Open(location.path) || !view.Parse(chunkFile.GetData(), chunkFile.GetSize()))
+        {
+            NC_LOG_ERROR("Failed to read map chunk (%s) for packing", location.path.c_str());
+            output.close();
+            fs::remove(temporaryPath, errorCode);
+            return false;
+        }
+
+        if (view.chunkHeader->token != Terrain::MAP_CHUNK_TOKEN || view.chunkHeader->version != Terrain::MAP_CHUNK_VERSION)
+        {
+            NC_LOG_ERROR("Map chunk (%s) has version %u instead of the expected version of %u, rerun dataextractor", location.path.c_str(), view.chunkHeader->version, Terrain::MAP_CHUNK_VERSION);
+            output.close();
+            fs::remove(temporaryPath, errorCode);
+            return false;
+        }
+
+        f32 maxHeightError = 0.0f;
+        encoded.clear();
+        EncodeChunk(view, encoded, maxHeightError);
+
+        compressed.clear();
+        LZCompression::Compress(encoded.data(), encoded.size(), compressed);
+        output.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+
+        TableEntry& entry = entries[i];
+        entry.chunkID = chunkIDs[i];
+        entry.unpackedSize = static_cast<u32>(encoded.size());
+        entry.offset = offset;
+        entry.size = compressed.size();
+        entry.contentHash = location.contentHash;
+        memcpy(entry.boundsMin, &location.boundsMin, sizeof(entry.boundsMin));
+        memcpy(entry.boundsMax, &location.boundsMax, sizeof(entry.boundsMax));
+
+        offset += compressed.size();
+
+        stats.numChunks++;
+        stats.unpackedBytes += chunkFile.GetSize();
+        stats.maxHeightError = glm::max(stats.maxHeightError, maxHeightError);
+    }
+
+    output.seekp(sizeof(Header));
+    output.write(reinterpret_cast<const char*>(entries.data()), sizeof(TableEntry) * entries.size());
+    output.close();
+
+    if (!output)
+    {
+        NC_LOG_ERROR("Failed to write map archive (%s)", temporaryPath.c_str());
+        fs::remove(temporaryPath, errorCode);
+        return false;
+    }
+
+    stats.packedBytes = offset;
+
+    fs::rename(temporaryPath, archivePath, errorCode);
+    if (errorCode)
+    {
+        NC_LOG_ERROR("Failed to move map archive to (%s): %s", archivePath.c_str(), errorCode.message().c_str());
+        fs::remove(temporaryPath, errorCode);
+        return false;
+    }
+
+    return true;
+}
+
+void MapArchive::EncodeChunk(const Terrain::ChunkView& view, std::vector<u8>& encoded, f32& maxHeightError)
+{
+    f32 minHeight = std::numeric_limits<f32>::max();
+    f32 maxHeight = std::numeric_limits<f32>::lowest();
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        for (u32 j = 0; j < Terrain::MAP_CELL_TOTAL_GRID_SIZE; j++)
+        {
+            minHeight = glm::min(minHeight, view.cells[i].heightData[j]);
+            maxHeight = glm::max(maxHeight, view.cells[i].heightData[j]);
+        }
+    }
+
+    // Heights are relative to the height range in the HeightHeader, unless the cells go outside of it
+    const Terrain::HeightHeader& heightHeader = *view.heightHeader;
+    const bool useHeaderRange = heightHeader.gridMinHeight <= minHeight && heightHeader.gridMaxHeight >= maxHeight;
+
+    EncodedChunkHeader header;
+    memcpy(&header.chunkHeader, view.chunkHeader, sizeof(Terrain::ChunkHeader));
+    memcpy(&header.heightHeader, view.heightHeader, sizeof(Terrain::HeightHeader));
+    memcpy(&header.heightBox, view.heightBox, sizeof(Terrain::HeightBox));
+    header.heightBase = useHeaderRange ? heightHeader.gridMinHeight : minHeight;
+    header.heightStep = ((useHeaderRange ? heightHeader.gridMaxHeight : maxHeight) - header.heightBase) / 65535.0f;
+    header.alphaMapStringID = view.alphaMapStringID;
+    header.numMapObjectPlacements = view.numMapObjectPlacements;
+    header.stringTableSize = static_cast<u32>(view.stringTableSize);
+    Append(encoded, &header, sizeof(EncodedChunkHeader));
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Append(encoded, &view.cells[i].areaId, sizeof(u16));
+    }
+
+    // Heights are stored as the difference to the previous height of their cell, split into a plane of low bytes and one of high bytes
+    // Neighbouring heights are close, so most high bytes end up 0 or 255 which is what makes them compress
+    {
+        const size_t lowOffset = encoded.size();
+        const size_t highOffset = lowOffset + NUM_CELL_HEIGHTS;
+        encoded.resize(highOffset + NUM_CELL_HEIGHTS);
+
+        const f32 inverseStep = header.heightStep > 0.0f ? 1.0f / header.heightStep : 0.0f;
+        for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+        {
+            u16 previous = 0;
+            for (u32 j = 0; j < Terrain::MAP_CELL_TOTAL_GRID_SIZE; j++)
+            {
+                const f32 height = view.cells[i].heightData[j];
+                const u16 quantized = static_cast<u16>(glm::clamp(glm::round((height - header.heightBase) * inverseStep), 0.0f, 65535.0f));
+                const u16 delta = static_cast<u16>(quantized - previous);
+                previous = quantized;
+
+                const u32 index = (i * Terrain::MAP_CELL_TOTAL_GRID_SIZE) + j;
+                encoded[lowOffset + index] = static_cast<u8>(delta & 0xFF);
+                encoded[highOffset + index] = static_cast<u8>(delta >> 8);
+
+                maxHeightError = glm::max(maxHeightError, glm::abs(header.heightBase + (quantized * header.heightStep) - height));
+            }
+        }
+    }
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Append(encoded, view.cells[i].normalData, sizeof(view.cells[i].normalData));
+    }
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Append(encoded, view.cells[i].colorData, sizeof(view.cells[i].colorData));
+    }
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Append(encoded, &view.cells[i].liquidData, sizeof(Terrain::LiquidData));
+    }
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Append(encoded, &view.cells[i].hole, sizeof(u16));
+    }
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Append(encoded, view.cells[i].layers, sizeof(view.cells[i].layers));
+    }
+
+    Append(encoded, view.mapObjectPlacements, sizeof(Terrain::MapObjectPlacement) * view.numMapObjectPlacements);
+    Append(encoded, view.stringTableData, view.stringTableSize);
+}
+
+bool MapArchive::DecodeChunk(const u8* data, size_t size, u32 unpackedSize, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch)
+{
+    scratch.resize(unpackedSize);
+    if (!LZCompression::Decompress(data, size, scratch.data(), unpackedSize))
+        return false;
+
+    size_t offset = 0;
+    const u8* headerData = Take(scratch, offset, sizeof(EncodedChunkHeader));
+    if (headerData == nullptr)
+        return false;
+
+    EncodedChunkHeader header;
+    memcpy(&header, headerData, sizeof(EncodedChunkHeader));
+
+    chunk.chunkHeader = header.chunkHeader;
+    chunk.heightHeader = header.heightHeader;
+    chunk.heightBox = header.heightBox;
+    chunk.alphaMapStringID = header.alphaMapStringID;
+
+    const u8* areaIds = Take(scratch, offset, sizeof(u16) * Terrain::MAP_CELLS_PER_CHUNK);
+    const u8* heightLow = Take(scratch, offset, NUM_CELL_HEIGHTS);
+    const u8* heightHigh = Take(scratch, offset, NUM_CELL_HEIGHTS);
+    const u8* normals = Take(scratch, offset, sizeof(Terrain::Cell::normalData) * Terrain::MAP_CELLS_PER_CHUNK);
+    const u8* colors = Take(scratch, offset, sizeof(Terrain::Cell::colorData) * Terrain::MAP_CELLS_PER_CHUNK);
+    const u8* liquids = Take(scratch, offset, sizeof(Terrain::LiquidData) * Terrain::MAP_CELLS_PER_CHUNK);
+    const u8* holes = Take(scratch, offset, sizeof(u16) * Terrain::MAP_CELLS_PER_CHUNK);
+    const u8* layers = Take(scratch, offset, sizeof(Terrain::Cell::layers) * Terrain::MAP_CELLS_PER_CHUNK);
+    const u8* placements = Take(scratch, offset, sizeof(Terrain::MapObjectPlacement) * static_cast<size_t>(header.numMapObjectPlacements));
+    const u8* stringTableData = Take(scratch, offset, header.stringTableSize);
+
+    if (areaIds == nullptr || heightLow == nullptr || heightHigh == nullptr || normals == nullptr || colors == nullptr || liquids == nullptr || holes == nullptr || layers == nullptr || placements == nullptr || stringTableData == nullptr)
+        return false;
+
+    for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
+    {
+        Terrain::Cell& cell = chunk.cells[i];
+
+        memcpy(&cell.areaId, &areaIds[i * sizeof(u16)], sizeof(u16));
+
+        u16 quantized = 0;
+        for (u32 j = 0; j < Terrain::MAP_CELL_TOTAL_GRID_SIZE; j++)
+        {
+            const u32 index = (i * Terrain::MAP_CELL_TOTAL_GRID_SIZE) + j;
+            quantized += static_cast<u16>(heightLow[index] | (heightHigh[index] << 8));
+            cell.heightData[j] = header.heightBase + (quantized * header.heightStep);
+        }
+
+        memcpy(cell.normalData, &normals[i * sizeof(cell.normalData)], sizeof(cell.normalData));
+        memcpy(cell.colorData, &colors[i * sizeof(cell.colorData)], sizeof(cell.colorData));
+        memcpy(&cell.liquidData, &liquids[i * sizeof(Terrain::LiquidData)], sizeof(Terrain::LiquidData));
+        memcpy(&cell.hole, &holes[i * sizeof(u16)], sizeof(u16));
+        memcpy(cell.layers, &layers[i * sizeof(cell.layers)], sizeof(cell.layers));
+    }
+
+    chunk.mapObjectPlacements.resize(header.numMapObjectPlacements);
+    if (header.numMapObjectPlacements > 0)
+    {
+        memcpy(&chunk.mapObjectPlacements[0], placements, sizeof(Terrain::MapObjectPlacement) * header.numMapObjectPlacements);
+    }
+
+    Bytebuffer stringTableBuffer(const_cast<u8*>(stringTableData), header.stringTableSize);
+    stringTableBuffer.writtenData = header.stringTableSize;
+    stringTable.Deserialize(&stringTableBuffer);
+
+    return stringTable.GetNumStrings() > 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <NovusTypes.h>
+#include <string>
+#include <vector>
+
+#include "ChunkIndex.h"
+
+class StringTable;
+class MappedFile;
+namespace Terrain
+{
+    struct Chunk;
+    struct ChunkView;
+}
+
+// One file per map, stored as <map>.narc in the map folder, holding every chunk of it compressed with LZCompression
+// The file starts with a table of contents that doubles as the chunk index, so an archived map needs neither the loose .nmap files nor a .nidx
+// Heights are stored as 16 bit steps between the lowest and highest height of their chunk, that makes them lossy by up to half a step
+class MapArchive
+{
+public:
+    static constexpr u32 TOKEN = 1129464142; // NARC
+    static constexpr u32 VERSION = 1;
+
+    struct PackStats
+    {
+        u32 numChunks = 0;
+        u64 unpackedBytes = 0; // What the .nmap files add up to
+        u64 packedBytes = 0;
+        f32 maxHeightError = 0.0f;
+    };
+
+    static std::string GetPath(const std::string& mapFolder, const std::string& mapInternalName);
+
+    // Maps the archive into archiveFile and fills locations from the table of contents, their path is the archive itself
+    // archiveFile stays open on success so the chunks can be decoded from it without mapping the archive again
+    static bool ReadTableOfContents(const std::string& archivePath, MappedFile& archiveFile, ChunkIndex::ChunkLocations& locations);
+
+    // Packs every .nmap file in mapFolder into one archive at archivePath
+    static bool Pack(const std::string& mapFolder, const std::string& archivePath, PackStats& stats);
+
+    // data is the compressed block of one chunk, scratch is where it gets decompressed to before it is decoded into chunk and stringTable
+    static bool DecodeChunk(const u8* data, size_t size, u32 unpackedSize, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch);
+
+private:
+#pragma pack(push, 1)
+    struct Header
+    {
+        u32 token = 0;
+        u32 version = 0;
+        u32 numChunks = 0;
+        u32 padding = 0;
+    };
+
+    struct TableEntry
+    {
+        u16 chunkID = 0;
+        u16 padding = 0;
+        u32 unpackedSize = 0;
+        u64 offset = 0;
+        u64 size = 0;
+        u64 contentHash = 0; // Of the .nmap file the chunk was packed from
+        f32 boundsMin[3] = { 0 };
+        f32 boundsMax[3] = { 0 };
+    };
+#pragma pack(pop)
+
+    static void EncodeChunk(const Terrain::ChunkView& view, std::vector<u8>& encoded, f32& maxHeightError);
+};
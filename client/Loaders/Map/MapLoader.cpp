@@ -2,15 +2,31 @@
 #include <Utils/ByteBuffer.h>
 #include <Utils/DebugHandler.h>
 #include <Utils/StringUtils.h>
+#include <Utils/Timer.h>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <entt.hpp>
+#include <taskflow/taskflow.hpp>
+#include <tracy/Tracy.hpp>
 
 #include "../DBC/DBC.h"
 #include "../../ECS/Components/Singletons/MapSingleton.h"
 #include "../../ECS/Components/Singletons/DBCSingleton.h"
+#include "../../Utils/MappedFile.h"
+#include "CVar/CVarSystem.h"
+#include "ChunkIndex.h"
+#include "MapArchive.h"
 
 namespace fs = std::filesystem;
 
+AutoCVar_Int CVAR_MapLoaderChunkIndex("map.loader.chunkIndex", "find map chunks through the cooked chunk index of the map instead of walking its folder", 1, CVarFlags::EditCheckbox);
+AutoCVar_Int CVAR_MapLoaderVerifyChunkHashes("map.loader.verifyChunkHashes", "compare mapped chunks against the content hash in the chunk index", 0, CVarFlags::EditCheckbox);
+AutoCVar_Int CVAR_MapLoaderArchives("map.loader.archives", "load maps from their packed .narc archive when there is one", 1, CVarFlags::EditCheckbox);
+AutoCVar_Int CVAR_MapLoaderThreads("map.loader.threads", "number of threads that load the chunks of a map that isn't streamed, 0 uses every hardware thread", 0);
+AutoCVar_Int CVAR_MapLoaderMappedFiles("map.loader.mappedFiles", "read map chunks through memory mapped files instead of copying them into a buffer first", 1, CVarFlags::EditCheckbox);
+
 bool MapLoader::Init(entt::registry* registry)
 {
     fs::path absolutePath = std::filesystem::absolute("Data/extracted/maps");
@@ -55,7 +71,7 @@ bool MapLoader::Init(entt::registry* registry)
     return true;
 }
 
-bool MapLoader::LoadMap(entt::registry* registry, u32 mapInternalNameHash)
+bool MapLoader::LoadMap(entt::registry* registry, u32 mapInternalNameHash, bool streamChunks)
 {
     MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
     DBCSingleton& dbcSingleton = registry->ctx<DBCSingleton>();
@@ -88,64 +104,262 @@ bool MapLoader::LoadMap(entt::registry* registry, u32 mapInternalNameHash)
     mapSingleton.currentMap.id = map->Id;
     mapSingleton.currentMap.name = mapInternalName;
 
-    size_t loadedChunks = 0;
-    for (const auto& entry : std::filesystem::recursive_directory_iterator(absolutePath))
+    const bool useMappedFiles = CVAR_MapLoaderMappedFiles.Get() != 0;
+    Terrain::Map& currentMap = mapSingleton.currentMap;
+
+    // The index knows every chunk of the map, without it the whole map folder has to be walked
+    // A packed map archive has its own table of contents and takes the place of both
+    Timer indexTimer;
+    const std::string mapFolder = absolutePath.string();
+    const std::string archivePath = MapArchive::GetPath(mapFolder, mapInternalName);
+    const std::string indexPath = ChunkIndex::GetPath(mapFolder, mapInternalName);
+    const bool useChunkIndex = CVAR_MapLoaderChunkIndex.Get() != 0;
+    const bool isArchived = CVAR_MapLoaderArchives.Get() && fs::exists(archivePath) && MapArchive::ReadTableOfContents(archivePath, currentMap.archiveFile, currentMap.chunkLocations);
+    if (isArchived)
     {
-        auto file = std::filesystem::path(entry.path());
-        if (file.extension() != ".nmap")
-            continue;
-
-        FileReader chunkFile(entry.path().string(), file.filename().string());
-        if (!chunkFile.Open())
+        NC_LOG_MESSAGE("Found %u chunks in map archive (%s)", static_cast<u32>(currentMap.chunkLocations.size()), archivePath.c_str());
+    }
+    else if (useChunkIndex && ChunkIndex::Read(indexPath, mapFolder, currentMap.chunkLocations))
+    {
+        NC_LOG_MESSAGE("Found %u chunks through the chunk index in %.2f ms", static_cast<u32>(currentMap.chunkLocations.size()), indexTimer.GetLifeTime() * 1000.0f);
+    }
+    else
+    {
+        if (!ChunkIndex::Build(mapFolder, useChunkIndex, currentMap.chunkLocations))
         {
-            NC_LOG_ERROR("Failed to load all maps");
+            NC_LOG_ERROR("Failed to find the chunks of (%s)", mapFolder.c_str());
             return false;
         }
 
-        Terrain::Chunk chunk;
-        StringTable chunkStringTable;
-        if (!ExtractChunkData(chunkFile, chunk, chunkStringTable))
+        if (useChunkIndex && !currentMap.chunkLocations.empty() && ChunkIndex::Write(indexPath, mapFolder, currentMap.chunkLocations))
+        {
+            NC_LOG_MESSAGE("Built chunk index (%s) in %.2f ms", indexPath.c_str(), indexTimer.GetLifeTime() * 1000.0f);
+        }
+    }
+
+    Timer timer;
+    const size_t loadedChunks = currentMap.chunkLocations.size();
+    u32 numThreads = 0;
+    if (!streamChunks && loadedChunks > 0)
+    {
+        numThreads = GetNumLoadThreads();
+        if (!LoadChunks(currentMap.chunkLocations, currentMap.archiveFile, currentMap.chunks, currentMap.stringTables, numThreads))
         {
             NC_LOG_ERROR("Failed to load all maps");
             return false;
         }
 
-        std::vector<std::string> splitName = StringUtils::SplitString(file.filename().string(), '_');
-        size_t numberOfSplits = splitName.size();
+        f32 maxHeightError = 0.0f;
+        for (const auto& itr : currentMap.chunks)
+        {
+            maxHeightError = glm::max(maxHeightError, currentMap.heightfield.SetChunk(itr.first, itr.second));
+        }
+
+        const f32 chunksMB = static_cast<f32>(sizeof(Terrain::Chunk) * currentMap.chunks.size()) / (1024.0f * 1024.0f);
+        const f32 heightfieldMB = static_cast<f32>(currentMap.heightfield.GetResidentBytes()) / (1024.0f * 1024.0f);
+        NC_LOG_MESSAGE("Gameplay heightfield takes %.1f MB instead of the %.1f MB of the chunks, heights are off by up to %.4f yards", heightfieldMB, chunksMB, maxHeightError);
+    }
 
-        std::string mapInternalName = splitName[0];
-        for (size_t i = 1; i < numberOfSplits - 2; i++)
+    if (loadedChunks == 0)
+    {
+        NC_LOG_ERROR("0 maps found in (%s)", absolutePath.string().c_str());
+        return false;
+    }
+
+    if (streamChunks)
+    {
+        NC_LOG_SUCCESS("Found %u chunks to stream", static_cast<u32>(loadedChunks));
+    }
+    else
+    {
+        // Peak RSS never goes down, so compare the two paths from a fresh start of the client
+        const f32 peakResidentMB = static_cast<f32>(MappedFile::GetPeakResidentBytes()) / (1024.0f * 1024.0f);
+        const f32 loadTime = timer.GetLifeTime();
+        NC_LOG_SUCCESS("Loaded %u chunks in %.2f ms (%.0f chunks/s) on %u threads through %s, peak RSS %.1f MB", static_cast<u32>(loadedChunks), loadTime * 1000.0f, static_cast<f32>(loadedChunks) / loadTime, numThreads, isArchived ? "the map archive" : useMappedFiles ? "mapped files" : "file buffers", peakResidentMB);
+    }
+
+    return true;
+}
+
+bool MapLoader::LoadChunk(const Terrain::ChunkLocation& location, const MappedFile& archiveFile, Terrain::Chunk& chunk, StringTable& stringTable)
+{
+    std::vector<u8> scratch;
+    return LoadChunk(location, archiveFile, chunk, stringTable, scratch);
+}
+
+bool MapLoader::LoadChunk(const Terrain::ChunkLocation& location, const MappedFile& archiveFile, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch)
+{
+    if (location.unpackedSize > 0)
+        return LoadArchivedChunk(location, archiveFile, chunk, stringTable, scratch);
+
+    if (CVAR_MapLoaderMappedFiles.Get())
+        return LoadMappedChunk(location, chunk, stringTable);
+
+    FileReader chunkFile(location.path, fs::path(location.path).filename().string());
+    if (!chunkFile.Open())
+    {
+        NC_LOG_ERROR("Failed to open map chunk (%s)", location.path.c_str());
+        return false;
+    }
+
+    return ExtractChunkData(chunkFile, location.offset, chunk, stringTable, scratch);
+}
+
+bool MapLoader::LoadArchivedChunk(const Terrain::ChunkLocation& location, const MappedFile& archiveFile, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch)
+{
+    // The archive stays mapped for as long as its map is loaded, only the pages of this chunk's block are read
+    if (!archiveFile.IsOpen() || location.offset + location.size > archiveFile.GetSize())
+    {
+        NC_LOG_ERROR("Map archive (%s) is not mapped", location.path.c_str());
+        return false;
+    }
+
+    if (!MapArchive::DecodeChunk(archiveFile.GetData() + location.offset, location.size, location.unpackedSize, chunk, stringTable, scratch))
+    {
+        NC_LOG_ERROR("Failed to decode chunk at offset %llu of map archive (%s)", static_cast<unsigned long long>(location.offset), location.path.c_str());
+        return false;
+    }
+
+    return ValidateChunkHeader(chunk.chunkHeader);
+}
+
+bool MapLoader::LoadChunks(const ChunkIndex::ChunkLocations& locations, const MappedFile& archiveFile, robin_hood::unordered_map<u16, Terrain::Chunk>& chunks, robin_hood::unordered_map<u16, StringTable>& stringTables, u32 numThreads)
+{
+    ZoneScoped;
+
+    struct ChunkLoadJob
+    {
+        const Terrain::ChunkLocation* location;
+        Terrain::Chunk* chunk;
+        StringTable* stringTable;
+    };
+
+    // Every chunk gets its entry up front, so the workers decode right into the map and nothing needs to be merged after them
+    // The pointers are only taken once every entry exists, inserting could still move the earlier ones around
+    for (const auto& itr : locations)
+    {
+        chunks[itr.first];
+        stringTables[itr.first];
+    }
+
+    std::vector<ChunkLoadJob> jobs;
+    jobs.reserve(locations.size());
+    for (const auto& itr : locations)
+    {
+        jobs.push_back({ &itr.second, &chunks[itr.first], &stringTables[itr.first] });
+    }
+
+    std::atomic<size_t> nextJob = 0;
+    std::atomic<bool> failed = false;
+
+    // Chunks differ a lot in size, so the workers take one chunk at a time instead of a fixed share of them
+    auto LoadJobs = [&]()
+    {
+        std::vector<u8> scratch; // Archived chunks get decompressed into it and the file buffer path reads into it, every worker keeps reusing its own
+
+        for (size_t i = nextJob++; i < jobs.size() && !failed; i = nextJob++)
         {
-            mapInternalName += "_" + splitName[i];
+            const ChunkLoadJob& job = jobs[i];
+            if (!LoadChunk(*job.location, archiveFile, *job.chunk, *job.stringTable, scratch))
+            {
+                NC_LOG_ERROR("Failed to load map chunk (%s)", job.location->path.c_str());
+                failed = true;
+            }
         }
+    };
 
-        auto itr = mapSingleton.mapInternalNameToDBC.find(mapInternalNameHash);
-        if (itr == mapSingleton.mapInternalNameToDBC.end())
+    numThreads = glm::clamp(numThreads, 1u, static_cast<u32>(jobs.size()));
+    if (numThreads == 1)
+    {
+        LoadJobs();
+    }
+    else
+    {
+        tf::Taskflow taskflow(numThreads);
+        for (u32 i = 0; i < numThreads; i++)
         {
-            NC_LOG_ERROR("Tried to Load Map with no entry in Maps.ndbc (%s, %s)", splitName[0].c_str(), splitName[1].c_str());
-            continue;
+            taskflow.emplace(LoadJobs);
         }
+        taskflow.wait_for_all();
+    }
 
-        u16 x = std::stoi(splitName[numberOfSplits - 2]);
-        u16 y = std::stoi(splitName[numberOfSplits - 1]);
-        u32 chunkId = x + (y * Terrain::MAP_CHUNKS_PER_MAP_STRIDE);
+    return !failed;
+}
 
-        mapSingleton.currentMap.chunks[chunkId] = chunk;
-        mapSingleton.currentMap.stringTables[chunkId].CopyFrom(chunkStringTable);
+u32 MapLoader::GetNumLoadThreads()
+{
+    const i32 numThreads = CVAR_MapLoaderThreads.Get();
+    if (numThreads > 0)
+        return static_cast<u32>(numThreads);
+
+    return glm::max(std::thread::hardware_concurrency(), 1u);
+}
 
-        loadedChunks++;
+bool MapLoader::FindChunkLocations(const std::string& mapInternalName, ChunkIndex::ChunkLocations& locations, MappedFile& archiveFile)
+{
+    const std::string mapFolder = std::filesystem::absolute("Data/extracted/maps/" + mapInternalName).string();
+    if (!fs::is_directory(mapFolder))
+    {
+        NC_LOG_ERROR("Failed to find map folder for %s", mapInternalName.c_str());
+        return false;
     }
 
-    if (loadedChunks == 0)
+    const std::string archivePath = MapArchive::GetPath(mapFolder, mapInternalName);
+    const bool isArchived = CVAR_MapLoaderArchives.Get() && fs::exists(archivePath) && MapArchive::ReadTableOfContents(archivePath, archiveFile, locations);
+    if (!isArchived && !ChunkIndex::Read(ChunkIndex::GetPath(mapFolder, mapInternalName), mapFolder, locations) && !ChunkIndex::Build(mapFolder, false, locations))
     {
-        NC_LOG_ERROR("0 maps found in (%s)", absolutePath.string().c_str());
+        NC_LOG_ERROR("Failed to find the chunks of (%s)", mapFolder.c_str());
+        return false;
+    }
+
+    if (locations.empty())
+    {
+        NC_LOG_ERROR("0 maps found in (%s)", mapFolder.c_str());
         return false;
     }
 
-    NC_LOG_SUCCESS("Loaded %u chunks", loadedChunks);
     return true;
 }
 
+void MapLoader::BenchmarkLoad(const std::string& mapInternalName)
+{
+    ChunkIndex::ChunkLocations locations;
+    MappedFile archiveFile;
+    if (!FindChunkLocations(mapInternalName, locations, archiveFile))
+        return;
+
+    const bool isArchived = archiveFile.IsOpen();
+
+    const u32 maxThreads = glm::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<u32> threadCounts = { 1, 2, 4, 8 };
+    threadCounts.erase(std::remove_if(threadCounts.begin(), threadCounts.end(), [maxThreads](u32 numThreads) { return numThreads >= maxThreads; }), threadCounts.end());
+    threadCounts.push_back(maxThreads);
+
+    NC_LOG_MESSAGE("Benchmarking the load of %u chunks of %s through %s", static_cast<u32>(locations.size()), mapInternalName.c_str(), isArchived ? "the map archive" : CVAR_MapLoaderMappedFiles.Get() ? "mapped files" : "file buffers");
+
+    // The first load is only there to get the files into the OS file cache, otherwise the 1 thread run would pay for the disk alone
+    for (i32 run = -1; run < static_cast<i32>(threadCounts.size()); run++)
+    {
+        const u32 numThreads = run < 0 ? maxThreads : threadCounts[run];
+
+        robin_hood::unordered_map<u16, Terrain::Chunk> chunks;
+        robin_hood::unordered_map<u16, StringTable> stringTables;
+
+        Timer timer;
+        if (!LoadChunks(locations, archiveFile, chunks, stringTables, numThreads))
+        {
+            NC_LOG_ERROR("Benchmark load on %u threads failed", numThreads);
+            return;
+        }
+        const f32 loadTime = timer.GetLifeTime();
+
+        if (run >= 0)
+        {
+            NC_LOG_MESSAGE("%u threads: %.2f ms, %.0f chunks/s", numThreads, loadTime * 1000.0f, static_cast<f32>(locations.size()) / loadTime);
+        }
+    }
+}
+
 bool MapLoader::ExtractMapDBC(DBC::File& file, std::vector<DBC::Map>& maps)
 {
     u32 numMaps = 0;
@@ -160,29 +374,17 @@ bool MapLoader::ExtractMapDBC(DBC::File& file, std::vector<DBC::Map>& maps)
     return true;
 }
 
-bool MapLoader::ExtractChunkData(FileReader& reader, Terrain::Chunk& chunk, StringTable& stringTable)
+bool MapLoader::ExtractChunkData(FileReader& reader, u64 offset, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch)
 {
-    Bytebuffer buffer(nullptr, reader.Length());
+    // scratch only grows, so a worker going through many chunks stops allocating once it saw the biggest one
+    scratch.resize(reader.Length());
+    Bytebuffer buffer(scratch.data(), scratch.size());
     reader.Read(&buffer, buffer.size);
+    buffer.readData = offset;
 
     buffer.Get<Terrain::ChunkHeader>(chunk.chunkHeader);
-
-    if (chunk.chunkHeader.token != Terrain::MAP_CHUNK_TOKEN)
-    {
-        NC_LOG_FATAL("Tried to load a map chunk file with the wrong token");
-    }
-
-    if (chunk.chunkHeader.version != Terrain::MAP_CHUNK_VERSION)
-    {
-        if (chunk.chunkHeader.version < Terrain::MAP_CHUNK_VERSION)
-        {
-            NC_LOG_FATAL("Loaded map chunk with too old version %u instead of expected version of %u, rerun dataextractor", chunk.chunkHeader.version, Terrain::MAP_CHUNK_VERSION);
-        }
-        else
-        {
-            NC_LOG_FATAL("Loaded map chunk with too new version %u instead of expected version of %u, update your client", chunk.chunkHeader.version, Terrain::MAP_CHUNK_VERSION);
-        }
-    }
+    if (!ValidateChunkHeader(chunk.chunkHeader))
+        return false;
 
     buffer.Get<Terrain::HeightHeader>(chunk.heightHeader);
     buffer.Get<Terrain::HeightBox>(chunk.heightBox);
@@ -203,4 +405,72 @@ bool MapLoader::ExtractChunkData(FileReader& reader, Terrain::Chunk& chunk, Stri
     stringTable.Deserialize(&buffer);
     assert(stringTable.GetNumStrings() > 0); // We always expect to have at least 1 string in our stringtable, a path for the base texture
     return true;
-}
\ No newline at end of file
+}
+
+bool MapLoader::LoadMappedChunk(const Terrain::ChunkLocation& location, Terrain::Chunk& chunk, StringTable& stringTable)
+{
+    MappedFile chunkFile;
+    if (!chunkFile.Open(location.path))
+    {
+        NC_LOG_ERROR("Failed to map map chunk (%s)", location.path.c_str());
+        return false;
+    }
+
+    // Locations from a folder walk have no size of their own, the chunk is the whole file then
+    const u64 size = location.size > 0 ? location.size : chunkFile.GetSize() - location.offset;
+    if (location.offset + size > chunkFile.GetSize())
+    {
+        NC_LOG_ERROR("Map chunk (%s) is smaller than the chunk index says, rebuild the index by deleting it", location.path.c_str());
+        return false;
+    }
+
+    const u8* data = chunkFile.GetData() + location.offset;
+    if (CVAR_MapLoaderVerifyChunkHashes.Get() && location.contentHash != 0 && ChunkIndex::HashContent(data, size) != location.contentHash)
+    {
+        NC_LOG_WARNING("Map chunk (%s) changed since the chunk index was built", location.path.c_str());
+    }
+
+    Terrain::ChunkView view;
+    if (!view.Parse(data, size))
+    {
+        NC_LOG_ERROR("Map chunk is too small for its contents (%s)", location.path.c_str());
+        return false;
+    }
+
+    if (!ValidateChunkHeader(*view.chunkHeader))
+        return false;
+
+    view.Decode(chunk);
+
+    // The string table is deserialized from the mapped pages as well, the buffer doesn't own them
+    Bytebuffer stringTableBuffer(const_cast<u8*>(view.stringTableData), view.stringTableSize);
+    stringTableBuffer.writtenData = view.stringTableSize;
+
+    stringTable.Deserialize(&stringTableBuffer);
+    assert(stringTable.GetNumStrings() > 0); // We always expect to have at least 1 string in our stringtable, a path for the base texture
+    return true;
+}
+
+bool MapLoader::ValidateChunkHeader(const Terrain::ChunkHeader& chunkHeader)
+{
+    if (chunkHeader.token != Terrain::MAP_CHUNK_TOKEN)
+    {
+        NC_LOG_FATAL("Tried to load a map chunk file with the wrong token");
+        return false;
+    }
+
+    if (chunkHeader.version != Terrain::MAP_CHUNK_VERSION)
+    {
+        if (chunkHeader.version < Terrain::MAP_CHUNK_VERSION)
+        {
+            NC_LOG_FATAL("Loaded map chunk with too old version %u instead of expected version of %u, rerun dataextractor", chunkHeader.version, Terrain::MAP_CHUNK_VERSION);
+        }
+        else
+        {
+            NC_LOG_FATAL("Loaded map chunk with too new version %u instead of expected version of %u, update your client", chunkHeader.version, Terrain::MAP_CHUNK_VERSION);
+        }
+        return false;
+    }
+
+    return true;
+}
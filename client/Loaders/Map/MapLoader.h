@@ -26,11 +26,17 @@
 #include <Utils/FileReader.h>
 #include <entity/fwd.hpp>
 #include <vector>
+#include <string>
+
+#include "ChunkIndex.h"
 
 class StringTable;
+class MappedFile;
 namespace Terrain
 {
     struct Chunk;
+    struct ChunkHeader;
+    struct ChunkLocation;
 }
 
 namespace DBC
@@ -45,9 +51,32 @@ public:
     MapLoader() { }
 
     static bool Init(entt::registry* registry);
-    static bool LoadMap(entt::registry* registry, u32 mapInternalNameHash);
+    // With streamChunks set only the chunk locations are collected, chunks are then read on demand through LoadChunk
+    static bool LoadMap(entt::registry* registry, u32 mapInternalNameHash, bool streamChunks = false);
+
+    // Safe to call from any thread, map.loader.mappedFiles picks between LoadMappedChunk and reading the whole file into a buffer
+    // Archived chunks are decoded from archiveFile, the mapping of the archive their locations came from
+    static bool LoadChunk(const Terrain::ChunkLocation& location, const MappedFile& archiveFile, Terrain::Chunk& chunk, StringTable& stringTable);
+
+    // Loads every location into chunks and stringTables on numThreads threads, map.loader.threads is what LoadMap uses
+    static bool LoadChunks(const ChunkIndex::ChunkLocations& locations, const MappedFile& archiveFile, robin_hood::unordered_map<u16, Terrain::Chunk>& chunks, robin_hood::unordered_map<u16, StringTable>& stringTables, u32 numThreads);
+    static u32 GetNumLoadThreads();
+
+    // Finds the chunks of a map the way LoadMap would without loading any of them, archiveFile is left open when they are in a map archive
+    static bool FindChunkLocations(const std::string& mapInternalName, ChunkIndex::ChunkLocations& locations, MappedFile& archiveFile);
+
+    // Loads the whole map on 1, 2, 4, 8 and every hardware thread and logs the chunks per second of each, without touching the current map
+    static void BenchmarkLoad(const std::string& mapInternalName);
 
 private:
     static bool ExtractMapDBC(DBC::File& file, std::vector<DBC::Map>& maps);
-    static bool ExtractChunkData(FileReader& reader, Terrain::Chunk& chunk, StringTable& stringTable);
+    static bool ExtractChunkData(FileReader& reader, u64 offset, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch);
+
+    // scratch is reused by whatever path the location needs a buffer for, so callers loading many chunks can keep one around
+    static bool LoadChunk(const Terrain::ChunkLocation& location, const MappedFile& archiveFile, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch);
+    static bool LoadArchivedChunk(const Terrain::ChunkLocation& location, const MappedFile& archiveFile, Terrain::Chunk& chunk, StringTable& stringTable, std::vector<u8>& scratch);
+
+    // Decodes straight from the mapped file into chunk and stringTable, without reading the file into a buffer first
+    static bool LoadMappedChunk(const Terrain::ChunkLocation& location, Terrain::Chunk& chunk, StringTable& stringTable);
+    static bool ValidateChunkHeader(const Terrain::ChunkHeader& chunkHeader);
 };
\ No newline at end of file
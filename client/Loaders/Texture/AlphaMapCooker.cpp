@@ -0,0 +1,461 @@
+#include "AlphaMapCooker.h"
+#include <Utils/DebugHandler.h>
+#include <gli/gli.hpp>
+#include <tracy/Tracy.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+// BC7 blocks are read and written one bit field at a time, lowest bit first
+static void WriteBits(u8* block, u32& offset, u32 value, u32 numBits)
+{
+    for (u32 i = 0; i < numBits; i++, offset++)
+    {
+        block[offset / 8] |= static_cast<u8>(((value >> i) & 1) << (offset % 8));
+    }
+}
+
+static u32 ReadBits(const u8* block, u32& offset, u32 numBits)
+{
+    u32 value = 0;
+    for (u32 i = 0; i < numBits; i++, offset++)
+    {
+        value |= static_cast<u32>((block[offset / 8] >> (offset % 8)) & 1) << i;
+    }
+
+    return value;
+}
+
+static void GetBC4Palette(u8 endpoint0, u8 endpoint1, u8 palette[8])
+{
+    palette[0] = endpoint0;
+    palette[1] = endpoint1;
+
+    // With endpoint0 > endpoint1 there are 6 values between them, otherwise 4 plus 0 and 255
+    if (endpoint0 > endpoint1)
+    {
+        for (u32 i = 1; i < 7; i++)
+        {
+            palette[i + 1] = static_cast<u8>((((7 - i) * endpoint0 + i * endpoint1) * 2 + 7) / 14);
+        }
+    }
+    else
+    {
+        for (u32 i = 1; i < 5; i++)
+        {
+            palette[i + 1] = static_cast<u8>((((5 - i) * endpoint0 + i * endpoint1) * 2 + 5) / 10);
+        }
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// Mode 6 is the only BC7 mode we write, one subset with 7 bit rgba endpoints, a p-bit per endpoint and 4 bit indices
+static const u32 BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+AlphaMapCooker::Format AlphaMapCooker::GetFormat(u8 numLayers)
+{
+    if (numLayers <= 2)
+        return Format::BC4;
+
+    if (numLayers == 3)
+        return Format::BC5;
+
+    return Format::BC7;
+}
+
+std::string AlphaMapCooker::GetCookedPath(const std::string& path, Format format)
+{
+    static const char* extensions[] = { ".bc4.dds", ".bc5.dds", ".bc7.dds" };
+
+    fs::path cookedPath = path;
+    cookedPath.replace_extension(extensions[static_cast<u8>(format)]);
+
+    return cookedPath.string();
+}
+
+bool AlphaMapCooker::ReadInfo(const std::string& path, Info& info)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    // Magic, DDS_HEADER and the optional DDS_HEADER_DXT10 which is where the layer count of arrays is
+    u8 header[148] = { 0 };
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (file.gcount() < 128 || memcmp(header, "DDS ", 4) != 0)
+        return false;
+
+    u32 fourCC;
+    memcpy(&info.height, &header[12], sizeof(u32));
+    memcpy(&info.width, &header[16], sizeof(u32));
+    memcpy(&fourCC, &header[84], sizeof(u32));
+
+    info.layers = 1;
+    if (fourCC == 0x30315844 && file.gcount() == sizeof(header)) // "DX10"
+    {
+        memcpy(&info.layers, &header[140], sizeof(u32));
+        info.layers = glm::max(info.layers, 1u);
+    }
+
+    return true;
+}
+
+size_t AlphaMapCooker::GetCompressedSize(const Info& info, Format format)
+{
+    const size_t blockSize = format == Format::BC4 ? 8 : 16;
+    return static_cast<size_t>((info.width + 3) / 4) * ((info.height + 3) / 4) * info.layers * blockSize;
+}
+
+bool AlphaMapCooker::Cook(const std::string& path, const std::string& cookedPath, Format format, CookResult& result)
+{
+    ZoneScoped;
+
+    gli::texture source = gli::load(path);
+    if (source.empty())
+    {
+        NC_LOG_ERROR("Failed to load alpha map (%s) for cooking", path.c_str());
+        return false;
+    }
+
+    // The uncompressed path uploads these as they are, anything else was already cooked by someone else
+    const bool isBGRA = source.format() == gli::FORMAT_BGRA8_UNORM_PACK8;
+    if (!isBGRA && source.format() != gli::FORMAT_RGBA8_UNORM_PACK8)
+    {
+        NC_LOG_ERROR("Alpha map (%s) is not uncompressed RGBA8, it can't be cooked", path.c_str());
+        return false;
+    }
+
+    const gli::extent3d extent = source.extent(0);
+    result.info.width = static_cast<u32>(extent.x);
+    result.info.height = static_cast<u32>(extent.y);
+    result.info.layers = static_cast<u32>(source.layers());
+
+    if (result.info.width % 4 != 0 || result.info.height % 4 != 0)
+    {
+        NC_LOG_ERROR("Alpha map (%s) is %ux%u, cooking needs a multiple of 4", path.c_str(), result.info.width, result.info.height);
+        return false;
+    }
+
+    static const gli::format cookedFormats[] = { gli::FORMAT_R_ATI1N_UNORM_BLOCK8, gli::FORMAT_RG_ATI2N_UNORM_BLOCK16, gli::FORMAT_RGBA_BP_UNORM_BLOCK16 };
+    gli::texture2d_array cooked(cookedFormats[static_cast<u8>(format)], gli::extent2d(extent.x, extent.y), source.layers(), 1);
+
+    const u32 blockSize = format == Format::BC4 ? 8 : 16;
+    const u32 numChannels = static_cast<u32>(format) + 1;
+    const u32 blocksPerRow = result.info.width / 4;
+
+    u64 squaredErrorSum = 0;
+    result.maxError = 0;
+
+    for (u32 layer = 0; layer < result.info.layers; layer++)
+    {
+        const u8* sourcePixels = static_cast<const u8*>(source.data(layer, 0, 0));
+        u8* cookedBlocks = static_cast<u8*>(cooked.data(layer, 0, 0));
+
+        for (u32 blockY = 0; blockY < result.info.height / 4; blockY++)
+        {
+            for (u32 blockX = 0; blockX < blocksPerRow; blockX++)
+            {
+                u8 pixels[16][4];
+                for (u32 i = 0; i < 16; i++)
+                {
+                    const u32 x = blockX * 4 + (i % 4);
+                    const u32 y = blockY * 4 + (i / 4);
+                    const u8* pixel = &sourcePixels[(y * result.info.width + x) * 4];
+
+                    pixels[i][0] = isBGRA ? pixel[2] : pixel[0];
+                    pixels[i][1] = pixel[1];
+                    pixels[i][2] = isBGRA ? pixel[0] : pixel[2];
+                    pixels[i][3] = 255;
+                }
+
+                u8* block = &cookedBlocks[(blockY * blocksPerRow + blockX) * blockSize];
+
+                // Every block is decoded again right away, that is what the error is measured on
+                u8 decoded[16][4] = { { 0 } };
+                if (format == Format::BC7)
+                {
+                    EncodeBC7(pixels, block);
+                    DecodeBC7(block, decoded);
+                }
+                else
+                {
+                    for (u32 channel = 0; channel < numChannels; channel++)
+                    {
+                        u8 values[16];
+                        for (u32 i = 0; i < 16; i++)
+                        {
+                            values[i] = pixels[i][channel];
+                        }
+
+                        EncodeBC4(values, &block[channel * 8]);
+                        DecodeBC4(&block[channel * 8], values);
+
+                        for (u32 i = 0; i < 16; i++)
+                        {
+                            decoded[i][channel] = values[i];
+                        }
+                    }
+                }
+
+                for (u32 i = 0; i < 16; i++)
+                {
+                    for (u32 channel = 0; channel < numChannels; channel++)
+                    {
+                        const u32 error = static_cast<u32>(glm::abs(static_cast<i32>(pixels[i][channel]) - static_cast<i32>(decoded[i][channel])));
+                        result.maxError = glm::max(result.maxError, error);
+                        squaredErrorSum += error * error;
+                    }
+                }
+            }
+        }
+    }
+
+    const f64 numValues = static_cast<f64>(result.info.width) * result.info.height * result.info.layers * numChannels;
+    result.rmsError = static_cast<f32>(glm::sqrt(static_cast<f64>(squaredErrorSum) / numValues));
+
+    if (result.maxError > MAX_EXPECTED_ERROR)
+    {
+        NC_LOG_WARNING("Cooked alpha map (%s) is off by up to %u (%.2f RMS) from the uncompressed one", cookedPath.c_str(), result.maxError, result.rmsError);
+    }
+
+    const std::string temporaryPath = cookedPath + ".tmp";
+    if (!gli::save_dds(cooked, temporaryPath))
+    {
+        NC_LOG_ERROR("Failed to write cooked alpha map (%s)", temporaryPath.c_str());
+        return false;
+    }
+
+    std::error_code errorCode;
+    fs::rename(temporaryPath, cookedPath, errorCode);
+    if (errorCode)
+    {
+        NC_LOG_ERROR("Failed to move cooked alpha map to (%s): %s", cookedPath.c_str(), errorCode.message().c_str());
+        fs::remove(temporaryPath, errorCode);
+        return false;
+    }
+
+    return true;
+}
+
+void AlphaMapCooker::EncodeBC4(const u8* values, u8* block)
+{
+    u8 min = 255;
+    u8 max = 0;
+    for (u32 i = 0; i < 16; i++)
+    {
+        min = glm::min(min, values[i]);
+        max = glm::max(max, values[i]);
+    }
+
+    // Max first picks the 8 value palette, with max == min every index decodes to the same value anyway
+    block[0] = max;
+    block[1] = min;
+
+    u8 palette[8];
+    GetBC4Palette(max, min, palette);
+
+    u64 indices = 0;
+    for (u32 i = 0; i < 16; i++)
+    {
+        u32 bestIndex = 0;
+        i32 bestError = 256;
+
+        for (u32 j = 0; j < 8; j++)
+        {
+            const i32 error = glm::abs(static_cast<i32>(values[i]) - static_cast<i32>(palette[j]));
+            if (error < bestError)
+            {
+                bestIndex = j;
+                bestError = error;
+            }
+        }
+
+        indices |= static_cast<u64>(bestIndex) << (i * 3);
+    }
+
+    for (u32 i = 0; i < 6; i++)
+    {
+        block[2 + i] = static_cast<u8>(indices >> (i * 8));
+    }
+}
+
+void AlphaMapCooker::DecodeBC4(const u8* block, u8* values)
+{
+    u8 palette[8];
+    GetBC4Palette(block[0], block[1], palette);
+
+    u64 indices = 0;
+    for (u32 i = 0; i < 6; i++)
+    {
+        indices |= static_cast<u64>(block[2 + i]) << (i * 8);
+    }
+
+    for (u32 i = 0; i < 16; i++)
+    {
+        values[i] = palette[(indices >> (i * 3)) & 0x7];
+    }
+}
+
+void AlphaMapCooker::EncodeBC7(const u8 (*pixels)[4], u8* block)
+{
+    // The endpoints go on the principal axis of the block's colors, alpha is not used by the terrain and stays at 255
+    vec3 mean = vec3(0.0f);
+    for (u32 i = 0; i < 16; i++)
+    {
+        mean += vec3(pixels[i][0], pixels[i][1], pixels[i][2]);
+    }
+    mean /= 16.0f;
+
+    glm::mat3 covariance = glm::mat3(0.0f);
+    for (u32 i = 0; i < 16; i++)
+    {
+        const vec3 offset = vec3(pixels[i][0], pixels[i][1], pixels[i][2]) - mean;
+        covariance += glm::outerProduct(offset, offset);
+    }
+
+    vec3 axis = vec3(1.0f);
+    for (u32 i = 0; i < 8; i++)
+    {
+        const vec3 next = covariance * axis;
+        const f32 length = glm::length(next);
+        if (length < 1e-4f)
+            break;
+
+        axis = next / length;
+    }
+    axis = glm::normalize(axis);
+
+    f32 minT = 0.0f;
+    f32 maxT = 0.0f;
+    for (u32 i = 0; i < 16; i++)
+    {
+        const f32 t = glm::dot(vec3(pixels[i][0], pixels[i][1], pixels[i][2]) - mean, axis);
+        minT = glm::min(minT, t);
+        maxT = glm::max(maxT, t);
+    }
+
+    const vec3 endpoints[2] = { glm::clamp(mean + axis * minT, 0.0f, 255.0f), glm::clamp(mean + axis * maxT, 0.0f, 255.0f) };
+
+    // Every endpoint is 7 bits per channel plus a p-bit shared by its channels, try both p-bits
+    u32 quantized[2][3];
+    u32 pBits[2];
+    i32 colors[2][3];
+    for (u32 e = 0; e < 2; e++)
+    {
+        f32 bestError = std::numeric_limits<f32>::max();
+        for (u32 p = 0; p < 2; p++)
+        {
+            u32 candidate[3];
+            f32 error = 0.0f;
+            for (u32 c = 0; c < 3; c++)
+            {
+                candidate[c] = static_cast<u32>(glm::clamp(static_cast<i32>(glm::round((endpoints[e][c] - p) / 2.0f)), 0, 127));
+                const f32 difference = static_cast<f32>((candidate[c] << 1) | p) - endpoints[e][c];
+                error += difference * difference;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                pBits[e] = p;
+                for (u32 c = 0; c < 3; c++)
+                {
+                    quantized[e][c] = candidate[c];
+                    colors[e][c] = static_cast<i32>((candidate[c] << 1) | p);
+                }
+            }
+        }
+    }
+
+    u32 indices[16];
+    for (u32 i = 0; i < 16; i++)
+    {
+        i32 bestError = std::numeric_limits<i32>::max();
+        for (u32 j = 0; j < 16; j++)
+        {
+            i32 error = 0;
+            for (u32 c = 0; c < 3; c++)
+            {
+                const i32 value = ((64 - BC7_WEIGHTS[j]) * colors[0][c] + BC7_WEIGHTS[j] * colors[1][c] + 32) >> 6;
+                error += (value - pixels[i][c]) * (value - pixels[i][c]);
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = j;
+            }
+        }
+    }
+
+    // The first index only gets 3 bits, its top bit has to be 0 so the endpoints get swapped if it isn't
+    if (indices[0] & 0x8)
+    {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (u32 i = 0; i < 16; i++)
+        {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    memset(block, 0, 16);
+
+    u32 offset = 0;
+    WriteBits(block, offset, 1 << 6, 7);
+    for (u32 c = 0; c < 3; c++)
+    {
+        WriteBits(block, offset, quantized[0][c], 7);
+        WriteBits(block, offset, quantized[1][c], 7);
+    }
+    WriteBits(block, offset, 127, 7);
+    WriteBits(block, offset, 127, 7);
+    WriteBits(block, offset, pBits[0], 1);
+    WriteBits(block, offset, pBits[1], 1);
+
+    for (u32 i = 0; i < 16; i++)
+    {
+        WriteBits(block, offset, indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+void AlphaMapCooker::DecodeBC7(const u8* block, u8 (*pixels)[4])
+{
+    u32 offset = 0;
+    if (ReadBits(block, offset, 7) != 1 << 6)
+    {
+        // Not a mode 6 block, which means it wasn't written by EncodeBC7
+        memset(pixels, 0, sizeof(u8) * 16 * 4);
+        return;
+    }
+
+    u32 endpoints[2][4];
+    for (u32 c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = ReadBits(block, offset, 7);
+        endpoints[1][c] = ReadBits(block, offset, 7);
+    }
+
+    for (u32 e = 0; e < 2; e++)
+    {
+        const u32 p = ReadBits(block, offset, 1);
+        for (u32 c = 0; c < 4; c++)
+        {
+            endpoints[e][c] = (endpoints[e][c] << 1) | p;
+        }
+    }
+
+    for (u32 i = 0; i < 16; i++)
+    {
+        const u32 index = ReadBits(block, offset, i == 0 ? 3 : 4);
+        for (u32 c = 0; c < 4; c++)
+        {
+            pixels[i][c] = static_cast<u8>(((64 - BC7_WEIGHTS[index]) * endpoints[0][c] + BC7_WEIGHTS[index] * endpoints[1][c] + 32) >> 6);
+        }
+    }
+}
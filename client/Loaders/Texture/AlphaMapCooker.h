@@ -0,0 +1,52 @@
+#pragma once
+#include <NovusTypes.h>
+#include <string>
+
+// Cooks the uncompressed chunk alpha maps into block compressed DDS files that get cached next to them
+// An alpha map holds the blend weights of layer 1-3 in rgb, so chunks with fewer layers need fewer channels
+class AlphaMapCooker
+{
+public:
+    enum class Format : u8
+    {
+        BC4, // Up to 2 layers, one channel
+        BC5, // 3 layers, two channels
+        BC7 // 4 layers, three channels
+    };
+
+    struct Info
+    {
+        u32 width = 0;
+        u32 height = 0;
+        u32 layers = 0;
+    };
+
+    // Error of the cooked alpha map against the uncompressed one, in 0-255 steps of the channels the format keeps
+    struct CookResult
+    {
+        Info info;
+        u32 maxError = 0;
+        f32 rmsError = 0.0f;
+    };
+
+    // Cooks that lose more than this on any texel get reported
+    static constexpr u32 MAX_EXPECTED_ERROR = 24;
+
+    static Format GetFormat(u8 numLayers);
+    static std::string GetCookedPath(const std::string& path, Format format);
+
+    // Only reads the DDS header
+    static bool ReadInfo(const std::string& path, Info& info);
+
+    static size_t GetUncompressedSize(const Info& info) { return static_cast<size_t>(info.width) * info.height * info.layers * 4; }
+    static size_t GetCompressedSize(const Info& info, Format format);
+
+    // Safe to call from any thread, the cooked file is written to a temporary path first so other threads never see half of it
+    static bool Cook(const std::string& path, const std::string& cookedPath, Format format, CookResult& result);
+
+private:
+    static void EncodeBC4(const u8* values, u8* block);
+    static void DecodeBC4(const u8* block, u8* values);
+    static void EncodeBC7(const u8 (*pixels)[4], u8* block);
+    static void DecodeBC7(const u8* block, u8 (*pixels)[4]);
+};
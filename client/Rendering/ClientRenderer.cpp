@@ -7,6 +7,7 @@
 #include "../Utils/ServiceLocator.h"
 
 #include <Renderer/Renderer.h>
+#include <Renderer/DepthPyramid.h>
 #include <Renderer/Renderers/Vulkan/RendererVK.h>
 #include <Window/Window.h>
 #include <InputManager.h>
@@ -18,12 +19,25 @@
 
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/implot.h"
+#include "CVar/CVarSystem.h"
 
 
 const size_t FRAME_ALLOCATOR_SIZE = 8 * 1024 * 1024; // 8 MB
 u32 MAIN_RENDER_LAYER = "MainLayer"_h; // _h will compiletime hash the string into a u32
 u32 DEPTH_PREPASS_RENDER_LAYER = "DepthPrepass"_h; // _h will compiletime hash the string into a u32
 
+AutoCVar_Int CVAR_DepthPrepassEnabled("depthPrepass.enable", "lay down depth for opaque geometry before shading it with depth testing set to equal", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_OverdrawEnabled("render.overdraw", "show how many times every pixel of terrain and map objects gets shaded instead of their color, disables the depth prepass", 0, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_DepthPyramidEnabled("depthPyramid.enable", "build the Hi-Z depth pyramid after the opaque passes while depthPyramid.debugMip shows it", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_DepthPyramidDebugMip("depthPyramid.debugMip", "draw this mip of the depth pyramid over the screen, -1 disables", -1);
+
+AutoCVar_Int CVAR_DepthPyramidDebugShowMin("depthPyramid.debugShowMin", "show the nearest instead of the farthest depth in the debug view", 0, CVarFlags::EditCheckbox);
+
+AutoCVar_Float CVAR_DepthPyramidDebugScale("depthPyramid.debugScale", "brightness scale of the depth pyramid debug view", 50.0f);
+
 void KeyCallback(GLFWwindow* window, i32 key, i32 scancode, i32 action, i32 modifiers)
 {
     Window* userWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
@@ -60,7 +74,7 @@ void WindowIconifyCallback(GLFWwindow* window, int iconified)
     userWindow->SetIsMinimized(iconified == 1);
 }
 
-ClientRenderer::ClientRenderer()
+ClientRenderer::ClientRenderer(tf::Taskflow* workerTaskflow)
 {
     _window = new Window();
     _window->Init(WIDTH, HEIGHT);
@@ -90,7 +104,7 @@ ClientRenderer::ClientRenderer()
 
     _debugRenderer = new DebugRenderer(_renderer);
     _uiRenderer = new UIRenderer(_renderer);
-    _terrainRenderer = new TerrainRenderer(_renderer, _debugRenderer);
+    _terrainRenderer = new TerrainRenderer(_renderer, _debugRenderer, workerTaskflow);
     _nm2Renderer = new NM2Renderer(_renderer, _debugRenderer);
 
     ServiceLocator::SetClientRenderer(this);
@@ -143,6 +157,10 @@ void ClientRenderer::Render()
     _globalDescriptorSet.Bind("_viewData"_h, _viewConstantBuffer->GetBuffer(_frameIndex));
     _globalDescriptorSet.Bind("_lightData"_h, _lightConstantBuffer->GetBuffer(_frameIndex));
 
+    // Overdraw is only interesting without a depth prepass, with one every pixel is shaded exactly once
+    const bool overdrawEnabled = CVAR_OverdrawEnabled.Get();
+    const bool depthPrepassEnabled = CVAR_DepthPrepassEnabled.Get() && !overdrawEnabled;
+
     // Depth Prepass
     {
         struct DepthPrepassData
@@ -163,76 +181,21 @@ void ClientRenderer::Render()
 
             GPU_SCOPED_PROFILER_ZONE(commandList, DepthPrepass);
 
-            Renderer::GraphicsPipelineDesc pipelineDesc;
-            resources.InitializePipelineDesc(pipelineDesc);
-
-            // Shaders
-            Renderer::VertexShaderDesc vertexShaderDesc;
-            vertexShaderDesc.path = "Data/shaders/depthprepass.vs.hlsl.spv";
-            pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
-
-            // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
-            pipelineDesc.states.inputLayouts[0].enabled = true;
-            pipelineDesc.states.inputLayouts[0].SetName("POSITION");
-            pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
-            pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-            pipelineDesc.states.inputLayouts[1].enabled = true;
-            pipelineDesc.states.inputLayouts[1].SetName("NORMAL");
-            pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32G32B32_FLOAT;
-            pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-            pipelineDesc.states.inputLayouts[2].enabled = true;
-            pipelineDesc.states.inputLayouts[2].SetName("TEXCOORD");
-            pipelineDesc.states.inputLayouts[2].format = Renderer::InputFormat::INPUT_FORMAT_R32G32_FLOAT;
-            pipelineDesc.states.inputLayouts[2].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_VERTEX;
-
-            // Depth state
-            pipelineDesc.states.depthStencilState.depthEnable = true;
-            pipelineDesc.states.depthStencilState.depthWriteEnable = true;
-            pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
-
-            // Rasterizer state
-            pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
-            pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
-
-            // Render targets
-            pipelineDesc.depthStencil = data.mainDepth;
-
-            // Clear mainColor TODO: This should be handled by the parameter in Setup, and it should definitely not act on ImageID and DepthImageID
+            // Clear mainDepth TODO: This should be handled by the parameter in Setup, and it should definitely not act on ImageID and DepthImageID
             commandList.Clear(_mainDepth, 1.0f);
 
-            // Set pipeline
-            Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
-            commandList.BeginPipeline(pipeline);
-
             commandList.SetViewport(0, 0, static_cast<f32>(WIDTH), static_cast<f32>(HEIGHT), 0.0f, 1.0f);
             commandList.SetScissorRect(0, WIDTH, 0, HEIGHT);
-
-            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::GLOBAL, &_globalDescriptorSet, _frameIndex);
-
-            // Render depth prepass layer
-            //Renderer::RenderLayer& layer = _renderer->GetRenderLayer(DEPTH_PREPASS_RENDER_LAYER);
-            //
-            //for (auto const& model : layer.GetModels())
-            //{
-            //    auto const& modelID = Renderer::ModelID(model.first);
-            //    auto const& instances = model.second;
-            //
-            //
-            //    for (auto const& instance : instances)
-            //    {
-            //        instance->Apply(_frameIndex);
-            //
-            //        //_drawDescriptorSet.Bind("_modelData", instance->GetConstantBuffer());
-            //        commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_DRAW, &_drawDescriptorSet, _frameIndex);
-            //
-            //        // Draw
-            //        commandList.Draw(modelID);
-            //    }
-            //}
-            commandList.EndPipeline(pipeline);
         });
     }
 
+    // The sub renderers lay down depth for all opaque geometry first, so their main passes can test for EQUAL and only shade visible pixels
+    if (depthPrepassEnabled)
+    {
+        _terrainRenderer->AddTerrainDepthPrepass(&renderGraph, &_globalDescriptorSet, _mainDepth, _depthPyramid, _frameIndex);
+        _nm2Renderer->AddNM2DepthPrepass(&renderGraph, &_globalDescriptorSet, _mainDepth, _frameIndex);
+    }
+
     // Main Pass
     {
         struct MainPassData
@@ -327,12 +290,29 @@ void ClientRenderer::Render()
         });
     }
 
-    _terrainRenderer->AddTerrainPass(&renderGraph, &_globalDescriptorSet, _mainColor, _mainDepth, _frameIndex);
+    _terrainRenderer->AddTerrainPass(&renderGraph, &_globalDescriptorSet, _mainColor, _mainDepth, _depthPyramid, depthPrepassEnabled, overdrawEnabled, _frameIndex);
 
-    _nm2Renderer->AddNM2Pass(&renderGraph, &_globalDescriptorSet, _mainColor, _mainDepth, _frameIndex);
+    // NM2s would draw their color over the overdraw view
+    if (!overdrawEnabled)
+    {
+        _nm2Renderer->AddNM2Pass(&renderGraph, &_globalDescriptorSet, _mainColor, _mainDepth, depthPrepassEnabled, _frameIndex);
+    }
+
+    // Terrain occlusion culling builds the pyramid it needs itself halfway through the frame, the debug view is the only thing reading this one
+    const i32 depthPyramidDebugMip = CVAR_DepthPyramidDebugMip.Get();
+    const bool depthPyramidEnabled = CVAR_DepthPyramidEnabled.Get() && depthPyramidDebugMip >= 0;
+    if (depthPyramidEnabled)
+    {
+        _depthPyramid->AddBuildPass(&renderGraph, _mainDepth, _frameIndex);
+    }
     
     _debugRenderer->Add3DPass(&renderGraph, &_globalDescriptorSet, _mainColor, _mainDepth, _frameIndex);
 
+    if (depthPyramidEnabled)
+    {
+        _depthPyramid->AddDebugPass(&renderGraph, _mainColor, static_cast<u32>(depthPyramidDebugMip), CVAR_DepthPyramidDebugShowMin.Get(), CVAR_DepthPyramidDebugScale.GetFloat(), _frameIndex);
+    }
+
     _uiRenderer->AddUIPass(&renderGraph, _mainColor, _frameIndex);
 
     renderGraph.AddSignalSemaphore(_sceneRenderedSemaphore); // Signal that we are ready to present
@@ -438,6 +418,9 @@ void ClientRenderer::CreatePermanentResources()
 
     _drawDescriptorSet.SetBackend(_renderer->CreateDescriptorSetBackend());
 
+    // Hi-Z pyramid of the main depth, rebuilt every frame after the opaque passes
+    _depthPyramid = new Renderer::DepthPyramid(_renderer);
+
     // Frame allocator, this is a fast allocator for data that is only needed this frame
     _frameAllocator = new Memory::StackAllocator(FRAME_ALLOCATOR_SIZE);
     _frameAllocator->Init();
@@ -17,6 +17,7 @@
 namespace Renderer
 {
     class Renderer;
+    class DepthPyramid;
 }
 
 namespace Memory
@@ -32,10 +33,15 @@ class NM2Renderer;
 class InputManager;
 class DebugRenderer;
 
+namespace tf
+{
+    class Taskflow;
+}
+
 class ClientRenderer
 {
 public:
-    ClientRenderer();
+    ClientRenderer(tf::Taskflow* workerTaskflow);
 
     bool UpdateWindow(f32 deltaTime);
     void Update(f32 deltaTime);
@@ -83,6 +89,8 @@ private:
     Renderer::DescriptorSet _passDescriptorSet;
     Renderer::DescriptorSet _drawDescriptorSet;
 
+    Renderer::DepthPyramid* _depthPyramid;
+
     // Sub renderers
     DebugRenderer* _debugRenderer;
     UIRenderer* _uiRenderer;
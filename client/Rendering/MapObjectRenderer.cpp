@@ -4,6 +4,8 @@
 #include <Utils/FileReader.h>
 #include <glm/gtx/rotate_vector.hpp>
 #include <glm/gtx/euler_angles.hpp>
+#include <tracy/Tracy.hpp>
+#include <limits>
 
 #include "../ECS/Components/Singletons/TextureSingleton.h"
 
@@ -12,9 +14,16 @@
 #include "../Gameplay/Map/MapObjectRoot.h"
 #include "../Gameplay/Map/MapObject.h"
 #include "../Utils/ServiceLocator.h"
+#include "../Utils/RadixSort.h"
+#include "Camera.h"
+#include "CVar/CVarSystem.h"
 
 namespace fs = std::filesystem;
 
+AutoCVar_Int CVAR_MapObjectSortFrontToBack("mapObjects.sortFrontToBack", "draw map objects and their instances front to back so early depth testing rejects more of what is behind them", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Float CVAR_MapObjectSortDistance("mapObjects.sortDistance", "distance in yards the camera has to move before map objects get sorted again", 8.0f);
+
 MapObjectRenderer::MapObjectRenderer(Renderer::Renderer* renderer)
     : _renderer(renderer)
 {
@@ -23,10 +32,88 @@ MapObjectRenderer::MapObjectRenderer(Renderer::Renderer* renderer)
 
 void MapObjectRenderer::Update(f32 deltaTime)
 {
+    // The order only changes noticeably once the camera moved a bit, so it isn't sorted and uploaded every frame
+    const bool sortFrontToBack = CVAR_MapObjectSortFrontToBack.Get();
+    const vec3 cameraPosition = ServiceLocator::GetCamera()->GetPosition();
 
+    bool needsSort = sortFrontToBack != _isSortedFrontToBack;
+    if (sortFrontToBack && glm::distance(cameraPosition, _drawOrderPosition) > CVAR_MapObjectSortDistance.GetFloat())
+    {
+        needsSort = true;
+    }
+
+    if (needsSort && !_drawParameters.empty())
+    {
+        BuildDrawOrder(sortFrontToBack, cameraPosition);
+        _isDrawOrderUploadPending = true;
+    }
 }
 
-void MapObjectRenderer::AddMapObjectPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, u8 frameIndex)
+void MapObjectRenderer::AddMapObjectDepthPrepass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::DepthImageID depthTarget, u8 frameIndex)
+{
+    // Map Object Depth Prepass
+    {
+        struct MapObjectDepthPrepassData
+        {
+            Renderer::RenderPassMutableResource mainDepth;
+        };
+
+        renderGraph->AddPass<MapObjectDepthPrepassData>("MapObject Depth Prepass",
+            [=](MapObjectDepthPrepassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+        {
+            data.mainDepth = builder.Write(depthTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+
+            return true; // Return true from setup to enable this pass, return false to disable it
+        },
+            [=](MapObjectDepthPrepassData& data, Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList) // Execute
+        {
+            GPU_SCOPED_PROFILER_ZONE(commandList, MapObjectDepthPrepass);
+
+            // This is the first pass to draw map objects this frame
+            UploadDrawOrder(commandList);
+
+            Renderer::GraphicsPipelineDesc pipelineDesc;
+            resources.InitializePipelineDesc(pipelineDesc);
+
+            // Shaders, the pixel shader only alpha tests so cutout materials don't leave holes in the depth buffer
+            Renderer::VertexShaderDesc vertexShaderDesc;
+            vertexShaderDesc.path = "Data/shaders/mapObjectDepth.vs.hlsl.spv";
+            pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+
+            Renderer::PixelShaderDesc pixelShaderDesc;
+            pixelShaderDesc.path = "Data/shaders/mapObjectDepth.ps.hlsl.spv";
+            pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+
+            // Depth state
+            pipelineDesc.states.depthStencilState.depthEnable = true;
+            pipelineDesc.states.depthStencilState.depthWriteEnable = true;
+            pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+
+            // Rasterizer state
+            pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
+            pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
+
+            // Render targets
+            pipelineDesc.depthStencil = data.mainDepth;
+
+            // Set pipeline
+            Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
+            commandList.BeginPipeline(pipeline);
+
+            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::GLOBAL, globalDescriptorSet, frameIndex);
+            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_passDescriptorSet, frameIndex);
+
+            commandList.SetIndexBuffer(_indexBuffer, Renderer::IndexFormat::UInt16);
+
+            u32 drawCount = static_cast<u32>(_drawParameters.size());
+            commandList.DrawIndexedIndirect(_indirectArgumentBuffer, 0, drawCount);
+
+            commandList.EndPipeline(pipeline);
+        });
+    }
+}
+
+void MapObjectRenderer::AddMapObjectPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, bool depthPrepassEnabled, bool overdrawEnabled, u8 frameIndex)
 {
     // Map Object Pass
     {
@@ -48,6 +135,12 @@ void MapObjectRenderer::AddMapObjectPass(Renderer::RenderGraph* renderGraph, Ren
         {
             GPU_SCOPED_PROFILER_ZONE(commandList, MapObjectPass);
 
+            // The depth prepass already uploaded the draw order
+            if (!depthPrepassEnabled)
+            {
+                UploadDrawOrder(commandList);
+            }
+
             Renderer::GraphicsPipelineDesc pipelineDesc;
             resources.InitializePipelineDesc(pipelineDesc);
 
@@ -56,20 +149,29 @@ void MapObjectRenderer::AddMapObjectPass(Renderer::RenderGraph* renderGraph, Ren
             vertexShaderDesc.path = "Data/shaders/mapObject.vs.hlsl.spv";
             pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
 
+            // The overdraw view adds up every pixel that gets shaded, so it shows how much early depth testing rejects
             Renderer::PixelShaderDesc pixelShaderDesc;
-            pixelShaderDesc.path = "Data/shaders/mapObject.ps.hlsl.spv";
+            pixelShaderDesc.path = overdrawEnabled ? "Data/shaders/overdraw.ps.hlsl.spv" : "Data/shaders/mapObject.ps.hlsl.spv";
             pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
 
+            if (overdrawEnabled)
+            {
+                pipelineDesc.states.blendState.renderTargets[0].blendEnable = true;
+                pipelineDesc.states.blendState.renderTargets[0].srcBlend = Renderer::BLEND_MODE_ONE;
+                pipelineDesc.states.blendState.renderTargets[0].destBlend = Renderer::BLEND_MODE_ONE;
+                pipelineDesc.states.blendState.renderTargets[0].blendOp = Renderer::BLEND_OP_ADD;
+            }
+
             // Blend state
             //pipelineDesc.states.blendState.renderTargets[0].blendEnable = true;
             //pipelineDesc.states.blendState.renderTargets[0].srcBlend = Renderer::BLEND_MODE_DEST_ALPHA;
             //pipelineDesc.states.blendState.renderTargets[0].destBlend = Renderer::BLEND_MODE_INV_DEST_ALPHA;
             //pipelineDesc.states.blendState.renderTargets[0].blendOp = Renderer::BLEND_OP_ADD;
 
-            // Depth state
+            // Depth state, with a depth prepass only the closest surface passes so every pixel is shaded once
             pipelineDesc.states.depthStencilState.depthEnable = true;
-            pipelineDesc.states.depthStencilState.depthWriteEnable = true;
-            pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+            pipelineDesc.states.depthStencilState.depthWriteEnable = !depthPrepassEnabled;
+            pipelineDesc.states.depthStencilState.depthFunc = depthPrepassEnabled ? Renderer::ComparisonFunc::COMPARISON_FUNC_EQUAL : Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
 
             // Rasterizer state
             pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
@@ -147,6 +249,7 @@ void MapObjectRenderer::Clear()
     _indices.clear();
     _vertices.clear();
     _drawParameters.clear();
+    _drawArguments.clear();
     _instances.clear();
     _instanceLookupData.clear();
     _materials.clear();
@@ -474,44 +577,134 @@ void MapObjectRenderer::AddInstance(LoadedMapObject& mapObject, const Terrain::M
     mapObject.instanceCount++;
 }
 
-void MapObjectRenderer::CreateBuffers()
+void MapObjectRenderer::BuildDrawOrder(bool sortFrontToBack, const vec3& cameraPosition)
 {
-    // Fix DrawParameters to be cumulative
+    ZoneScoped;
+
+    const u32 numMapObjects = static_cast<u32>(_loadedMapObjects.size());
+
+    _mapObjectOrder.resize(numMapObjects);
+    for (u32 i = 0; i < numMapObjects; i++)
     {
-        u32 instanceIndex = 0;
-        u32 instanceIDLookupIndex = 0;
+        _mapObjectOrder[i] = i;
+    }
 
-        // Loop over all LoadedMapObjects
-        for (LoadedMapObject& loadedMapObject : _loadedMapObjects)
+    // Map objects are drawn by their nearest instance, the instance matrices hold the placement in their last column
+    if (sortFrontToBack)
+    {
+        _mapObjectSortKeys.resize(numMapObjects);
+        for (u32 i = 0; i < numMapObjects; i++)
         {
-            // Loop over their DrawParameters
-            for(u32 i = 0; i < loadedMapObject.drawParameterIDs.size(); i++)
+            u16 nearestKey = std::numeric_limits<u16>::max();
+            for (u16 instanceID : _loadedMapObjects[i].instanceIDs)
             {
-                u32 drawParameterID = loadedMapObject.drawParameterIDs[i];
+                const f32 distance = glm::distance(cameraPosition, vec3(_instances[instanceID].instanceMatrix[3]));
+                nearestKey = glm::min(nearestKey, RadixSort::GetDistanceKey(distance));
+            }
 
-                DrawParameters& drawParameters = _drawParameters[drawParameterID];
-                drawParameters.firstInstance = instanceIndex; // Fix its firstInstance to be cumulative
+            _mapObjectSortKeys[i] = nearestKey;
+        }
 
-                u32 instanceCount = loadedMapObject.instanceCount;
-                instanceIndex += instanceCount;
+        RadixSort::SortByKey16(_mapObjectSortKeys.data(), _mapObjectOrder.data(), numMapObjects, _sortScratchKeys, _sortScratchMapObjects);
+    }
 
-                u16 materialParameterID = loadedMapObject.materialParameterIDs[i];
+    // Fix DrawParameters to be cumulative, the lookup data is rebuilt from scratch since terrain streaming can call this again as chunks add map objects
+    u32 instanceIndex = 0;
 
-                for (u32 j = 0; j < instanceCount; j++)
-                {
-                    u16 instanceID = loadedMapObject.instanceIDs[j];
+    _instanceLookupData.clear();
+    _drawArguments.clear();
+
+    for (u32 mapObjectID : _mapObjectOrder)
+    {
+        const LoadedMapObject& loadedMapObject = _loadedMapObjects[mapObjectID];
+        const u32 instanceCount = loadedMapObject.instanceCount;
 
-                    InstanceLookupData& instanceLookupData = _instanceLookupData.emplace_back();
-                    instanceLookupData.instanceID = instanceID;
-                    instanceLookupData.materialParamID = materialParameterID;
-                    instanceLookupData.vertexColorTextureID0 = static_cast<u16>(loadedMapObject.vertexColorTextureIDs[0]);
-                    instanceLookupData.vertexColorTextureID1 = static_cast<u16>(loadedMapObject.vertexColorTextureIDs[1]);
-                    instanceLookupData.vertexOffset = drawParameters.vertexOffset;
-                }
+        // Every draw of a map object uses the same instance order
+        _instanceOrder.assign(loadedMapObject.instanceIDs.begin(), loadedMapObject.instanceIDs.end());
+        if (sortFrontToBack)
+        {
+            _instanceSortKeys.resize(instanceCount);
+            for (u32 j = 0; j < instanceCount; j++)
+            {
+                const f32 distance = glm::distance(cameraPosition, vec3(_instances[_instanceOrder[j]].instanceMatrix[3]));
+                _instanceSortKeys[j] = RadixSort::GetDistanceKey(distance);
+            }
+
+            RadixSort::SortByKey16(_instanceSortKeys.data(), _instanceOrder.data(), instanceCount, _sortScratchKeys, _sortScratchInstances);
+        }
+
+        // Loop over their DrawParameters
+        for (u32 i = 0; i < loadedMapObject.drawParameterIDs.size(); i++)
+        {
+            u32 drawParameterID = loadedMapObject.drawParameterIDs[i];
+
+            DrawParameters& drawParameters = _drawParameters[drawParameterID];
+            drawParameters.firstInstance = instanceIndex; // Fix its firstInstance to be cumulative
+            _drawArguments.push_back(drawParameters);
+
+            instanceIndex += instanceCount;
+
+            u16 materialParameterID = loadedMapObject.materialParameterIDs[i];
+
+            for (u32 j = 0; j < instanceCount; j++)
+            {
+                InstanceLookupData& instanceLookupData = _instanceLookupData.emplace_back();
+                instanceLookupData.instanceID = _instanceOrder[j];
+                instanceLookupData.materialParamID = materialParameterID;
+                instanceLookupData.vertexColorTextureID0 = static_cast<u16>(loadedMapObject.vertexColorTextureIDs[0]);
+                instanceLookupData.vertexColorTextureID1 = static_cast<u16>(loadedMapObject.vertexColorTextureIDs[1]);
+                instanceLookupData.vertexOffset = drawParameters.vertexOffset;
             }
         }
     }
 
+    _isSortedFrontToBack = sortFrontToBack;
+    _drawOrderPosition = cameraPosition;
+}
+
+void MapObjectRenderer::UploadDrawOrder(Renderer::CommandList& commandList)
+{
+    if (!_isDrawOrderUploadPending || _drawArguments.empty())
+        return;
+
+    ZoneScoped;
+
+    // The buffers keep their size, only the order of what is in them changes
+    const size_t argumentSize = sizeof(DrawParameters) * _drawArguments.size();
+    const size_t lookupSize = sizeof(InstanceLookupData) * _instanceLookupData.size();
+
+    Renderer::BufferDesc uploadBufferDesc;
+    uploadBufferDesc.name = "MapObjectDrawOrderUploadBuffer";
+    uploadBufferDesc.size = argumentSize + lookupSize;
+    uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+    uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+
+    Renderer::BufferID uploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+    _renderer->QueueDestroyBuffer(uploadBuffer);
+
+    u8* uploadBufferMemory = static_cast<u8*>(_renderer->MapBuffer(uploadBuffer));
+    memcpy(uploadBufferMemory, _drawArguments.data(), argumentSize);
+    memcpy(uploadBufferMemory + argumentSize, _instanceLookupData.data(), lookupSize);
+    _renderer->UnmapBuffer(uploadBuffer);
+
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ShaderReadToTransferDest, _indirectArgumentBuffer);
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ShaderReadToTransferDest, _instanceLookupBuffer);
+
+    commandList.CopyBuffer(_indirectArgumentBuffer, 0, uploadBuffer, 0, argumentSize);
+    commandList.CopyBuffer(_instanceLookupBuffer, 0, uploadBuffer, argumentSize, lookupSize);
+
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToIndirectArguments, _indirectArgumentBuffer);
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToShaderRead, _instanceLookupBuffer);
+
+    _isDrawOrderUploadPending = false;
+}
+
+void MapObjectRenderer::CreateBuffers()
+{
+    // The buffers below are created with the new order already in them
+    BuildDrawOrder(CVAR_MapObjectSortFrontToBack.Get(), ServiceLocator::GetCamera()->GetPosition());
+    _isDrawOrderUploadPending = false;
+
     // Create Instance Lookup Buffer
     if (_instanceLookupBuffer != Renderer::BufferID::Invalid())
     {
@@ -552,7 +745,7 @@ void MapObjectRenderer::CreateBuffers()
     {
         Renderer::BufferDesc desc;
         desc.name = "MapObjectIndirectArgs";
-        desc.size = sizeof(DrawParameters) * _drawParameters.size();
+        desc.size = sizeof(DrawParameters) * _drawArguments.size();
         desc.usage = Renderer::BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _indirectArgumentBuffer = _renderer->CreateBuffer(desc);
 
@@ -565,7 +758,7 @@ void MapObjectRenderer::CreateBuffers()
 
         // Upload to staging buffer
         void* dst = _renderer->MapBuffer(stagingBuffer);
-        memcpy(dst, _drawParameters.data(), desc.size);
+        memcpy(dst, _drawArguments.data(), desc.size);
         _renderer->UnmapBuffer(stagingBuffer);
 
         // Queue destroy staging buffer
@@ -19,6 +19,7 @@ namespace Renderer
     class RenderGraph;
     class Renderer;
     class DescriptorSet;
+    class CommandList;
 }
 
 namespace Terrain
@@ -99,7 +100,8 @@ public:
 
     void Update(f32 deltaTime);
 
-    void AddMapObjectPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, u8 frameIndex);
+    void AddMapObjectDepthPrepass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::DepthImageID depthTarget, u8 frameIndex);
+    void AddMapObjectPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, bool depthPrepassEnabled, bool overdrawEnabled, u8 frameIndex);
 
     void RegisterMapObjectsToBeLoaded(const Terrain::Chunk& chunk, StringTable& stringTable);
     void ExecuteLoad();
@@ -120,6 +122,10 @@ private:
 
     void AddInstance(LoadedMapObject& mapObject, const Terrain::MapObjectPlacement* placement);
 
+    // Lays out the draws and their instances, front to back from cameraPosition when sorting is enabled and in load order otherwise
+    void BuildDrawOrder(bool sortFrontToBack, const vec3& cameraPosition);
+    void UploadDrawOrder(Renderer::CommandList& commandList);
+
     void CreateBuffers();
 
     struct Material
@@ -164,6 +170,7 @@ private:
     robin_hood::unordered_map<u32, u32> _nameHashToIndexMap;
 
     std::vector<DrawParameters> _drawParameters;
+    std::vector<DrawParameters> _drawArguments; // _drawParameters in the order they are drawn, this is what the indirect argument buffer holds
     std::vector<u16> _indices;
     std::vector<Terrain::MapObjectVertex> _vertices;
     std::vector<InstanceData> _instances;
@@ -182,4 +189,16 @@ private:
     Renderer::TextureArrayID _mapObjectTextures;
 
     std::vector<MapObjectToBeLoaded> _mapObjectsToBeLoaded;
+
+    // Draw order
+    bool _isSortedFrontToBack = false;
+    bool _isDrawOrderUploadPending = false;
+    vec3 _drawOrderPosition = vec3(0.0f);
+    std::vector<u32> _mapObjectOrder;
+    std::vector<u16> _mapObjectSortKeys;
+    std::vector<u16> _instanceOrder; // Instances of the map object that is being laid out
+    std::vector<u16> _instanceSortKeys;
+    std::vector<u16> _sortScratchKeys;
+    std::vector<u32> _sortScratchMapObjects;
+    std::vector<u16> _sortScratchInstances;
 };
\ No newline at end of file
@@ -40,7 +40,90 @@ void NM2Renderer::Update(f32 deltaTime)
 
 }
 
-void NM2Renderer::AddNM2Pass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, u8 frameIndex)
+void NM2Renderer::AddNM2DepthPrepass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::DepthImageID depthTarget, u8 frameIndex)
+{
+    struct NM2DepthPrepassData
+    {
+        Renderer::RenderPassMutableResource mainDepth;
+    };
+
+    const auto setup = [=](NM2DepthPrepassData& data, Renderer::RenderGraphBuilder& builder)
+    {
+        data.mainDepth = builder.Write(depthTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+
+        return true; // Return true from setup to enable this pass, return false to disable it
+    };
+
+    const auto execute = [=](NM2DepthPrepassData& data, Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList)
+    {
+        GPU_SCOPED_PROFILER_ZONE(commandList, NM2DepthPrepass);
+
+        Renderer::GraphicsPipelineDesc pipelineDesc;
+        resources.InitializePipelineDesc(pipelineDesc);
+
+        // Shaders
+        Renderer::VertexShaderDesc vertexShaderDesc;
+        vertexShaderDesc.path = "Data/shaders/nm2Depth.vs.hlsl.spv";
+        pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+
+        // Depth state
+        pipelineDesc.states.depthStencilState.depthEnable = true;
+        pipelineDesc.states.depthStencilState.depthWriteEnable = true;
+        pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+
+        // Rasterizer state, this needs to match the NM2 Pass
+        pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_NONE; //Renderer::CullMode::CULL_MODE_BACK;
+        pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
+
+        // Render targets
+        pipelineDesc.depthStencil = data.mainDepth;
+
+        // Set pipeline
+        Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
+        commandList.BeginPipeline(pipeline);
+
+        commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::GLOBAL, globalDescriptorSet, frameIndex);
+
+        // Clamp the debug submesh count the same way the NM2 Pass does so both passes draw the same submeshes
+        size_t numSubMeshesToRender = _numSubMeshesToRender;
+
+        for (LoadedNM2& loadedNM2 : _loadedNM2s)
+        {
+            commandList.PushMarker("NM2", Color::White);
+
+            _passDescriptorSet.Bind("_instanceData", loadedNM2.instanceBuffer);
+            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_passDescriptorSet, frameIndex);
+
+            Mesh& mesh = loadedNM2.mesh;
+
+            _meshDescriptorSet.Bind("_vertexPositions", mesh.vertexPositionsBuffer);
+            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_DRAW, &_meshDescriptorSet, frameIndex);
+
+            size_t numSubMeshes = mesh.subMeshes.size();
+            if (_debugSubMeshRendering)
+            {
+                numSubMeshes = glm::min(numSubMeshesToRender, numSubMeshes);
+                numSubMeshesToRender = numSubMeshes;
+            }
+
+            for (size_t j = 0; j < numSubMeshes; j++)
+            {
+                SubMesh& subMesh = mesh.subMeshes[j];
+
+                commandList.SetIndexBuffer(subMesh.indexBuffer, Renderer::IndexFormat::UInt16);
+                commandList.DrawIndexed(subMesh.indexCount, loadedNM2.numInstances, 0, 0, 0);
+            }
+
+            commandList.PopMarker();
+        }
+
+        commandList.EndPipeline(pipeline);
+    };
+
+    renderGraph->AddPass<NM2DepthPrepassData>("NM2 Depth Prepass", setup, execute);
+}
+
+void NM2Renderer::AddNM2Pass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, bool depthPrepassEnabled, u8 frameIndex)
 {
     struct NM2PassData
     {
@@ -72,10 +155,10 @@ void NM2Renderer::AddNM2Pass(Renderer::RenderGraph* renderGraph, Renderer::Descr
         pixelShaderDesc.path = "Data/shaders/nm2.ps.hlsl.spv";
         pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
 
-        // Depth state
+        // Depth state, with a depth prepass only the closest surface passes so every pixel is shaded once
         pipelineDesc.states.depthStencilState.depthEnable = true;
-        pipelineDesc.states.depthStencilState.depthWriteEnable = true;
-        pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+        pipelineDesc.states.depthStencilState.depthWriteEnable = !depthPrepassEnabled;
+        pipelineDesc.states.depthStencilState.depthFunc = depthPrepassEnabled ? Renderer::ComparisonFunc::COMPARISON_FUNC_EQUAL : Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
 
         // Rasterizer state
         pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_NONE; //Renderer::CullMode::CULL_MODE_BACK;
@@ -43,7 +43,8 @@ public:
 
     void Update(f32 deltaTime);
 
-    void AddNM2Pass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, u8 frameIndex);
+    void AddNM2DepthPrepass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::DepthImageID depthTarget, u8 frameIndex);
+    void AddNM2Pass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, bool depthPrepassEnabled, u8 frameIndex);
 
     bool LoadCreature(u32 displayId, u32& objectID);
 private:
@@ -0,0 +1,152 @@
+#include "RendererStressTest.h"
+#include <Renderer/Renderer.h>
+#include <Utils/DebugHandler.h>
+#include <Utils/Timer.h>
+#include <taskflow/taskflow.hpp>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace RendererStressTest
+{
+    namespace
+    {
+        // Sorts a copy so the caller's order, which matches the workers, stays intact
+        template <typename T>
+        u32 CountDuplicates(std::vector<T> values)
+        {
+            std::sort(values.begin(), values.end());
+
+            u32 numDuplicates = 0;
+            for (size_t i = 1; i < values.size(); i++)
+            {
+                numDuplicates += values[i] == values[i - 1];
+            }
+
+            return numDuplicates;
+        }
+    }
+
+    bool Run(Renderer::Renderer* renderer, u32 numWorkers, u32 numResourcesPerWorker)
+    {
+        const u32 numResources = numWorkers * numResourcesPerWorker;
+        if (numResources == 0)
+            return false;
+
+        // The images stay around, so one run can't eat a noticeable part of the 16 bit ImageID range
+        constexpr u32 maxResources = 4096;
+        if (numResources > maxResources)
+        {
+            NC_LOG_ERROR("Tried to stress test %u resources, at most %u are allowed per run", numResources, maxResources);
+            return false;
+        }
+
+        Renderer::TextureArrayDesc textureArrayDesc;
+        textureArrayDesc.size = numResources;
+        const Renderer::TextureArrayID textureArrayID = renderer->CreateTextureArray(textureArrayDesc);
+
+        std::vector<Renderer::BufferID::type> bufferIDs(numResources);
+        std::vector<Renderer::ImageID::type> imageIDs(numResources);
+        std::vector<Renderer::TextureID::type> textureIDs(numResources);
+        std::vector<u32> arrayIndices(numResources);
+
+        std::atomic<u32> numLookupMismatches = 0;
+
+        // Every worker looks up what it just created while the others keep creating, that is where a handler that publishes a handle too early falls over
+        auto Work = [&](u32 worker)
+        {
+            for (u32 i = 0; i < numResourcesPerWorker; i++)
+            {
+                const u32 index = (worker * numResourcesPerWorker) + i;
+
+                Renderer::BufferDesc bufferDesc;
+                bufferDesc.name = "StressTestBuffer";
+                bufferDesc.usage = Renderer::BufferUsage::BUFFER_USAGE_STORAGE_BUFFER;
+                bufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+                bufferDesc.size = sizeof(u32) * (1 + (index % 16));
+
+                const Renderer::BufferID bufferID = renderer->CreateBuffer(bufferDesc);
+                u32* bufferData = static_cast<u32*>(renderer->MapBuffer(bufferID));
+                if (bufferData == nullptr)
+                {
+                    numLookupMismatches++;
+                }
+                else
+                {
+                    bufferData[0] = index;
+                    renderer->UnmapBuffer(bufferID);
+                }
+
+                Renderer::ImageDesc imageDesc;
+                imageDesc.debugName = "StressTestImage";
+                imageDesc.dimensions = vec2(1 + (index % 4), 1 + ((index / 4) % 4));
+                imageDesc.format = Renderer::IMAGE_FORMAT_R8G8B8A8_UNORM;
+
+                const Renderer::ImageID imageID = renderer->CreateImage(imageDesc);
+                const uvec2 imageDimensions = renderer->GetImageDimensions(imageID);
+                if (imageDimensions.x != static_cast<u32>(imageDesc.dimensions.x) || imageDimensions.y != static_cast<u32>(imageDesc.dimensions.y))
+                {
+                    numLookupMismatches++;
+                }
+
+                u8 pixel[4] = { static_cast<u8>(index), static_cast<u8>(index >> 8), static_cast<u8>(worker), 255 };
+
+                Renderer::DataTextureDesc textureDesc;
+                textureDesc.width = 1;
+                textureDesc.height = 1;
+                textureDesc.format = Renderer::IMAGE_FORMAT_R8G8B8A8_UNORM;
+                textureDesc.data = pixel;
+                textureDesc.debugName = "StressTestTexture";
+
+                u32 arrayIndex = 0;
+                const Renderer::TextureID textureID = renderer->CreateDataTextureIntoArray(textureDesc, textureArrayID, arrayIndex);
+
+                bufferIDs[index] = static_cast<Renderer::BufferID::type>(bufferID);
+                imageIDs[index] = static_cast<Renderer::ImageID::type>(imageID);
+                textureIDs[index] = static_cast<Renderer::TextureID::type>(textureID);
+                arrayIndices[index] = arrayIndex;
+            }
+        };
+
+        Timer timer;
+        if (numWorkers == 1)
+        {
+            Work(0);
+        }
+        else
+        {
+            tf::Taskflow taskflow(numWorkers);
+            for (u32 worker = 0; worker < numWorkers; worker++)
+            {
+                taskflow.emplace([&Work, worker]() { Work(worker); });
+            }
+            taskflow.wait_for_all();
+        }
+        const f32 time = timer.GetLifeTime();
+
+        const u32 numDuplicateBuffers = CountDuplicates(bufferIDs);
+        const u32 numDuplicateImages = CountDuplicates(imageIDs);
+        const u32 numDuplicateTextures = CountDuplicates(textureIDs);
+        const u32 numDuplicateArrayIndices = CountDuplicates(arrayIndices);
+
+        for (Renderer::BufferID::type bufferID : bufferIDs)
+        {
+            renderer->QueueDestroyBuffer(Renderer::BufferID(bufferID));
+        }
+        renderer->UnloadTexturesInArray(textureArrayID, 0);
+
+        const bool succeeded = numDuplicateBuffers == 0 && numDuplicateImages == 0 && numDuplicateTextures == 0 && numDuplicateArrayIndices == 0 && numLookupMismatches == 0;
+
+        NC_LOG_MESSAGE("Created %u buffers, images and textures from %u workers in %.2f ms", numResources, numWorkers, time * 1000.0f);
+        if (succeeded)
+        {
+            NC_LOG_MESSAGE("Every handle was unique and every lookup matched what was created");
+        }
+        else
+        {
+            NC_LOG_ERROR("Duplicate handles: %u buffers, %u images, %u textures, %u texture array indices. %u lookups didn't match what was created", numDuplicateBuffers, numDuplicateImages, numDuplicateTextures, numDuplicateArrayIndices, numLookupMismatches.load());
+        }
+
+        return succeeded;
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <NovusTypes.h>
+
+namespace Renderer
+{
+    class Renderer;
+}
+
+namespace RendererStressTest
+{
+    // Creates and looks up buffers, images and textures from numWorkers threads at once and checks that every handle came out unique
+    // Images can't be destroyed through the Renderer, the ones this creates are kept tiny since they stay around until shutdown
+    bool Run(Renderer::Renderer* renderer, u32 numWorkers, u32 numResourcesPerWorker);
+}
@@ -0,0 +1,212 @@
+#include "TerrainClipmap.h"
+#include <Renderer/Renderer.h>
+#include <Renderer/RenderGraphResources.h>
+#include <Renderer/CommandList.h>
+#include <Utils/Timer.h>
+#include <tracy/Tracy.hpp>
+
+#include <algorithm>
+
+#include "../Gameplay/Map/Chunk.h"
+
+TerrainClipmap::TerrainClipmap(Renderer::Renderer* renderer)
+    : _renderer(renderer)
+{
+    CreatePermanentResources();
+    InvalidateAll();
+}
+
+void TerrainClipmap::Update(const vec2& cameraCellPosition, u32 bakeBudget)
+{
+    ZoneScoped;
+    Timer timer;
+
+    // Bakes that didn't get recorded yet still count against the budget
+    bakeBudget = glm::min(bakeBudget, Terrain::CLIPMAP_MAX_BAKES_PER_FRAME);
+    const u32 numPending = static_cast<u32>(_pendingBakes.size());
+    bakeBudget = numPending < bakeBudget ? bakeBudget - numPending : 0;
+
+    struct MissingPage
+    {
+        u32 level;
+        ivec2 page;
+        f32 distance; // In pages of its level
+    };
+
+    std::vector<MissingPage> missingPages;
+
+    _stats.residentPages = 0;
+    _stats.missingPages = 0;
+
+    for (u32 level = 0; level < Terrain::CLIPMAP_NUM_LEVELS; level++)
+    {
+        const f32 texelsPerCell = static_cast<f32>(Terrain::CLIPMAP_LEVEL0_TEXELS_PER_CELL >> level);
+        const vec2 cameraPage = (cameraCellPosition * texelsPerCell) / static_cast<f32>(Terrain::CLIPMAP_PAGE_SIZE);
+        const i32 numMapPages = static_cast<i32>((Terrain::MAP_CHUNKS_PER_MAP_STRIDE * Terrain::MAP_CELLS_PER_CHUNK_SIDE * static_cast<u32>(texelsPerCell)) / Terrain::CLIPMAP_PAGE_SIZE);
+
+        // The window is one page wider on the side the camera is closer to, so it always reaches at least 3.5 pages out
+        const ivec2 first = ivec2(glm::round(cameraPage)) - ivec2(Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE / 2);
+
+        for (u32 y = 0; y < Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE; y++)
+        {
+            for (u32 x = 0; x < Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE; x++)
+            {
+                const ivec2 page = first + ivec2(x, y);
+                if (page.x < 0 || page.y < 0 || page.x >= numMapPages || page.y >= numMapPages)
+                    continue;
+
+                // Every page in the window maps to its own slot, pages that scroll out are overwritten by the ones scrolling in
+                const u32 slot = (level * Terrain::CLIPMAP_PAGES_PER_LEVEL) + ((page.y % Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE) * Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE) + (page.x % Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE);
+                if (_pageTable[slot] == PackPage(page))
+                {
+                    _stats.residentPages++;
+                    continue;
+                }
+
+                _stats.missingPages++;
+
+                const vec2 pageCenter = vec2(page) + vec2(0.5f);
+                missingPages.push_back({ level, page, glm::distance(pageCenter, cameraPage) });
+            }
+        }
+    }
+
+    // Finer levels first since they cover what is closest, then the pages closest to the camera within a level
+    std::sort(missingPages.begin(), missingPages.end(), [](const MissingPage& a, const MissingPage& b)
+    {
+        return a.level != b.level ? a.level < b.level : a.distance < b.distance;
+    });
+
+    const u32 numBakes = glm::min(bakeBudget, static_cast<u32>(missingPages.size()));
+    for (u32 i = 0; i < numBakes; i++)
+    {
+        const MissingPage& missingPage = missingPages[i];
+        const u32 slot = (missingPage.level * Terrain::CLIPMAP_PAGES_PER_LEVEL) + ((missingPage.page.y % Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE) * Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE) + (missingPage.page.x % Terrain::CLIPMAP_PAGES_PER_LEVEL_SIDE);
+
+        // The page is baked before anything samples it this frame, so it can be marked resident right away
+        _pageTable[slot] = PackPage(missingPage.page);
+        _pendingBakes.push_back({ missingPage.level, slot, static_cast<u32>(missingPage.page.x), static_cast<u32>(missingPage.page.y) });
+    }
+
+    _stats.residentPages += numBakes;
+    _stats.missingPages -= numBakes;
+    _stats.updateTime = timer.GetLifeTime();
+}
+
+void TerrainClipmap::InvalidateChunk(u16 chunkID)
+{
+    const u32 chunkX = chunkID % Terrain::MAP_CHUNKS_PER_MAP_STRIDE;
+    const u32 chunkY = chunkID / Terrain::MAP_CHUNKS_PER_MAP_STRIDE;
+
+    const uvec2 firstCell = uvec2(chunkX, chunkY) * static_cast<u32>(Terrain::MAP_CELLS_PER_CHUNK_SIDE);
+    const uvec2 lastCell = firstCell + uvec2(Terrain::MAP_CELLS_PER_CHUNK_SIDE - 1);
+
+    for (u32 level = 0; level < Terrain::CLIPMAP_NUM_LEVELS; level++)
+    {
+        const u32 texelsPerCell = Terrain::CLIPMAP_LEVEL0_TEXELS_PER_CELL >> level;
+
+        // The border texels of the pages next to the chunk are sampled too, so those pages get baked again as well
+        const ivec2 firstPage = (ivec2(firstCell * texelsPerCell) - ivec2(Terrain::CLIPMAP_PAGE_BORDER)) / static_cast<i32>(Terrain::CLIPMAP_PAGE_SIZE);
+        const ivec2 lastPage = (ivec2((lastCell + uvec2(1)) * texelsPerCell) + ivec2(Terrain::CLIPMAP_PAGE_BORDER - 1)) / static_cast<i32>(Terrain::CLIPMAP_PAGE_SIZE);
+
+        for (u32 i = 0; i < Terrain::CLIPMAP_PAGES_PER_LEVEL; i++)
+        {
+            const u32 slot = (level * Terrain::CLIPMAP_PAGES_PER_LEVEL) + i;
+            if (_pageTable[slot] == Terrain::CLIPMAP_PAGE_INVALID)
+                continue;
+
+            const ivec2 page = ivec2(_pageTable[slot] & 0xFFFF, _pageTable[slot] >> 16);
+            if (page.x >= firstPage.x && page.x <= lastPage.x && page.y >= firstPage.y && page.y <= lastPage.y)
+            {
+                _pageTable[slot] = Terrain::CLIPMAP_PAGE_INVALID;
+            }
+        }
+    }
+}
+
+void TerrainClipmap::InvalidateAll()
+{
+    for (u32 i = 0; i < Terrain::CLIPMAP_NUM_PAGES; i++)
+    {
+        _pageTable[i] = Terrain::CLIPMAP_PAGE_INVALID;
+    }
+
+    _pendingBakes.clear();
+}
+
+void TerrainClipmap::Bake(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, const BakeResources& bakeResources, u8 frameIndex)
+{
+    _stats.bakedPages = static_cast<u32>(_pendingBakes.size());
+    _stats.totalBakedPages += _stats.bakedPages;
+
+    if (_pendingBakes.empty())
+        return;
+
+    GPU_SCOPED_PROFILER_ZONE(commandList, TerrainClipmapBake);
+
+    memcpy(_bakeConstantBuffer->resource.requests, _pendingBakes.data(), sizeof(BakeRequest) * _pendingBakes.size());
+    _bakeConstantBuffer->Apply(frameIndex);
+
+    // Last frame's terrain pass might still be sampling pages that get replaced now
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::PixelShaderReadToComputeWrite, _atlas);
+
+    Renderer::ComputePipelineDesc pipelineDesc;
+    resources.InitializePipelineDesc(pipelineDesc);
+
+    Renderer::ComputeShaderDesc shaderDesc;
+    shaderDesc.path = "Data/shaders/terrainClipmapBake.cs.hlsl.spv";
+    pipelineDesc.computeShader = _renderer->LoadShader(shaderDesc);
+
+    Renderer::ComputePipelineID pipeline = _renderer->CreatePipeline(pipelineDesc);
+    commandList.BeginPipeline(pipeline);
+
+    _bakeDescriptorSet.Bind("_chunkSlots", bakeResources.chunkSlots);
+    _bakeDescriptorSet.Bind("_cellData", bakeResources.cellData);
+    _bakeDescriptorSet.Bind("_chunkData", bakeResources.chunkData);
+    _bakeDescriptorSet.Bind("_alphaSampler", bakeResources.alphaSampler);
+    _bakeDescriptorSet.Bind("_colorSampler", bakeResources.colorSampler);
+    _bakeDescriptorSet.Bind("_terrainColorTextures", bakeResources.colorTextures);
+    _bakeDescriptorSet.Bind("_terrainAlphaTextures", bakeResources.alphaTextures);
+    _bakeDescriptorSet.Bind("_constants", _bakeConstantBuffer->GetBuffer(frameIndex));
+    _bakeDescriptorSet.BindStorage("_atlas", _atlas);
+
+    commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_bakeDescriptorSet, frameIndex);
+
+    // One layer of workgroups per page, 8x8 threads per workgroup
+    const u32 numWorkGroups = (Terrain::CLIPMAP_PHYSICAL_PAGE_SIZE + 7) / 8;
+    commandList.Dispatch(numWorkGroups, numWorkGroups, static_cast<u32>(_pendingBakes.size()));
+
+    commandList.EndPipeline(pipeline);
+
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToPixelShaderRead, _atlas);
+
+    _pendingBakes.clear();
+}
+
+void TerrainClipmap::Bind(Renderer::DescriptorSet& descriptorSet, u8 frameIndex)
+{
+    memcpy(_pageTableBuffer->resource.pages, _pageTable, sizeof(_pageTable));
+    _pageTableBuffer->Apply(frameIndex);
+
+    descriptorSet.Bind("_clipmapAtlas", _atlas);
+    descriptorSet.Bind("_clipmapPages", _pageTableBuffer->GetBuffer(frameIndex));
+}
+
+void TerrainClipmap::CreatePermanentResources()
+{
+    static_assert(Terrain::CLIPMAP_NUM_PAGES % Terrain::CLIPMAP_ATLAS_PAGES_PER_ROW == 0);
+
+    Renderer::ImageDesc atlasDesc;
+    atlasDesc.debugName = "TerrainClipmapAtlas";
+    atlasDesc.dimensions = vec2(Terrain::CLIPMAP_ATLAS_PAGES_PER_ROW, Terrain::CLIPMAP_NUM_PAGES / Terrain::CLIPMAP_ATLAS_PAGES_PER_ROW) * static_cast<f32>(Terrain::CLIPMAP_PHYSICAL_PAGE_SIZE);
+    atlasDesc.dimensionType = Renderer::ImageDimensionType::DIMENSION_ABSOLUTE;
+    atlasDesc.format = Renderer::IMAGE_FORMAT_R8G8B8A8_UNORM;
+    atlasDesc.sampleCount = Renderer::SAMPLE_COUNT_1;
+
+    _atlas = _renderer->CreateImage(atlasDesc);
+
+    _pageTableBuffer = new Renderer::Buffer<PageTable>(_renderer, "TerrainClipmapPageTableBuffer", Renderer::BUFFER_USAGE_UNIFORM_BUFFER, Renderer::BufferCPUAccess::WriteOnly);
+    _bakeConstantBuffer = new Renderer::Buffer<BakeConstants>(_renderer, "TerrainClipmapBakeConstantBuffer", Renderer::BUFFER_USAGE_UNIFORM_BUFFER, Renderer::BufferCPUAccess::WriteOnly);
+
+    _bakeDescriptorSet.SetBackend(_renderer->CreateDescriptorSetBackend());
+}
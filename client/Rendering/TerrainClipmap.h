@@ -0,0 +1,118 @@
+#pragma once
+#include <NovusTypes.h>
+
+#include <vector>
+
+#include <Renderer/Descriptors/ImageDesc.h>
+#include <Renderer/Descriptors/BufferDesc.h>
+#include <Renderer/Descriptors/SamplerDesc.h>
+#include <Renderer/Descriptors/TextureArrayDesc.h>
+#include <Renderer/Buffer.h>
+#include <Renderer/DescriptorSet.h>
+
+namespace Renderer
+{
+    class Renderer;
+    class RenderGraphResources;
+    class CommandList;
+}
+
+namespace Terrain
+{
+    // The clipmap is addressed in cell units from the map origin, so x is chunkX * 16 + cellX plus the position within the cell
+    // Level n has 64 >> n texels per cell and keeps 8x8 pages of 128x128 texels around the camera
+    constexpr u32 CLIPMAP_NUM_LEVELS = 5;
+    constexpr u32 CLIPMAP_LEVEL0_TEXELS_PER_CELL = 64;
+    constexpr u32 CLIPMAP_PAGE_SIZE = 128;
+    constexpr u32 CLIPMAP_PAGE_BORDER = 1; // Every page is baked with a border so bilinear filtering never reads a neighbouring page
+    constexpr u32 CLIPMAP_PHYSICAL_PAGE_SIZE = CLIPMAP_PAGE_SIZE + CLIPMAP_PAGE_BORDER * 2;
+    constexpr u32 CLIPMAP_PAGES_PER_LEVEL_SIDE = 8;
+    constexpr u32 CLIPMAP_PAGES_PER_LEVEL = CLIPMAP_PAGES_PER_LEVEL_SIDE * CLIPMAP_PAGES_PER_LEVEL_SIDE;
+    constexpr u32 CLIPMAP_NUM_PAGES = CLIPMAP_PAGES_PER_LEVEL * CLIPMAP_NUM_LEVELS;
+    constexpr u32 CLIPMAP_ATLAS_PAGES_PER_ROW = 16;
+    constexpr u32 CLIPMAP_MAX_BAKES_PER_FRAME = 32;
+
+    // Page table entry of a slot that holds no page, real entries pack the page position as x | (y << 16)
+    constexpr u32 CLIPMAP_PAGE_INVALID = 0xFFFFFFFF;
+}
+
+// Caches the composited terrain albedo in atlas pages around the camera, terrain.ps.hlsl shades distant pixels with a single fetch from it
+// A page is only baked when it comes into range of its level or when a chunk it covers gets loaded
+class TerrainClipmap
+{
+public:
+    struct Stats
+    {
+        u32 residentPages = 0; // Pages in range that are baked, these are the hits
+        u32 missingPages = 0; // Pages in range that still need a bake, pixels on them fall back to full shading
+        u32 bakedPages = 0; // Baked this frame
+        u32 totalBakedPages = 0;
+        f32 updateTime = 0.0f; // CPU time of picking the pages to bake in seconds
+    };
+
+    // Everything the bake needs from TerrainRenderer
+    struct BakeResources
+    {
+        Renderer::BufferID chunkSlots;
+        Renderer::BufferID cellData;
+        Renderer::BufferID chunkData;
+        Renderer::TextureArrayID colorTextures;
+        Renderer::TextureArrayID alphaTextures;
+        Renderer::SamplerID colorSampler;
+        Renderer::SamplerID alphaSampler;
+    };
+
+public:
+    TerrainClipmap(Renderer::Renderer* renderer);
+
+    // Picks the pages that get baked this frame, cameraCellPosition is in the cell units described above
+    void Update(const vec2& cameraCellPosition, u32 bakeBudget);
+
+    // Pages covering a chunk that got loaded have to be baked again
+    void InvalidateChunk(u16 chunkID);
+    void InvalidateAll();
+
+    // Records the bakes picked by Update, this has to happen after the chunk data of this frame got uploaded
+    void Bake(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, const BakeResources& bakeResources, u8 frameIndex);
+
+    // Binds the atlas and page table for terrain.ps.hlsl
+    void Bind(Renderer::DescriptorSet& descriptorSet, u8 frameIndex);
+
+    const Stats& GetStats() { return _stats; }
+
+private:
+    void CreatePermanentResources();
+
+    static u32 PackPage(const ivec2& page) { return static_cast<u32>(page.x) | (static_cast<u32>(page.y) << 16); }
+
+private:
+    struct PageTable
+    {
+        uvec4 pages[Terrain::CLIPMAP_NUM_PAGES / 4]; // Which page every slot holds, slot = level * 64 + (y % 8) * 8 + (x % 8)
+    };
+
+    struct BakeRequest
+    {
+        u32 level;
+        u32 slot;
+        u32 pageX;
+        u32 pageY;
+    };
+
+    struct BakeConstants
+    {
+        BakeRequest requests[Terrain::CLIPMAP_MAX_BAKES_PER_FRAME];
+    };
+
+    Renderer::Renderer* _renderer;
+
+    Renderer::ImageID _atlas;
+    Renderer::Buffer<PageTable>* _pageTableBuffer = nullptr;
+    Renderer::Buffer<BakeConstants>* _bakeConstantBuffer = nullptr;
+    Renderer::DescriptorSet _bakeDescriptorSet;
+
+    u32 _pageTable[Terrain::CLIPMAP_NUM_PAGES];
+    std::vector<BakeRequest> _pendingBakes;
+
+    Stats _stats;
+};
@@ -0,0 +1,184 @@
+#include "TerrainCulling.h"
+#include <Utils/DebugHandler.h>
+#include <Utils/Timer.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace Terrain
+{
+    namespace Culling
+    {
+        void Benchmark(u32 numChunks)
+        {
+            if (numChunks == 0)
+            {
+                NC_LOG_ERROR("Can't benchmark terrain culling without any chunks");
+                return;
+            }
+
+            // The chunks are laid out in a square around the origin with hills of random height, like the resident chunks around the camera would be
+            const u32 numChunksPerSide = static_cast<u32>(glm::ceil(glm::sqrt(static_cast<f32>(numChunks))));
+            const f32 gridHalfSize = (numChunksPerSide * MAP_CHUNK_SIZE) / 2.0f;
+
+            std::mt19937 random(1337);
+            std::uniform_real_distribution<f32> groundDistribution(0.0f, 300.0f);
+            std::uniform_real_distribution<f32> heightDistribution(1.0f, 50.0f);
+
+            std::vector<Geometry::AABoundingBox> cellBoundingBoxes(static_cast<size_t>(numChunks) * MAP_CELLS_PER_CHUNK);
+            std::vector<ChunkBounds> chunkBounds(numChunks);
+            for (u32 chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+            {
+                const vec2 chunkOrigin = vec2((chunkIndex % numChunksPerSide) * MAP_CHUNK_SIZE, (chunkIndex / numChunksPerSide) * MAP_CHUNK_SIZE) - gridHalfSize;
+                Geometry::AABoundingBox* chunkCellBoundingBoxes = &cellBoundingBoxes[static_cast<size_t>(chunkIndex) * MAP_CELLS_PER_CHUNK];
+
+                for (u32 cellID = 0; cellID < MAP_CELLS_PER_CHUNK; cellID++)
+                {
+                    const vec2 cellOrigin = chunkOrigin + vec2(cellID % MAP_CELLS_PER_CHUNK_SIDE, cellID / MAP_CELLS_PER_CHUNK_SIDE) * MAP_CELL_SIZE;
+                    const f32 ground = groundDistribution(random);
+
+                    // Swapped like the cell bounding boxes of the renderer, IsInsideFrustum depends on that
+                    Geometry::AABoundingBox& boundingBox = chunkCellBoundingBoxes[cellID];
+                    boundingBox.min = vec3(cellOrigin.x + MAP_CELL_SIZE, ground + heightDistribution(random), cellOrigin.y + MAP_CELL_SIZE);
+                    boundingBox.max = vec3(cellOrigin.x, ground, cellOrigin.y);
+                }
+
+                CalculateChunkBounds(chunkCellBoundingBoxes, chunkBounds[chunkIndex]);
+            }
+
+            // Every view stands somewhere over the grid and looks slightly down in a random direction, with the same projection as the cameras
+            constexpr u32 numViews = 16;
+            std::uniform_real_distribution<f32> positionDistribution(-gridHalfSize, gridHalfSize);
+            std::uniform_real_distribution<f32> altitudeDistribution(50.0f, 500.0f);
+            std::uniform_real_distribution<f32> yawDistribution(0.0f, glm::two_pi<f32>());
+            std::uniform_real_distribution<f32> pitchDistribution(glm::radians(5.0f), glm::radians(30.0f));
+
+            std::vector<vec4> viewPlanes(numViews * 6);
+            for (u32 view = 0; view < numViews; view++)
+            {
+                const vec3 position = vec3(positionDistribution(random), altitudeDistribution(random), positionDistribution(random));
+                const f32 yaw = yawDistribution(random);
+                const f32 pitch = pitchDistribution(random);
+                const vec3 front = vec3(glm::cos(yaw) * glm::cos(pitch), -glm::sin(pitch), glm::sin(yaw) * glm::cos(pitch));
+
+                const mat4x4 viewMatrix = glm::lookAt(position, position + front, vec3(0.0f, 1.0f, 0.0f));
+                const mat4x4 projectionMatrix = glm::perspective(glm::radians(75.0f), 16.0f / 9.0f, 1.0f, 100000.0f);
+                const mat4x4 m = glm::transpose(projectionMatrix * viewMatrix);
+
+                // Same planes as Camera::UpdateFrustumPlanes
+                vec4* planes = &viewPlanes[view * 6];
+                planes[0] = m[3] + m[0];
+                planes[1] = m[3] - m[0];
+                planes[2] = m[3] + m[1];
+                planes[3] = m[3] - m[1];
+                planes[4] = m[3] + m[2];
+                planes[5] = m[3] - m[2];
+            }
+
+            constexpr u32 numMasksPerChunk = MAP_CELLS_PER_CHUNK / 64;
+            std::vector<u64> scalarVisibleCells(static_cast<size_t>(numChunks) * numMasksPerChunk);
+            std::vector<u64> hierarchicalVisibleCells(static_cast<size_t>(numChunks) * numMasksPerChunk);
+
+            // Both run on this thread only, the renderer spreads the chunks over the workers but that doesn't change the cost per chunk
+            constexpr u32 numRuns = 10;
+            f32 scalarTime = 0.0f;
+            f32 hierarchicalTime = 0.0f;
+            u32 numScalarVisibleCells = 0;
+            u32 numHierarchicalVisibleCells = 0;
+            u32 numMismatches = 0;
+            u32 chunkResults[3] = { 0, 0, 0 };
+
+            for (u32 view = 0; view < numViews; view++)
+            {
+                const vec4* planes = &viewPlanes[view * 6];
+
+                // The first run of both is a warm up
+                for (u32 run = 0; run <= numRuns; run++)
+                {
+                    Timer timer;
+                    for (u32 chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+                    {
+                        const Geometry::AABoundingBox* chunkCellBoundingBoxes = &cellBoundingBoxes[static_cast<size_t>(chunkIndex) * MAP_CELLS_PER_CHUNK];
+                        u64* visibleCells = &scalarVisibleCells[static_cast<size_t>(chunkIndex) * numMasksPerChunk];
+                        memset(visibleCells, 0, numMasksPerChunk * sizeof(u64));
+
+                        for (u32 cellID = 0; cellID < MAP_CELLS_PER_CHUNK; cellID++)
+                        {
+                            if (IsInsideFrustum(planes, chunkCellBoundingBoxes[cellID]))
+                            {
+                                visibleCells[cellID / 64] |= 1ull << (cellID % 64);
+                            }
+                        }
+                    }
+
+                    if (run > 0)
+                    {
+                        scalarTime += timer.GetLifeTime();
+                    }
+                }
+
+                for (u32 run = 0; run <= numRuns; run++)
+                {
+                    Timer timer;
+                    for (u32 chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+                    {
+                        u64* visibleCells = &hierarchicalVisibleCells[static_cast<size_t>(chunkIndex) * numMasksPerChunk];
+
+                        switch (TestChunk(planes, chunkBounds[chunkIndex]))
+                        {
+                            case FrustumResult::Outside:
+                                memset(visibleCells, 0, numMasksPerChunk * sizeof(u64));
+                                break;
+                            case FrustumResult::Inside:
+                                memset(visibleCells, 0xFF, numMasksPerChunk * sizeof(u64));
+                                break;
+                            case FrustumResult::Intersecting:
+                                CullCells(planes, chunkBounds[chunkIndex], visibleCells);
+                                break;
+                        }
+                    }
+
+                    if (run > 0)
+                    {
+                        hierarchicalTime += timer.GetLifeTime();
+                    }
+                }
+
+                for (u32 chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+                {
+                    chunkResults[static_cast<u32>(TestChunk(planes, chunkBounds[chunkIndex]))]++;
+
+                    for (u32 cellID = 0; cellID < MAP_CELLS_PER_CHUNK; cellID++)
+                    {
+                        const size_t mask = (static_cast<size_t>(chunkIndex) * numMasksPerChunk) + (cellID / 64);
+                        const u64 bit = 1ull << (cellID % 64);
+
+                        const bool scalarVisible = (scalarVisibleCells[mask] & bit) != 0;
+                        const bool hierarchicalVisible = (hierarchicalVisibleCells[mask] & bit) != 0;
+
+                        numScalarVisibleCells += scalarVisible;
+                        numHierarchicalVisibleCells += hierarchicalVisible;
+                        numMismatches += scalarVisible != hierarchicalVisible;
+                    }
+                }
+            }
+
+            const f32 scalarTimePerView = scalarTime / (numViews * numRuns);
+            const f32 hierarchicalTimePerView = hierarchicalTime / (numViews * numRuns);
+
+            NC_LOG_MESSAGE("%u views over %u chunks: %.3f ms per view with TestChunk and CullCells, %.3f ms per view testing every cell (%.1fx)", numViews, numChunks, hierarchicalTimePerView * 1000.0f, scalarTimePerView * 1000.0f, scalarTimePerView / glm::max(hierarchicalTimePerView, 1e-12f));
+            NC_LOG_MESSAGE("%u chunks were outside, %u intersecting and %u inside over all views", chunkResults[static_cast<u32>(FrustumResult::Outside)], chunkResults[static_cast<u32>(FrustumResult::Intersecting)], chunkResults[static_cast<u32>(FrustumResult::Inside)]);
+
+            if (numMismatches > 0)
+            {
+                NC_LOG_WARNING("%u cells visible with TestChunk and CullCells, %u testing every cell, %u cells disagree", numHierarchicalVisibleCells, numScalarVisibleCells, numMismatches);
+            }
+            else
+            {
+                NC_LOG_SUCCESS("%u cells visible over all views, both agree on every cell", numHierarchicalVisibleCells);
+            }
+        }
+    }
+}
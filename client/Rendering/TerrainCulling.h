@@ -0,0 +1,185 @@
+#pragma once
+#include <NovusTypes.h>
+#include <Math/Geometry.h>
+#include <immintrin.h>
+#include <limits>
+
+#include "../Gameplay/Map/Chunk.h"
+
+namespace Terrain
+{
+    namespace Culling
+    {
+        // The bounding boxes of the cells of a chunk laid out for testing 4 at a time, unlike the cell bounding boxes min and max are in order here
+        struct ChunkBounds
+        {
+            vec3 min;
+            vec3 max;
+
+            f32 cellMinX[MAP_CELLS_PER_CHUNK];
+            f32 cellMinY[MAP_CELLS_PER_CHUNK];
+            f32 cellMinZ[MAP_CELLS_PER_CHUNK];
+            f32 cellMaxX[MAP_CELLS_PER_CHUNK];
+            f32 cellMaxY[MAP_CELLS_PER_CHUNK];
+            f32 cellMaxZ[MAP_CELLS_PER_CHUNK];
+        };
+
+        enum class FrustumResult : u8
+        {
+            Outside,
+            Intersecting,
+            Inside
+        };
+
+        inline void CalculateChunkBounds(const Geometry::AABoundingBox* cellBoundingBoxes, ChunkBounds& chunkBounds)
+        {
+            chunkBounds.min = vec3(std::numeric_limits<f32>::max());
+            chunkBounds.max = vec3(std::numeric_limits<f32>::lowest());
+
+            for (u32 i = 0; i < MAP_CELLS_PER_CHUNK; i++)
+            {
+                const Geometry::AABoundingBox& boundingBox = cellBoundingBoxes[i];
+
+                const vec3 min = glm::min(boundingBox.min, boundingBox.max);
+                const vec3 max = glm::max(boundingBox.min, boundingBox.max);
+
+                chunkBounds.cellMinX[i] = min.x;
+                chunkBounds.cellMinY[i] = min.y;
+                chunkBounds.cellMinZ[i] = min.z;
+                chunkBounds.cellMaxX[i] = max.x;
+                chunkBounds.cellMaxY[i] = max.y;
+                chunkBounds.cellMaxZ[i] = max.z;
+
+                chunkBounds.min = glm::min(chunkBounds.min, min);
+                chunkBounds.max = glm::max(chunkBounds.max, max);
+            }
+        }
+
+        // Tests the corner furthest along each plane normal to reject a box and the nearest one to accept it fully
+        inline FrustumResult TestChunk(const vec4* planes, const ChunkBounds& chunkBounds)
+        {
+            FrustumResult result = FrustumResult::Inside;
+
+            for (u32 i = 0; i < 6; i++)
+            {
+                const vec4& plane = planes[i];
+
+                const vec3 furthest = vec3(plane.x > 0 ? chunkBounds.max.x : chunkBounds.min.x, plane.y > 0 ? chunkBounds.max.y : chunkBounds.min.y, plane.z > 0 ? chunkBounds.max.z : chunkBounds.min.z);
+                if (glm::dot(vec3(plane), furthest) + plane.w < 0)
+                    return FrustumResult::Outside;
+
+                const vec3 nearest = vec3(plane.x > 0 ? chunkBounds.min.x : chunkBounds.max.x, plane.y > 0 ? chunkBounds.min.y : chunkBounds.max.y, plane.z > 0 ? chunkBounds.min.z : chunkBounds.max.z);
+                if (glm::dot(vec3(plane), nearest) + plane.w < 0)
+                    result = FrustumResult::Intersecting;
+            }
+
+            return result;
+        }
+
+        // The cell bounding boxes keep the highest corner in min, so the "vmin" picked here is the corner furthest along the plane
+        inline bool IsInsideFrustum(const vec4* planes, const Geometry::AABoundingBox& boundingBox)
+        {
+            // this is why god abandoned us
+            for (int i = 0; i < 6; ++i)
+            {
+                const vec4& plane = planes[i];
+
+                vec3 vmin, vmax;
+
+                // X axis 
+                if (plane.x > 0) {
+                    vmin.x = boundingBox.min.x;
+                    vmax.x = boundingBox.max.x;
+                }
+                else {
+                    vmin.x = boundingBox.max.x;
+                    vmax.x = boundingBox.min.x;
+                }
+                // Y axis 
+                if (plane.y > 0) {
+                    vmin.y = boundingBox.min.y;
+                    vmax.y = boundingBox.max.y;
+                }
+                else {
+                    vmin.y = boundingBox.max.y;
+                    vmax.y = boundingBox.min.y;
+                }
+                // Z axis 
+                if (plane.z > 0)
+                {
+                    vmin.z = boundingBox.min.z;
+                    vmax.z = boundingBox.max.z;
+                }
+                else
+                {
+                    vmin.z = boundingBox.max.z;
+                    vmax.z = boundingBox.min.z;
+                }
+
+                if (glm::dot(vec3(plane), vmin) + plane.w < 0)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Sets bit n of visibleCells for every cell n that is inside the frustum, this is the same test as IsInsideFrustum
+        inline void CullCells(const vec4* planes, const ChunkBounds& chunkBounds, u64 visibleCells[MAP_CELLS_PER_CHUNK / 64])
+        {
+            // Which corner is furthest along a plane only depends on the plane, so that choice is made once per plane instead of per cell
+            const f32* furthestX[6];
+            const f32* furthestY[6];
+            const f32* furthestZ[6];
+            __m128 planeX[6];
+            __m128 planeY[6];
+            __m128 planeZ[6];
+            __m128 planeW[6];
+
+            for (u32 i = 0; i < 6; i++)
+            {
+                const vec4& plane = planes[i];
+
+                furthestX[i] = plane.x > 0 ? chunkBounds.cellMaxX : chunkBounds.cellMinX;
+                furthestY[i] = plane.y > 0 ? chunkBounds.cellMaxY : chunkBounds.cellMinY;
+                furthestZ[i] = plane.z > 0 ? chunkBounds.cellMaxZ : chunkBounds.cellMinZ;
+
+                planeX[i] = _mm_set1_ps(plane.x);
+                planeY[i] = _mm_set1_ps(plane.y);
+                planeZ[i] = _mm_set1_ps(plane.z);
+                planeW[i] = _mm_set1_ps(plane.w);
+            }
+
+            const __m128 zero = _mm_setzero_ps();
+
+            for (u32 block = 0; block < MAP_CELLS_PER_CHUNK / 64; block++)
+            {
+                u64 blockMask = 0;
+
+                for (u32 group = 0; group < 64; group += 4)
+                {
+                    const u32 cell = block * 64 + group;
+                    __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+                    for (u32 i = 0; i < 6; i++)
+                    {
+                        __m128 distance = _mm_mul_ps(planeX[i], _mm_loadu_ps(furthestX[i] + cell));
+                        distance = _mm_add_ps(distance, _mm_mul_ps(planeY[i], _mm_loadu_ps(furthestY[i] + cell)));
+                        distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[i], _mm_loadu_ps(furthestZ[i] + cell)));
+                        distance = _mm_add_ps(distance, planeW[i]);
+
+                        visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, zero));
+                    }
+
+                    blockMask |= static_cast<u64>(_mm_movemask_ps(visible)) << group;
+                }
+
+                visibleCells[block] = blockMask;
+            }
+        }
+
+        // Fills a grid of chunks with random cell bounds and times TestChunk and CullCells against IsInsideFrustum on every cell, for a number of random views
+        void Benchmark(u32 numChunks);
+    }
+}
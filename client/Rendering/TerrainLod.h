@@ -0,0 +1,185 @@
+#pragma once
+#include <NovusTypes.h>
+#include <Math/Geometry.h>
+
+#include "../Gameplay/Map/Chunk.h"
+
+namespace Terrain
+{
+    // LOD n draws a cell with a grid that is 2^n times coarser, every quad of that grid is a fan of 4 triangles around its center like LOD 0
+    constexpr u32 NUM_CELL_LODS = 4;
+    constexpr u32 CELL_MAX_LOD_WITH_HOLES = 1; // Quads of LOD 1 line up with the hole bits, coarser ones would cover holes up
+
+    // CellInstance::instanceID packs the cell index with the LOD of the cell and of its 4 neighbours, this needs to match terrain.inc.hlsl
+    constexpr u32 CELL_INSTANCE_INDEX_MASK = 0xFFFFF;
+    constexpr u32 CELL_INSTANCE_LOD_SHIFT = 20;
+
+    constexpr u32 GetCellLodIndexCount(u32 lod)
+    {
+        const u32 quadsPerSide = MAP_CELL_INNER_GRID_STRIDE >> lod;
+        return quadsPerSide * quadsPerSide * 12;
+    }
+
+    constexpr u32 GetCellLodIndexOffset(u32 lod)
+    {
+        return lod == 0 ? 0 : GetCellLodIndexOffset(lod - 1) + GetCellLodIndexCount(lod - 1);
+    }
+
+    constexpr u32 NUM_CELL_LOD_INDICES = GetCellLodIndexOffset(NUM_CELL_LODS);
+
+    // Neighbours are stored in this order, which is also the order of the cell edges they share
+    enum class CellEdge : u8
+    {
+        Top, // First outer row
+        Right, // Last outer column
+        Bottom, // Last outer row
+        Left // First outer column
+    };
+
+    struct CellLodData
+    {
+        f32 errors[NUM_CELL_LODS - 1]; // Largest height difference to LOD 0 in yards for LOD 1 and up
+        u32 maxLod;
+    };
+
+    namespace Lod
+    {
+        inline f32 GetTriangleHeight(const vec2& p, const vec2& a, const vec2& b, const vec2& c, f32 aHeight, f32 bHeight, f32 cHeight)
+        {
+            const f32 det = (b.y - c.y) * (a.x - c.x) + (c.x - b.x) * (a.y - c.y);
+            const f32 alpha = ((b.y - c.y) * (p.x - c.x) + (c.x - b.x) * (p.y - c.y)) / det;
+            const f32 beta = ((c.y - a.y) * (p.x - c.x) + (a.x - c.x) * (p.y - c.y)) / det;
+
+            return aHeight * alpha + bHeight * beta + cHeight * (1.0f - alpha - beta);
+        }
+
+        inline u32 GetOuterVertexID(u32 row, u32 column)
+        {
+            return row * MAP_CELL_TOTAL_GRID_STRIDE + column;
+        }
+
+        inline void CalculateCellLodData(const Cell& cell, CellLodData& lodData)
+        {
+            f32 previousError = 0.0f;
+
+            for (u32 lod = 1; lod < NUM_CELL_LODS; lod++)
+            {
+                const u32 stride = 1 << lod;
+                const u32 quadsPerSide = MAP_CELL_INNER_GRID_STRIDE / stride;
+
+                f32 maxError = previousError;
+                for (u32 vertexID = 0; vertexID < MAP_CELL_TOTAL_GRID_SIZE; vertexID++)
+                {
+                    // Position in units of the outer grid, inner vertices sit in the middle of their quad
+                    const u32 row = vertexID / MAP_CELL_TOTAL_GRID_STRIDE;
+                    const u32 column = vertexID % MAP_CELL_TOTAL_GRID_STRIDE;
+                    const bool isInner = column >= MAP_CELL_OUTER_GRID_STRIDE;
+
+                    const vec2 position = isInner ? vec2(column - MAP_CELL_OUTER_GRID_STRIDE + 0.5f, row + 0.5f) : vec2(column, row);
+
+                    const u32 quadX = glm::min(static_cast<u32>(position.x) / stride, quadsPerSide - 1);
+                    const u32 quadY = glm::min(static_cast<u32>(position.y) / stride, quadsPerSide - 1);
+
+                    const u32 top = quadY * stride;
+                    const u32 left = quadX * stride;
+
+                    const vec2 topLeft = vec2(left, top);
+                    const vec2 topRight = vec2(left + stride, top);
+                    const vec2 bottomLeft = vec2(left, top + stride);
+                    const vec2 bottomRight = vec2(left + stride, top + stride);
+                    const vec2 center = vec2(left + stride / 2, top + stride / 2);
+
+                    const f32 topLeftHeight = cell.heightData[GetOuterVertexID(top, left)];
+                    const f32 topRightHeight = cell.heightData[GetOuterVertexID(top, left + stride)];
+                    const f32 bottomLeftHeight = cell.heightData[GetOuterVertexID(top + stride, left)];
+                    const f32 bottomRightHeight = cell.heightData[GetOuterVertexID(top + stride, left + stride)];
+                    const f32 centerHeight = cell.heightData[GetOuterVertexID(top + stride / 2, left + stride / 2)];
+
+                    // Find which triangle of the fan the vertex is in
+                    const vec2 local = (position - topLeft) / static_cast<f32>(stride);
+
+                    f32 coarseHeight;
+                    if (local.y <= local.x && local.y <= 1.0f - local.x)
+                    {
+                        coarseHeight = GetTriangleHeight(position, center, topRight, topLeft, centerHeight, topRightHeight, topLeftHeight);
+                    }
+                    else if (local.y >= local.x && local.y >= 1.0f - local.x)
+                    {
+                        coarseHeight = GetTriangleHeight(position, center, bottomLeft, bottomRight, centerHeight, bottomLeftHeight, bottomRightHeight);
+                    }
+                    else if (local.x <= local.y)
+                    {
+                        coarseHeight = GetTriangleHeight(position, center, topLeft, bottomLeft, centerHeight, topLeftHeight, bottomLeftHeight);
+                    }
+                    else
+                    {
+                        coarseHeight = GetTriangleHeight(position, center, bottomRight, topRight, centerHeight, bottomRightHeight, topRightHeight);
+                    }
+
+                    maxError = glm::max(maxError, glm::abs(cell.heightData[vertexID] - coarseHeight));
+                }
+
+                // Coarser LODs never get a smaller error, which keeps the selection a simple walk up the LODs
+                lodData.errors[lod - 1] = maxError;
+                previousError = maxError;
+            }
+
+            lodData.maxLod = cell.hole != 0 ? CELL_MAX_LOD_WITH_HOLES : NUM_CELL_LODS - 1;
+        }
+
+        // lodErrorScale is the size of a yard in pixels at a distance of 1 divided by the allowed error in pixels, forcedLod is ignored when negative
+        inline u32 SelectCellLod(const CellLodData& lodData, const Geometry::AABoundingBox& boundingBox, const vec3& cameraPosition, f32 lodErrorScale, i32 forcedLod)
+        {
+            if (forcedLod >= 0)
+                return glm::min(static_cast<u32>(forcedLod), lodData.maxLod);
+
+            // Cell bounding boxes don't keep min and max in order
+            const vec3 boxMin = glm::min(boundingBox.min, boundingBox.max);
+            const vec3 boxMax = glm::max(boundingBox.min, boundingBox.max);
+            const f32 distance = glm::distance(cameraPosition, glm::clamp(cameraPosition, boxMin, boxMax));
+
+            u32 lod = 0;
+            while (lod < lodData.maxLod && lodData.errors[lod] * lodErrorScale <= distance)
+            {
+                lod++;
+            }
+
+            return lod;
+        }
+
+        // Returns false if the neighbour would be outside of the map
+        inline bool GetNeighbourCell(u16 chunkID, u16 cellID, CellEdge edge, u16& neighbourChunkID, u16& neighbourCellID)
+        {
+            constexpr i32 offsetsX[] = { 0, 1, 0, -1 };
+            constexpr i32 offsetsY[] = { -1, 0, 1, 0 };
+
+            i32 chunkX = chunkID % MAP_CHUNKS_PER_MAP_STRIDE;
+            i32 chunkY = chunkID / MAP_CHUNKS_PER_MAP_STRIDE;
+            i32 cellX = (cellID % MAP_CELLS_PER_CHUNK_SIDE) + offsetsX[static_cast<u8>(edge)];
+            i32 cellY = (cellID / MAP_CELLS_PER_CHUNK_SIDE) + offsetsY[static_cast<u8>(edge)];
+
+            if (cellX < 0) { cellX += MAP_CELLS_PER_CHUNK_SIDE; chunkX--; }
+            if (cellX >= MAP_CELLS_PER_CHUNK_SIDE) { cellX -= MAP_CELLS_PER_CHUNK_SIDE; chunkX++; }
+            if (cellY < 0) { cellY += MAP_CELLS_PER_CHUNK_SIDE; chunkY--; }
+            if (cellY >= MAP_CELLS_PER_CHUNK_SIDE) { cellY -= MAP_CELLS_PER_CHUNK_SIDE; chunkY++; }
+
+            if (chunkX < 0 || chunkY < 0 || chunkX >= static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE) || chunkY >= static_cast<i32>(MAP_CHUNKS_PER_MAP_STRIDE))
+                return false;
+
+            neighbourChunkID = static_cast<u16>(chunkX + (chunkY * MAP_CHUNKS_PER_MAP_STRIDE));
+            neighbourCellID = static_cast<u16>(cellX + (cellY * MAP_CELLS_PER_CHUNK_SIDE));
+            return true;
+        }
+
+        inline u32 PackCellInstanceID(u32 cellIndex, u32 lod, const u32 neighbourLods[4])
+        {
+            u32 packed = lod;
+            for (u32 i = 0; i < 4; i++)
+            {
+                packed |= neighbourLods[i] << (2 + i * 2);
+            }
+
+            return cellIndex | (packed << CELL_INSTANCE_LOD_SHIFT);
+        }
+    }
+}
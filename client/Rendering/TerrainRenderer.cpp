@@ -1,9 +1,12 @@
 #include "TerrainRenderer.h"
 #include "DebugRenderer.h"
 #include "MapObjectRenderer.h"
+#include "TerrainStreamer.h"
+#include "TerrainClipmap.h"
 #include <entt.hpp>
 #include "../Utils/ServiceLocator.h"
 #include "../Utils/MapUtils.h"
+#include "../Utils/RadixSort.h"
 
 #include "../ECS/Components/Singletons/MapSingleton.h"
 #include "../ECS/Components/Singletons/TextureSingleton.h"
@@ -16,12 +19,17 @@
 #include <InputManager.h>
 #include <GLFW/glfw3.h>
 #include <tracy/Tracy.hpp>
+#include <taskflow/taskflow.hpp>
+#include <Utils/Timer.h>
 
 #include "Camera.h"
+#include "ClientRenderer.h"
 #include "../Loaders/Map/MapLoader.h"
+#include "../Loaders/Texture/AlphaMapCooker.h"
 #include "CVar/CVarSystem.h"
 
 #define USE_PACKED_HEIGHT_RANGE 1
+#define USE_DERIVED_NORMALS 1
 
 
 static vec3 s_debugPosition = vec3(0, 0, 0);
@@ -31,12 +39,48 @@ AutoCVar_Int CVAR_CullingEnabled("terrain.cullEnable", "enable culling of terrai
 
 AutoCVar_Int CVAR_GPUCullingEnabled("terrain.gpuCullEnable", "enable gpu culling", 0, CVarFlags::EditCheckbox);
 
+AutoCVar_Int CVAR_HierarchicalCulling("terrain.cpuCull.hierarchical", "cull chunks before their cells and test cells 4 at a time on the culling workers", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_CompareCulling("terrain.cpuCull.compare", "also run the scalar cpu culling every frame and report the timings of both", 0, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_OcclusionCullingEnabled("terrain.occlusionCullEnable", "test cells that weren't drawn last frame against the depth of the ones that were, needs gpu culling", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_SortFrontToBack("terrain.sortFrontToBack", "order the culled cells of every draw front to back so early depth testing rejects more of what is behind them", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_ClipmapEnabled("terrain.clipmap.enable", "shade distant terrain from an albedo clipmap that is baked around the camera", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_ClipmapBakeBudget("terrain.clipmap.bakeBudget", "clipmap pages baked per frame at most", 8);
+
+AutoCVar_Int CVAR_AlphaMapCompressionEnabled("terrain.alphaMap.compress", "load block compressed alpha maps, they are cooked from the uncompressed ones on first use", 1, CVarFlags::EditCheckbox);
+
 AutoCVar_Int CVAR_LockCullingFrustum("terrain.lockCullingFrustum", "lock frustrum for terrain culling", 0, CVarFlags::EditCheckbox);
 
 AutoCVar_Int CVAR_LockDebugPosition("terrain.lockDebugPosition", "lock terrain debug position", 0, CVarFlags::EditCheckbox);
 
+AutoCVar_Int CVAR_ForceSingleLayer("terrain.forceSingleLayer", "render all terrain cells with the single layer pixel shader permutation", 0, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_LayerClassesEnabled("terrain.layerClasses.enable", "shade cells with one or two layers with their own pixel shader permutation, when disabled every layer class uses the full one so their GPU zones can be compared", 1, CVarFlags::EditCheckbox);
+
 AutoCVar_Float CVAR_DebugPositionScale("terrain.debugPositionScale", "size of the debug position marker", 0.1f);
 
+AutoCVar_Int CVAR_StreamingEnabled("terrain.streaming.enable", "only keep chunks near the camera loaded, takes effect on the next map load", 1, CVarFlags::EditCheckbox);
+
+AutoCVar_Float CVAR_StreamingRadius("terrain.streaming.radius", "distance in chunks around the camera that gets loaded, the slot count is sized from it on map load", 6.0f);
+
+AutoCVar_Float CVAR_StreamingHysteresis("terrain.streaming.hysteresis", "extra distance in chunks a chunk has to move past the radius before it is unloaded", 1.0f);
+
+AutoCVar_Int CVAR_KeepChunks("terrain.keepChunks", "keep the full CPU side chunks around after they are uploaded, gameplay only needs the heightfield", 0, CVarFlags::EditCheckbox);
+
+AutoCVar_Int CVAR_StreamingUploadBudget("terrain.streaming.uploadBudget", "KB of streamed terrain data uploaded to the GPU per frame", 2048);
+
+AutoCVar_Float CVAR_LodErrorThreshold("terrain.lod.errorThreshold", "screen space error in pixels that the LOD of a cell is allowed to have", 2.0f);
+
+AutoCVar_Int CVAR_LodForced("terrain.lod.force", "draw every cell with this LOD, -1 picks them by screen space error", -1);
+
+// Slots of unloaded chunks are only reused once the frames that could still be drawing them are done
+constexpr u64 STREAMING_SLOT_REUSE_DELAY = 3;
+constexpr u32 MAX_STREAMING_WORKERS = 4;
+
 struct TerrainChunkData
 {
     u32 alphaMapID = 0;
@@ -46,7 +90,7 @@ struct TerrainCellData
 {
     u16 diffuseIDs[4];
     u16 hole;
-    u16 _padding;
+    u16 layerClass; // Terrain::CellLayerClass, the culling shader buckets the cell by it
 };
 
 struct TerrainCellHeightRange
@@ -59,13 +103,68 @@ struct TerrainCellHeightRange
 #endif
 };
 
-TerrainRenderer::TerrainRenderer(Renderer::Renderer* renderer, DebugRenderer* debugRenderer)
+#pragma pack(push, 1)
+struct TerrainVertexWithNormal
+{
+    u8 normal[3];
+    u8 color[3];
+    f16 height;
+};
+
+// terrain.vs.hlsl derives the normal from the neighbouring heights, the padding makes the vertex 6 bytes so the shader can load it from two aligned u32s
+struct TerrainVertexDerivedNormal
+{
+    u8 color[3];
+    f16 height;
+    u8 padding;
+};
+#pragma pack(pop)
+
+#if USE_DERIVED_NORMALS
+using TerrainVertex = TerrainVertexDerivedNormal;
+#else
+using TerrainVertex = TerrainVertexWithNormal;
+#endif
+
+// A chunk is uploaded through a single staging buffer holding these regions back to back, each one is copied to the chunk's slot in its own GPU buffer
+constexpr u64 CHUNK_UPLOAD_CELL_DATA_SIZE = sizeof(TerrainCellData) * Terrain::MAP_CELLS_PER_CHUNK;
+constexpr u64 CHUNK_UPLOAD_CHUNK_DATA_SIZE = sizeof(TerrainChunkData);
+constexpr u64 CHUNK_UPLOAD_VERTEX_SIZE = sizeof(TerrainVertex) * Terrain::NUM_VERTICES_PER_CHUNK;
+constexpr u64 CHUNK_UPLOAD_HEIGHT_RANGE_SIZE = sizeof(TerrainCellHeightRange) * Terrain::MAP_CELLS_PER_CHUNK;
+constexpr u64 CHUNK_UPLOAD_LOD_DATA_SIZE = sizeof(Terrain::CellLodData) * Terrain::MAP_CELLS_PER_CHUNK;
+
+constexpr u64 CHUNK_UPLOAD_CELL_DATA_OFFSET = 0;
+constexpr u64 CHUNK_UPLOAD_CHUNK_DATA_OFFSET = CHUNK_UPLOAD_CELL_DATA_OFFSET + CHUNK_UPLOAD_CELL_DATA_SIZE;
+constexpr u64 CHUNK_UPLOAD_VERTEX_OFFSET = CHUNK_UPLOAD_CHUNK_DATA_OFFSET + CHUNK_UPLOAD_CHUNK_DATA_SIZE;
+constexpr u64 CHUNK_UPLOAD_HEIGHT_RANGE_OFFSET = CHUNK_UPLOAD_VERTEX_OFFSET + CHUNK_UPLOAD_VERTEX_SIZE;
+constexpr u64 CHUNK_UPLOAD_LOD_DATA_OFFSET = CHUNK_UPLOAD_HEIGHT_RANGE_OFFSET + CHUNK_UPLOAD_HEIGHT_RANGE_SIZE;
+constexpr u64 CHUNK_UPLOAD_SIZE = CHUNK_UPLOAD_LOD_DATA_OFFSET + CHUNK_UPLOAD_LOD_DATA_SIZE;
+
+// Distance in chunks from a position in chunk space to the closest point of a chunk, 0 when inside it
+f32 GetChunkDistance(const vec2& chunkSpacePosition, u16 chunkID)
+{
+    const vec2 chunkCenter = vec2(chunkID % Terrain::MAP_CHUNKS_PER_MAP_STRIDE, chunkID / Terrain::MAP_CHUNKS_PER_MAP_STRIDE) + 0.5f;
+    const vec2 outside = glm::max(glm::abs(chunkSpacePosition - chunkCenter) - 0.5f, vec2(0.0f, 0.0f));
+
+    return glm::length(outside);
+}
+
+// CPU memory a chunk holds on to, not counting its string table
+size_t GetChunkBytes(const Terrain::Chunk& chunk)
+{
+    return sizeof(Terrain::Chunk) + (sizeof(Terrain::MapObjectPlacement) * chunk.mapObjectPlacements.capacity());
+}
+
+TerrainRenderer::TerrainRenderer(Renderer::Renderer* renderer, DebugRenderer* debugRenderer, tf::Taskflow* workerTaskflow)
     : _renderer(renderer)
     , _debugRenderer(debugRenderer)
+    , _workerTaskflow(workerTaskflow)
 {
     _mapObjectRenderer = new MapObjectRenderer(renderer); // Needs to be created before CreatePermanentResources
     CreatePermanentResources();
 
+    _clipmap = new TerrainClipmap(renderer);
+
     ServiceLocator::GetInputManager()->RegisterKeybind("ToggleCulling", GLFW_KEY_F2, KEYBIND_ACTION_PRESS, KEYBIND_MOD_ANY, [this](Window* window, std::shared_ptr<Keybind> keybind)
     {
         CVAR_CullingEnabled.Toggle();
@@ -103,6 +202,10 @@ TerrainRenderer::TerrainRenderer(Renderer::Renderer* renderer, DebugRenderer* de
 
 TerrainRenderer::~TerrainRenderer()
 {
+    FlushStreaming();
+    delete _streamer;
+
+    delete _clipmap;
     delete _mapObjectRenderer;
 }
 
@@ -138,100 +241,303 @@ void TerrainRenderer::Update(f32 deltaTime)
     
     DebugRenderCellTriangles(camera);
 
+    if (_isStreaming)
+    {
+        UpdateStreaming(camera);
+    }
+
+    // A yard at a distance of 1 covers projection[1][1] * height / 2 pixels
+    const f32 pixelsPerYard = camera->GetProjectionMatrix()[1][1] * 0.5f * static_cast<f32>(ServiceLocator::GetClientRenderer()->HEIGHT);
+    _lodErrorScale = pixelsPerYard / glm::max(CVAR_LodErrorThreshold.GetFloat(), 0.01f);
+
     if (CVAR_CullingEnabled.Get() && !CVAR_GPUCullingEnabled.Get())
     {
         CPUCulling(camera);
     }
 
+    if (CVAR_ClipmapEnabled.Get() && !_loadedChunks.empty())
+    {
+        const vec2 cameraCellPosition = Terrain::MapUtils::WorldPositionToADTCoordinates(camera->GetPosition()) / Terrain::MAP_CELL_SIZE;
+        _clipmap->Update(cameraCellPosition, static_cast<u32>(glm::max(CVAR_ClipmapBakeBudget.Get(), 0)));
+    }
+
     // Subrenderers
-    //_mapObjectRenderer->Update(deltaTime);
+    _mapObjectRenderer->Update(deltaTime);
 }
 
-__forceinline bool IsInsideFrustum(const vec4* planes, const Geometry::AABoundingBox& boundingBox)
+void TerrainRenderer::CPUCulling(const Camera* camera)
 {
-    // this is why god abandoned us
-    for (int i = 0; i < 6; ++i)
+    ZoneScoped;
+
+    static vec4 frustumPlanes[6];
+    static mat4x4 lockedViewProjectionMatrix;
+    static vec3 lockedCameraPosition;
+
+    if (!CVAR_LockCullingFrustum.Get())
     {
-        const vec4& plane = planes[i];
+        memcpy(frustumPlanes, camera->GetFrustumPlanes(), sizeof(frustumPlanes));
+        lockedViewProjectionMatrix = camera->GetViewProjectionMatrix();
+        lockedCameraPosition = camera->GetPosition();
+    }
 
-        vec3 vmin, vmax;
+    _cullingStats = CullingStats();
+    const bool hierarchicalCulling = CVAR_HierarchicalCulling.Get();
 
-        // X axis 
-        if (plane.x > 0) {
-            vmin.x = boundingBox.min.x;
-            vmax.x = boundingBox.max.x;
-        }
-        else {
-            vmin.x = boundingBox.max.x;
-            vmax.x = boundingBox.min.x;
-        }
-        // Y axis 
-        if (plane.y > 0) {
-            vmin.y = boundingBox.min.y;
-            vmax.y = boundingBox.max.y;
-        }
-        else {
-            vmin.y = boundingBox.max.y;
-            vmax.y = boundingBox.min.y;
-        }
-        // Z axis 
-        if (plane.z > 0)
+    // The scalar path runs first when comparing, so what gets drawn still comes from the hierarchical one
+    if (hierarchicalCulling && CVAR_CompareCulling.Get())
+    {
+        Timer scalarTimer;
+        CullCellsScalar(frustumPlanes, lockedCameraPosition);
+
+        _cullingStats.scalarCullingTime = scalarTimer.GetLifeTime();
+        _cullingStats.scalarVisibleCells = static_cast<u32>(_culledInstances.size());
+    }
+
+    Timer timer;
+    if (hierarchicalCulling)
+    {
+        CullCellsHierarchical(frustumPlanes, lockedCameraPosition);
+    }
+    else
+    {
+        CullCellsScalar(frustumPlanes, lockedCameraPosition);
+    }
+
+    _cullingStats.cullingTime = timer.GetLifeTime();
+    _cullingStats.visibleCells = static_cast<u32>(_culledInstances.size());
+
+    if (CVAR_SortFrontToBack.Get())
+    {
+        Timer sortTimer;
+        SortCulledInstances(lockedCameraPosition);
+        _cullingStats.sortTime = sortTimer.GetLifeTime();
+    }
+
+    u32 lodCells[Terrain::NUM_CELL_LODS] = { 0 };
+    for (u32 layerClass = 0; layerClass < Terrain::NUM_CELL_LAYER_CLASSES; layerClass++)
+    {
+        for (u32 lod = 0; lod < Terrain::NUM_CELL_LODS; lod++)
         {
-            vmin.z = boundingBox.min.z;
-            vmax.z = boundingBox.max.z;
+            const u32 cellCount = _culledBucketInstanceCounts[Terrain::GetCellDrawBucket(layerClass, lod)];
+            lodCells[lod] += cellCount;
+            _cullingStats.layerClassCells[layerClass] += cellCount;
         }
-        else
+    }
+
+    TracyPlot("Terrain LOD0 Cells", static_cast<i64>(lodCells[0]));
+    TracyPlot("Terrain LOD1 Cells", static_cast<i64>(lodCells[1]));
+    TracyPlot("Terrain LOD2 Cells", static_cast<i64>(lodCells[2]));
+    TracyPlot("Terrain LOD3 Cells", static_cast<i64>(lodCells[3]));
+    TracyPlot("Terrain Single Layer Cells", static_cast<i64>(_cullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_SINGLE]));
+    TracyPlot("Terrain Two Layer Cells", static_cast<i64>(_cullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_TWO]));
+    TracyPlot("Terrain Full Layer Cells", static_cast<i64>(_cullingStats.layerClassCells[Terrain::CELL_LAYER_CLASS_FULL]));
+
+    _debugRenderer->DrawFrustum(lockedViewProjectionMatrix, 0xff0000ff);
+}
+
+void TerrainRenderer::CullCellsScalar(const vec4* frustumPlanes, const vec3& cameraPosition)
+{
+    ZoneScoped;
+
+    // Every resident cell gets a LOD first, cells outside of the frustum still need one for the visible cells they share an edge with
+    const i32 forcedLod = CVAR_LodForced.Get();
+    for (const LoadedChunk& loadedChunk : _loadedChunks)
+    {
+        const u32 firstCellIndex = loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK;
+
+        for (u32 index = firstCellIndex; index < firstCellIndex + Terrain::MAP_CELLS_PER_CHUNK; index++)
         {
-            vmin.z = boundingBox.max.z;
-            vmax.z = boundingBox.min.z;
+            _cellLods[index] = Terrain::Lod::SelectCellLod(_cellLodData[index], _cellBoundingBoxes[index], cameraPosition, _lodErrorScale, forcedLod);
         }
+    }
+
+    for (std::vector<CellInstance>& bucketInstances : _culledBucketInstances)
+    {
+        bucketInstances.clear();
+    }
+
+    for (const LoadedChunk& loadedChunk : _loadedChunks)
+    {
+        const u32 firstCellIndex = loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK;
 
-        if (glm::dot(vec3(plane), vmin) + plane.w < 0)
+        for (u16 cellId = 0; cellId < Terrain::MAP_CELLS_PER_CHUNK; ++cellId)
         {
-            return false;
+            u32 index = firstCellIndex + cellId;
+
+            const Geometry::AABoundingBox& boundingBox = _cellBoundingBoxes[index];
+            if (Terrain::Culling::IsInsideFrustum(frustumPlanes, boundingBox))
+            {
+                const u32 lod = _cellLods[index];
+
+                u32 neighbourLods[4];
+                for (u8 edge = 0; edge < 4; edge++)
+                {
+                    neighbourLods[edge] = GetNeighbourCellLod(loadedChunk.chunkID, cellId, static_cast<Terrain::CellEdge>(edge), lod);
+                }
+
+                const u32 bucket = Terrain::GetCellDrawBucket(_cellLayerClasses[index], lod);
+                CellInstance& cellInstance = _culledBucketInstances[bucket].emplace_back();
+                cellInstance.packedChunkCellID = (loadedChunk.chunkID << 16) | cellId;
+                cellInstance.instanceID = Terrain::Lod::PackCellInstanceID(index, lod, neighbourLods);
+            }
         }
     }
 
-    return true;
+    // Instances of the same bucket need to be next to each other since every bucket is a separate draw
+    _culledInstances.clear();
+    for (u32 bucket = 0; bucket < Terrain::NUM_CELL_DRAW_BUCKETS; bucket++)
+    {
+        _culledInstances.insert(_culledInstances.end(), _culledBucketInstances[bucket].begin(), _culledBucketInstances[bucket].end());
+        _culledBucketInstanceCounts[bucket] = static_cast<u32>(_culledBucketInstances[bucket].size());
+    }
 }
 
-void TerrainRenderer::CPUCulling(const Camera* camera)
+void TerrainRenderer::CullCellsHierarchical(const vec4* frustumPlanes, const vec3& cameraPosition)
 {
     ZoneScoped;
 
-    static vec4 frustumPlanes[6];
-    static mat4x4 lockedViewProjectionMatrix;
-
-    if (!CVAR_LockCullingFrustum.Get())
+    const u32 numChunks = static_cast<u32>(_loadedChunks.size());
+    if (numChunks == 0)
     {
-        memcpy(frustumPlanes, camera->GetFrustumPlanes(), sizeof(frustumPlanes));
-        lockedViewProjectionMatrix = camera->GetViewProjectionMatrix();
+        _culledInstances.clear();
+        _culledBucketInstanceCounts.fill(0);
+        return;
     }
 
-    _culledInstances.clear();
-    _culledInstances.reserve(_loadedChunks.size() * Terrain::MAP_CELLS_PER_CHUNK);
+    _chunkCullingResults.resize(numChunks);
 
-    const size_t chunkCount = _loadedChunks.size();
-    size_t boundingBoxIndex = 0;
-    for (size_t i = 0; i < chunkCount; ++i)
+    // Selects the LOD of every cell and finds the visible ones, cells outside of the frustum still need a LOD for the visible cells they share an edge with
+    const i32 forcedLod = CVAR_LodForced.Get();
+    _workerTaskflow->parallel_for(0u, numChunks, 1u, [&](u32 chunkIndex)
     {
-        for (u16 cellId = 0; cellId < Terrain::MAP_CELLS_PER_CHUNK; ++cellId)
+        const LoadedChunk& loadedChunk = _loadedChunks[chunkIndex];
+        const u32 firstCellIndex = loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK;
+        ChunkCullingResult& result = _chunkCullingResults[chunkIndex];
+
+        for (u32 index = firstCellIndex; index < firstCellIndex + Terrain::MAP_CELLS_PER_CHUNK; index++)
         {
-            u32 index = static_cast<u32>(boundingBoxIndex++);
+            _cellLods[index] = Terrain::Lod::SelectCellLod(_cellLodData[index], _cellBoundingBoxes[index], cameraPosition, _lodErrorScale, forcedLod);
+        }
 
-            const Geometry::AABoundingBox& boundingBox = _cellBoundingBoxes[index];
-            if (IsInsideFrustum(frustumPlanes, boundingBox))
+        const Terrain::Culling::ChunkBounds& chunkBounds = _chunkBounds[loadedChunk.slot];
+        switch (Terrain::Culling::TestChunk(frustumPlanes, chunkBounds))
+        {
+            case Terrain::Culling::FrustumResult::Outside:
+                memset(result.visibleCells, 0, sizeof(result.visibleCells));
+                break;
+            case Terrain::Culling::FrustumResult::Inside:
+                memset(result.visibleCells, 0xFF, sizeof(result.visibleCells));
+                break;
+            case Terrain::Culling::FrustumResult::Intersecting:
+                Terrain::Culling::CullCells(frustumPlanes, chunkBounds, result.visibleCells);
+                break;
+        }
+
+        memset(result.bucketCounts, 0, sizeof(result.bucketCounts));
+        for (u32 cellID = 0; cellID < Terrain::MAP_CELLS_PER_CHUNK; cellID++)
+        {
+            if (result.visibleCells[cellID / 64] & (1ull << (cellID % 64)))
             {
-                const u16 chunkId = _loadedChunks[i];
+                const u32 index = firstCellIndex + cellID;
+                result.bucketCounts[Terrain::GetCellDrawBucket(_cellLayerClasses[index], _cellLods[index])]++;
+            }
+        }
+    });
+    _workerTaskflow->wait_for_all();
+
+    // Instances of the same bucket need to be next to each other since every bucket is a separate draw, within a bucket they keep the order of _loadedChunks
+    u32 numInstances = 0;
+    for (u32 bucket = 0; bucket < Terrain::NUM_CELL_DRAW_BUCKETS; bucket++)
+    {
+        const u32 firstInstance = numInstances;
+
+        for (ChunkCullingResult& result : _chunkCullingResults)
+        {
+            result.bucketOffsets[bucket] = numInstances;
+            numInstances += result.bucketCounts[bucket];
+        }
+
+        _culledBucketInstanceCounts[bucket] = numInstances - firstInstance;
+    }
 
-                CellInstance& cellInstance = _culledInstances.emplace_back();
-                cellInstance.packedChunkCellID = (chunkId << 16) | cellId;
-                cellInstance.instanceID = index;
+    for (const ChunkCullingResult& result : _chunkCullingResults)
+    {
+        const bool isVisible = (result.visibleCells[0] | result.visibleCells[1] | result.visibleCells[2] | result.visibleCells[3]) != 0;
+        _cullingStats.visibleChunks += isVisible;
+    }
+
+    // Every chunk knows where its instances go, so they are written straight into their final place
+    _culledInstances.resize(numInstances);
+    _workerTaskflow->parallel_for(0u, numChunks, 1u, [&](u32 chunkIndex)
+    {
+        const LoadedChunk& loadedChunk = _loadedChunks[chunkIndex];
+        const u32 firstCellIndex = loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK;
+        ChunkCullingResult& result = _chunkCullingResults[chunkIndex];
+
+        for (u16 cellID = 0; cellID < Terrain::MAP_CELLS_PER_CHUNK; cellID++)
+        {
+            if ((result.visibleCells[cellID / 64] & (1ull << (cellID % 64))) == 0)
+                continue;
+
+            const u32 index = firstCellIndex + cellID;
+            const u32 lod = _cellLods[index];
+
+            u32 neighbourLods[4];
+            for (u8 edge = 0; edge < 4; edge++)
+            {
+                neighbourLods[edge] = GetNeighbourCellLod(loadedChunk.chunkID, cellID, static_cast<Terrain::CellEdge>(edge), lod);
             }
+
+            const u32 bucket = Terrain::GetCellDrawBucket(_cellLayerClasses[index], lod);
+            CellInstance& cellInstance = _culledInstances[result.bucketOffsets[bucket]++];
+            cellInstance.packedChunkCellID = (loadedChunk.chunkID << 16) | cellID;
+            cellInstance.instanceID = Terrain::Lod::PackCellInstanceID(index, lod, neighbourLods);
         }
+    });
+    _workerTaskflow->wait_for_all();
+}
+
+void TerrainRenderer::SortCulledInstances(const vec3& cameraPosition)
+{
+    ZoneScoped;
+
+    _culledSortKeys.resize(_culledInstances.size());
+
+    for (size_t i = 0; i < _culledInstances.size(); i++)
+    {
+        // Cell bounding boxes don't keep min and max in order
+        const Geometry::AABoundingBox& boundingBox = _cellBoundingBoxes[_culledInstances[i].instanceID & Terrain::CELL_INSTANCE_INDEX_MASK];
+        const vec3 boxMin = glm::min(boundingBox.min, boundingBox.max);
+        const vec3 boxMax = glm::max(boundingBox.min, boundingBox.max);
+        const f32 distance = glm::distance(cameraPosition, glm::clamp(cameraPosition, boxMin, boxMax));
+
+        _culledSortKeys[i] = RadixSort::GetDistanceKey(distance);
     }
 
-    _debugRenderer->DrawFrustum(lockedViewProjectionMatrix, 0xff0000ff);
+    // Every bucket is a separate draw, so only the instances within a bucket get reordered
+    u32 firstInstance = 0;
+    for (u32 bucket = 0; bucket < Terrain::NUM_CELL_DRAW_BUCKETS; bucket++)
+    {
+        const u32 count = _culledBucketInstanceCounts[bucket];
+        RadixSort::SortByKey16(&_culledSortKeys[firstInstance], &_culledInstances[firstInstance], count, _sortScratchKeys, _sortScratchInstances);
+
+        firstInstance += count;
+    }
+}
+
+u32 TerrainRenderer::GetNeighbourCellLod(u16 chunkID, u16 cellID, Terrain::CellEdge edge, u32 cellLod)
+{
+    // Neighbours that aren't resident return our own LOD, which leaves the edge as it is
+    u16 neighbourChunkID;
+    u16 neighbourCellID;
+    if (!Terrain::Lod::GetNeighbourCell(chunkID, cellID, edge, neighbourChunkID, neighbourCellID))
+        return cellLod;
+
+    const u32 neighbourSlot = _chunkSlotTable[neighbourChunkID];
+    if (neighbourSlot == Terrain::CHUNK_SLOT_INVALID)
+        return cellLod;
+
+    return _cellLods[neighbourSlot * Terrain::MAP_CELLS_PER_CHUNK + neighbourCellID];
 }
 
 void TerrainRenderer::DebugRenderCellTriangles(const Camera* camera)
@@ -254,8 +560,80 @@ void TerrainRenderer::DebugRenderCellTriangles(const Camera* camera)
     }
 }
 
-void TerrainRenderer::AddTerrainPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, u8 frameIndex)
+void TerrainRenderer::AddTerrainDepthPrepass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::DepthImageID depthTarget, Renderer::DepthPyramid* depthPyramid, u8 frameIndex)
+{
+    const bool cullingEnabled = CVAR_CullingEnabled.Get();
+    const bool gpuCullEnabled = CVAR_GPUCullingEnabled.Get();
+    const bool lockFrustum = CVAR_LockCullingFrustum.Get();
+    const bool occlusionCullEnabled = IsOcclusionCullingEnabled();
+
+    // Terrain Depth Prepass
+    {
+        struct TerrainDepthPrepassData
+        {
+            Renderer::RenderPassMutableResource mainDepth;
+        };
+
+        renderGraph->AddPass<TerrainDepthPrepassData>("Terrain Depth Prepass",
+            [=](TerrainDepthPrepassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+        {
+            data.mainDepth = builder.Write(depthTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+
+            return true; // Return true from setup to enable this pass, return false to disable it
+        },
+            [=](TerrainDepthPrepassData& data, Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList) // Execute
+        {
+            GPU_SCOPED_PROFILER_ZONE(commandList, TerrainDepthPrepass);
+
+            // This is the first pass to draw terrain this frame, so it uploads streamed chunks and does the culling for both passes
+            UploadStreamedChunks(commandList);
+            BakeClipmap(resources, commandList, frameIndex);
+            CullCells(resources, commandList, cullingEnabled, gpuCullEnabled, lockFrustum, occlusionCullEnabled, depthPyramid->GetImage(), frameIndex);
+
+            RecordDepthPrepass(resources, commandList, globalDescriptorSet, data.mainDepth, cullingEnabled, gpuCullEnabled, CELL_DRAW_LIST_MAIN, frameIndex);
+        });
+    }
+
+    // The terrain that was visible last frame is in the depth buffer now, everything else gets tested against it
+    if (occlusionCullEnabled)
+    {
+        depthPyramid->AddBuildPass(renderGraph, depthTarget, frameIndex);
+
+        struct TerrainOcclusionDepthPrepassData
+        {
+            Renderer::RenderPassMutableResource mainDepth;
+            Renderer::RenderPassResource depthPyramid;
+        };
+
+        renderGraph->AddPass<TerrainOcclusionDepthPrepassData>("Terrain Occlusion Depth Prepass",
+            [=](TerrainOcclusionDepthPrepassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+        {
+            data.mainDepth = builder.Write(depthTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+            data.depthPyramid = builder.Read(depthPyramid->GetImage(), Renderer::RenderGraphBuilder::ShaderStage::SHADER_STAGE_COMPUTE);
+
+            return true; // Return true from setup to enable this pass, return false to disable it
+        },
+            [=](TerrainOcclusionDepthPrepassData& data, Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList) // Execute
+        {
+            GPU_SCOPED_PROFILER_ZONE(commandList, TerrainOcclusionDepthPrepass);
+
+            CullOccludedCells(resources, commandList, depthPyramid->GetImage(), frameIndex);
+
+            RecordDepthPrepass(resources, commandList, globalDescriptorSet, data.mainDepth, cullingEnabled, gpuCullEnabled, CELL_DRAW_LIST_NEWLY_VISIBLE, frameIndex);
+        });
+    }
+
+    // Subrenderers
+    _mapObjectRenderer->AddMapObjectDepthPrepass(renderGraph, globalDescriptorSet, depthTarget, frameIndex);
+}
+
+void TerrainRenderer::AddTerrainPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, Renderer::DepthPyramid* depthPyramid, bool depthPrepassEnabled, bool overdrawEnabled, u8 frameIndex)
 {
+    const bool cullingEnabled = CVAR_CullingEnabled.Get();
+    const bool gpuCullEnabled = CVAR_GPUCullingEnabled.Get();
+    const bool lockFrustum = CVAR_LockCullingFrustum.Get();
+    const bool occlusionCullEnabled = IsOcclusionCullingEnabled();
+
     // Terrain Pass
     {
         struct TerrainPassData
@@ -264,10 +642,6 @@ void TerrainRenderer::AddTerrainPass(Renderer::RenderGraph* renderGraph, Rendere
             Renderer::RenderPassMutableResource mainDepth;
         };
 
-        const bool cullingEnabled = CVAR_CullingEnabled.Get();
-        const bool gpuCullEnabled = CVAR_GPUCullingEnabled.Get();
-        const bool lockFrustum = CVAR_LockCullingFrustum.Get();
-
         renderGraph->AddPass<TerrainPassData>("Terrain Pass",
             [=](TerrainPassData& data, Renderer::RenderGraphBuilder& builder) // Setup
         {
@@ -280,180 +654,510 @@ void TerrainRenderer::AddTerrainPass(Renderer::RenderGraph* renderGraph, Rendere
         {
             GPU_SCOPED_PROFILER_ZONE(commandList, TerrainPass);
 
-            // Upload culled instances
-            if (cullingEnabled && !gpuCullEnabled && !_culledInstances.empty())
+            // The depth prepass already uploaded streamed chunks and culled this frame
+            if (!depthPrepassEnabled)
             {
-                Renderer::BufferDesc uploadBufferDesc;
-                uploadBufferDesc.name = "TerrainInstanceUploadBuffer";
-                uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
-                uploadBufferDesc.size = sizeof(CellInstance) * _culledInstances.size();
-                uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
-
-                Renderer::BufferID instanceUploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
-                _renderer->QueueDestroyBuffer(instanceUploadBuffer);
-
-                void* instanceBufferMemory = _renderer->MapBuffer(instanceUploadBuffer);
-                memcpy(instanceBufferMemory, _culledInstances.data(), uploadBufferDesc.size);
-                _renderer->UnmapBuffer(instanceUploadBuffer);
-                commandList.CopyBuffer(_culledInstanceBuffer, 0, instanceUploadBuffer, 0, uploadBufferDesc.size);
-
-                commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToIndirectArguments, _culledInstanceBuffer);
+                UploadStreamedChunks(commandList);
+                BakeClipmap(resources, commandList, frameIndex);
+                CullCells(resources, commandList, cullingEnabled, gpuCullEnabled, lockFrustum, occlusionCullEnabled, depthPyramid->GetImage(), frameIndex);
             }
 
-            // Cull instances on GPU
-            if (cullingEnabled && gpuCullEnabled)
+            if (!(cullingEnabled && gpuCullEnabled))
             {
-                Renderer::ComputePipelineDesc pipelineDesc;
-                resources.InitializePipelineDesc(pipelineDesc);
-
-                Renderer::ComputeShaderDesc shaderDesc;
-                shaderDesc.path = "Data/shaders/terrainCulling.cs.hlsl.spv";
-                pipelineDesc.computeShader = _renderer->LoadShader(shaderDesc);
-
-                Renderer::ComputePipelineID pipeline = _renderer->CreatePipeline(pipelineDesc);
-                commandList.BeginPipeline(pipeline);
-
-                if (!lockFrustum)
-                {
-                    Camera* camera = ServiceLocator::GetCamera();
-                    memcpy(_cullingConstantBuffer->resource.frustumPlanes, camera->GetFrustumPlanes(), sizeof(vec4[6]));
-                    _cullingConstantBuffer->Apply(frameIndex);
-                }
+                const u32 cellCount = cullingEnabled ? (u32)_culledInstances.size() : Terrain::MAP_CELLS_PER_CHUNK * (u32)_loadedChunks.size();
+                TracyPlot("Cell Instance Count", (i64)cellCount);
+            }
 
-                _cullingPassDescriptorSet.Bind("_instances", _instanceBuffer);
-                _cullingPassDescriptorSet.Bind("_heightRanges", _cellHeightRangeBuffer);
-                _cullingPassDescriptorSet.Bind("_culledInstances", _culledInstanceBuffer);
-                _cullingPassDescriptorSet.Bind("_argumentBuffer", _argumentBuffer);
-                _cullingPassDescriptorSet.Bind("_constants", _cullingConstantBuffer->GetBuffer(frameIndex));
+            // With a depth prepass both draw lists are in the depth buffer already, so they get shaded together
+            const u8 drawLists = (depthPrepassEnabled && occlusionCullEnabled) ? CELL_DRAW_LIST_ALL : CELL_DRAW_LIST_MAIN;
+            RecordTerrainPass(resources, commandList, globalDescriptorSet, data.mainColor, data.mainDepth, depthPrepassEnabled, overdrawEnabled, cullingEnabled, gpuCullEnabled, drawLists, frameIndex);
+        });
+    }
 
-                commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_cullingPassDescriptorSet, frameIndex);
+    // Without a depth prepass the occlusion test has to happen between drawing the two lists here
+    if (occlusionCullEnabled && !depthPrepassEnabled)
+    {
+        depthPyramid->AddBuildPass(renderGraph, depthTarget, frameIndex);
 
-                const u32 cellCount = (u32)_loadedChunks.size() * Terrain::MAP_CELLS_PER_CHUNK;
-                commandList.Dispatch((cellCount + 31) / 32, 1, 1);
+        struct TerrainOcclusionPassData
+        {
+            Renderer::RenderPassMutableResource mainColor;
+            Renderer::RenderPassMutableResource mainDepth;
+            Renderer::RenderPassResource depthPyramid;
+        };
 
-                commandList.EndPipeline(pipeline);
+        renderGraph->AddPass<TerrainOcclusionPassData>("Terrain Occlusion Pass",
+            [=](TerrainOcclusionPassData& data, Renderer::RenderGraphBuilder& builder) // Setup
+        {
+            data.mainColor = builder.Write(renderTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+            data.mainDepth = builder.Write(depthTarget, Renderer::RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, Renderer::RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+            data.depthPyramid = builder.Read(depthPyramid->GetImage(), Renderer::RenderGraphBuilder::ShaderStage::SHADER_STAGE_COMPUTE);
 
-                commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToIndirectArguments, _culledInstanceBuffer);
-                commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToIndirectArguments, _argumentBuffer);
-            }
+            return true; // Return true from setup to enable this pass, return false to disable it
+        },
+            [=](TerrainOcclusionPassData& data, Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList) // Execute
+        {
+            GPU_SCOPED_PROFILER_ZONE(commandList, TerrainOcclusionPass);
 
-            Renderer::GraphicsPipelineDesc pipelineDesc;
-            resources.InitializePipelineDesc(pipelineDesc);
-
-            // Shaders
-            Renderer::VertexShaderDesc vertexShaderDesc;
-            vertexShaderDesc.path = "Data/shaders/terrain.vs.hlsl.spv";
-            pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
-
-            Renderer::PixelShaderDesc pixelShaderDesc;
-            pixelShaderDesc.path = "Data/shaders/terrain.ps.hlsl.spv";
-            pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
-
-            // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
-            pipelineDesc.states.inputLayouts[0].enabled = true;
-            pipelineDesc.states.inputLayouts[0].SetName("TEXCOORD0");
-            pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32_UINT;
-            pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_INSTANCE;
-            pipelineDesc.states.inputLayouts[1].enabled = true;
-            pipelineDesc.states.inputLayouts[1].SetName("TEXCOORD1");
-            pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32_UINT;
-            pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_INSTANCE;
-
-            // Depth state
-            pipelineDesc.states.depthStencilState.depthEnable = true;
-            pipelineDesc.states.depthStencilState.depthWriteEnable = true;
-            pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
-
-            // Rasterizer state
-            pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
-            pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
-
-            // Render targets
-            pipelineDesc.renderTargets[0] = data.mainColor;
-
-            pipelineDesc.depthStencil = data.mainDepth;
-
-            // Set pipeline
-            Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
-            commandList.BeginPipeline(pipeline);
-
-            // Set instance buffer
-            const Renderer::BufferID instanceBuffer = cullingEnabled ? _culledInstanceBuffer : _instanceBuffer;
-            commandList.SetBuffer(0, instanceBuffer);
-
-            // Set index buffer
-            commandList.SetIndexBuffer(_cellIndexBuffer, Renderer::IndexFormat::UInt16);
-
-            // Bind viewbuffer
-            _passDescriptorSet.Bind("_vertices"_h, _vertexBuffer);
-            _passDescriptorSet.Bind("_cellData"_h, _cellBuffer);
-            _passDescriptorSet.Bind("_cellDataVS"_h, _cellBuffer);
-            _passDescriptorSet.Bind("_chunkData"_h, _chunkBuffer);
-
-            // Bind descriptorset
-            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::GLOBAL, globalDescriptorSet, frameIndex);
-            commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_passDescriptorSet, frameIndex);
-            if (cullingEnabled)
-            {
-                if (gpuCullEnabled)
-                {
-                    commandList.DrawIndexedIndirect(_argumentBuffer, 0, 1);
-                }
-                else
-                {
-                    const u32 cellCount = (u32)_culledInstances.size();
-                    TracyPlot("Cell Instance Count", (i64)cellCount);
-                    commandList.DrawIndexed(Terrain::NUM_INDICES_PER_CELL, cellCount, 0, 0, 0);
-                }
-            }
-            else
-            {
-                const u32 cellCount = Terrain::MAP_CELLS_PER_CHUNK * (u32)_loadedChunks.size();
-                TracyPlot("Cell Instance Count", (i64)cellCount);
-                commandList.DrawIndexed(Terrain::NUM_INDICES_PER_CELL, cellCount, 0, 0, 0);
-            }
+            CullOccludedCells(resources, commandList, depthPyramid->GetImage(), frameIndex);
 
-            commandList.EndPipeline(pipeline);
+            RecordTerrainPass(resources, commandList, globalDescriptorSet, data.mainColor, data.mainDepth, depthPrepassEnabled, overdrawEnabled, cullingEnabled, gpuCullEnabled, CELL_DRAW_LIST_NEWLY_VISIBLE, frameIndex);
         });
     }
 
     // Subrenderers
-    _mapObjectRenderer->AddMapObjectPass(renderGraph, globalDescriptorSet, renderTarget, depthTarget, frameIndex);
+    _mapObjectRenderer->AddMapObjectPass(renderGraph, globalDescriptorSet, renderTarget, depthTarget, depthPrepassEnabled, overdrawEnabled, frameIndex);
 }
 
-void TerrainRenderer::CreatePermanentResources()
+void TerrainRenderer::RecordDepthPrepass(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, Renderer::DescriptorSet* globalDescriptorSet, Renderer::RenderPassMutableResource depth, bool cullingEnabled, bool gpuCullEnabled, u8 drawLists, u8 frameIndex)
 {
-    entt::registry* registry = ServiceLocator::GetGameRegistry();
-    MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
+    Renderer::GraphicsPipelineDesc pipelineDesc;
+    resources.InitializePipelineDesc(pipelineDesc);
+
+    // Shaders
+    Renderer::VertexShaderDesc vertexShaderDesc;
+    vertexShaderDesc.path = "Data/shaders/terrainDepth.vs.hlsl.spv";
+    pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+    pipelineDesc.states.vertexPermutation.SetKeyword(Terrain::TERRAIN_KEYWORD_DERIVED_NORMALS, USE_DERIVED_NORMALS);
+
+    // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
+    pipelineDesc.states.inputLayouts[0].enabled = true;
+    pipelineDesc.states.inputLayouts[0].SetName("TEXCOORD0");
+    pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32_UINT;
+    pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_INSTANCE;
+    pipelineDesc.states.inputLayouts[1].enabled = true;
+    pipelineDesc.states.inputLayouts[1].SetName("TEXCOORD1");
+    pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32_UINT;
+    pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_INSTANCE;
+
+    // Depth state
+    pipelineDesc.states.depthStencilState.depthEnable = true;
+    pipelineDesc.states.depthStencilState.depthWriteEnable = true;
+    pipelineDesc.states.depthStencilState.depthFunc = Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+
+    // Rasterizer state
+    pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
+    pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
+
+    // Render targets
+    pipelineDesc.depthStencil = depth;
+
+    // Set pipeline
+    Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
+    commandList.BeginPipeline(pipeline);
+
+    // Bind viewbuffer
+    _passDescriptorSet.Bind("_vertices"_h, _vertexBuffer);
+    _passDescriptorSet.Bind("_cellDataVS"_h, _cellBuffer);
+
+    // Bind descriptorset
+    commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::GLOBAL, globalDescriptorSet, frameIndex);
+    commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_passDescriptorSet, frameIndex);
+
+    // Depth only, so every layer class goes through the same pipeline
+    DrawCells(commandList, cullingEnabled, gpuCullEnabled, drawLists, Terrain::CELL_LAYER_CLASS_MASK_ALL);
+
+    commandList.EndPipeline(pipeline);
+}
 
-    // Create texture array
-    Renderer::TextureArrayDesc textureColorArrayDesc;
-    textureColorArrayDesc.size = 4096;
+void TerrainRenderer::RecordTerrainPass(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, Renderer::DescriptorSet* globalDescriptorSet, Renderer::RenderPassMutableResource color, Renderer::RenderPassMutableResource depth, bool depthPrepassEnabled, bool overdrawEnabled, bool cullingEnabled, bool gpuCullEnabled, u8 drawLists, u8 frameIndex)
+{
+    Renderer::GraphicsPipelineDesc pipelineDesc;
+    resources.InitializePipelineDesc(pipelineDesc);
+
+    // Shaders
+    Renderer::VertexShaderDesc vertexShaderDesc;
+    vertexShaderDesc.path = "Data/shaders/terrain.vs.hlsl.spv";
+    pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+    pipelineDesc.states.vertexPermutation.SetKeyword(Terrain::TERRAIN_KEYWORD_DERIVED_NORMALS, USE_DERIVED_NORMALS);
+
+    // The overdraw view adds up every pixel that gets shaded, so it shows how much early depth testing rejects
+    Renderer::PixelShaderDesc pixelShaderDesc;
+    pixelShaderDesc.path = overdrawEnabled ? "Data/shaders/overdraw.ps.hlsl.spv" : "Data/shaders/terrain.ps.hlsl.spv";
+    pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+    pipelineDesc.states.pixelPermutation.SetKeyword(Terrain::TERRAIN_KEYWORD_CLIPMAP, CVAR_ClipmapEnabled.Get());
+
+    if (overdrawEnabled)
+    {
+        pipelineDesc.states.blendState.renderTargets[0].blendEnable = true;
+        pipelineDesc.states.blendState.renderTargets[0].srcBlend = Renderer::BLEND_MODE_ONE;
+        pipelineDesc.states.blendState.renderTargets[0].destBlend = Renderer::BLEND_MODE_ONE;
+        pipelineDesc.states.blendState.renderTargets[0].blendOp = Renderer::BLEND_OP_ADD;
+    }
 
-    _terrainColorTextureArray = _renderer->CreateTextureArray(textureColorArrayDesc);
+    // Input layouts TODO: Improve on this, if I set state 0 and 3 it won't work etc... Maybe responsibility for this should be moved to ModelHandler and the cooker?
+    pipelineDesc.states.inputLayouts[0].enabled = true;
+    pipelineDesc.states.inputLayouts[0].SetName("TEXCOORD0");
+    pipelineDesc.states.inputLayouts[0].format = Renderer::InputFormat::INPUT_FORMAT_R32_UINT;
+    pipelineDesc.states.inputLayouts[0].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_INSTANCE;
+    pipelineDesc.states.inputLayouts[1].enabled = true;
+    pipelineDesc.states.inputLayouts[1].SetName("TEXCOORD1");
+    pipelineDesc.states.inputLayouts[1].format = Renderer::InputFormat::INPUT_FORMAT_R32_UINT;
+    pipelineDesc.states.inputLayouts[1].inputClassification = Renderer::InputClassification::INPUT_CLASSIFICATION_PER_INSTANCE;
+
+    // Depth state, with a depth prepass only the closest surface passes so every pixel is shaded once
+    pipelineDesc.states.depthStencilState.depthEnable = true;
+    pipelineDesc.states.depthStencilState.depthWriteEnable = !depthPrepassEnabled;
+    pipelineDesc.states.depthStencilState.depthFunc = depthPrepassEnabled ? Renderer::ComparisonFunc::COMPARISON_FUNC_EQUAL : Renderer::ComparisonFunc::COMPARISON_FUNC_LESS;
+
+    // Rasterizer state
+    pipelineDesc.states.rasterizerState.cullMode = Renderer::CullMode::CULL_MODE_BACK;
+    pipelineDesc.states.rasterizerState.frontFaceMode = Renderer::FrontFaceState::FRONT_FACE_STATE_COUNTERCLOCKWISE;
+
+    // Render targets
+    pipelineDesc.renderTargets[0] = color;
+
+    pipelineDesc.depthStencil = depth;
+
+    // Bind viewbuffer
+    _passDescriptorSet.Bind("_vertices"_h, _vertexBuffer);
+    _passDescriptorSet.Bind("_cellData"_h, _cellBuffer);
+    _passDescriptorSet.Bind("_cellDataVS"_h, _cellBuffer);
+    _passDescriptorSet.Bind("_chunkData"_h, _chunkBuffer);
+    _passDescriptorSet.Bind("_chunkSlots"_h, _chunkSlotBuffer); // Derived normals read the heights of neighbouring chunks
+
+    // The permutation without the clipmap still has the bindings
+    _clipmap->Bind(_passDescriptorSet, frameIndex);
+
+    // Every layer class is drawn with the pixel shader permutation that samples only the layers it has
+    const bool layerClassesEnabled = CVAR_LayerClassesEnabled.Get() && !overdrawEnabled;
+    const bool forceSingleLayer = CVAR_ForceSingleLayer.Get();
+
+    auto drawLayerClass = [&](Terrain::CellLayerClass layerClass)
+    {
+        const bool singleLayer = forceSingleLayer || (layerClassesEnabled && layerClass == Terrain::CELL_LAYER_CLASS_SINGLE);
+        const bool twoLayers = !singleLayer && layerClassesEnabled && layerClass == Terrain::CELL_LAYER_CLASS_TWO;
+        pipelineDesc.states.pixelPermutation.SetKeyword(Terrain::TERRAIN_KEYWORD_SINGLE_LAYER, singleLayer);
+        pipelineDesc.states.pixelPermutation.SetKeyword(Terrain::TERRAIN_KEYWORD_TWO_LAYERS, twoLayers);
 
-    Renderer::TextureArrayDesc textureAlphaArrayDesc;
-    textureAlphaArrayDesc.size = Terrain::MAP_CHUNKS_PER_MAP;
+        // Set pipeline
+        Renderer::GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
+        commandList.BeginPipeline(pipeline);
 
-    _terrainAlphaTextureArray = _renderer->CreateTextureArray(textureAlphaArrayDesc);
+        // Bind descriptorset
+        commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::GLOBAL, globalDescriptorSet, frameIndex);
+        commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_passDescriptorSet, frameIndex);
 
-    // Create and load a 1x1 pixel RGBA8 unorm texture with zero'ed data so we can use textureArray[0] as "invalid" textures, sampling it will return 0.0f on all channels
-    Renderer::DataTextureDesc zeroColorTexture;
-    zeroColorTexture.debugName = "TerrainZeroColor";
-    zeroColorTexture.layers = 1;
-    zeroColorTexture.width = 1;
-    zeroColorTexture.height = 1;
-    zeroColorTexture.format = Renderer::IMAGE_FORMAT_R8G8B8A8_UNORM;
-    zeroColorTexture.data = new u8[4]{ 0, 0, 0, 0 };
+        DrawCells(commandList, cullingEnabled, gpuCullEnabled, drawLists, 1 << layerClass);
 
-    u32 index;
-    _renderer->CreateDataTextureIntoArray(zeroColorTexture, _terrainColorTextureArray, index);
+        commandList.EndPipeline(pipeline);
+    };
 
-    delete[] zeroColorTexture.data;
+    // Unculled cells aren't bucketed, they are all drawn as full layer cells
+    // Each class has its own GPU zone, toggling terrain.layerClasses.enable shows the time the specialised permutations save
+    if (cullingEnabled)
+    {
+        GPU_SCOPED_PROFILER_ZONE(commandList, TerrainSingleLayerCells);
+        drawLayerClass(Terrain::CELL_LAYER_CLASS_SINGLE);
+    }
 
-    // Samplers
-    Renderer::SamplerDesc alphaSamplerDesc;
-    alphaSamplerDesc.enabled = true;
+    if (cullingEnabled)
+    {
+        GPU_SCOPED_PROFILER_ZONE(commandList, TerrainTwoLayerCells);
+        drawLayerClass(Terrain::CELL_LAYER_CLASS_TWO);
+    }
+
+    {
+        GPU_SCOPED_PROFILER_ZONE(commandList, TerrainFullLayerCells);
+        drawLayerClass(Terrain::CELL_LAYER_CLASS_FULL);
+    }
+}
+
+bool TerrainRenderer::IsOcclusionCullingEnabled()
+{
+    return CVAR_CullingEnabled.Get() && CVAR_GPUCullingEnabled.Get() && CVAR_OcclusionCullingEnabled.Get();
+}
+
+void TerrainRenderer::CullCells(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, bool cullingEnabled, bool gpuCullEnabled, bool lockFrustum, bool occlusionCullEnabled, Renderer::ImageID depthPyramid, u8 frameIndex)
+{
+    // Upload culled instances
+    if (cullingEnabled && !gpuCullEnabled && !_culledInstances.empty())
+    {
+        Renderer::BufferDesc uploadBufferDesc;
+        uploadBufferDesc.name = "TerrainInstanceUploadBuffer";
+        uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        uploadBufferDesc.size = sizeof(CellInstance) * _culledInstances.size();
+        uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+
+        Renderer::BufferID instanceUploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+        _renderer->QueueDestroyBuffer(instanceUploadBuffer);
+
+        void* instanceBufferMemory = _renderer->MapBuffer(instanceUploadBuffer);
+        memcpy(instanceBufferMemory, _culledInstances.data(), uploadBufferDesc.size);
+        _renderer->UnmapBuffer(instanceUploadBuffer);
+        commandList.CopyBuffer(_culledInstanceBuffer, 0, instanceUploadBuffer, 0, uploadBufferDesc.size);
+
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToIndirectArguments, _culledInstanceBuffer);
+    }
+
+    _gpuCullingStats.isValid = false;
+
+    // Cull instances on GPU
+    if (cullingEnabled && gpuCullEnabled && !_loadedChunks.empty())
+    {
+        // FlipFrame waited for the last frame that used this frame index, so its counters are ready
+        if (_cullingCounterReadbackPending[frameIndex])
+        {
+            const CullingCounters* counters = static_cast<const CullingCounters*>(_renderer->MapBuffer(_cullingCounterReadbackBuffers[frameIndex]));
+
+            _gpuCullingStats.isValid = true;
+            _gpuCullingStats.frustumCulledCells = counters->frustumCulledCells;
+            _gpuCullingStats.occlusionCulledCells = counters->occlusionCulledCells;
+            _gpuCullingStats.mainCells = counters->drawnCells[0];
+            _gpuCullingStats.newlyVisibleCells = counters->drawnCells[1];
+            memcpy(_gpuCullingStats.layerClassCells, counters->layerClassCells, sizeof(_gpuCullingStats.layerClassCells));
+
+            _renderer->UnmapBuffer(_cullingCounterReadbackBuffers[frameIndex]);
+            _cullingCounterReadbackPending[frameIndex] = false;
+        }
+
+        // Instances are counted per LOD, layer class and draw list, so every draw starts out with an instance count of 0
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ShaderReadToTransferDest, _argumentBuffer);
+        commandList.CopyBuffer(_argumentBuffer, 0, _argumentResetBuffer, 0, sizeof(VkDrawIndexedIndirectCommand) * Terrain::NUM_CELL_DRAW_BUCKETS * 2);
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToShaderRead, _argumentBuffer);
+
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ShaderReadToTransferDest, _cullingCounterBuffer);
+        commandList.CopyBuffer(_cullingCounterBuffer, 0, _cullingCounterResetBuffer, 0, sizeof(CullingCounters));
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToShaderRead, _cullingCounterBuffer);
+
+        if (!lockFrustum)
+        {
+            Camera* camera = ServiceLocator::GetCamera();
+            memcpy(_cullingConstantBuffer->resource.frustumPlanes, camera->GetFrustumPlanes(), sizeof(vec4[6]));
+            _cullingConstantBuffer->resource.cameraPosition = camera->GetPosition();
+        }
+
+        _cullingConstantBuffer->resource.viewProjectionMatrix = ServiceLocator::GetCamera()->GetViewProjectionMatrix();
+        _cullingConstantBuffer->resource.lodErrorScale = _lodErrorScale;
+        _cullingConstantBuffer->resource.forcedLod = CVAR_LodForced.Get();
+        _cullingConstantBuffer->resource.culledInstanceCapacity = _culledInstanceCapacity;
+        _cullingConstantBuffer->Apply(frameIndex);
+
+        u32 keywords = occlusionCullEnabled ? Terrain::TERRAIN_KEYWORD_OCCLUSION_CULLING : 0;
+        keywords |= CVAR_SortFrontToBack.Get() ? Terrain::TERRAIN_KEYWORD_DEPTH_SORT : 0;
+        DispatchCulling(resources, commandList, keywords, depthPyramid, frameIndex);
+
+        // The occlusion pass reads the counters back once it is done with them
+        if (!occlusionCullEnabled)
+        {
+            ReadBackCullingCounters(commandList, frameIndex);
+        }
+    }
+}
+
+void TerrainRenderer::CullOccludedCells(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, Renderer::ImageID depthPyramid, u8 frameIndex)
+{
+    if (_loadedChunks.empty())
+        return;
+
+    u32 keywords = Terrain::TERRAIN_KEYWORD_OCCLUSION_CULLING | Terrain::TERRAIN_KEYWORD_OCCLUSION_PASS;
+    keywords |= CVAR_SortFrontToBack.Get() ? Terrain::TERRAIN_KEYWORD_DEPTH_SORT : 0;
+    DispatchCulling(resources, commandList, keywords, depthPyramid, frameIndex);
+    ReadBackCullingCounters(commandList, frameIndex);
+}
+
+void TerrainRenderer::DispatchCulling(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, u32 keywords, Renderer::ImageID depthPyramid, u8 frameIndex)
+{
+    // Both phases count the bands of their own draw list from 0
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ShaderReadToTransferDest, _distanceBandCountBuffer);
+    commandList.CopyBuffer(_distanceBandCountBuffer, 0, _distanceBandCountResetBuffer, 0, sizeof(u32) * Terrain::NUM_CELL_DRAW_BUCKETS * Terrain::NUM_CELL_DISTANCE_BANDS);
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToShaderRead, _distanceBandCountBuffer);
+
+    Renderer::ComputePipelineDesc pipelineDesc;
+    resources.InitializePipelineDesc(pipelineDesc);
+
+    Renderer::ComputeShaderDesc shaderDesc;
+    shaderDesc.path = "Data/shaders/terrainCulling.cs.hlsl.spv";
+    pipelineDesc.computeShader = _renderer->LoadShader(shaderDesc);
+    pipelineDesc.permutation.SetKeyword(Terrain::TERRAIN_KEYWORD_PACKED_HEIGHT_RANGE, USE_PACKED_HEIGHT_RANGE);
+    pipelineDesc.permutation.SetKeyword(Terrain::TERRAIN_KEYWORD_OCCLUSION_CULLING, (keywords & Terrain::TERRAIN_KEYWORD_OCCLUSION_CULLING) != 0);
+    pipelineDesc.permutation.SetKeyword(Terrain::TERRAIN_KEYWORD_OCCLUSION_PASS, (keywords & Terrain::TERRAIN_KEYWORD_OCCLUSION_PASS) != 0);
+    pipelineDesc.permutation.SetKeyword(Terrain::TERRAIN_KEYWORD_DEPTH_SORT, (keywords & Terrain::TERRAIN_KEYWORD_DEPTH_SORT) != 0);
+
+    Renderer::ComputePipelineID pipeline = _renderer->CreatePipeline(pipelineDesc);
+    commandList.BeginPipeline(pipeline);
+
+    // The depth pyramid is only read by the occlusion pass, but it is bound either way so both permutations share one layout
+    _cullingPassDescriptorSet.Bind("_instances", _instanceBuffer);
+    _cullingPassDescriptorSet.Bind("_heightRanges", _cellHeightRangeBuffer);
+    _cullingPassDescriptorSet.Bind("_culledInstances", _culledInstanceBuffer);
+    _cullingPassDescriptorSet.Bind("_argumentBuffer", _argumentBuffer);
+    _cullingPassDescriptorSet.Bind("_constants", _cullingConstantBuffer->GetBuffer(frameIndex));
+    _cullingPassDescriptorSet.Bind("_chunkSlots", _chunkSlotBuffer);
+    _cullingPassDescriptorSet.Bind("_cellLodData", _cellLodBuffer);
+    _cullingPassDescriptorSet.Bind("_cellVisibility", _cellVisibilityBuffer);
+    _cullingPassDescriptorSet.Bind("_counters", _cullingCounterBuffer);
+    _cullingPassDescriptorSet.Bind("_depthPyramid", depthPyramid);
+    _cullingPassDescriptorSet.Bind("_cellData", _cellBuffer);
+    _cullingPassDescriptorSet.Bind("_unsortedInstances", _unsortedInstanceBuffer);
+    _cullingPassDescriptorSet.Bind("_sortKeys", _cellSortKeyBuffer);
+    _cullingPassDescriptorSet.Bind("_bandCounts", _distanceBandCountBuffer);
+
+    commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_cullingPassDescriptorSet, frameIndex);
+
+    const u32 cellCount = (u32)_loadedChunks.size() * Terrain::MAP_CELLS_PER_CHUNK;
+    commandList.Dispatch((cellCount + 31) / 32, 1, 1);
+
+    commandList.EndPipeline(pipeline);
+
+    // The culling only counted how many instances every draw and distance band of this list gets, now that the counts are final every draw gets its place in _culledInstanceBuffer
+    {
+        GPU_SCOPED_PROFILER_ZONE(commandList, TerrainCullingOffsets);
+
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToComputeShaderRead, _argumentBuffer);
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToComputeShaderRead, _distanceBandCountBuffer);
+
+        Renderer::ComputePipelineDesc offsetsPipelineDesc;
+        resources.InitializePipelineDesc(offsetsPipelineDesc);
+
+        Renderer::ComputeShaderDesc offsetsShaderDesc;
+        offsetsShaderDesc.path = "Data/shaders/terrainCullingOffsets.cs.hlsl.spv";
+        offsetsPipelineDesc.computeShader = _renderer->LoadShader(offsetsShaderDesc);
+        offsetsPipelineDesc.permutation.SetKeyword(Terrain::TERRAIN_KEYWORD_OCCLUSION_PASS, (keywords & Terrain::TERRAIN_KEYWORD_OCCLUSION_PASS) != 0);
+
+        Renderer::ComputePipelineID offsetsPipeline = _renderer->CreatePipeline(offsetsPipelineDesc);
+        commandList.BeginPipeline(offsetsPipeline);
+
+        commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_cullingPassDescriptorSet, frameIndex);
+        commandList.Dispatch(1, 1, 1);
+
+        commandList.EndPipeline(offsetsPipeline);
+    }
+
+    // Then every instance can be moved into its draw and band
+    {
+        GPU_SCOPED_PROFILER_ZONE(commandList, TerrainCullingCompaction);
+
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToComputeShaderRead, _unsortedInstanceBuffer);
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToComputeShaderRead, _cellSortKeyBuffer);
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToComputeShaderRead, _distanceBandCountBuffer);
+
+        Renderer::ComputePipelineDesc compactionPipelineDesc;
+        resources.InitializePipelineDesc(compactionPipelineDesc);
+
+        Renderer::ComputeShaderDesc compactionShaderDesc;
+        compactionShaderDesc.path = "Data/shaders/terrainCullingCompaction.cs.hlsl.spv";
+        compactionPipelineDesc.computeShader = _renderer->LoadShader(compactionShaderDesc);
+
+        Renderer::ComputePipelineID compactionPipeline = _renderer->CreatePipeline(compactionPipelineDesc);
+        commandList.BeginPipeline(compactionPipeline);
+
+        commandList.BindDescriptorSet(Renderer::DescriptorSetSlot::PER_PASS, &_cullingPassDescriptorSet, frameIndex);
+        commandList.Dispatch((cellCount + 31) / 32, 1, 1);
+
+        commandList.EndPipeline(compactionPipeline);
+    }
+
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToVertexBuffer, _culledInstanceBuffer);
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToIndirectArguments, _argumentBuffer);
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToIndirectArguments, _cullingCounterBuffer);
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToComputeShaderRead, _cellVisibilityBuffer);
+}
+
+void TerrainRenderer::ReadBackCullingCounters(Renderer::CommandList& commandList, u8 frameIndex)
+{
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::ComputeWriteToTransferSource, _cullingCounterBuffer);
+    commandList.CopyBuffer(_cullingCounterReadbackBuffers[frameIndex], 0, _cullingCounterBuffer, 0, sizeof(CullingCounters));
+    commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToHostRead, _cullingCounterReadbackBuffers[frameIndex]);
+
+    _cullingCounterReadbackPending[frameIndex] = true;
+}
+
+void TerrainRenderer::DrawCells(Renderer::CommandList& commandList, bool cullingEnabled, bool gpuCullEnabled, u8 drawLists, u8 layerClassMask)
+{
+    // Nothing is streamed in yet, the GPU culling arguments haven't been written either
+    if (_loadedChunks.empty())
+        return;
+
+    // Set instance buffer
+    const Renderer::BufferID instanceBuffer = cullingEnabled ? _culledInstanceBuffer : _instanceBuffer;
+    commandList.SetBuffer(0, instanceBuffer);
+
+    // Set index buffer
+    commandList.SetIndexBuffer(_cellIndexBuffer, Renderer::IndexFormat::UInt16);
+
+    if (cullingEnabled)
+    {
+        if (gpuCullEnabled)
+        {
+            // Every draw list has the LODs of every layer class back to back, the draw counts are the highest LOD used + 1, so an empty bucket doesn't issue any draws
+            constexpr u32 bucketArgumentSize = sizeof(VkDrawIndexedIndirectCommand) * Terrain::NUM_CELL_LODS;
+
+            for (u32 drawList = 0; drawList < 2; drawList++)
+            {
+                if ((drawLists & (1 << drawList)) == 0)
+                    continue;
+
+                for (u32 layerClass = 0; layerClass < Terrain::NUM_CELL_LAYER_CLASSES; layerClass++)
+                {
+                    if ((layerClassMask & (1 << layerClass)) == 0)
+                        continue;
+
+                    const u32 bucket = (drawList * Terrain::NUM_CELL_LAYER_CLASSES) + layerClass;
+                    commandList.DrawIndexedIndirectCount(_argumentBuffer, bucket * bucketArgumentSize, _cullingCounterBuffer, offsetof(CullingCounters, drawCounts) + (bucket * sizeof(u32)), Terrain::NUM_CELL_LODS);
+                }
+            }
+        }
+        else if (drawLists & CELL_DRAW_LIST_MAIN)
+        {
+            u32 firstInstance = 0;
+            for (u32 layerClass = 0; layerClass < Terrain::NUM_CELL_LAYER_CLASSES; layerClass++)
+            {
+                const bool isDrawn = (layerClassMask & (1 << layerClass)) != 0;
+
+                for (u32 lod = 0; lod < Terrain::NUM_CELL_LODS; lod++)
+                {
+                    const u32 cellCount = _culledBucketInstanceCounts[Terrain::GetCellDrawBucket(layerClass, lod)];
+                    if (isDrawn && cellCount > 0)
+                    {
+                        commandList.DrawIndexed(Terrain::GetCellLodIndexCount(lod), cellCount, Terrain::GetCellLodIndexOffset(lod), 0, firstInstance);
+                    }
+
+                    firstInstance += cellCount;
+                }
+            }
+        }
+    }
+    else if ((drawLists & CELL_DRAW_LIST_MAIN) && (layerClassMask & (1 << Terrain::CELL_LAYER_CLASS_FULL)))
+    {
+        const u32 cellCount = Terrain::MAP_CELLS_PER_CHUNK * (u32)_loadedChunks.size();
+        commandList.DrawIndexed(Terrain::NUM_INDICES_PER_CELL, cellCount, 0, 0, 0);
+    }
+}
+
+void TerrainRenderer::CreatePermanentResources()
+{
+    entt::registry* registry = ServiceLocator::GetGameRegistry();
+    MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
+
+    // Create texture array
+    Renderer::TextureArrayDesc textureColorArrayDesc;
+    textureColorArrayDesc.size = 4096;
+
+    _terrainColorTextureArray = _renderer->CreateTextureArray(textureColorArrayDesc);
+
+    Renderer::TextureArrayDesc textureAlphaArrayDesc;
+    textureAlphaArrayDesc.size = Terrain::MAP_CHUNKS_PER_MAP;
+
+    _terrainAlphaTextureArray = _renderer->CreateTextureArray(textureAlphaArrayDesc);
+
+    // Create and load a 1x1 pixel RGBA8 unorm texture with zero'ed data so we can use textureArray[0] as "invalid" textures, sampling it will return 0.0f on all channels
+    Renderer::DataTextureDesc zeroColorTexture;
+    zeroColorTexture.debugName = "TerrainZeroColor";
+    zeroColorTexture.layers = 1;
+    zeroColorTexture.width = 1;
+    zeroColorTexture.height = 1;
+    zeroColorTexture.format = Renderer::IMAGE_FORMAT_R8G8B8A8_UNORM;
+    zeroColorTexture.data = new u8[4]{ 0, 0, 0, 0 };
+
+    u32 index;
+    _renderer->CreateDataTextureIntoArray(zeroColorTexture, _terrainColorTextureArray, index);
+
+    delete[] zeroColorTexture.data;
+
+    // Samplers
+    Renderer::SamplerDesc alphaSamplerDesc;
+    alphaSamplerDesc.enabled = true;
     alphaSamplerDesc.filter = Renderer::SamplerFilter::SAMPLER_FILTER_MIN_MAG_MIP_LINEAR;
     alphaSamplerDesc.addressU = Renderer::TextureAddressMode::TEXTURE_ADDRESS_MODE_CLAMP;
     alphaSamplerDesc.addressV = Renderer::TextureAddressMode::TEXTURE_ADDRESS_MODE_CLAMP;
@@ -487,7 +1191,7 @@ void TerrainRenderer::CreatePermanentResources()
     {
         Renderer::BufferDesc desc;
         desc.name = "TerrainCellIndexBuffer";
-        desc.size = Terrain::NUM_INDICES_PER_CELL * sizeof(u16);
+        desc.size = Terrain::NUM_CELL_LOD_INDICES * sizeof(u16);
         desc.usage = Renderer::BUFFER_USAGE_INDEX_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _cellIndexBuffer = _renderer->CreateBuffer(desc);
     }
@@ -495,17 +1199,74 @@ void TerrainRenderer::CreatePermanentResources()
     {
         Renderer::BufferDesc desc;
         desc.name = "TerrainArgumentBuffer";
-        desc.size = sizeof(VkDrawIndexedIndirectCommand);
-        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER;
+        desc.size = sizeof(VkDrawIndexedIndirectCommand) * Terrain::NUM_CELL_DRAW_BUCKETS * 2; // One draw per layer class and LOD for each of the two draw lists
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _argumentBuffer = _renderer->CreateBuffer(desc);
     }
 
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainCullingCounterBuffer";
+        desc.size = sizeof(CullingCounters);
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_INDIRECT_ARGUMENT_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_SOURCE | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+        _cullingCounterBuffer = _renderer->CreateBuffer(desc);
+    }
+
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainCullingCounterResetBuffer";
+        desc.size = sizeof(CullingCounters);
+        desc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+        desc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        _cullingCounterResetBuffer = _renderer->CreateBuffer(desc);
+
+        void* counters = _renderer->MapBuffer(_cullingCounterResetBuffer);
+        memset(counters, 0, sizeof(CullingCounters));
+        _renderer->UnmapBuffer(_cullingCounterResetBuffer);
+    }
+
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainDistanceBandCountBuffer";
+        desc.size = sizeof(u32) * Terrain::NUM_CELL_DRAW_BUCKETS * Terrain::NUM_CELL_DISTANCE_BANDS; // Only the draw list being culled needs its bands
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+        _distanceBandCountBuffer = _renderer->CreateBuffer(desc);
+
+        desc.name = "TerrainDistanceBandCountResetBuffer";
+        desc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+        desc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        _distanceBandCountResetBuffer = _renderer->CreateBuffer(desc);
+
+        void* bandCounts = _renderer->MapBuffer(_distanceBandCountResetBuffer);
+        memset(bandCounts, 0, desc.size);
+        _renderer->UnmapBuffer(_distanceBandCountResetBuffer);
+    }
+
+    // One per frame in flight, each one is only read after the fence of its frame has been waited on
+    for (u32 i = 0; i < 2; i++)
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainCullingCounterReadbackBuffer";
+        desc.size = sizeof(CullingCounters);
+        desc.usage = Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+        desc.cpuAccess = Renderer::BufferCPUAccess::ReadOnly;
+        _cullingCounterReadbackBuffers[i] = _renderer->CreateBuffer(desc);
+    }
+
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainChunkSlotBuffer";
+        desc.size = sizeof(u32) * Terrain::MAP_CHUNKS_PER_MAP;
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+        _chunkSlotBuffer = _renderer->CreateBuffer(desc);
+    }
+
     // Upload cell index buffer
     {
         Renderer::BufferDesc indexUploadBufferDesc;
         indexUploadBufferDesc.name = "TerrainCellIndexUploadBuffer";
         indexUploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
-        indexUploadBufferDesc.size = sizeof(u16) * Terrain::NUM_INDICES_PER_CELL;
+        indexUploadBufferDesc.size = sizeof(u16) * Terrain::NUM_CELL_LOD_INDICES;
         indexUploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
 
         Renderer::BufferID indexUploadBuffer = _renderer->CreateBuffer(indexUploadBufferDesc);
@@ -513,43 +1274,53 @@ void TerrainRenderer::CreatePermanentResources()
 
         u16* indices = static_cast<u16*>(_renderer->MapBuffer(indexUploadBuffer));
 
-        // Fill index buffer
+        // Fill index buffer, the LODs are stored back to back starting with the full resolution one
         size_t indexIndex = 0;
-        for (u16 row = 0; row < Terrain::MAP_CELL_INNER_GRID_STRIDE; row++)
+        for (u32 lod = 0; lod < Terrain::NUM_CELL_LODS; lod++)
         {
-            for (u16 col = 0; col < Terrain::MAP_CELL_INNER_GRID_STRIDE; col++)
+            assert(indexIndex == Terrain::GetCellLodIndexOffset(lod));
+
+            const u16 stride = 1 << lod;
+            const u16 quadsPerSide = Terrain::MAP_CELL_INNER_GRID_STRIDE / stride;
+
+            for (u16 row = 0; row < quadsPerSide; row++)
             {
-                const u16 baseVertex = (row * Terrain::MAP_CELL_TOTAL_GRID_STRIDE + col);
-
-                //1     2
-                //   0
-                //3     4
-
-                const u16 topLeftVertex = baseVertex;
-                const u16 topRightVertex = baseVertex + 1;
-                const u16 bottomLeftVertex = baseVertex + Terrain::MAP_CELL_TOTAL_GRID_STRIDE;
-                const u16 bottomRightVertex = baseVertex + Terrain::MAP_CELL_TOTAL_GRID_STRIDE + 1;
-                const u16 centerVertex = baseVertex + Terrain::MAP_CELL_OUTER_GRID_STRIDE;
-
-                // Up triangle
-                indices[indexIndex++] = centerVertex;
-                indices[indexIndex++] = topRightVertex;
-                indices[indexIndex++] = topLeftVertex;
-
-                // Left triangle
-                indices[indexIndex++] = centerVertex;
-                indices[indexIndex++] = topLeftVertex;
-                indices[indexIndex++] = bottomLeftVertex;
-
-                // Down triangle
-                indices[indexIndex++] = centerVertex;
-                indices[indexIndex++] = bottomLeftVertex;
-                indices[indexIndex++] = bottomRightVertex;
-
-                // Right triangle
-                indices[indexIndex++] = centerVertex;
-                indices[indexIndex++] = bottomRightVertex;
-                indices[indexIndex++] = topRightVertex;
+                for (u16 col = 0; col < quadsPerSide; col++)
+                {
+                    const u16 baseVertex = (row * stride * Terrain::MAP_CELL_TOTAL_GRID_STRIDE + col * stride);
+
+                    //1     2
+                    //   0
+                    //3     4
+
+                    const u16 topLeftVertex = baseVertex;
+                    const u16 topRightVertex = baseVertex + stride;
+                    const u16 bottomLeftVertex = baseVertex + stride * Terrain::MAP_CELL_TOTAL_GRID_STRIDE;
+                    const u16 bottomRightVertex = baseVertex + stride * Terrain::MAP_CELL_TOTAL_GRID_STRIDE + stride;
+
+                    // Only full resolution quads have an inner vertex in their center, the others use the outer vertex there
+                    const u16 centerVertex = lod == 0 ? baseVertex + Terrain::MAP_CELL_OUTER_GRID_STRIDE : baseVertex + (stride / 2) * (Terrain::MAP_CELL_TOTAL_GRID_STRIDE + 1);
+
+                    // Up triangle
+                    indices[indexIndex++] = centerVertex;
+                    indices[indexIndex++] = topRightVertex;
+                    indices[indexIndex++] = topLeftVertex;
+
+                    // Left triangle
+                    indices[indexIndex++] = centerVertex;
+                    indices[indexIndex++] = topLeftVertex;
+                    indices[indexIndex++] = bottomLeftVertex;
+
+                    // Down triangle
+                    indices[indexIndex++] = centerVertex;
+                    indices[indexIndex++] = bottomLeftVertex;
+                    indices[indexIndex++] = bottomRightVertex;
+
+                    // Right triangle
+                    indices[indexIndex++] = centerVertex;
+                    indices[indexIndex++] = bottomRightVertex;
+                    indices[indexIndex++] = topRightVertex;
+                }
             }
         }
 
@@ -608,9 +1379,13 @@ void TerrainRenderer::RegisterChunkToBeLoaded(Terrain::Map& map, u16 chunkPosX,
     chunkToBeLoaded.chunkID = chunkID;
 }
 
-void TerrainRenderer::ExecuteLoad()
+void TerrainRenderer::CreateChunkBuffers(size_t numChunkSlots)
 {
-    size_t numChunksToLoad = _chunksToBeLoaded.size();
+    // Chunks only ever write their own slot, so buffers that are big enough are kept when switching maps
+    if (numChunkSlots <= _numAllocatedChunkSlots && _instanceBuffer != Renderer::BufferID::Invalid())
+        return;
+
+    _numAllocatedChunkSlots = static_cast<u32>(numChunkSlots);
 
     if (_instanceBuffer != Renderer::BufferID::Invalid())
     {
@@ -619,7 +1394,7 @@ void TerrainRenderer::ExecuteLoad()
     {
         Renderer::BufferDesc desc;
         desc.name = "CulledTerrainInstanceBuffer";
-        desc.size = sizeof(CellInstance) * Terrain::MAP_CELLS_PER_CHUNK * numChunksToLoad;
+        desc.size = sizeof(CellInstance) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots;
         desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_VERTEX_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _instanceBuffer = _renderer->CreateBuffer(desc);
     }
@@ -631,7 +1406,7 @@ void TerrainRenderer::ExecuteLoad()
     {
         Renderer::BufferDesc desc;
         desc.name = "TerrainInstanceBuffer";
-        desc.size = sizeof(CellInstance) * Terrain::MAP_CELLS_PER_CHUNK * numChunksToLoad;
+        desc.size = sizeof(CellInstance) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots; // The draws are placed back to back, both draw lists together draw every cell once at most
         desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_VERTEX_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _culledInstanceBuffer = _renderer->CreateBuffer(desc);
     }
@@ -643,7 +1418,7 @@ void TerrainRenderer::ExecuteLoad()
     {
         Renderer::BufferDesc desc;
         desc.name = "TerrainChunkBuffer";
-        desc.size = sizeof(TerrainChunkData) * numChunksToLoad;
+        desc.size = sizeof(TerrainChunkData) * numChunkSlots;
         desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _chunkBuffer = _renderer->CreateBuffer(desc);
     }
@@ -655,7 +1430,7 @@ void TerrainRenderer::ExecuteLoad()
     {
         Renderer::BufferDesc desc;
         desc.name = "TerrainCellBuffer";
-        desc.size = sizeof(TerrainCellData) * Terrain::MAP_CELLS_PER_CHUNK * numChunksToLoad;
+        desc.size = sizeof(TerrainCellData) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots;
         desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _cellBuffer = _renderer->CreateBuffer(desc);
     }
@@ -667,12 +1442,11 @@ void TerrainRenderer::ExecuteLoad()
     {
         Renderer::BufferDesc desc;
         desc.name = "TerrainVertexBuffer";
-        desc.size = sizeof(TerrainVertex) * Terrain::NUM_VERTICES_PER_CHUNK * numChunksToLoad;
+        desc.size = sizeof(TerrainVertex) * Terrain::NUM_VERTICES_PER_CHUNK * numChunkSlots;
         desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _vertexBuffer = _renderer->CreateBuffer(desc);
     }
 
-
     if (_cellHeightRangeBuffer != Renderer::BufferID::Invalid())
     {
         _renderer->QueueDestroyBuffer(_cellHeightRangeBuffer);
@@ -680,11 +1454,110 @@ void TerrainRenderer::ExecuteLoad()
     {
         Renderer::BufferDesc desc;
         desc.name = "CellHeightRangeBuffer";
-        desc.size = sizeof(TerrainCellHeightRange) * Terrain::MAP_CELLS_PER_CHUNK * numChunksToLoad;
+        desc.size = sizeof(TerrainCellHeightRange) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots;
         desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
         _cellHeightRangeBuffer = _renderer->CreateBuffer(desc);
     }
 
+    if (_cellLodBuffer != Renderer::BufferID::Invalid())
+    {
+        _renderer->QueueDestroyBuffer(_cellLodBuffer);
+    }
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainCellLodBuffer";
+        desc.size = sizeof(Terrain::CellLodData) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots;
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+        _cellLodBuffer = _renderer->CreateBuffer(desc);
+    }
+
+    // One bit per cell that says if it was drawn last frame, occlusion culling starts from these cells
+    if (_cellVisibilityBuffer != Renderer::BufferID::Invalid())
+    {
+        _renderer->QueueDestroyBuffer(_cellVisibilityBuffer);
+    }
+    {
+        const size_t visibilitySize = ((Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots + 31) / 32) * sizeof(u32);
+
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainCellVisibilityBuffer";
+        desc.size = visibilitySize;
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER | Renderer::BUFFER_USAGE_TRANSFER_DESTINATION;
+        _cellVisibilityBuffer = _renderer->CreateBuffer(desc);
+
+        // Nothing counts as visible yet, so the first frame tests every cell in the occlusion pass
+        Renderer::BufferDesc uploadBufferDesc;
+        uploadBufferDesc.name = "TerrainCellVisibilityUploadBuffer";
+        uploadBufferDesc.size = visibilitySize;
+        uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+        uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        Renderer::BufferID uploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+
+        void* visibility = _renderer->MapBuffer(uploadBuffer);
+        memset(visibility, 0, visibilitySize);
+        _renderer->UnmapBuffer(uploadBuffer);
+
+        _renderer->CopyBuffer(_cellVisibilityBuffer, 0, uploadBuffer, 0, visibilitySize);
+        _renderer->QueueDestroyBuffer(uploadBuffer);
+    }
+
+    if (_unsortedInstanceBuffer != Renderer::BufferID::Invalid())
+    {
+        _renderer->QueueDestroyBuffer(_unsortedInstanceBuffer);
+    }
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainUnsortedInstanceBuffer";
+        desc.size = sizeof(CellInstance) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots;
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER;
+        _unsortedInstanceBuffer = _renderer->CreateBuffer(desc);
+    }
+
+    if (_cellSortKeyBuffer != Renderer::BufferID::Invalid())
+    {
+        _renderer->QueueDestroyBuffer(_cellSortKeyBuffer);
+    }
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainCellSortKeyBuffer";
+        desc.size = sizeof(u32) * Terrain::MAP_CELLS_PER_CHUNK * numChunkSlots;
+        desc.usage = Renderer::BUFFER_USAGE_STORAGE_BUFFER;
+        _cellSortKeyBuffer = _renderer->CreateBuffer(desc);
+    }
+
+    _culledInstanceCapacity = static_cast<u32>(numChunkSlots) * Terrain::MAP_CELLS_PER_CHUNK;
+
+    if (_argumentResetBuffer != Renderer::BufferID::Invalid())
+    {
+        _renderer->QueueDestroyBuffer(_argumentResetBuffer);
+    }
+    {
+        Renderer::BufferDesc desc;
+        desc.name = "TerrainArgumentResetBuffer";
+        desc.size = sizeof(VkDrawIndexedIndirectCommand) * Terrain::NUM_CELL_DRAW_BUCKETS * 2;
+        desc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+        desc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        _argumentResetBuffer = _renderer->CreateBuffer(desc);
+
+        VkDrawIndexedIndirectCommand* arguments = static_cast<VkDrawIndexedIndirectCommand*>(_renderer->MapBuffer(_argumentResetBuffer));
+        for (u32 drawIndex = 0; drawIndex < Terrain::NUM_CELL_DRAW_BUCKETS * 2; drawIndex++)
+        {
+            const u32 lod = drawIndex % Terrain::NUM_CELL_LODS;
+
+            arguments[drawIndex].indexCount = Terrain::GetCellLodIndexCount(lod);
+            arguments[drawIndex].instanceCount = 0;
+            arguments[drawIndex].firstIndex = Terrain::GetCellLodIndexOffset(lod);
+            arguments[drawIndex].vertexOffset = 0;
+            arguments[drawIndex].firstInstance = 0; // Written by terrainCullingOffsets.cs.hlsl once the draws of its list are counted
+        }
+        _renderer->UnmapBuffer(_argumentResetBuffer);
+    }
+}
+
+void TerrainRenderer::ExecuteLoad()
+{
+    ResetChunkSlots(static_cast<u32>(_chunksToBeLoaded.size()));
+
     for (const ChunkToBeLoaded& chunk : _chunksToBeLoaded)
     {
         LoadChunk(chunk);
@@ -692,12 +1565,78 @@ void TerrainRenderer::ExecuteLoad()
     _chunksToBeLoaded.clear();
 }
 
+void TerrainRenderer::ResetChunkSlots(u32 numChunkSlots)
+{
+    CreateChunkBuffers(numChunkSlots);
+
+    _numChunkSlots = numChunkSlots;
+    _cellBoundingBoxes.resize(static_cast<size_t>(numChunkSlots) * Terrain::MAP_CELLS_PER_CHUNK);
+    _cellLodData.resize(static_cast<size_t>(numChunkSlots) * Terrain::MAP_CELLS_PER_CHUNK);
+    _cellLods.resize(static_cast<size_t>(numChunkSlots) * Terrain::MAP_CELLS_PER_CHUNK);
+    _cellLayerClasses.resize(static_cast<size_t>(numChunkSlots) * Terrain::MAP_CELLS_PER_CHUNK);
+    _chunkBounds.resize(numChunkSlots);
+
+    // Popped from the back, so the lowest slots get used first
+    _freeChunkSlots.clear();
+    _freeChunkSlots.reserve(numChunkSlots);
+    for (u32 i = numChunkSlots; i > 0; i--)
+    {
+        _freeChunkSlots.push_back(static_cast<u16>(i - 1));
+    }
+    _retiredChunkSlots.clear();
+
+    _chunkSlotTable.assign(Terrain::MAP_CHUNKS_PER_MAP, Terrain::CHUNK_SLOT_INVALID);
+    _chunkSlotTableDirtyBegin = 0;
+    _chunkSlotTableDirtyEnd = Terrain::MAP_CHUNKS_PER_MAP;
+
+    _clipmap->InvalidateAll();
+}
+
+void TerrainRenderer::SetChunkSlot(u16 chunkID, u32 slot)
+{
+    _chunkSlotTable[chunkID] = slot;
+
+    _chunkSlotTableDirtyBegin = glm::min(_chunkSlotTableDirtyBegin, static_cast<u32>(chunkID));
+    _chunkSlotTableDirtyEnd = glm::max(_chunkSlotTableDirtyEnd, static_cast<u32>(chunkID) + 1);
+}
+
+void TerrainRenderer::UploadChunkSlotTable()
+{
+    if (_chunkSlotTableDirtyBegin >= _chunkSlotTableDirtyEnd)
+        return;
+
+    // Uploads the dirty range in one go, entries are 4 bytes so this is cheaper than a copy per entry
+    Renderer::BufferDesc uploadBufferDesc;
+    uploadBufferDesc.name = "TerrainChunkSlotUploadBuffer";
+    uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+    uploadBufferDesc.size = sizeof(u32) * (_chunkSlotTableDirtyEnd - _chunkSlotTableDirtyBegin);
+    uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+
+    Renderer::BufferID uploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+
+    void* uploadBufferMemory = _renderer->MapBuffer(uploadBuffer);
+    memcpy(uploadBufferMemory, &_chunkSlotTable[_chunkSlotTableDirtyBegin], uploadBufferDesc.size);
+    _renderer->UnmapBuffer(uploadBuffer);
+
+    _pendingChunkCopies.push_back({ _chunkSlotBuffer, _chunkSlotTableDirtyBegin * sizeof(u32), uploadBuffer, 0, uploadBufferDesc.size });
+    _renderer->QueueDestroyBuffer(uploadBuffer);
+
+    _streamingStats.bytesUploaded += uploadBufferDesc.size;
+
+    _chunkSlotTableDirtyBegin = Terrain::MAP_CHUNKS_PER_MAP;
+    _chunkSlotTableDirtyEnd = 0;
+}
+
 bool TerrainRenderer::LoadMap(u32 mapInternalNameHash)
 {
     entt::registry* registry = ServiceLocator::GetGameRegistry();
     MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
 
-    if (!MapLoader::LoadMap(registry, mapInternalNameHash))
+    // The streaming workers read from the current map, they need to be done before the MapLoader clears it
+    FlushStreaming();
+
+    const bool streamChunks = CVAR_StreamingEnabled.Get();
+    if (!MapLoader::LoadMap(registry, mapInternalNameHash, streamChunks))
         return false;
 
     // Clear Terrain & WMOs
@@ -705,10 +1644,53 @@ bool TerrainRenderer::LoadMap(u32 mapInternalNameHash)
     _cellBoundingBoxes.clear();
     _mapObjectRenderer->Clear();
 
+    _pendingChunkCopies.clear();
+    _dirtyInstanceBlocks.clear();
+    _streamingStats = StreamingStats();
+
     // Unload everything but the first texture in our color array
     _renderer->UnloadTexturesInArray(_terrainColorTextureArray, 1);
     // Unload everything in our alpha array
     _renderer->UnloadTexturesInArray(_terrainAlphaTextureArray, 0);
+    {
+        std::scoped_lock lock(_alphaMapStatsMutex);
+        _alphaMapStats.numAlphaMaps = 0;
+        _alphaMapStats.residentBytes = 0;
+        _alphaMapStats.uncompressedBytes = 0;
+        _countedAlphaMaps.clear();
+    }
+
+    _isStreaming = streamChunks;
+    if (_isStreaming)
+    {
+        Terrain::Map& map = mapSingleton.currentMap;
+
+        // Enough slots for every chunk that can be within radius + hysteresis of the camera at once
+        const f32 unloadRadius = CVAR_StreamingRadius.GetFloat() + CVAR_StreamingHysteresis.GetFloat();
+        const u32 side = 2 * static_cast<u32>(glm::ceil(unloadRadius)) + 2;
+        ResetChunkSlots(glm::min(side * side + side, Terrain::MAP_CHUNKS_PER_MAP));
+        UploadChunkSlotTable();
+
+        _chunkStreamingStates.assign(Terrain::MAP_CHUNKS_PER_MAP, ChunkStreamingState::Missing);
+        for (const auto& itr : map.chunkLocations)
+        {
+            _chunkStreamingStates[itr.first] = ChunkStreamingState::Unloaded;
+        }
+        _chunkMapObjectsLoaded.assign(Terrain::MAP_CHUNKS_PER_MAP, false);
+        _numRequestedChunks = 0;
+
+        _streamingMap = &map;
+        _textureStringTable = &registry->ctx<TextureSingleton>().textureStringTable;
+
+        if (_streamer == nullptr)
+        {
+            const u32 numWorkers = glm::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_STREAMING_WORKERS);
+            _streamer = new TerrainStreamer([this](StreamedChunk& streamedChunk) { LoadStreamedChunk(streamedChunk); }, numWorkers);
+        }
+
+        NC_LOG_MESSAGE("Streaming terrain with %u chunk slots", _numChunkSlots);
+        return true;
+    }
 
     RegisterChunksToBeLoaded(mapSingleton.currentMap, ivec2(32, 32), 32); // Load everything
     //RegisterChunksToBeLoaded(mapSingleton.currentMap, ivec2(31, 52), 1); // Goldshire
@@ -716,6 +1698,7 @@ bool TerrainRenderer::LoadMap(u32 mapInternalNameHash)
     //RegisterChunksToBeLoaded(map, ivec2(22, 25), 8); // Borean Tundra
 
     ExecuteLoad();
+    UploadChunkSlotTable();
 
     // Upload instance data
     {
@@ -732,54 +1715,93 @@ bool TerrainRenderer::LoadMap(u32 mapInternalNameHash)
 
         void* instanceBufferMemory = _renderer->MapBuffer(instanceUploadBuffer);
         CellInstance* instanceData = static_cast<CellInstance*>(instanceBufferMemory);
-        u32 instanceDataIndex = 0;
 
-        for (const u16 chunkID : _loadedChunks)
+        for (size_t i = 0; i < _loadedChunks.size(); i++)
         {
-            for (u32 cellID = 0; cellID < Terrain::MAP_CELLS_PER_CHUNK; ++cellID)
-            {
-                instanceData[instanceDataIndex].packedChunkCellID = (chunkID << 16) | (cellID & 0xffff);
-                instanceData[instanceDataIndex++].instanceID = instanceDataIndex;
-            }
+            FillChunkInstances(_loadedChunks[i], &instanceData[i * Terrain::MAP_CELLS_PER_CHUNK]);
         }
-        assert(instanceDataIndex == cellCount);
+
         _renderer->UnmapBuffer(instanceUploadBuffer);
         _renderer->CopyBuffer(_instanceBuffer, 0, instanceUploadBuffer, 0, uploadBufferDesc.size);
     }
 
     _mapObjectRenderer->ExecuteLoad();
 
+    // The GPU and the map objects have what they need from the chunks now, gameplay reads the heightfield
+    if (!CVAR_KeepChunks.Get())
+    {
+        Terrain::Map& map = mapSingleton.currentMap;
+
+        size_t releasedBytes = 0;
+        for (const auto& itr : map.chunks)
+        {
+            releasedBytes += GetChunkBytes(itr.second);
+        }
+        map.chunks.clear();
+        map.stringTables.clear();
+
+        NC_LOG_MESSAGE("Released %.1f MB of chunks, the gameplay heightfield keeps %.1f MB", static_cast<f32>(releasedBytes) / (1024.0f * 1024.0f), static_cast<f32>(map.heightfield.GetResidentBytes()) / (1024.0f * 1024.0f));
+    }
+
     return true;
 }
 
 void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
 {
     Terrain::Map& map = *chunkToBeLoaded.map;
-    u16 chunkPosX = chunkToBeLoaded.chunkPosX;
-    u16 chunkPosY = chunkToBeLoaded.chunkPosY;
     u16 chunkID = chunkToBeLoaded.chunkID;
     const Terrain::Chunk& chunk = *chunkToBeLoaded.chunk;
 
     StringTable& stringTable = map.stringTables[chunkID];
-    entt::registry* registry = ServiceLocator::GetGameRegistry();     
+    entt::registry* registry = ServiceLocator::GetGameRegistry();
     TextureSingleton& textureSingleton = registry->ctx<TextureSingleton>();
 
-    size_t currentChunkIndex = _loadedChunks.size();
+    LoadedChunk loadedChunk;
+    loadedChunk.chunkID = chunkID;
+    loadedChunk.slot = _freeChunkSlots.back();
+    _freeChunkSlots.pop_back();
+    SetChunkSlot(chunkID, loadedChunk.slot);
+
+    Geometry::AABoundingBox* cellBoundingBoxes = &_cellBoundingBoxes[loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK];
+    Terrain::CellLodData* cellLodData = &_cellLodData[loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK];
+    u8* cellLayerClasses = &_cellLayerClasses[loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK];
+    Renderer::BufferID uploadBuffer = PrepareChunkUpload(chunk, stringTable, textureSingleton.textureStringTable, chunkID, cellBoundingBoxes, cellLodData, cellLayerClasses);
+    Terrain::Culling::CalculateChunkBounds(cellBoundingBoxes, _chunkBounds[loadedChunk.slot]);
 
-    // Upload cell data.
+    std::vector<BufferCopy> copies;
+    GetChunkUploadCopies(uploadBuffer, loadedChunk.slot, copies);
+
+    for (const BufferCopy& copy : copies)
     {
-        Renderer::BufferDesc cellDataUploadBufferDesc;
-        cellDataUploadBufferDesc.name = "TerrainCellUploadBuffer";
-        cellDataUploadBufferDesc.size = sizeof(TerrainCellData) * Terrain::MAP_CELLS_PER_CHUNK;
-        cellDataUploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
-        cellDataUploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        _renderer->CopyBuffer(copy.dstBuffer, copy.dstOffset, copy.srcBuffer, copy.srcOffset, copy.size);
+    }
 
-        Renderer::BufferID cellUploadBuffer = _renderer->CreateBuffer(cellDataUploadBufferDesc);
-        _renderer->QueueDestroyBuffer(cellUploadBuffer);
+    // CopyBuffer destroys buffers that are already queued for destruction right away, so this has to wait until all regions are copied
+    _renderer->QueueDestroyBuffer(uploadBuffer);
 
-        TerrainCellData* cellDatas = static_cast<TerrainCellData*>(_renderer->MapBuffer(cellUploadBuffer));
+    _mapObjectRenderer->RegisterMapObjectsToBeLoaded(chunk, stringTable);
+    _loadedChunks.push_back(loadedChunk);
+
+    _clipmap->InvalidateChunk(chunkID);
+}
 
-        u32 chunkVertexOffset = static_cast<u32>(currentChunkIndex) * Terrain::NUM_VERTICES_PER_CHUNK;
+Renderer::BufferID TerrainRenderer::PrepareChunkUpload(const Terrain::Chunk& chunk, StringTable& stringTable, StringTable& textureStringTable, u16 chunkID, Geometry::AABoundingBox* cellBoundingBoxes, Terrain::CellLodData* cellLodData, u8* cellLayerClasses)
+{
+    Renderer::BufferDesc uploadBufferDesc;
+    uploadBufferDesc.name = "TerrainChunkUploadBuffer";
+    uploadBufferDesc.size = CHUNK_UPLOAD_SIZE;
+    uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+    uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+
+    Renderer::BufferID uploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+    u8* uploadBufferMemory = static_cast<u8*>(_renderer->MapBuffer(uploadBuffer));
+
+    // The alpha map only needs a channel for every layer after the first one, so the most layers in any cell picks its format
+    u8 maxLayerCount = 0;
+
+    // Cell data
+    {
+        TerrainCellData* cellDatas = reinterpret_cast<TerrainCellData*>(uploadBufferMemory + CHUNK_UPLOAD_CELL_DATA_OFFSET);
 
         // Loop over all the cells in the chunk
         for (u32 i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
@@ -787,8 +1809,8 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
             const Terrain::Cell& cell = chunk.cells[i];
 
             TerrainCellData& cellData = cellDatas[i];
+            memset(cellData.diffuseIDs, 0, sizeof(cellData.diffuseIDs));
             cellData.hole = cell.hole;
-            cellData._padding = 1337;
 
             u8 layerCount = 0;
             for (auto layer : cell.layers)
@@ -796,7 +1818,7 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
                 if (layer.textureId == Terrain::LayerData::TextureIdInvalid)
                     break;
 
-                const std::string& texturePath = textureSingleton.textureStringTable.GetString(layer.textureId);
+                const std::string& texturePath = textureStringTable.GetString(layer.textureId);
 
                 Renderer::TextureDesc textureDesc;
                 textureDesc.path = "Data/extracted/Textures/" + texturePath;
@@ -807,55 +1829,31 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
 
                 cellData.diffuseIDs[layerCount++] = diffuseID;
             }
-        }
-
-        _renderer->UnmapBuffer(cellUploadBuffer);
-        const u64 cellBufferOffset = (currentChunkIndex * Terrain::MAP_CELLS_PER_CHUNK) * sizeof(TerrainCellData);
-        _renderer->CopyBuffer(_cellBuffer, cellBufferOffset, cellUploadBuffer, 0, cellDataUploadBufferDesc.size);
-    }
 
-    u32 alphaMapStringID = chunk.alphaMapStringID;
-    u32 alphaID = 0;
+            cellLayerClasses[i] = Terrain::GetCellLayerClass(layerCount);
+            cellData.layerClass = cellLayerClasses[i];
 
-    if (alphaMapStringID < stringTable.GetNumStrings())
-    {
-        Renderer::TextureDesc chunkAlphaMapDesc;
-        chunkAlphaMapDesc.path = "Data/extracted/" + stringTable.GetString(alphaMapStringID);
-
-        _renderer->LoadTextureIntoArray(chunkAlphaMapDesc, _terrainAlphaTextureArray, alphaID);
+            maxLayerCount = glm::max(maxLayerCount, layerCount);
+        }
     }
 
-    // Upload chunk data.
+    // Chunk data
     {
-        Renderer::BufferDesc chunkDataUploadBufferDesc;
-        chunkDataUploadBufferDesc.name = "TerrainChunkUploadBuffer";
-        chunkDataUploadBufferDesc.size = sizeof(TerrainChunkData);
-        chunkDataUploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
-        chunkDataUploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+        u32 alphaMapStringID = chunk.alphaMapStringID;
+        u32 alphaID = 0;
 
-        Renderer::BufferID chunkUploadBuffer = _renderer->CreateBuffer(chunkDataUploadBufferDesc);
-        _renderer->QueueDestroyBuffer(chunkUploadBuffer);
+        if (alphaMapStringID < stringTable.GetNumStrings())
+        {
+            LoadAlphaMap("Data/extracted/" + stringTable.GetString(alphaMapStringID), maxLayerCount, alphaID);
+        }
 
-        TerrainChunkData* chunkData = static_cast<TerrainChunkData*>(_renderer->MapBuffer(chunkUploadBuffer));
+        TerrainChunkData* chunkData = reinterpret_cast<TerrainChunkData*>(uploadBufferMemory + CHUNK_UPLOAD_CHUNK_DATA_OFFSET);
         chunkData->alphaMapID = alphaID;
-
-        _renderer->UnmapBuffer(chunkUploadBuffer);
-        const u64 chunkBufferOffset = currentChunkIndex * sizeof(TerrainChunkData);
-        _renderer->CopyBuffer(_chunkBuffer, chunkBufferOffset, chunkUploadBuffer, 0, chunkDataUploadBufferDesc.size);
     }
 
-    // Upload height data.
+    // Height data
     {
-        Renderer::BufferDesc vertexUploadBufferDesc;
-        vertexUploadBufferDesc.name = "TerrainVertexUploadBuffer";
-        vertexUploadBufferDesc.size = sizeof(TerrainVertex) * Terrain::NUM_VERTICES_PER_CHUNK;
-        vertexUploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
-        vertexUploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
-
-        Renderer::BufferID vertexUploadBuffer = _renderer->CreateBuffer(vertexUploadBufferDesc);
-        _renderer->QueueDestroyBuffer(vertexUploadBuffer);
-
-        TerrainVertex* vertexBufferMemory = reinterpret_cast<TerrainVertex*>(_renderer->MapBuffer(vertexUploadBuffer));
+        TerrainVertex* vertexBufferMemory = reinterpret_cast<TerrainVertex*>(uploadBufferMemory + CHUNK_UPLOAD_VERTEX_OFFSET);
         for (size_t i = 0; i < Terrain::MAP_CELLS_PER_CHUNK; i++)
         {
             size_t cellOffset = i * Terrain::MAP_CELL_TOTAL_GRID_SIZE;
@@ -867,6 +1865,13 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
                 f32 height = chunk.cells[i].heightData[j];
                 vertexBufferMemory[offset].height = height;
 
+#if USE_DERIVED_NORMALS
+                // Set color
+                vertexBufferMemory[offset].color[0] = chunk.cells[i].colorData[j][0];
+                vertexBufferMemory[offset].color[1] = chunk.cells[i].colorData[j][1];
+                vertexBufferMemory[offset].color[2] = chunk.cells[i].colorData[j][2];
+                vertexBufferMemory[offset].padding = 0;
+#else
                 u8 x = chunk.cells[i].normalData[j][0];
                 u8 y = chunk.cells[i].normalData[j][1];
                 u8 z = chunk.cells[i].normalData[j][2];
@@ -880,24 +1885,23 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
                 vertexBufferMemory[offset].color[0] = chunk.cells[i].colorData[j][0];
                 vertexBufferMemory[offset].color[1] = chunk.cells[i].colorData[j][1];
                 vertexBufferMemory[offset].color[2] = chunk.cells[i].colorData[j][2];
+#endif
             }
         }
-
-        _renderer->UnmapBuffer(vertexUploadBuffer);
-        const u64 chunkVertexBufferOffset = currentChunkIndex * sizeof(TerrainVertex) * Terrain::NUM_VERTICES_PER_CHUNK;
-        _renderer->CopyBuffer(_vertexBuffer, chunkVertexBufferOffset, vertexUploadBuffer, 0, vertexUploadBufferDesc.size);
     }
 
-    // Calculate bounding boxes and upload height ranges
+    // Calculate bounding boxes and height ranges
     {
         constexpr float halfWorldSize = 17066.66656f;
 
+        const u16 chunkPosX = chunkID % Terrain::MAP_CHUNKS_PER_MAP_STRIDE;
+        const u16 chunkPosY = chunkID / Terrain::MAP_CHUNKS_PER_MAP_STRIDE;
+
         vec2 chunkOrigin;
         chunkOrigin.x = -((chunkPosY)*Terrain::MAP_CHUNK_SIZE - halfWorldSize);
         chunkOrigin.y = ((Terrain::MAP_CHUNKS_PER_MAP_STRIDE - chunkPosX) * Terrain::MAP_CHUNK_SIZE - halfWorldSize);
 
-        std::vector<TerrainCellHeightRange> heightRanges;
-        heightRanges.reserve(Terrain::MAP_CELLS_PER_CHUNK);
+        TerrainCellHeightRange* heightRanges = reinterpret_cast<TerrainCellHeightRange*>(uploadBufferMemory + CHUNK_UPLOAD_HEIGHT_RANGE_OFFSET);
 
         for (u32 cellIndex = 0; cellIndex < Terrain::MAP_CELLS_PER_CHUNK; cellIndex++)
         {
@@ -918,12 +1922,11 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
             max.y = *minmax.second;
             max.z = chunkOrigin.y - ((cellX + 1) * Terrain::MAP_CELL_SIZE);
 
-            Geometry::AABoundingBox boundingBox;
+            Geometry::AABoundingBox& boundingBox = cellBoundingBoxes[cellIndex];
             boundingBox.min = glm::max(min, max);
             boundingBox.max = glm::min(min, max);
-            _cellBoundingBoxes.push_back(boundingBox);
 
-            TerrainCellHeightRange heightRange;
+            TerrainCellHeightRange& heightRange = heightRanges[cellIndex];
 #if USE_PACKED_HEIGHT_RANGE
             float packedHeightRange[4];
             _mm_store_ps(packedHeightRange, _mm_castsi128_ps(_mm_cvtps_ph(_mm_setr_ps(*minmax.first, *minmax.second, 0.0f, 0.0f), 0)));
@@ -932,29 +1935,486 @@ void TerrainRenderer::LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded)
             heightRange.min = *minmax.first;
             heightRange.max = *minmax.second;
 #endif
-            heightRanges.push_back(heightRange);
         }
+    }
+
+    // LOD errors, culling needs them on both the CPU and the GPU
+    {
+        Terrain::CellLodData* uploadLodData = reinterpret_cast<Terrain::CellLodData*>(uploadBufferMemory + CHUNK_UPLOAD_LOD_DATA_OFFSET);
 
-        // Upload height ranges
+        for (u32 cellIndex = 0; cellIndex < Terrain::MAP_CELLS_PER_CHUNK; cellIndex++)
         {
-            Renderer::BufferDesc heightRangeUploadBufferDesc;
-            heightRangeUploadBufferDesc.name = "HeightRangeUploadBuffer";
-            heightRangeUploadBufferDesc.size = sizeof(TerrainCellHeightRange) * Terrain::MAP_CELLS_PER_CHUNK;
-            heightRangeUploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
-            heightRangeUploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+            Terrain::Lod::CalculateCellLodData(chunk.cells[cellIndex], cellLodData[cellIndex]);
+        }
 
-            Renderer::BufferID heightRangeUploadBuffer = _renderer->CreateBuffer(heightRangeUploadBufferDesc);
-            _renderer->QueueDestroyBuffer(heightRangeUploadBuffer);
+        memcpy(uploadLodData, cellLodData, CHUNK_UPLOAD_LOD_DATA_SIZE);
+    }
 
-            void* heightRangeBufferMemory = _renderer->MapBuffer(heightRangeUploadBuffer);
-            memcpy(heightRangeBufferMemory, heightRanges.data(), heightRangeUploadBufferDesc.size);
-            _renderer->UnmapBuffer(heightRangeUploadBuffer);
+    _renderer->UnmapBuffer(uploadBuffer);
+    return uploadBuffer;
+}
 
-            const u64 chunkVertexBufferOffset = currentChunkIndex * sizeof(TerrainCellHeightRange) * Terrain::MAP_CELLS_PER_CHUNK;
-            _renderer->CopyBuffer(_cellHeightRangeBuffer, chunkVertexBufferOffset, heightRangeUploadBuffer, 0, heightRangeUploadBufferDesc.size);
+void TerrainRenderer::LoadAlphaMap(const std::string& path, u8 numLayers, u32& alphaID)
+{
+    Renderer::TextureDesc alphaMapDesc;
+    alphaMapDesc.path = path;
+
+    AlphaMapCooker::Info info;
+    u64 residentBytes = 0;
+    u64 uncompressedBytes = 0;
+
+    if (CVAR_AlphaMapCompressionEnabled.Get())
+    {
+        const AlphaMapCooker::Format format = AlphaMapCooker::GetFormat(numLayers);
+        const std::string cookedPath = AlphaMapCooker::GetCookedPath(path, format);
+
+        bool isCooked = AlphaMapCooker::ReadInfo(cookedPath, info);
+        if (!isCooked)
+        {
+            AlphaMapCooker::CookResult cookResult;
+            isCooked = AlphaMapCooker::Cook(path, cookedPath, format, cookResult);
+
+            if (isCooked)
+            {
+                info = cookResult.info;
+
+                std::scoped_lock lock(_alphaMapStatsMutex);
+                _alphaMapStats.numCooked++;
+                _alphaMapStats.maxCookError = glm::max(_alphaMapStats.maxCookError, cookResult.maxError);
+                _alphaMapStats.maxCookRmsError = glm::max(_alphaMapStats.maxCookRmsError, cookResult.rmsError);
+            }
+        }
+
+        if (isCooked)
+        {
+            alphaMapDesc.path = cookedPath;
+            residentBytes = AlphaMapCooker::GetCompressedSize(info, format);
+            uncompressedBytes = AlphaMapCooker::GetUncompressedSize(info);
         }
     }
 
-    _mapObjectRenderer->RegisterMapObjectsToBeLoaded(chunk, stringTable);
-    _loadedChunks.push_back(chunkID);
+    // Compression is disabled or the alpha map couldn't be cooked, either way the uncompressed one gets loaded
+    if (residentBytes == 0 && AlphaMapCooker::ReadInfo(path, info))
+    {
+        residentBytes = AlphaMapCooker::GetUncompressedSize(info);
+        uncompressedBytes = residentBytes;
+    }
+
+    _renderer->LoadTextureIntoArray(alphaMapDesc, _terrainAlphaTextureArray, alphaID);
+
+    std::scoped_lock lock(_alphaMapStatsMutex);
+    if (_countedAlphaMaps.insert(alphaID).second)
+    {
+        _alphaMapStats.numAlphaMaps++;
+        _alphaMapStats.residentBytes += residentBytes;
+        _alphaMapStats.uncompressedBytes += uncompressedBytes;
+    }
+}
+
+TerrainRenderer::AlphaMapStats TerrainRenderer::GetAlphaMapStats()
+{
+    std::scoped_lock lock(_alphaMapStatsMutex);
+    return _alphaMapStats;
+}
+
+TerrainRenderer::VertexMemoryStats TerrainRenderer::GetVertexMemoryStats()
+{
+    // Streaming uploads shrink by the same amount per chunk, CHUNK_UPLOAD_VERTEX_SIZE is most of CHUNK_UPLOAD_SIZE
+    VertexMemoryStats stats;
+    stats.vertexSize = sizeof(TerrainVertex);
+    stats.vertexSizeWithNormals = sizeof(TerrainVertexWithNormal);
+    stats.vertexBufferBytes = static_cast<u64>(sizeof(TerrainVertex)) * Terrain::NUM_VERTICES_PER_CHUNK * _numAllocatedChunkSlots;
+    stats.vertexBufferBytesWithNormals = static_cast<u64>(sizeof(TerrainVertexWithNormal)) * Terrain::NUM_VERTICES_PER_CHUNK * _numAllocatedChunkSlots;
+
+    return stats;
+}
+
+void TerrainRenderer::GetChunkUploadCopies(Renderer::BufferID uploadBuffer, u16 chunkSlot, std::vector<BufferCopy>& copies)
+{
+    copies.push_back({ _cellBuffer, chunkSlot * CHUNK_UPLOAD_CELL_DATA_SIZE, uploadBuffer, CHUNK_UPLOAD_CELL_DATA_OFFSET, CHUNK_UPLOAD_CELL_DATA_SIZE });
+    copies.push_back({ _chunkBuffer, chunkSlot * CHUNK_UPLOAD_CHUNK_DATA_SIZE, uploadBuffer, CHUNK_UPLOAD_CHUNK_DATA_OFFSET, CHUNK_UPLOAD_CHUNK_DATA_SIZE });
+    copies.push_back({ _vertexBuffer, chunkSlot * CHUNK_UPLOAD_VERTEX_SIZE, uploadBuffer, CHUNK_UPLOAD_VERTEX_OFFSET, CHUNK_UPLOAD_VERTEX_SIZE });
+    copies.push_back({ _cellHeightRangeBuffer, chunkSlot * CHUNK_UPLOAD_HEIGHT_RANGE_SIZE, uploadBuffer, CHUNK_UPLOAD_HEIGHT_RANGE_OFFSET, CHUNK_UPLOAD_HEIGHT_RANGE_SIZE });
+    copies.push_back({ _cellLodBuffer, chunkSlot * CHUNK_UPLOAD_LOD_DATA_SIZE, uploadBuffer, CHUNK_UPLOAD_LOD_DATA_OFFSET, CHUNK_UPLOAD_LOD_DATA_SIZE });
+}
+
+void TerrainRenderer::FillChunkInstances(const LoadedChunk& loadedChunk, CellInstance* instances)
+{
+    const u32 firstCellIndex = loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK;
+
+    for (u32 cellID = 0; cellID < Terrain::MAP_CELLS_PER_CHUNK; ++cellID)
+    {
+        instances[cellID].packedChunkCellID = (loadedChunk.chunkID << 16) | (cellID & 0xffff);
+        instances[cellID].instanceID = firstCellIndex + cellID;
+    }
+}
+
+void TerrainRenderer::UpdateStreaming(const Camera* camera)
+{
+    ZoneScoped;
+
+    Terrain::Map& map = *_streamingMap;
+    _streamingFrame++;
+    _streamingStats.bytesUploaded = 0;
+
+    const vec2 adtPosition = Terrain::MapUtils::WorldPositionToADTCoordinates(camera->GetPosition());
+    const vec2 chunkSpacePosition = Terrain::MapUtils::GetChunkFromAdtPosition(adtPosition);
+
+    const f32 loadRadius = CVAR_StreamingRadius.GetFloat();
+    const f32 unloadRadius = loadRadius + glm::max(CVAR_StreamingHysteresis.GetFloat(), 0.0f);
+
+    // Slots become free again once no frame in flight can still be reading them
+    for (size_t i = 0; i < _retiredChunkSlots.size();)
+    {
+        if (_streamingFrame - _retiredChunkSlots[i].retiredFrame >= STREAMING_SLOT_REUSE_DELAY)
+        {
+            _freeChunkSlots.push_back(_retiredChunkSlots[i].slot);
+            _retiredChunkSlots[i] = _retiredChunkSlots.back();
+            _retiredChunkSlots.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // Unload chunks that moved out of range, _loadedChunks stays packed by moving the last chunk into the hole so only its instances need to be rewritten
+    for (size_t i = 0; i < _loadedChunks.size();)
+    {
+        const LoadedChunk loadedChunk = _loadedChunks[i];
+        if (GetChunkDistance(chunkSpacePosition, loadedChunk.chunkID) <= unloadRadius)
+        {
+            i++;
+            continue;
+        }
+
+        map.chunks.erase(loadedChunk.chunkID);
+        map.stringTables.erase(loadedChunk.chunkID);
+        _chunkStreamingStates[loadedChunk.chunkID] = ChunkStreamingState::Unloaded;
+        _retiredChunkSlots.push_back({ loadedChunk.slot, _streamingFrame });
+        SetChunkSlot(loadedChunk.chunkID, Terrain::CHUNK_SLOT_INVALID);
+
+        _loadedChunks[i] = _loadedChunks.back();
+        _loadedChunks.pop_back();
+        _dirtyInstanceBlocks.push_back(static_cast<u32>(i));
+    }
+
+    // Requests that no worker has started on yet are rebuilt from scratch each frame, so they always follow the camera
+    {
+        std::vector<u16> cancelledChunkIDs;
+        _streamer->CancelRequests(cancelledChunkIDs);
+
+        for (u16 chunkID : cancelledChunkIDs)
+        {
+            _chunkStreamingStates[chunkID] = ChunkStreamingState::Unloaded;
+        }
+        _numRequestedChunks -= static_cast<u32>(cancelledChunkIDs.size());
+    }
+
+    // Request the closest chunks within range, but never more than we have slots for
+    {
+        const i32 minX = glm::max(static_cast<i32>(glm::floor(chunkSpacePosition.x - loadRadius)), 0);
+        const i32 maxX = glm::min(static_cast<i32>(glm::floor(chunkSpacePosition.x + loadRadius)), static_cast<i32>(Terrain::MAP_CHUNKS_PER_MAP_STRIDE) - 1);
+        const i32 minY = glm::max(static_cast<i32>(glm::floor(chunkSpacePosition.y - loadRadius)), 0);
+        const i32 maxY = glm::min(static_cast<i32>(glm::floor(chunkSpacePosition.y + loadRadius)), static_cast<i32>(Terrain::MAP_CHUNKS_PER_MAP_STRIDE) - 1);
+
+        std::vector<std::pair<f32, u16>> candidates;
+        for (i32 y = minY; y <= maxY; y++)
+        {
+            for (i32 x = minX; x <= maxX; x++)
+            {
+                const u16 chunkID = static_cast<u16>(x + (y * Terrain::MAP_CHUNKS_PER_MAP_STRIDE));
+                if (_chunkStreamingStates[chunkID] != ChunkStreamingState::Unloaded)
+                    continue;
+
+                const f32 distance = GetChunkDistance(chunkSpacePosition, chunkID);
+                if (distance <= loadRadius)
+                {
+                    candidates.push_back({ distance, chunkID });
+                }
+            }
+        }
+
+        const u32 numUsedSlots = static_cast<u32>(_loadedChunks.size()) + _numRequestedChunks;
+        const u32 numRequestableChunks = _numChunkSlots > numUsedSlots ? _numChunkSlots - numUsedSlots : 0;
+
+        std::sort(candidates.begin(), candidates.end());
+        if (candidates.size() > numRequestableChunks)
+        {
+            candidates.resize(numRequestableChunks);
+        }
+
+        std::vector<u16> requests;
+        requests.reserve(candidates.size());
+        for (const auto& candidate : candidates)
+        {
+            _chunkStreamingStates[candidate.second] = ChunkStreamingState::Requested;
+            requests.push_back(candidate.second);
+        }
+
+        _numRequestedChunks += static_cast<u32>(requests.size());
+        _streamer->AddRequests(requests);
+    }
+
+    // Upload loaded chunks, closest first, until we run out of budget or slots
+    {
+        StreamedChunk* streamedChunk;
+        while (_streamer->TryGetLoadedChunk(streamedChunk))
+        {
+            _readyChunks.push_back(streamedChunk);
+        }
+
+        std::sort(_readyChunks.begin(), _readyChunks.end(), [&chunkSpacePosition](const StreamedChunk* a, const StreamedChunk* b)
+        {
+            return GetChunkDistance(chunkSpacePosition, a->chunkID) < GetChunkDistance(chunkSpacePosition, b->chunkID);
+        });
+
+        const u64 uploadBudget = static_cast<u64>(glm::max(CVAR_StreamingUploadBudget.Get(), 0)) * 1024;
+        bool addedMapObjects = false;
+        std::vector<u16> addedChunkIDs;
+
+        size_t numHandledChunks = 0;
+        for (; numHandledChunks < _readyChunks.size(); numHandledChunks++)
+        {
+            StreamedChunk* readyChunk = _readyChunks[numHandledChunks];
+
+            if (!readyChunk->isValid || GetChunkDistance(chunkSpacePosition, readyChunk->chunkID) > unloadRadius)
+            {
+                DiscardStreamedChunk(readyChunk);
+                continue;
+            }
+
+            // Always let at least one chunk through so a small budget can't stall streaming
+            const bool isOverBudget = _streamingStats.bytesUploaded > 0 && _streamingStats.bytesUploaded + readyChunk->uploadSize > uploadBudget;
+            if (isOverBudget || _freeChunkSlots.empty())
+                break;
+
+            addedMapObjects |= !_chunkMapObjectsLoaded[readyChunk->chunkID] && !readyChunk->chunk->mapObjectPlacements.empty();
+            addedChunkIDs.push_back(readyChunk->chunkID);
+            AddStreamedChunk(readyChunk);
+        }
+        _readyChunks.erase(_readyChunks.begin(), _readyChunks.begin() + numHandledChunks);
+
+        if (addedMapObjects)
+        {
+            _mapObjectRenderer->ExecuteLoad();
+        }
+
+        // The map objects registered above point into the chunks, so they can only go once ExecuteLoad is done with them
+        if (!CVAR_KeepChunks.Get())
+        {
+            for (u16 chunkID : addedChunkIDs)
+            {
+                map.chunks.erase(chunkID);
+                map.stringTables.erase(chunkID);
+            }
+        }
+    }
+
+    // Upload the instance blocks of every index in _loadedChunks that changed
+    if (!_dirtyInstanceBlocks.empty())
+    {
+        std::sort(_dirtyInstanceBlocks.begin(), _dirtyInstanceBlocks.end());
+        _dirtyInstanceBlocks.erase(std::unique(_dirtyInstanceBlocks.begin(), _dirtyInstanceBlocks.end()), _dirtyInstanceBlocks.end());
+
+        // Blocks past the end belonged to chunks that were removed, nothing reads them anymore
+        const u32 numLoadedChunks = static_cast<u32>(_loadedChunks.size());
+        while (!_dirtyInstanceBlocks.empty() && _dirtyInstanceBlocks.back() >= numLoadedChunks)
+        {
+            _dirtyInstanceBlocks.pop_back();
+        }
+
+        if (!_dirtyInstanceBlocks.empty())
+        {
+            constexpr u64 instanceBlockSize = sizeof(CellInstance) * Terrain::MAP_CELLS_PER_CHUNK;
+
+            Renderer::BufferDesc uploadBufferDesc;
+            uploadBufferDesc.name = "TerrainInstanceUploadBuffer";
+            uploadBufferDesc.cpuAccess = Renderer::BufferCPUAccess::WriteOnly;
+            uploadBufferDesc.size = instanceBlockSize * _dirtyInstanceBlocks.size();
+            uploadBufferDesc.usage = Renderer::BUFFER_USAGE_TRANSFER_SOURCE;
+
+            Renderer::BufferID instanceUploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+            CellInstance* instanceData = static_cast<CellInstance*>(_renderer->MapBuffer(instanceUploadBuffer));
+
+            for (size_t i = 0; i < _dirtyInstanceBlocks.size(); i++)
+            {
+                const u32 blockIndex = _dirtyInstanceBlocks[i];
+                FillChunkInstances(_loadedChunks[blockIndex], &instanceData[i * Terrain::MAP_CELLS_PER_CHUNK]);
+
+                _pendingChunkCopies.push_back({ _instanceBuffer, blockIndex * instanceBlockSize, instanceUploadBuffer, i * instanceBlockSize, instanceBlockSize });
+            }
+
+            _renderer->UnmapBuffer(instanceUploadBuffer);
+            _renderer->QueueDestroyBuffer(instanceUploadBuffer);
+
+            _streamingStats.bytesUploaded += uploadBufferDesc.size;
+        }
+
+        _dirtyInstanceBlocks.clear();
+    }
+
+    UploadChunkSlotTable();
+
+    _streamingStats.residentChunks = static_cast<u32>(_loadedChunks.size());
+    _streamingStats.queueDepth = _numRequestedChunks;
+
+    TracyPlot("Terrain Resident Chunks", static_cast<i64>(_streamingStats.residentChunks));
+    TracyPlot("Terrain Streaming Queue Depth", static_cast<i64>(_streamingStats.queueDepth));
+    TracyPlot("Terrain Streaming Bytes Uploaded", static_cast<i64>(_streamingStats.bytesUploaded));
+}
+
+void TerrainRenderer::LoadStreamedChunk(StreamedChunk& streamedChunk)
+{
+    // Runs on a TerrainStreamer worker, chunkLocations and archiveFile are only modified by MapLoader::LoadMap which waits for the workers first
+    const auto locationItr = _streamingMap->chunkLocations.find(streamedChunk.chunkID);
+    if (locationItr == _streamingMap->chunkLocations.end())
+        return;
+
+    Terrain::Chunk* chunk = new Terrain::Chunk();
+    if (!MapLoader::LoadChunk(locationItr->second, _streamingMap->archiveFile, *chunk, streamedChunk.stringTable))
+    {
+        delete chunk;
+        return;
+    }
+
+    streamedChunk.chunk = chunk;
+    streamedChunk.cellBoundingBoxes.resize(Terrain::MAP_CELLS_PER_CHUNK);
+    streamedChunk.cellLodData.resize(Terrain::MAP_CELLS_PER_CHUNK);
+    streamedChunk.cellLayerClasses.resize(Terrain::MAP_CELLS_PER_CHUNK);
+    streamedChunk.uploadBuffer = PrepareChunkUpload(*chunk, streamedChunk.stringTable, *_textureStringTable, streamedChunk.chunkID, streamedChunk.cellBoundingBoxes.data(), streamedChunk.cellLodData.data(), streamedChunk.cellLayerClasses.data());
+    streamedChunk.uploadSize = CHUNK_UPLOAD_SIZE;
+    streamedChunk.isValid = true;
+}
+
+void TerrainRenderer::AddStreamedChunk(StreamedChunk* streamedChunk)
+{
+    Terrain::Map& map = *_streamingMap;
+    const u16 chunkID = streamedChunk->chunkID;
+
+    LoadedChunk loadedChunk;
+    loadedChunk.chunkID = chunkID;
+    loadedChunk.slot = _freeChunkSlots.back();
+    _freeChunkSlots.pop_back();
+    SetChunkSlot(chunkID, loadedChunk.slot);
+
+    memcpy(&_cellBoundingBoxes[loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK], streamedChunk->cellBoundingBoxes.data(), sizeof(Geometry::AABoundingBox) * Terrain::MAP_CELLS_PER_CHUNK);
+    memcpy(&_cellLodData[loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK], streamedChunk->cellLodData.data(), sizeof(Terrain::CellLodData) * Terrain::MAP_CELLS_PER_CHUNK);
+    memcpy(&_cellLayerClasses[loadedChunk.slot * Terrain::MAP_CELLS_PER_CHUNK], streamedChunk->cellLayerClasses.data(), Terrain::MAP_CELLS_PER_CHUNK);
+    Terrain::Culling::CalculateChunkBounds(streamedChunk->cellBoundingBoxes.data(), _chunkBounds[loadedChunk.slot]);
+
+    // The copies are recorded by the first terrain pass of the frame, the upload buffer is freed once that frame is done
+    GetChunkUploadCopies(streamedChunk->uploadBuffer, loadedChunk.slot, _pendingChunkCopies);
+    _renderer->QueueDestroyBuffer(streamedChunk->uploadBuffer);
+    _streamingStats.bytesUploaded += streamedChunk->uploadSize;
+
+    // Saves TerrainResidencySystem from reading the chunk again, it also decides when the heightfield lets go of it
+    Terrain::Chunk& chunk = map.chunks[chunkID];
+    chunk = std::move(*streamedChunk->chunk);
+    map.heightfield.SetChunk(chunkID, chunk);
+
+    StringTable& stringTable = map.stringTables[chunkID];
+    stringTable.CopyFrom(streamedChunk->stringTable);
+
+    if (!_chunkMapObjectsLoaded[chunkID])
+    {
+        _mapObjectRenderer->RegisterMapObjectsToBeLoaded(chunk, stringTable);
+        _chunkMapObjectsLoaded[chunkID] = true;
+    }
+
+    _dirtyInstanceBlocks.push_back(static_cast<u32>(_loadedChunks.size()));
+    _loadedChunks.push_back(loadedChunk);
+
+    _chunkStreamingStates[chunkID] = ChunkStreamingState::Resident;
+    _numRequestedChunks--;
+
+    // The copies above land before the bake of this frame, so the pages can be baked again right away
+    _clipmap->InvalidateChunk(chunkID);
+
+    delete streamedChunk->chunk;
+    delete streamedChunk;
+}
+
+void TerrainRenderer::DiscardStreamedChunk(StreamedChunk* streamedChunk)
+{
+    if (streamedChunk->uploadBuffer != Renderer::BufferID::Invalid())
+    {
+        _renderer->QueueDestroyBuffer(streamedChunk->uploadBuffer);
+    }
+
+    // A chunk that failed to load would just fail again, so it isn't requested anymore
+    _chunkStreamingStates[streamedChunk->chunkID] = streamedChunk->isValid ? ChunkStreamingState::Unloaded : ChunkStreamingState::Missing;
+    _numRequestedChunks--;
+
+    delete streamedChunk->chunk;
+    delete streamedChunk;
+}
+
+void TerrainRenderer::FlushStreaming()
+{
+    if (_streamer == nullptr)
+        return;
+
+    std::vector<u16> cancelledChunkIDs;
+    _streamer->Flush(cancelledChunkIDs);
+
+    for (u16 chunkID : cancelledChunkIDs)
+    {
+        _chunkStreamingStates[chunkID] = ChunkStreamingState::Unloaded;
+    }
+    _numRequestedChunks -= static_cast<u32>(cancelledChunkIDs.size());
+
+    StreamedChunk* streamedChunk;
+    while (_streamer->TryGetLoadedChunk(streamedChunk))
+    {
+        _readyChunks.push_back(streamedChunk);
+    }
+
+    for (StreamedChunk* readyChunk : _readyChunks)
+    {
+        DiscardStreamedChunk(readyChunk);
+    }
+    _readyChunks.clear();
+}
+
+void TerrainRenderer::UploadStreamedChunks(Renderer::CommandList& commandList)
+{
+    if (_pendingChunkCopies.empty())
+        return;
+
+    const Renderer::BufferID chunkBuffers[] = { _cellBuffer, _chunkBuffer, _vertexBuffer, _cellHeightRangeBuffer, _instanceBuffer, _chunkSlotBuffer, _cellLodBuffer };
+
+    for (Renderer::BufferID buffer : chunkBuffers)
+    {
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::ShaderReadToTransferDest, buffer);
+    }
+
+    for (const BufferCopy& copy : _pendingChunkCopies)
+    {
+        commandList.CopyBuffer(copy.dstBuffer, copy.dstOffset, copy.srcBuffer, copy.srcOffset, copy.size);
+    }
+
+    for (Renderer::BufferID buffer : chunkBuffers)
+    {
+        commandList.PipelineBarrier(Renderer::PipelineBarrierType::TransferDestToShaderRead, buffer);
+    }
+
+    _pendingChunkCopies.clear();
+}
+
+void TerrainRenderer::BakeClipmap(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, u8 frameIndex)
+{
+    if (!CVAR_ClipmapEnabled.Get() || _loadedChunks.empty())
+        return;
+
+    TerrainClipmap::BakeResources bakeResources;
+    bakeResources.chunkSlots = _chunkSlotBuffer;
+    bakeResources.cellData = _cellBuffer;
+    bakeResources.chunkData = _chunkBuffer;
+    bakeResources.colorTextures = _terrainColorTextureArray;
+    bakeResources.alphaTextures = _terrainAlphaTextureArray;
+    bakeResources.colorSampler = _colorSampler;
+    bakeResources.alphaSampler = _alphaSampler;
+
+    _clipmap->Bake(resources, commandList, bakeResources, frameIndex);
 }
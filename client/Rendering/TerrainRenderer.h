@@ -2,6 +2,8 @@
 #include <NovusTypes.h>
 
 #include <array>
+#include <mutex>
+#include <robin_hood.h>
 
 #include <Utils/StringUtils.h>
 #include <Math/Geometry.h>
@@ -14,9 +16,12 @@
 #include <Renderer/Descriptors/BufferDesc.h>
 #include <Renderer/Buffer.h>
 #include <Renderer/DescriptorSet.h>
+#include <Renderer/RenderPassResources.h>
 
 #include "../Gameplay/Map/Chunk.h"
 #include "ViewConstantBuffer.h"
+#include "TerrainLod.h"
+#include "TerrainCulling.h"
 
 namespace Terrain
 {
@@ -24,18 +29,68 @@ namespace Terrain
 
     constexpr u32 NUM_VERTICES_PER_CHUNK = Terrain::MAP_CELL_TOTAL_GRID_SIZE * Terrain::MAP_CELLS_PER_CHUNK;
     constexpr u32 NUM_INDICES_PER_CELL = 768;
+
+    // Shader permutation keywords, these need to match terrain.inc.hlsl
+    constexpr u32 TERRAIN_KEYWORD_SINGLE_LAYER = 1 << 0;
+    constexpr u32 TERRAIN_KEYWORD_PACKED_HEIGHT_RANGE = 1 << 1;
+    constexpr u32 TERRAIN_KEYWORD_OCCLUSION_CULLING = 1 << 2;
+    constexpr u32 TERRAIN_KEYWORD_OCCLUSION_PASS = 1 << 3;
+    constexpr u32 TERRAIN_KEYWORD_CLIPMAP = 1 << 4;
+    constexpr u32 TERRAIN_KEYWORD_DERIVED_NORMALS = 1 << 5;
+    constexpr u32 TERRAIN_KEYWORD_TWO_LAYERS = 1 << 6;
+    constexpr u32 TERRAIN_KEYWORD_DEPTH_SORT = 1 << 7;
+
+    // With depth sorting the GPU culling splits the instances of every draw into these distance bands, this needs to match terrain.inc.hlsl
+    constexpr u32 NUM_CELL_DISTANCE_BANDS = 16;
+
+    // Cells are drawn in buckets by the pixel shader permutation their layer count needs, every bucket has a draw per LOD, this needs to match terrain.inc.hlsl
+    enum CellLayerClass : u8
+    {
+        CELL_LAYER_CLASS_SINGLE, // One layer, no alpha map
+        CELL_LAYER_CLASS_TWO, // Two layers, one alpha channel
+        CELL_LAYER_CLASS_FULL, // Three or four layers
+        NUM_CELL_LAYER_CLASSES
+    };
+
+    constexpr u8 CELL_LAYER_CLASS_MASK_ALL = (1 << NUM_CELL_LAYER_CLASSES) - 1;
+    constexpr u32 NUM_CELL_DRAW_BUCKETS = NUM_CELL_LAYER_CLASSES * NUM_CELL_LODS;
+
+    constexpr CellLayerClass GetCellLayerClass(u8 numLayers)
+    {
+        return numLayers <= 1 ? CELL_LAYER_CLASS_SINGLE : (numLayers == 2 ? CELL_LAYER_CLASS_TWO : CELL_LAYER_CLASS_FULL);
+    }
+
+    constexpr u32 GetCellDrawBucket(u32 layerClass, u32 lod)
+    {
+        return (layerClass * NUM_CELL_LODS) + lod;
+    }
+
+    // Marks a chunk without a slot in the chunk slot table, this needs to match terrain.inc.hlsl
+    constexpr u32 CHUNK_SLOT_INVALID = 0xFFFFFFFF;
 }
 
 namespace Renderer
 {
     class RenderGraph;
+    class RenderGraphResources;
+    class CommandList;
     class Renderer;
     class DescriptorSet;
+    class DepthPyramid;
+}
+
+namespace tf
+{
+    class Taskflow;
 }
 
 class Camera;
 class DebugRenderer;
 class MapObjectRenderer;
+class TerrainStreamer;
+class TerrainClipmap;
+class StringTable;
+struct StreamedChunk;
 
 class TerrainRenderer
 {
@@ -51,6 +106,31 @@ class TerrainRenderer
     struct CullingConstants
     {
         vec4 frustumPlanes[6];
+        vec3 cameraPosition;
+        f32 lodErrorScale;
+        i32 forcedLod;
+        u32 culledInstanceCapacity; // Every cell is drawn once at most, so the draws of both lists share a range of one instance per loaded cell
+        u32 padding[2];
+        mat4x4 viewProjectionMatrix; // Not locked with the frustum, the depth pyramid always comes from the real camera
+    };
+
+    // Written by the GPU culling, this needs to match the offsets in terrainCulling.cs.hlsl
+    struct CullingCounters
+    {
+        u32 drawCounts[2 * Terrain::NUM_CELL_LAYER_CLASSES]; // Per draw list and layer class, read by DrawIndexedIndirectCount
+        u32 frustumCulledCells;
+        u32 occlusionCulledCells;
+        u32 drawnCells[2]; // Per draw list
+        u32 layerClassCells[Terrain::NUM_CELL_LAYER_CLASSES]; // Of both draw lists
+        u32 padding[3];
+    };
+
+    // Two phase occlusion culling draws last frame's visible cells first, then the ones that a depth pyramid of those shows to be newly visible
+    enum CellDrawList : u8
+    {
+        CELL_DRAW_LIST_MAIN = 1 << 0, // Every visible cell without occlusion culling
+        CELL_DRAW_LIST_NEWLY_VISIBLE = 1 << 1,
+        CELL_DRAW_LIST_ALL = CELL_DRAW_LIST_MAIN | CELL_DRAW_LIST_NEWLY_VISIBLE
     };
 
     struct CellInstance
@@ -59,34 +139,151 @@ class TerrainRenderer
         u32 instanceID;
     };
 
-#pragma pack(push, 1)
-    struct TerrainVertex
+    struct LoadedChunk
+    {
+        u16 chunkID;
+        u16 slot; // Where the chunk lives in the per chunk GPU buffers and _cellBoundingBoxes
+    };
+
+    // Written by the chunk culling tasks, one per entry in _loadedChunks
+    struct ChunkCullingResult
+    {
+        u64 visibleCells[Terrain::MAP_CELLS_PER_CHUNK / 64];
+        u32 bucketCounts[Terrain::NUM_CELL_DRAW_BUCKETS];
+        u32 bucketOffsets[Terrain::NUM_CELL_DRAW_BUCKETS]; // Where this chunk writes its instances of every draw bucket in _culledInstances
+    };
+
+    struct BufferCopy
+    {
+        Renderer::BufferID dstBuffer;
+        u64 dstOffset;
+        Renderer::BufferID srcBuffer;
+        u64 srcOffset;
+        u64 size;
+    };
+
+    struct RetiredChunkSlot
+    {
+        u16 slot;
+        u64 retiredFrame;
+    };
+
+    enum class ChunkStreamingState : u8
     {
-        u8 normal[3];
-        u8 color[3];
-        f16 height;
+        Missing, // The map has no chunk here
+        Unloaded,
+        Requested, // Queued, being loaded or waiting for upload
+        Resident
     };
-#pragma pack(pop)
 
 public:
-    TerrainRenderer(Renderer::Renderer* renderer, DebugRenderer* debugRenderer);
+    struct StreamingStats
+    {
+        u32 residentChunks = 0;
+        u32 queueDepth = 0;
+        u64 bytesUploaded = 0; // This frame
+    };
+
+    struct CullingStats
+    {
+        f32 cullingTime = 0.0f; // In seconds
+        f32 sortTime = 0.0f; // In seconds, ordering the culled cells front to back
+        f32 scalarCullingTime = 0.0f; // Only measured when terrain.cpuCull.compare is enabled
+        u32 visibleChunks = 0;
+        u32 visibleCells = 0;
+        u32 scalarVisibleCells = 0;
+        u32 layerClassCells[Terrain::NUM_CELL_LAYER_CLASSES] = { 0 };
+    };
+
+    // Read back from the GPU culling counters, so these lag a couple of frames behind
+    struct GPUCullingStats
+    {
+        bool isValid = false;
+        u32 frustumCulledCells = 0;
+        u32 occlusionCulledCells = 0;
+        u32 mainCells = 0;
+        u32 newlyVisibleCells = 0;
+        u32 layerClassCells[Terrain::NUM_CELL_LAYER_CLASSES] = { 0 };
+    };
+
+    struct VertexMemoryStats
+    {
+        u32 vertexSize = 0;
+        u32 vertexSizeWithNormals = 0;
+        u64 vertexBufferBytes = 0; // For every allocated chunk slot
+        u64 vertexBufferBytesWithNormals = 0; // What the same slots take when the normals are stored
+    };
+
+    struct AlphaMapStats
+    {
+        u32 numAlphaMaps = 0;
+        u64 residentBytes = 0;
+        u64 uncompressedBytes = 0; // What the same alpha maps take without compression
+        u32 numCooked = 0; // Since startup, every alpha map is only cooked once and read from its cached file after that
+        u32 maxCookError = 0;
+        f32 maxCookRmsError = 0.0f;
+    };
+
+    TerrainRenderer(Renderer::Renderer* renderer, DebugRenderer* debugRenderer, tf::Taskflow* workerTaskflow);
     ~TerrainRenderer();
 
     void Update(f32 deltaTime);
 
-    void AddTerrainPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, u8 frameIndex);
+    // With occlusion culling these build depthPyramid from the terrain that was visible last frame before culling the rest against it
+    void AddTerrainDepthPrepass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::DepthImageID depthTarget, Renderer::DepthPyramid* depthPyramid, u8 frameIndex);
+    void AddTerrainPass(Renderer::RenderGraph* renderGraph, Renderer::DescriptorSet* globalDescriptorSet, Renderer::ImageID renderTarget, Renderer::DepthImageID depthTarget, Renderer::DepthPyramid* depthPyramid, bool depthPrepassEnabled, bool overdrawEnabled, u8 frameIndex);
 
     bool LoadMap(u32 mapInternalNameHash);
+
+    bool IsStreaming() { return _isStreaming; }
+    const StreamingStats& GetStreamingStats() { return _streamingStats; }
+    const CullingStats& GetCullingStats() { return _cullingStats; }
+    const GPUCullingStats& GetGPUCullingStats() { return _gpuCullingStats; }
+    AlphaMapStats GetAlphaMapStats();
+    VertexMemoryStats GetVertexMemoryStats();
+    TerrainClipmap* GetClipmap() { return _clipmap; }
 private:
     void CreatePermanentResources();
+    void CreateChunkBuffers(size_t numChunkSlots);
+    void ResetChunkSlots(u32 numChunkSlots);
+    void SetChunkSlot(u16 chunkID, u32 slot);
+    void UploadChunkSlotTable();
 
     void RegisterChunksToBeLoaded(Terrain::Map& map, ivec2 middleChunk, u16 drawDistance);
     void RegisterChunkToBeLoaded(Terrain::Map& map, u16 chunkPosX, u16 chunkPosY);
     void ExecuteLoad();
 
     void LoadChunk(const ChunkToBeLoaded& chunkToBeLoaded);
+
+    // Fills a new staging buffer with everything the GPU needs for a chunk, safe to call from streaming workers
+    Renderer::BufferID PrepareChunkUpload(const Terrain::Chunk& chunk, StringTable& stringTable, StringTable& textureStringTable, u16 chunkID, Geometry::AABoundingBox* cellBoundingBoxes, Terrain::CellLodData* cellLodData, u8* cellLayerClasses);
+    void LoadAlphaMap(const std::string& path, u8 numLayers, u32& alphaID);
+    void GetChunkUploadCopies(Renderer::BufferID uploadBuffer, u16 chunkSlot, std::vector<BufferCopy>& copies);
+    void FillChunkInstances(const LoadedChunk& loadedChunk, CellInstance* instances);
+
+    void UpdateStreaming(const Camera* camera);
+    void LoadStreamedChunk(StreamedChunk& streamedChunk);
+    void AddStreamedChunk(StreamedChunk* streamedChunk);
+    void DiscardStreamedChunk(StreamedChunk* streamedChunk);
+    void FlushStreaming();
+    void UploadStreamedChunks(Renderer::CommandList& commandList);
+    void BakeClipmap(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, u8 frameIndex);
     //void LoadChunksAround(Terrain::Map& map, ivec2 middleChunk, u16 drawDistance);
     void CPUCulling(const Camera* camera);
+    void CullCellsScalar(const vec4* frustumPlanes, const vec3& cameraPosition);
+    void CullCellsHierarchical(const vec4* frustumPlanes, const vec3& cameraPosition);
+    void SortCulledInstances(const vec3& cameraPosition);
+    u32 GetNeighbourCellLod(u16 chunkID, u16 cellID, Terrain::CellEdge edge, u32 cellLod);
+
+    bool IsOcclusionCullingEnabled();
+    void CullCells(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, bool cullingEnabled, bool gpuCullEnabled, bool lockFrustum, bool occlusionCullEnabled, Renderer::ImageID depthPyramid, u8 frameIndex);
+    void CullOccludedCells(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, Renderer::ImageID depthPyramid, u8 frameIndex);
+    void DispatchCulling(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, u32 keywords, Renderer::ImageID depthPyramid, u8 frameIndex);
+    void ReadBackCullingCounters(Renderer::CommandList& commandList, u8 frameIndex);
+    void DrawCells(Renderer::CommandList& commandList, bool cullingEnabled, bool gpuCullEnabled, u8 drawLists, u8 layerClassMask);
+
+    void RecordDepthPrepass(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, Renderer::DescriptorSet* globalDescriptorSet, Renderer::RenderPassMutableResource depth, bool cullingEnabled, bool gpuCullEnabled, u8 drawLists, u8 frameIndex);
+    void RecordTerrainPass(Renderer::RenderGraphResources& resources, Renderer::CommandList& commandList, Renderer::DescriptorSet* globalDescriptorSet, Renderer::RenderPassMutableResource color, Renderer::RenderPassMutableResource depth, bool depthPrepassEnabled, bool overdrawEnabled, bool cullingEnabled, bool gpuCullEnabled, u8 drawLists, u8 frameIndex);
 
     void DebugRenderCellTriangles(const Camera* camera);
 private:
@@ -95,9 +292,23 @@ private:
     Renderer::Buffer<CullingConstants>* _cullingConstantBuffer;
 
     Renderer::BufferID _argumentBuffer = Renderer::BufferID::Invalid();
+    Renderer::BufferID _argumentResetBuffer = Renderer::BufferID::Invalid(); // Draw arguments for every LOD with an instance count of 0
     Renderer::BufferID _instanceBuffer = Renderer::BufferID::Invalid();
     Renderer::BufferID _culledInstanceBuffer = Renderer::BufferID::Invalid();
     Renderer::BufferID _cellHeightRangeBuffer = Renderer::BufferID::Invalid();
+    Renderer::BufferID _cellLodBuffer = Renderer::BufferID::Invalid();
+    Renderer::BufferID _cellVisibilityBuffer = Renderer::BufferID::Invalid(); // One bit per cell, kept between frames for occlusion culling
+
+    // GPU culling writes the visible instances here first, the compaction pass moves them into their draw and distance band in _culledInstanceBuffer
+    Renderer::BufferID _unsortedInstanceBuffer = Renderer::BufferID::Invalid(); // Indexed like _instanceBuffer
+    Renderer::BufferID _cellSortKeyBuffer = Renderer::BufferID::Invalid(); // Draw, band and rank within the band of every instance, or ~0 if it wasn't drawn
+    Renderer::BufferID _distanceBandCountBuffer = Renderer::BufferID::Invalid(); // Instances per band of every draw in the list being culled, turned into offsets before the compaction
+    Renderer::BufferID _distanceBandCountResetBuffer = Renderer::BufferID::Invalid();
+
+    Renderer::BufferID _cullingCounterBuffer = Renderer::BufferID::Invalid();
+    Renderer::BufferID _cullingCounterResetBuffer = Renderer::BufferID::Invalid();
+    Renderer::BufferID _cullingCounterReadbackBuffers[2] = { Renderer::BufferID::Invalid(), Renderer::BufferID::Invalid() }; // Per frame index
+    bool _cullingCounterReadbackPending[2] = { false, false };
 
     Renderer::BufferID _chunkBuffer = Renderer::BufferID::Invalid();
     Renderer::BufferID _cellBuffer = Renderer::BufferID::Invalid();
@@ -105,10 +316,21 @@ private:
     Renderer::BufferID _vertexBuffer = Renderer::BufferID::Invalid();
 
     Renderer::BufferID _cellIndexBuffer = Renderer::BufferID::Invalid();
+
+    Renderer::BufferID _chunkSlotBuffer = Renderer::BufferID::Invalid(); // chunkID -> slot for every chunk of the map
+    std::vector<u32> _chunkSlotTable; // CPU copy of _chunkSlotBuffer
+    u32 _chunkSlotTableDirtyBegin = 0;
+    u32 _chunkSlotTableDirtyEnd = 0;
+    u32 _numAllocatedChunkSlots = 0; // The per chunk buffers only grow, so switching maps reuses them
     
     Renderer::TextureArrayID _terrainColorTextureArray = Renderer::TextureArrayID::Invalid();
     Renderer::TextureArrayID _terrainAlphaTextureArray = Renderer::TextureArrayID::Invalid();
 
+    // Alpha maps are loaded by the streaming workers, the set keeps chunks that share an alpha map from counting it twice
+    std::mutex _alphaMapStatsMutex;
+    AlphaMapStats _alphaMapStats;
+    robin_hood::unordered_set<u32> _countedAlphaMaps;
+
     Renderer::SamplerID _alphaSampler;
     Renderer::SamplerID _colorSampler;
 
@@ -117,12 +339,51 @@ private:
 
     Renderer::DescriptorSet _cullingPassDescriptorSet;
 
-    std::vector<u16> _loadedChunks;
+    std::vector<LoadedChunk> _loadedChunks;
     std::vector<Geometry::AABoundingBox> _cellBoundingBoxes;
+    std::vector<Terrain::CellLodData> _cellLodData;
+    std::vector<u8> _cellLods; // Selected by CPUCulling
+    std::vector<u8> _cellLayerClasses; // Terrain::CellLayerClass of every cell, set on load
+    std::vector<Terrain::Culling::ChunkBounds> _chunkBounds; // Indexed by slot like _cellBoundingBoxes
+
+    tf::Taskflow* _workerTaskflow = nullptr; // The update framework's, which is idle while the renderer updates
+    std::vector<ChunkCullingResult> _chunkCullingResults;
+    CullingStats _cullingStats;
+    GPUCullingStats _gpuCullingStats;
 
-    std::vector<CellInstance> _culledInstances;
+    f32 _lodErrorScale = 1.0f;
+    u32 _culledInstanceCapacity = 0;
+
+    std::vector<CellInstance> _culledInstances; // Sorted by draw bucket
+    std::array<std::vector<CellInstance>, Terrain::NUM_CELL_DRAW_BUCKETS> _culledBucketInstances;
+    std::array<u32, Terrain::NUM_CELL_DRAW_BUCKETS> _culledBucketInstanceCounts = { 0 };
+    std::vector<u16> _culledSortKeys; // Distance of every culled instance, scratch for SortCulledInstances
+    std::vector<u16> _sortScratchKeys;
+    std::vector<CellInstance> _sortScratchInstances;
 
     std::vector<ChunkToBeLoaded> _chunksToBeLoaded;
+
+    // Streaming
+    TerrainStreamer* _streamer = nullptr;
+    bool _isStreaming = false;
+    Terrain::Map* _streamingMap = nullptr;
+    StringTable* _textureStringTable = nullptr;
+
+    u64 _streamingFrame = 0;
+    u32 _numChunkSlots = 0;
+    std::vector<u16> _freeChunkSlots;
+    std::vector<RetiredChunkSlot> _retiredChunkSlots;
+    std::vector<ChunkStreamingState> _chunkStreamingStates;
+    u32 _numRequestedChunks = 0;
+    std::vector<bool> _chunkMapObjectsLoaded; // Map objects aren't unloaded with their chunk, so they are only added the first time it streams in
+
+    std::vector<StreamedChunk*> _readyChunks; // Loaded, waiting for upload budget or a free slot
+    std::vector<u32> _dirtyInstanceBlocks; // Indices into _loadedChunks whose instances need to be uploaded
+    std::vector<BufferCopy> _pendingChunkCopies; // Recorded by the first terrain pass of the frame
+
+    StreamingStats _streamingStats;
+
+    TerrainClipmap* _clipmap = nullptr;
     
     // Subrenderers
     MapObjectRenderer* _mapObjectRenderer = nullptr;
@@ -0,0 +1,106 @@
+#include "TerrainStreamer.h"
+#include <tracy/Tracy.hpp>
+
+TerrainStreamer::TerrainStreamer(LoadFunction loadFunction, u32 numWorkers)
+    : _loadFunction(loadFunction)
+{
+    assert(numWorkers > 0);
+
+    _workers.reserve(numWorkers);
+    for (u32 i = 0; i < numWorkers; i++)
+    {
+        _workers.emplace_back(&TerrainStreamer::WorkerThread, this);
+    }
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+    {
+        std::scoped_lock lock(_mutex);
+        _isStopping = true;
+    }
+    _wakeCondition.notify_all();
+
+    for (std::thread& worker : _workers)
+    {
+        worker.join();
+    }
+
+    // Whoever owns us is expected to have fetched these, but don't leak them if they didn't
+    StreamedChunk* streamedChunk;
+    while (_loadedChunks.try_dequeue(streamedChunk))
+    {
+        delete streamedChunk->chunk;
+        delete streamedChunk;
+    }
+}
+
+void TerrainStreamer::AddRequests(const std::vector<u16>& chunkIDs)
+{
+    if (chunkIDs.empty())
+        return;
+
+    {
+        std::scoped_lock lock(_mutex);
+        _requests.insert(_requests.end(), chunkIDs.begin(), chunkIDs.end());
+    }
+    _wakeCondition.notify_all();
+}
+
+void TerrainStreamer::CancelRequests(std::vector<u16>& cancelledChunkIDs)
+{
+    std::scoped_lock lock(_mutex);
+
+    cancelledChunkIDs.insert(cancelledChunkIDs.end(), _requests.begin(), _requests.end());
+    _requests.clear();
+}
+
+void TerrainStreamer::Flush(std::vector<u16>& cancelledChunkIDs)
+{
+    std::unique_lock lock(_mutex);
+
+    cancelledChunkIDs.insert(cancelledChunkIDs.end(), _requests.begin(), _requests.end());
+    _requests.clear();
+
+    _idleCondition.wait(lock, [this]() { return _numLoading == 0; });
+}
+
+bool TerrainStreamer::TryGetLoadedChunk(StreamedChunk*& streamedChunk)
+{
+    return _loadedChunks.try_dequeue(streamedChunk);
+}
+
+void TerrainStreamer::WorkerThread()
+{
+    while (true)
+    {
+        u16 chunkID;
+        {
+            std::unique_lock lock(_mutex);
+            _wakeCondition.wait(lock, [this]() { return _isStopping || !_requests.empty(); });
+
+            if (_isStopping)
+                return;
+
+            chunkID = _requests.front();
+            _requests.pop_front();
+            _numLoading++;
+        }
+
+        StreamedChunk* streamedChunk = new StreamedChunk();
+        streamedChunk->chunkID = chunkID;
+        {
+            ZoneScopedNC("TerrainStreamer::LoadChunk", tracy::Color::Blue2)
+            _loadFunction(*streamedChunk);
+        }
+
+        // Publish the chunk before we report idle, Flush relies on every finished chunk being fetchable once it returns
+        _loadedChunks.enqueue(streamedChunk);
+
+        {
+            std::scoped_lock lock(_mutex);
+            _numLoading--;
+        }
+        _idleCondition.notify_all();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <NovusTypes.h>
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <Utils/ConcurrentQueue.h>
+#include <Containers/StringTable.h>
+#include <Math/Geometry.h>
+#include <Renderer/Descriptors/BufferDesc.h>
+
+#include "../Gameplay/Map/Chunk.h"
+#include "TerrainLod.h"
+
+// A chunk that a TerrainStreamer worker has read, decoded and written into a staging buffer
+struct StreamedChunk
+{
+    u16 chunkID = Terrain::MAP_CHUNK_ID_INVALID;
+    bool isValid = false; // False if the chunk failed to load, nothing below is set in that case
+
+    Terrain::Chunk* chunk = nullptr;
+    StringTable stringTable;
+
+    Renderer::BufferID uploadBuffer = Renderer::BufferID::Invalid();
+    u64 uploadSize = 0;
+    std::vector<Geometry::AABoundingBox> cellBoundingBoxes;
+    std::vector<Terrain::CellLodData> cellLodData;
+    std::vector<u8> cellLayerClasses;
+};
+
+// Loads terrain chunks on background threads, what gets requested and what happens to the results is up to TerrainRenderer
+class TerrainStreamer
+{
+public:
+    using LoadFunction = std::function<void(StreamedChunk& streamedChunk)>;
+
+    TerrainStreamer(LoadFunction loadFunction, u32 numWorkers);
+    ~TerrainStreamer();
+
+    // Adds requests to the back of the queue, workers load them in order
+    void AddRequests(const std::vector<u16>& chunkIDs);
+
+    // Removes every request that no worker has picked up yet and appends their IDs to cancelledChunkIDs
+    void CancelRequests(std::vector<u16>& cancelledChunkIDs);
+
+    // Cancels all requests and blocks until no worker is loading anymore, chunks that already finished can still be fetched
+    void Flush(std::vector<u16>& cancelledChunkIDs);
+
+    bool TryGetLoadedChunk(StreamedChunk*& streamedChunk);
+
+private:
+    void WorkerThread();
+
+private:
+    LoadFunction _loadFunction;
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wakeCondition;
+    std::condition_variable _idleCondition;
+    std::deque<u16> _requests;
+    u32 _numLoading = 0;
+    bool _isStopping = false;
+
+    moodycamel::ConcurrentQueue<StreamedChunk*> _loadedChunks;
+};
@@ -0,0 +1,168 @@
+#include "LZCompression.h"
+#include <cstring>
+
+namespace LZCompression
+{
+    constexpr u32 MIN_MATCH_LENGTH = 4;
+    constexpr u32 MAX_MATCH_OFFSET = 65535;
+    constexpr u32 HASH_BITS = 14;
+    constexpr u32 INVALID_POSITION = 0xFFFFFFFF;
+
+    static u32 Read32(const u8* data)
+    {
+        u32 value;
+        memcpy(&value, data, sizeof(u32));
+        return value;
+    }
+
+    static u32 Hash(u32 sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Lengths that don't fit in their nibble continue in bytes of 255 until one is smaller
+    static void WriteLength(std::vector<u8>& output, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            output.push_back(255);
+        }
+        output.push_back(static_cast<u8>(length));
+    }
+
+    static bool ReadLength(const u8* input, size_t inputSize, size_t& position, size_t& length)
+    {
+        u8 value;
+        do
+        {
+            if (position >= inputSize)
+                return false;
+
+            value = input[position++];
+            length += value;
+        } while (value == 255);
+
+        return true;
+    }
+
+    static void WriteSequence(std::vector<u8>& output, const u8* literals, size_t numLiterals, u32 matchOffset, size_t matchLength)
+    {
+        const size_t matchLengthCode = matchLength - MIN_MATCH_LENGTH;
+        const u8 literalNibble = static_cast<u8>(numLiterals < 15 ? numLiterals : 15);
+        const u8 matchNibble = static_cast<u8>(matchLengthCode < 15 ? matchLengthCode : 15);
+
+        output.push_back(static_cast<u8>((literalNibble << 4) | matchNibble));
+        if (numLiterals >= 15)
+        {
+            WriteLength(output, numLiterals - 15);
+        }
+
+        output.insert(output.end(), literals, literals + numLiterals);
+
+        output.push_back(static_cast<u8>(matchOffset & 0xFF));
+        output.push_back(static_cast<u8>(matchOffset >> 8));
+
+        if (matchLengthCode >= 15)
+        {
+            WriteLength(output, matchLengthCode - 15);
+        }
+    }
+
+    void Compress(const u8* input, size_t inputSize, std::vector<u8>& output)
+    {
+        std::vector<u32> hashTable(1 << HASH_BITS, INVALID_POSITION);
+
+        size_t anchor = 0;
+        size_t position = 0;
+        while (position + MIN_MATCH_LENGTH <= inputSize)
+        {
+            const u32 sequence = Read32(&input[position]);
+            u32& entry = hashTable[Hash(sequence)];
+            const u32 candidate = entry;
+            entry = static_cast<u32>(position);
+
+            if (candidate == INVALID_POSITION || position - candidate > MAX_MATCH_OFFSET || Read32(&input[candidate]) != sequence)
+            {
+                position++;
+                continue;
+            }
+
+            size_t matchLength = MIN_MATCH_LENGTH;
+            while (position + matchLength < inputSize && input[candidate + matchLength] == input[position + matchLength])
+            {
+                matchLength++;
+            }
+
+            WriteSequence(output, &input[anchor], position - anchor, static_cast<u32>(position - candidate), matchLength);
+
+            position += matchLength;
+            anchor = position;
+        }
+
+        // The last sequence holds whatever is left as literals, it is written even when that is nothing so the block always ends on literals
+        const size_t numLiterals = inputSize - anchor;
+        output.push_back(static_cast<u8>((numLiterals < 15 ? numLiterals : 15) << 4));
+        if (numLiterals >= 15)
+        {
+            WriteLength(output, numLiterals - 15);
+        }
+        output.insert(output.end(), &input[anchor], &input[anchor] + numLiterals);
+    }
+
+    bool Decompress(const u8* input, size_t inputSize, u8* output, size_t outputSize)
+    {
+        size_t inputPosition = 0;
+        size_t outputPosition = 0;
+
+        while (inputPosition < inputSize)
+        {
+            const u8 token = input[inputPosition++];
+
+            size_t numLiterals = token >> 4;
+            if (numLiterals == 15 && !ReadLength(input, inputSize, inputPosition, numLiterals))
+                return false;
+
+            if (numLiterals > inputSize - inputPosition || numLiterals > outputSize - outputPosition)
+                return false;
+
+            memcpy(&output[outputPosition], &input[inputPosition], numLiterals);
+            inputPosition += numLiterals;
+            outputPosition += numLiterals;
+
+            // Only the last sequence ends right after its literals
+            if (inputPosition == inputSize)
+                break;
+
+            if (inputSize - inputPosition < 2)
+                return false;
+
+            const size_t matchOffset = input[inputPosition] | (static_cast<size_t>(input[inputPosition + 1]) << 8);
+            inputPosition += 2;
+
+            size_t matchLength = token & 0xF;
+            if (matchLength == 15 && !ReadLength(input, inputSize, inputPosition, matchLength))
+                return false;
+            matchLength += MIN_MATCH_LENGTH;
+
+            if (matchOffset == 0 || matchOffset > outputPosition || matchLength > outputSize - outputPosition)
+                return false;
+
+            // Matches may overlap the bytes they produce, that is how runs get encoded, so those are copied a byte at a time
+            const u8* match = &output[outputPosition - matchOffset];
+            if (matchOffset >= matchLength)
+            {
+                memcpy(&output[outputPosition], match, matchLength);
+            }
+            else
+            {
+                for (size_t i = 0; i < matchLength; i++)
+                {
+                    output[outputPosition + i] = match[i];
+                }
+            }
+            outputPosition += matchLength;
+        }
+
+        return outputPosition == outputSize;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+
+// Byte oriented LZ77 block codec in the spirit of LZ4, it trades ratio for decoding at close to memcpy speed
+// A block is a run of sequences, each is a token with the literal count in the high nibble and the match length minus 4 in the low one,
+// followed by any extra length bytes, the literals and a little endian 16 bit match offset, the last sequence only has literals
+namespace LZCompression
+{
+    // Appends the compressed block to output
+    void Compress(const u8* input, size_t inputSize, std::vector<u8>& output);
+
+    // outputSize needs to be the exact size the block was compressed from, fails on any block that would read or write out of bounds
+    bool Decompress(const u8* input, size_t inputSize, u8* output, size_t outputSize);
+}
@@ -35,6 +35,7 @@
 #include <entt.hpp>
 #include "ServiceLocator.h"
 #include "../Gameplay/Map/Chunk.h"
+#include "../Gameplay/Map/HeightfieldSweep.h"
 #include "../ECS/Components/Singletons/MapSingleton.h"
 
 namespace Terrain
@@ -182,7 +183,7 @@ namespace Terrain
 
             return vertexIds;
         }
-        inline f32 GetHeightFromVertexIds(const ivec3& vertexIds, const f32* heightData, const vec2& a, const vec2& b, const vec2& c, const vec2& p)
+        inline f32 GetHeightFromVertexIds(const ivec3& vertexIds, const Terrain::HeightfieldChunk& chunk, u32 cellId, const vec2& a, const vec2& b, const vec2& c, const vec2& p)
         {
             // We do standard barycentric triangle interpolation to get the actual height of the position
 
@@ -193,9 +194,9 @@ namespace Terrain
             f32 beta = factorB / det;
             f32 gamma = 1.0f - alpha - beta;
 
-            f32 aHeight = heightData[vertexIds.x];
-            f32 bHeight = heightData[vertexIds.y];
-            f32 cHeight = heightData[vertexIds.z];
+            f32 aHeight = chunk.GetHeight(cellId, vertexIds.x);
+            f32 bHeight = chunk.GetHeight(cellId, vertexIds.y);
+            f32 cHeight = chunk.GetHeight(cellId, vertexIds.z);
 
             return aHeight * alpha + bHeight * beta + cHeight * gamma;
         }
@@ -211,13 +212,10 @@ namespace Terrain
             vec2 chunkRemainder = chunkPos - glm::floor(chunkPos);
             u32 chunkId = GetChunkIdFromChunkPos(chunkPos);
 
-            Terrain::Map& currentMap = mapSingleton.currentMap;
-            auto chunkItr = currentMap.chunks.find(chunkId);
-            if (chunkItr == currentMap.chunks.end())
+            const Terrain::HeightfieldChunk* currentChunk = mapSingleton.currentMap.heightfield.GetChunk(chunkId);
+            if (currentChunk == nullptr)
                 return false;
 
-            Terrain::Chunk& currentChunk = chunkItr->second;
-
             vec2 cellPos = (chunkRemainder * Terrain::MAP_CHUNK_SIZE) / Terrain::MAP_CELL_SIZE;
             vec2 cellRemainder = cellPos - glm::floor(cellPos);
             u32 cellId = GetCellIdFromCellPos(cellPos);
@@ -244,32 +242,29 @@ namespace Terrain
             // Calculate Vertex A
             {
                 triangle.vert1.x = Terrain::MAP_HALF_SIZE - (x + a.y);
-                triangle.vert1.y = currentChunk.cells[cellId].heightData[vertexIds.x];
+                triangle.vert1.y = currentChunk->GetHeight(cellId, vertexIds.x);
                 triangle.vert1.z = Terrain::MAP_HALF_SIZE - (z + a.x);
             }
 
             // Calculate Vertex B
             {
                 triangle.vert2.x = Terrain::MAP_HALF_SIZE - (x + b.y);
-                triangle.vert2.y = currentChunk.cells[cellId].heightData[vertexIds.y];
+                triangle.vert2.y = currentChunk->GetHeight(cellId, vertexIds.y);
                 triangle.vert2.z = Terrain::MAP_HALF_SIZE - (z + b.x);
             }
 
             // Calculate Vertex C
             {
                 triangle.vert3.x = Terrain::MAP_HALF_SIZE - (x + c.y);
-                triangle.vert3.y = currentChunk.cells[cellId].heightData[vertexIds.z];
+                triangle.vert3.y = currentChunk->GetHeight(cellId, vertexIds.z);
                 triangle.vert3.z = Terrain::MAP_HALF_SIZE - (z + c.x);
             }
 
-            height = GetHeightFromVertexIds(vertexIds, &currentChunk.cells[cellId].heightData[0], a, b, c, patchRemainder * Terrain::MAP_PATCH_SIZE);
+            height = GetHeightFromVertexIds(vertexIds, *currentChunk, cellId, a, b, c, patchRemainder * Terrain::MAP_PATCH_SIZE);
             return true;
         }
-        inline std::vector<Geometry::Triangle> GetCellTrianglesFromWorldPosition(const vec3& position)
+        inline std::vector<Geometry::Triangle> GetCellTrianglesFromWorldPosition(const Terrain::Heightfield& heightfield, const vec3& position)
         {
-            entt::registry* registry = ServiceLocator::GetGameRegistry();
-            MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
-
             std::vector<Geometry::Triangle> triangles;
             triangles.reserve(256);
 
@@ -279,13 +274,10 @@ namespace Terrain
             vec2 chunkRemainder = chunkPos - glm::floor(chunkPos);
             u32 chunkId = GetChunkIdFromChunkPos(chunkPos);
 
-            Terrain::Map& currentMap = mapSingleton.currentMap;
-            auto chunkItr = currentMap.chunks.find(chunkId);
-            if (chunkItr == currentMap.chunks.end())
+            const Terrain::HeightfieldChunk* currentChunk = heightfield.GetChunk(chunkId);
+            if (currentChunk == nullptr)
                 return triangles;
 
-            Terrain::Chunk& currentChunk = chunkItr->second;
-
             vec2 cellPos = (chunkRemainder * Terrain::MAP_CHUNK_SIZE) / Terrain::MAP_CELL_SIZE;
             vec2 cellRemainder = cellPos - glm::floor(cellPos);
             u32 cellId = GetCellIdFromCellPos(cellPos);
@@ -339,21 +331,21 @@ namespace Terrain
                         // Calculate Vertex A
                         {
                             triangle.vert1.x = Terrain::MAP_HALF_SIZE - (x + a.y);
-                            triangle.vert1.y = currentChunk.cells[cellId].heightData[vertexIds.x];
+                            triangle.vert1.y = currentChunk->GetHeight(cellId, vertexIds.x);
                             triangle.vert1.z = Terrain::MAP_HALF_SIZE - (z + a.x);
                         }
 
                         // Calculate Vertex B
                         {
                             triangle.vert2.x = Terrain::MAP_HALF_SIZE - (x + b.y);
-                            triangle.vert2.y = currentChunk.cells[cellId].heightData[vertexIds.y];
+                            triangle.vert2.y = currentChunk->GetHeight(cellId, vertexIds.y);
                             triangle.vert2.z = Terrain::MAP_HALF_SIZE - (z + b.x);
                         }
 
                         // Calculate Vertex C
                         {
                             triangle.vert3.x = Terrain::MAP_HALF_SIZE - (x + c.y);
-                            triangle.vert3.y = currentChunk.cells[cellId].heightData[vertexIds.z];
+                            triangle.vert3.y = currentChunk->GetHeight(cellId, vertexIds.z);
                             triangle.vert3.z = Terrain::MAP_HALF_SIZE - (z + c.x);
                         }
                     }
@@ -363,24 +355,27 @@ namespace Terrain
             return triangles;
         }
 
-        inline f32 GetHeightFromWorldPosition(const vec3& position)
+        inline std::vector<Geometry::Triangle> GetCellTrianglesFromWorldPosition(const vec3& position)
         {
             entt::registry* registry = ServiceLocator::GetGameRegistry();
             MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
 
+            return GetCellTrianglesFromWorldPosition(mapSingleton.currentMap.heightfield, position);
+        }
+
+        // Resolves a single point, Terrain::QueryHeights answers whole arrays of them at once
+        inline f32 GetHeightFromWorldPosition(const Terrain::Heightfield& heightfield, const vec3& position)
+        {
             vec2 adtPos = Terrain::MapUtils::WorldPositionToADTCoordinates(position);
 
             vec2 chunkPos = Terrain::MapUtils::GetChunkFromAdtPosition(adtPos);
             vec2 chunkRemainder = chunkPos - glm::floor(chunkPos);
             u32 chunkId = GetChunkIdFromChunkPos(chunkPos);
 
-            Terrain::Map& currentMap = mapSingleton.currentMap;
-            auto chunkItr = currentMap.chunks.find(chunkId);
-            if (chunkItr == currentMap.chunks.end())
+            const Terrain::HeightfieldChunk* currentChunk = heightfield.GetChunk(chunkId);
+            if (currentChunk == nullptr)
                 return false;
 
-            Terrain::Chunk& currentChunk = chunkItr->second;
-
             vec2 cellPos = (chunkRemainder * Terrain::MAP_CHUNK_SIZE) / Terrain::MAP_CELL_SIZE;
             vec2 cellRemainder = cellPos - glm::floor(cellPos);
             u32 cellId = GetCellIdFromCellPos(cellPos);
@@ -395,7 +390,15 @@ namespace Terrain
 
             ivec3 vertexIds = GetVertexIDsFromPatchPos(patchPos, patchRemainder, b, c);
 
-            return GetHeightFromVertexIds(vertexIds, &currentChunk.cells[cellId].heightData[0], a, b, c, patchRemainder * Terrain::MAP_PATCH_SIZE);
+            return GetHeightFromVertexIds(vertexIds, *currentChunk, cellId, a, b, c, patchRemainder * Terrain::MAP_PATCH_SIZE);
+        }
+
+        inline f32 GetHeightFromWorldPosition(const vec3& position)
+        {
+            entt::registry* registry = ServiceLocator::GetGameRegistry();
+            MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
+
+            return GetHeightFromWorldPosition(mapSingleton.currentMap.heightfield, position);
         }
 
         inline void Project(const vec3& vertex, const vec3& axis, vec2& minMax)
@@ -731,6 +734,7 @@ namespace Terrain
 
             return false;
         }
+        // Sweeps against every patch the swept box overlaps, triangle and height are still the ones under the last of the center and the four bottom corners that is on the terrain
         inline bool Intersect_AABB_TERRAIN_SWEEP(const Geometry::AABoundingBox& box, Geometry::Triangle& triangle, const vec3& direction, f32& height, f32 maxDist, vec3& outDistToCollision)
         {
             vec3 scale = (box.max - box.min) / 2.0f;
@@ -745,37 +749,24 @@ namespace Terrain
                 {scale.x, 0, scale.z}
             };
 
-
-            // TODO: Look into if we want to optimize this, the reason we currently
-            //       always get the Verticies from pos is because we don't manually
-            //       check for chunk/cell borders, but we could speed this part up
-            //       by doing that manually instead of calling GetVerticiesFromWorldPosition
-            //       5 times.
-
-            f32 timeToCollision = f32MaxValue;
-
             for (i32 i = 0; i < 5; i++)
             {
-                vec3 pos = center + offsets[i];
                 Geometry::Triangle tri;
-
-                if (GetTriangleFromWorldPosition(pos, tri, height))
+                if (GetTriangleFromWorldPosition(center + offsets[i], tri, height))
                 {
-                    // First store tri in triangle and then translate tri's position so that center is origin(0,0)
                     triangle = tri;
+                }
+            }
 
-                    tri.vert1 -= center;
-                    tri.vert2 -= center;
-                    tri.vert3 -= center;
+            entt::registry* registry = ServiceLocator::GetGameRegistry();
+            MapSingleton& mapSingleton = registry->ctx<MapSingleton>();
 
-                    // We need to find the "shortest" collision here and not just "any" collision (Not doing this causes issues when testing against multiple triangles
-                    f32 tmpTimeToCollision = 0;
-                    if (Intersect_AABB_TRIANGLE_SWEEP(scale, tri, direction, maxDist, tmpTimeToCollision, true))
-                    {
-                        if (tmpTimeToCollision < timeToCollision)
-                            timeToCollision = tmpTimeToCollision;
-                    }
-                }
+            f32 timeToCollision = f32MaxValue;
+
+            Terrain::SweepHit hit;
+            if (Terrain::SweepAABB(mapSingleton.currentMap.heightfield, box, direction, maxDist, hit))
+            {
+                timeToCollision = hit.distance;
             }
 
             outDistToCollision = timeToCollision * direction;
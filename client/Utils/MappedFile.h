@@ -0,0 +1,33 @@
+#pragma once
+#include <NovusTypes.h>
+#include <string>
+
+// Read only view of a whole file mapped into memory, pages are only read from disk once they are touched
+class MappedFile
+{
+public:
+    MappedFile() { }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return _data != nullptr; }
+    const u8* GetData() const { return _data; }
+    size_t GetSize() const { return _size; }
+
+    // Peak resident memory of the whole process in bytes, 0 if the platform can't tell us
+    static size_t GetPeakResidentBytes();
+
+private:
+    const u8* _data = nullptr;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    void* _fileHandle = nullptr;
+    void* _mappingHandle = nullptr;
+#endif
+};
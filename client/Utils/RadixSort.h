@@ -0,0 +1,73 @@
+#pragma once
+#include <NovusTypes.h>
+#include <vector>
+#include <cstring>
+#include <utility>
+
+namespace RadixSort
+{
+    // Stable LSD radix sort of values by 16 bit keys in two passes of 8 bits, both arrays end up sorted
+    // The scratch vectors only get grown, so keeping them around between calls avoids allocating every time
+    template <typename T>
+    void SortByKey16(u16* keys, T* values, size_t count, std::vector<u16>& scratchKeys, std::vector<T>& scratchValues)
+    {
+        if (count < 2)
+            return;
+
+        if (scratchKeys.size() < count)
+        {
+            scratchKeys.resize(count);
+            scratchValues.resize(count);
+        }
+
+        u16* srcKeys = keys;
+        T* srcValues = values;
+        u16* dstKeys = scratchKeys.data();
+        T* dstValues = scratchValues.data();
+
+        for (u32 shift = 0; shift < 16; shift += 8)
+        {
+            u32 offsets[256] = { 0 };
+            for (size_t i = 0; i < count; i++)
+            {
+                offsets[(srcKeys[i] >> shift) & 0xFF]++;
+            }
+
+            // All keys have the same digit, this pass wouldn't move anything
+            if (offsets[(srcKeys[0] >> shift) & 0xFF] == count)
+                continue;
+
+            u32 offset = 0;
+            for (u32 digit = 0; digit < 256; digit++)
+            {
+                const u32 digitCount = offsets[digit];
+                offsets[digit] = offset;
+                offset += digitCount;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                const u32 index = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+                dstKeys[index] = srcKeys[i];
+                dstValues[index] = srcValues[i];
+            }
+
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+
+        // An odd number of passes leaves the result in the scratch vectors
+        if (srcKeys != keys)
+        {
+            memcpy(keys, srcKeys, sizeof(u16) * count);
+            memcpy(values, srcValues, sizeof(T) * count);
+        }
+    }
+
+    // Keys for sorting front to back, half a yard per step which covers the whole map
+    inline u16 GetDistanceKey(f32 distance)
+    {
+        const f32 key = distance * 2.0f;
+        return key >= 65535.0f ? 65535 : static_cast<u16>(key);
+    }
+}
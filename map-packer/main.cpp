@@ -0,0 +1,65 @@
+#include <NovusTypes.h>
+#include <Utils/DebugHandler.h>
+#include <Utils/Timer.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../client/Loaders/Map/MapArchive.h"
+
+namespace fs = std::filesystem;
+
+// Usage: map-packer [map internal name...]
+// Packs every map in Data/extracted/maps, or only the ones named, into <map>/<map>.narc next to its .nmap files
+i32 main(i32 argc, char* argv[])
+{
+    const fs::path mapsPath = fs::absolute("Data/extracted/maps");
+    if (!fs::is_directory(mapsPath))
+    {
+        NC_LOG_ERROR("Failed to find maps folder (%s)", mapsPath.string().c_str());
+        return 1;
+    }
+
+    std::vector<std::string> mapInternalNames;
+    for (i32 i = 1; i < argc; i++)
+    {
+        mapInternalNames.push_back(argv[i]);
+    }
+
+    if (mapInternalNames.empty())
+    {
+        for (const auto& entry : fs::directory_iterator(mapsPath))
+        {
+            if (entry.is_directory())
+            {
+                mapInternalNames.push_back(entry.path().filename().string());
+            }
+        }
+    }
+
+    u32 numFailed = 0;
+    for (const std::string& mapInternalName : mapInternalNames)
+    {
+        const std::string mapFolder = (mapsPath / mapInternalName).string();
+        if (!fs::is_directory(mapFolder))
+        {
+            NC_LOG_ERROR("Failed to find map folder for %s", mapInternalName.c_str());
+            numFailed++;
+            continue;
+        }
+
+        Timer timer;
+        MapArchive::PackStats stats;
+        if (!MapArchive::Pack(mapFolder, MapArchive::GetPath(mapFolder, mapInternalName), stats))
+        {
+            NC_LOG_ERROR("Failed to pack %s", mapInternalName.c_str());
+            numFailed++;
+            continue;
+        }
+
+        const f64 ratio = stats.packedBytes > 0 ? static_cast<f64>(stats.unpackedBytes) / static_cast<f64>(stats.packedBytes) : 0.0;
+        NC_LOG_SUCCESS("Packed %u chunks of %s in %.2f s, %.1f MB to %.1f MB (%.2fx), heights are off by up to %.4f yards", stats.numChunks, mapInternalName.c_str(), timer.GetLifeTime(), stats.unpackedBytes / (1024.0 * 1024.0), stats.packedBytes / (1024.0 * 1024.0), ratio, stats.maxHeightError);
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
@@ -232,6 +232,20 @@ namespace Renderer
         renderer->PipelineBarrier(commandList, actualData->barrierType, actualData->buffer);
     }
 
+    void BackendDispatch::ImagePipelineBarrier(Renderer* renderer, CommandListID commandList, const void* data)
+    {
+        ZoneScopedC(tracy::Color::Red3);
+        const Commands::ImagePipelineBarrier* actualData = static_cast<const Commands::ImagePipelineBarrier*>(data);
+        renderer->PipelineBarrier(commandList, actualData->barrierType, actualData->image);
+    }
+
+    void BackendDispatch::DepthImagePipelineBarrier(Renderer* renderer, CommandListID commandList, const void* data)
+    {
+        ZoneScopedC(tracy::Color::Red3);
+        const Commands::DepthImagePipelineBarrier* actualData = static_cast<const Commands::DepthImagePipelineBarrier*>(data);
+        renderer->PipelineBarrier(commandList, actualData->barrierType, actualData->image);
+    }
+
     void BackendDispatch::DrawImgui(Renderer* renderer, CommandListID commandList, const void* data)
     {
         ZoneScopedNC("Imgui Draw", tracy::Color::Red3);
@@ -50,6 +50,8 @@ namespace Renderer
         static void CopyBuffer(Renderer* renderer, CommandListID commandList, const void* data);
 
         static void PipelineBarrier(Renderer* renderer, CommandListID commandList, const void* data);
+        static void ImagePipelineBarrier(Renderer* renderer, CommandListID commandList, const void* data);
+        static void DepthImagePipelineBarrier(Renderer* renderer, CommandListID commandList, const void* data);
 
         static void DrawImgui(Renderer* renderer, CommandListID commandList, const void* data);
 
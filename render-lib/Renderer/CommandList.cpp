@@ -437,6 +437,30 @@ namespace Renderer
 #endif
     }
 
+    void CommandList::PipelineBarrier(PipelineBarrierType type, ImageID image)
+    {
+        assert(image != ImageID::Invalid());
+        Commands::ImagePipelineBarrier* command = AddCommand<Commands::ImagePipelineBarrier>();
+        command->barrierType = type;
+        command->image = image;
+
+#if COMMANDLIST_DEBUG_IMMEDIATE_MODE
+        Commands::ImagePipelineBarrier::DISPATCH_FUNCTION(_renderer, _immediateCommandList, command);
+#endif
+    }
+
+    void CommandList::PipelineBarrier(PipelineBarrierType type, DepthImageID image)
+    {
+        assert(image != DepthImageID::Invalid());
+        Commands::DepthImagePipelineBarrier* command = AddCommand<Commands::DepthImagePipelineBarrier>();
+        command->barrierType = type;
+        command->image = image;
+
+#if COMMANDLIST_DEBUG_IMMEDIATE_MODE
+        Commands::DepthImagePipelineBarrier::DISPATCH_FUNCTION(_renderer, _immediateCommandList, command);
+#endif
+    }
+
     void CommandList::DrawImgui()
     {
         Commands::DrawImgui* command = AddCommand<Commands::DrawImgui>();
@@ -91,6 +91,8 @@ namespace Renderer
         void CopyBuffer(BufferID dstBuffer, u64 dstBufferOffset, BufferID srcBuffer, u64 srcBufferOffset, u64 region);
 
         void PipelineBarrier(PipelineBarrierType type, BufferID buffer);
+        void PipelineBarrier(PipelineBarrierType type, ImageID image);
+        void PipelineBarrier(PipelineBarrierType type, DepthImageID image);
 
         void DrawImgui();
 
@@ -60,6 +60,8 @@ namespace Renderer
         const BackendDispatchFunction AddWaitSemaphore::DISPATCH_FUNCTION = &BackendDispatch::AddWaitSemaphore;
         const BackendDispatchFunction CopyBuffer::DISPATCH_FUNCTION = &BackendDispatch::CopyBuffer;
         const BackendDispatchFunction PipelineBarrier::DISPATCH_FUNCTION = &BackendDispatch::PipelineBarrier;
+        const BackendDispatchFunction ImagePipelineBarrier::DISPATCH_FUNCTION = &BackendDispatch::ImagePipelineBarrier;
+        const BackendDispatchFunction DepthImagePipelineBarrier::DISPATCH_FUNCTION = &BackendDispatch::DepthImagePipelineBarrier;
         const BackendDispatchFunction DrawImgui::DISPATCH_FUNCTION = &BackendDispatch::DrawImgui;
         const BackendDispatchFunction PushConstant::DISPATCH_FUNCTION = &BackendDispatch::PushConstant;
     }
@@ -1,6 +1,8 @@
 #pragma once
 #include <NovusTypes.h>
 #include <Renderer/Descriptors/BufferDesc.h>
+#include <Renderer/Descriptors/ImageDesc.h>
+#include <Renderer/Descriptors/DepthImageDesc.h>
 
 namespace Renderer
 {
@@ -13,5 +15,21 @@ namespace Renderer
             PipelineBarrierType barrierType;
             BufferID buffer = BufferID::Invalid();
         };
+
+        struct ImagePipelineBarrier
+        {
+            static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+            PipelineBarrierType barrierType;
+            ImageID image = ImageID::Invalid();
+        };
+
+        struct DepthImagePipelineBarrier
+        {
+            static const BackendDispatchFunction DISPATCH_FUNCTION;
+
+            PipelineBarrierType barrierType;
+            DepthImageID image = DepthImageID::Invalid();
+        };
     }
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "DepthPyramid.h"
+#include "Renderer.h"
+#include "RenderGraph.h"
+#include "RenderGraphBuilder.h"
+#include "CommandList.h"
+
+namespace Renderer
+{
+    constexpr u32 DEPTH_PYRAMID_MAX_MIPS = 13; // Has to match DEPTH_PYRAMID_MAX_MIPS in depthPyramid.inc.hlsl
+    constexpr u32 DEPTH_PYRAMID_TILE_SIZE = 64; // Every workgroup reduces a 64x64 tile of mip 0
+
+    DepthPyramid::DepthPyramid(Renderer* renderer)
+        : _renderer(renderer)
+    {
+        CreatePermanentResources();
+    }
+
+    void DepthPyramid::AddBuildPass(RenderGraph* renderGraph, DepthImageID depthImage, u8 frameIndex)
+    {
+        struct DepthPyramidPassData
+        {
+            RenderPassResource depth;
+        };
+
+        renderGraph->AddPass<DepthPyramidPassData>("DepthPyramid",
+            [=](DepthPyramidPassData& data, RenderGraphBuilder& builder) // Setup
+        {
+            data.depth = builder.Read(depthImage, RenderGraphBuilder::ShaderStage::SHADER_STAGE_COMPUTE);
+
+            return true; // Return true from setup to enable this pass, return false to disable it
+        },
+            [=](DepthPyramidPassData& data, RenderGraphResources& resources, CommandList& commandList) // Execute
+        {
+            GPU_SCOPED_PROFILER_ZONE(commandList, DepthPyramid);
+
+            const uvec2 baseSize = GetDimensions();
+            const uvec2 numWorkGroups = (baseSize + uvec2(DEPTH_PYRAMID_TILE_SIZE - 1)) / DEPTH_PYRAMID_TILE_SIZE;
+
+            _buildConstantBuffer->resource.numMips = glm::min(GetNumMipLevels(), DEPTH_PYRAMID_MAX_MIPS);
+            _buildConstantBuffer->resource.numWorkGroups = numWorkGroups.x * numWorkGroups.y;
+            _buildConstantBuffer->Apply(frameIndex);
+
+            // Wait for the depth writes and for whoever read last frame's pyramid
+            commandList.PipelineBarrier(PipelineBarrierType::DepthWriteToComputeShaderRead, depthImage);
+            commandList.PipelineBarrier(PipelineBarrierType::ComputeWriteToComputeShaderRead, _pyramid);
+            commandList.PipelineBarrier(PipelineBarrierType::ComputeWriteToComputeShaderRead, _atomicCounterBuffer);
+
+            ComputePipelineDesc pipelineDesc;
+            resources.InitializePipelineDesc(pipelineDesc);
+
+            ComputeShaderDesc shaderDesc;
+            shaderDesc.path = "Data/shaders/depthPyramid.cs.hlsl.spv";
+            pipelineDesc.computeShader = _renderer->LoadShader(shaderDesc);
+
+            ComputePipelineID pipeline = _renderer->CreatePipeline(pipelineDesc);
+            commandList.BeginPipeline(pipeline);
+
+            _buildDescriptorSet.Bind("_depth", depthImage);
+            _buildDescriptorSet.BindStorageArray("_pyramid", _pyramid);
+            _buildDescriptorSet.Bind("_atomicCounter", _atomicCounterBuffer);
+            _buildDescriptorSet.Bind("_constants", _buildConstantBuffer->GetBuffer(frameIndex));
+
+            commandList.BindDescriptorSet(DescriptorSetSlot::PER_PASS, &_buildDescriptorSet, frameIndex);
+            commandList.Dispatch(numWorkGroups.x, numWorkGroups.y, 1);
+
+            commandList.EndPipeline(pipeline);
+
+            commandList.PipelineBarrier(PipelineBarrierType::ComputeShaderReadToDepthWrite, depthImage);
+            commandList.PipelineBarrier(PipelineBarrierType::ComputeWriteToComputeShaderRead, _pyramid);
+        });
+    }
+
+    void DepthPyramid::AddDebugPass(RenderGraph* renderGraph, ImageID renderTarget, u32 mipLevel, bool showMinDepth, f32 depthScale, u8 frameIndex)
+    {
+        struct DepthPyramidDebugPassData
+        {
+            RenderPassMutableResource renderTarget;
+            RenderPassResource pyramid;
+        };
+
+        renderGraph->AddPass<DepthPyramidDebugPassData>("DepthPyramidDebug",
+            [=](DepthPyramidDebugPassData& data, RenderGraphBuilder& builder) // Setup
+        {
+            data.renderTarget = builder.Write(renderTarget, RenderGraphBuilder::WriteMode::WRITE_MODE_RENDERTARGET, RenderGraphBuilder::LoadMode::LOAD_MODE_LOAD);
+            data.pyramid = builder.Read(_pyramid, RenderGraphBuilder::ShaderStage::SHADER_STAGE_PIXEL);
+
+            return true; // Return true from setup to enable this pass, return false to disable it
+        },
+            [=](DepthPyramidDebugPassData& data, RenderGraphResources& resources, CommandList& commandList) // Execute
+        {
+            GPU_SCOPED_PROFILER_ZONE(commandList, DepthPyramidDebug);
+
+            commandList.PipelineBarrier(PipelineBarrierType::ComputeWriteToPixelShaderRead, _pyramid);
+
+            _debugConstantBuffer->resource.mipLevel = mipLevel;
+            _debugConstantBuffer->resource.showMinDepth = showMinDepth;
+            _debugConstantBuffer->resource.depthScale = depthScale;
+            _debugConstantBuffer->Apply(frameIndex);
+
+            GraphicsPipelineDesc pipelineDesc;
+            resources.InitializePipelineDesc(pipelineDesc);
+
+            // Shaders
+            VertexShaderDesc vertexShaderDesc;
+            vertexShaderDesc.path = "Data/shaders/blit.vs.hlsl.spv";
+            pipelineDesc.states.vertexShader = _renderer->LoadShader(vertexShaderDesc);
+
+            PixelShaderDesc pixelShaderDesc;
+            pixelShaderDesc.path = "Data/shaders/depthPyramidDebug.ps.hlsl.spv";
+            pipelineDesc.states.pixelShader = _renderer->LoadShader(pixelShaderDesc);
+
+            // Render targets
+            pipelineDesc.renderTargets[0] = data.renderTarget;
+
+            // Set pipeline
+            GraphicsPipelineID pipeline = _renderer->CreatePipeline(pipelineDesc); // This will compile the pipeline and return the ID, or just return ID of cached pipeline
+            commandList.BeginPipeline(pipeline);
+
+            _debugDescriptorSet.Bind("_depthPyramid", _pyramid);
+            _debugDescriptorSet.Bind("_constants", _debugConstantBuffer->GetBuffer(frameIndex));
+
+            commandList.BindDescriptorSet(DescriptorSetSlot::PER_PASS, &_debugDescriptorSet, frameIndex);
+
+            // Fullscreen triangle
+            commandList.Draw(3, 1, 0, 0);
+
+            commandList.EndPipeline(pipeline);
+        });
+    }
+
+    uvec2 DepthPyramid::GetDimensions()
+    {
+        return _renderer->GetImageDimensions(_pyramid);
+    }
+
+    u32 DepthPyramid::GetNumMipLevels()
+    {
+        return _renderer->GetImageNumMipLevels(_pyramid);
+    }
+
+    void DepthPyramid::CreatePermanentResources()
+    {
+        // The pyramid follows the window size, rounded down to a power of two
+        ImageDesc pyramidDesc;
+        pyramidDesc.debugName = "DepthPyramid";
+        pyramidDesc.dimensions = vec2(1.0f, 1.0f);
+        pyramidDesc.dimensionType = ImageDimensionType::DIMENSION_PYRAMID;
+        pyramidDesc.mipLevels = DEPTH_PYRAMID_MAX_MIPS;
+        pyramidDesc.format = IMAGE_FORMAT_R32G32_FLOAT;
+        pyramidDesc.sampleCount = SAMPLE_COUNT_1;
+
+        _pyramid = _renderer->CreateImage(pyramidDesc);
+
+        // Counts finished workgroups so the last one knows it can build the remaining mips, the shader resets it to 0 when done
+        {
+            BufferDesc desc;
+            desc.name = "DepthPyramidAtomicCounter";
+            desc.size = sizeof(u32);
+            desc.usage = BUFFER_USAGE_STORAGE_BUFFER | BUFFER_USAGE_TRANSFER_DESTINATION;
+            _atomicCounterBuffer = _renderer->CreateBuffer(desc);
+
+            BufferDesc uploadBufferDesc;
+            uploadBufferDesc.name = "DepthPyramidAtomicCounterUploadBuffer";
+            uploadBufferDesc.cpuAccess = BufferCPUAccess::WriteOnly;
+            uploadBufferDesc.size = sizeof(u32);
+            uploadBufferDesc.usage = BUFFER_USAGE_TRANSFER_SOURCE;
+
+            BufferID uploadBuffer = _renderer->CreateBuffer(uploadBufferDesc);
+            _renderer->QueueDestroyBuffer(uploadBuffer);
+
+            u32* counter = static_cast<u32*>(_renderer->MapBuffer(uploadBuffer));
+            *counter = 0;
+            _renderer->UnmapBuffer(uploadBuffer);
+
+            _renderer->CopyBuffer(_atomicCounterBuffer, 0, uploadBuffer, 0, uploadBufferDesc.size);
+        }
+
+        _buildConstantBuffer = new Buffer<BuildConstants>(_renderer, "DepthPyramidBuildConstantBuffer", BUFFER_USAGE_UNIFORM_BUFFER, BufferCPUAccess::WriteOnly);
+        _debugConstantBuffer = new Buffer<DebugConstants>(_renderer, "DepthPyramidDebugConstantBuffer", BUFFER_USAGE_UNIFORM_BUFFER, BufferCPUAccess::WriteOnly);
+
+        _buildDescriptorSet.SetBackend(_renderer->CreateDescriptorSetBackend());
+        _debugDescriptorSet.SetBackend(_renderer->CreateDescriptorSetBackend());
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <NovusTypes.h>
+#include "DescriptorSet.h"
+#include "Buffer.h"
+#include "Descriptors/ImageDesc.h"
+#include "Descriptors/DepthImageDesc.h"
+
+namespace Renderer
+{
+    class Renderer;
+    class RenderGraph;
+
+    // Hierarchical min/max depth pyramid (Hi-Z) built from any depth image
+    // Mip 0 is the window size rounded down to a power of two, shaders test against it with depthPyramid.inc.hlsl
+    class DepthPyramid
+    {
+    public:
+        DepthPyramid(Renderer* renderer);
+
+        // Adds a compute pass that rebuilds every mip of the pyramid from depthImage in a single dispatch
+        // depthImage is expected to be a depth attachment and is transitioned back to one when the pass is done
+        void AddBuildPass(RenderGraph* renderGraph, DepthImageID depthImage, u8 frameIndex);
+
+        // Draws a single mip of the pyramid over renderTarget, showMinDepth shows the nearest instead of the farthest depth
+        void AddDebugPass(RenderGraph* renderGraph, ImageID renderTarget, u32 mipLevel, bool showMinDepth, f32 depthScale, u8 frameIndex);
+
+        ImageID GetImage() { return _pyramid; }
+        uvec2 GetDimensions();
+        u32 GetNumMipLevels();
+
+    private:
+        void CreatePermanentResources();
+
+    private:
+        struct BuildConstants
+        {
+            u32 numMips;
+            u32 numWorkGroups;
+        };
+
+        struct DebugConstants
+        {
+            u32 mipLevel;
+            u32 showMinDepth;
+            f32 depthScale;
+            u32 padding;
+        };
+
+        Renderer* _renderer;
+
+        ImageID _pyramid;
+        BufferID _atomicCounterBuffer;
+
+        Buffer<BuildConstants>* _buildConstantBuffer;
+        Buffer<DebugConstants>* _debugConstantBuffer;
+
+        DescriptorSet _buildDescriptorSet;
+        DescriptorSet _debugDescriptorSet;
+    };
+}
@@ -103,4 +103,102 @@ namespace Renderer
         boundDescriptor.descriptorType = DESCRIPTOR_TYPE_BUFFER;
         boundDescriptor.bufferID = buffer;
     }
+
+    void DescriptorSet::Bind(const std::string& name, ImageID imageID)
+    {
+        u32 nameHash = StringUtils::fnv1a_32(name.c_str(), name.size());
+        Bind(nameHash, imageID);
+    }
+
+    void DescriptorSet::Bind(u32 nameHash, ImageID imageID)
+    {
+        for (u32 i = 0; i < _boundDescriptors.size(); i++)
+        {
+            if (nameHash == _boundDescriptors[i].nameHash)
+            {
+                _boundDescriptors[i].descriptorType = DescriptorType::DESCRIPTOR_TYPE_IMAGE;
+                _boundDescriptors[i].imageID = imageID;
+                return;
+            }
+        }
+
+        Descriptor& boundDescriptor = _boundDescriptors.emplace_back();
+        boundDescriptor.nameHash = nameHash;
+        boundDescriptor.descriptorType = DESCRIPTOR_TYPE_IMAGE;
+        boundDescriptor.imageID = imageID;
+    }
+
+    void DescriptorSet::Bind(const std::string& name, DepthImageID depthImageID)
+    {
+        u32 nameHash = StringUtils::fnv1a_32(name.c_str(), name.size());
+        Bind(nameHash, depthImageID);
+    }
+
+    void DescriptorSet::Bind(u32 nameHash, DepthImageID depthImageID)
+    {
+        for (u32 i = 0; i < _boundDescriptors.size(); i++)
+        {
+            if (nameHash == _boundDescriptors[i].nameHash)
+            {
+                _boundDescriptors[i].descriptorType = DescriptorType::DESCRIPTOR_TYPE_DEPTH_IMAGE;
+                _boundDescriptors[i].depthImageID = depthImageID;
+                return;
+            }
+        }
+
+        Descriptor& boundDescriptor = _boundDescriptors.emplace_back();
+        boundDescriptor.nameHash = nameHash;
+        boundDescriptor.descriptorType = DESCRIPTOR_TYPE_DEPTH_IMAGE;
+        boundDescriptor.depthImageID = depthImageID;
+    }
+
+    void DescriptorSet::BindStorage(const std::string& name, ImageID imageID, u32 mipLevel)
+    {
+        u32 nameHash = StringUtils::fnv1a_32(name.c_str(), name.size());
+        BindStorage(nameHash, imageID, mipLevel);
+    }
+
+    void DescriptorSet::BindStorage(u32 nameHash, ImageID imageID, u32 mipLevel)
+    {
+        for (u32 i = 0; i < _boundDescriptors.size(); i++)
+        {
+            if (nameHash == _boundDescriptors[i].nameHash)
+            {
+                _boundDescriptors[i].descriptorType = DescriptorType::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                _boundDescriptors[i].imageID = imageID;
+                _boundDescriptors[i].imageMipLevel = mipLevel;
+                return;
+            }
+        }
+
+        Descriptor& boundDescriptor = _boundDescriptors.emplace_back();
+        boundDescriptor.nameHash = nameHash;
+        boundDescriptor.descriptorType = DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        boundDescriptor.imageID = imageID;
+        boundDescriptor.imageMipLevel = mipLevel;
+    }
+
+    void DescriptorSet::BindStorageArray(const std::string& name, ImageID imageID)
+    {
+        u32 nameHash = StringUtils::fnv1a_32(name.c_str(), name.size());
+        BindStorageArray(nameHash, imageID);
+    }
+
+    void DescriptorSet::BindStorageArray(u32 nameHash, ImageID imageID)
+    {
+        for (u32 i = 0; i < _boundDescriptors.size(); i++)
+        {
+            if (nameHash == _boundDescriptors[i].nameHash)
+            {
+                _boundDescriptors[i].descriptorType = DescriptorType::DESCRIPTOR_TYPE_STORAGE_IMAGE_ARRAY;
+                _boundDescriptors[i].imageID = imageID;
+                return;
+            }
+        }
+
+        Descriptor& boundDescriptor = _boundDescriptors.emplace_back();
+        boundDescriptor.nameHash = nameHash;
+        boundDescriptor.descriptorType = DESCRIPTOR_TYPE_STORAGE_IMAGE_ARRAY;
+        boundDescriptor.imageID = imageID;
+    }
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "Descriptors/SamplerDesc.h"
 #include "Descriptors/TextureDesc.h"
 #include "Descriptors/TextureArrayDesc.h"
+#include "Descriptors/ImageDesc.h"
+#include "Descriptors/DepthImageDesc.h"
 #include <robin_hood.h>
 
 namespace Renderer
@@ -14,6 +16,10 @@ namespace Renderer
         DESCRIPTOR_TYPE_TEXTURE,
         DESCRIPTOR_TYPE_TEXTURE_ARRAY,
         DESCRIPTOR_TYPE_BUFFER,
+        DESCRIPTOR_TYPE_IMAGE,
+        DESCRIPTOR_TYPE_DEPTH_IMAGE,
+        DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        DESCRIPTOR_TYPE_STORAGE_IMAGE_ARRAY,
     };
 
     struct Descriptor
@@ -26,6 +32,9 @@ namespace Renderer
         SamplerID samplerID;
         TextureArrayID textureArrayID;
         BufferID bufferID;
+        ImageID imageID;
+        DepthImageID depthImageID;
+        u32 imageMipLevel;
     };
 
     enum DescriptorSetSlot
@@ -61,6 +70,22 @@ namespace Renderer
         void Bind(const std::string& name, BufferID buffer);
         void Bind(u32 nameHash, BufferID buffer);
 
+        // Binds all mips of the image for sampling
+        void Bind(const std::string& name, ImageID imageID);
+        void Bind(u32 nameHash, ImageID imageID);
+
+        // The depth image needs to be transitioned with PipelineBarrierType::DepthWriteToComputeShaderRead before it can be sampled
+        void Bind(const std::string& name, DepthImageID depthImageID);
+        void Bind(u32 nameHash, DepthImageID depthImageID);
+
+        // Binds a single mip of the image as a RWTexture
+        void BindStorage(const std::string& name, ImageID imageID, u32 mipLevel = 0);
+        void BindStorage(u32 nameHash, ImageID imageID, u32 mipLevel = 0);
+
+        // Binds every mip of the image to a RWTexture array, one mip per element
+        void BindStorageArray(const std::string& name, ImageID imageID);
+        void BindStorageArray(u32 nameHash, ImageID imageID);
+
         const std::vector<Descriptor>& GetDescriptors() { return _boundDescriptors; }
         
         DescriptorSetBackend* GetBackend() { return _backend; }
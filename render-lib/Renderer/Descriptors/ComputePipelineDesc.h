@@ -3,12 +3,14 @@
 #include <Utils/StrongTypedef.h>
 
 #include "ComputeShaderDesc.h"
+#include "ShaderPermutationDesc.h"
 
 namespace Renderer
 {
     struct ComputePipelineDesc
     {
         ComputeShaderID computeShader = ComputeShaderID::Invalid();
+        ShaderPermutation permutation;
     };
 
     // Lets strong-typedef an ID type with the underlying type of u16
@@ -8,6 +8,7 @@
 
 #include "VertexShaderDesc.h"
 #include "PixelShaderDesc.h"
+#include "ShaderPermutationDesc.h"
 #include "ImageDesc.h"
 #include "DepthImageDesc.h"
 #include "RenderTargetDesc.h"
@@ -39,6 +40,10 @@ namespace Renderer
             // Shaders
             VertexShaderID vertexShader = VertexShaderID::Invalid();
             PixelShaderID pixelShader = PixelShaderID::Invalid();
+
+            // Permutations
+            ShaderPermutation vertexPermutation;
+            ShaderPermutation pixelPermutation;
         };
         States states;
 
@@ -13,6 +13,7 @@ namespace Renderer
         ImageDimensionType dimensionType = ImageDimensionType::DIMENSION_ABSOLUTE;
 
         u32 depth = 1;
+        u32 mipLevels = 1; // 0 means a full mip chain down to 1x1, larger values are clamped to the full chain
 
         ImageFormat format = IMAGE_FORMAT_UNKNOWN;
         SampleCount sampleCount = SAMPLE_COUNT_1;
@@ -0,0 +1,67 @@
+#pragma once
+#include <NovusTypes.h>
+#include <cassert>
+#include <cstring>
+
+namespace Renderer
+{
+    static const int MAX_SPECIALIZATION_CONSTANTS = 8;
+
+    // constant_id 0 is reserved for the keyword bitmask, see permutation.inc.hlsl
+    static const u32 SHADER_KEYWORDS_CONSTANT_ID = 0;
+
+    struct SpecializationConstant
+    {
+        u32 constantID = 0;
+        u32 value = 0;
+    };
+
+    // Selects a permutation of a shader through specialization constants, this gets hashed as part of the pipeline description so every permutation gets its own pipeline
+    // Keywords are a bitmask which shaders test with HasKeyword(), the driver then strips the branches that aren't taken
+    struct ShaderPermutation
+    {
+        u32 keywords = 0;
+
+        u32 numConstants = 0;
+        SpecializationConstant constants[MAX_SPECIALIZATION_CONSTANTS];
+
+        void EnableKeyword(u32 keyword) { keywords |= keyword; }
+        void SetKeyword(u32 keyword, bool enabled) { keywords = enabled ? (keywords | keyword) : (keywords & ~keyword); }
+
+        void SetConstant(u32 constantID, u32 value)
+        {
+            assert(constantID != SHADER_KEYWORDS_CONSTANT_ID); // Use the keyword functions for this one
+
+            // Keep the constants sorted by ID so setting them in a different order still gives us the same hash
+            u32 index = 0;
+            while (index < numConstants && constants[index].constantID < constantID)
+            {
+                index++;
+            }
+
+            if (index < numConstants && constants[index].constantID == constantID)
+            {
+                constants[index].value = value;
+                return;
+            }
+
+            assert(numConstants < MAX_SPECIALIZATION_CONSTANTS); // If this hits you need to increase MAX_SPECIALIZATION_CONSTANTS
+            for (u32 i = numConstants; i > index; i--)
+            {
+                constants[i] = constants[i - 1];
+            }
+
+            constants[index].constantID = constantID;
+            constants[index].value = value;
+            numConstants++;
+        }
+        void SetConstant(u32 constantID, i32 value) { SetConstant(constantID, static_cast<u32>(value)); }
+        void SetConstant(u32 constantID, bool value) { SetConstant(constantID, static_cast<u32>(value)); }
+        void SetConstant(u32 constantID, f32 value)
+        {
+            u32 bits;
+            memcpy(&bits, &value, sizeof(u32));
+            SetConstant(constantID, bits);
+        }
+    };
+}
@@ -473,7 +473,8 @@ namespace Renderer
     enum ImageDimensionType
     {
         DIMENSION_ABSOLUTE, // vec2(1,1) means 1x1 pixels
-        DIMENSION_SCALE     // vec2(1,1) means 100% of window size
+        DIMENSION_SCALE,    // vec2(1,1) means 100% of window size
+        DIMENSION_PYRAMID   // vec2(1,1) means 100% of window size rounded down to the closest power of two, used for mip pyramids that need to halve cleanly
     };
 
     enum BufferUsage
@@ -502,6 +503,13 @@ namespace Renderer
         ComputeWriteToVertexShaderRead,
         ComputeWriteToPixelShaderRead,
         ComputeWriteToComputeShaderRead,
+        DepthWriteToComputeShaderRead, // Only valid for DepthImageID, transitions it to be sampled
+        ComputeShaderReadToDepthWrite, // Only valid for DepthImageID, transitions it back to a depth attachment
+        ShaderReadToTransferDest, // Only valid for BufferID, waits for earlier indirect argument, vertex, pixel and compute reads before the buffer gets copied into
+        TransferDestToShaderRead, // Only valid for BufferID, makes a copy visible to vertex input and every shader stage
+        ComputeWriteToTransferSource, // Only valid for BufferID
+        TransferDestToHostRead, // Only valid for BufferID, makes a copy into a ReadOnly buffer visible to the CPU once the frame is done
+        PixelShaderReadToComputeWrite, // Only valid for ImageID, waits for earlier pixel shader reads before a compute shader overwrites the image
     };
 
     inline ImageComponentType ToImageComponentType(ImageFormat imageFormat)
@@ -43,6 +43,7 @@ namespace Renderer
         RenderGraph CreateRenderGraph(RenderGraphDesc& desc);
 
         // Creation
+        // Buffers, images, textures, texture arrays and models can be created and loaded from any thread
         virtual BufferID CreateBuffer(BufferDesc& desc) = 0;
         virtual void QueueDestroyBuffer(BufferID buffer) = 0;
 
@@ -111,6 +112,8 @@ namespace Renderer
         virtual void AddWaitSemaphore(CommandListID commandListID, GPUSemaphoreID semaphoreID) = 0;
         virtual void CopyBuffer(CommandListID commandListID, BufferID dstBuffer, u64 dstOffset, BufferID srcBuffer, u64 srcOffset, u64 range) = 0;
         virtual void PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, BufferID buffer) = 0;
+        virtual void PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, ImageID image) = 0;
+        virtual void PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, DepthImageID image) = 0;
         virtual void PushConstant(CommandListID commandListID, void* data, u32 offset, u32 size) = 0;
 
         // Present functions
@@ -124,6 +127,9 @@ namespace Renderer
         virtual void* MapBuffer(BufferID buffer) = 0;
         virtual void UnmapBuffer(BufferID buffer) = 0;
 
+        virtual uvec2 GetImageDimensions(ImageID imageID, u32 mipLevel = 0) = 0; // The actual size in pixels, after DIMENSION_SCALE or DIMENSION_PYRAMID has been applied
+        virtual u32 GetImageNumMipLevels(ImageID imageID) = 0;
+
         virtual size_t GetVRAMUsage() = 0;
         virtual size_t GetVRAMBudget() = 0;
 
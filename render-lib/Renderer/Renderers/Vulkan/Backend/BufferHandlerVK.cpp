@@ -3,6 +3,7 @@
 #include "DebugMarkerUtilVK.h"
 
 #include "vulkan/vulkan.h"
+#include <Utils/DebugHandler.h>
 
 constexpr size_t MaxBufferCount = 65535;
 
@@ -21,11 +22,10 @@ namespace Renderer
 
             for (unsigned i = 0; i < MaxBufferCount; ++i) 
             {
-                _indices[i].next = i + 1;
+                _indices[i].next.store(i + 1, std::memory_order_relaxed);
             }
 
-            _freelistDequeue = 0;
-            _freelistEnqueue = MaxBufferCount - 1;
+            _freelistHead = 0;
         }
 
         BufferHandlerVK::~BufferHandlerVK()
@@ -38,19 +38,42 @@ namespace Renderer
 
         BufferID BufferHandlerVK::AcquireNewBufferID() 
         {
-            assert(_bufferCount < MaxBufferCount);
-            ++_bufferCount;
+            u32 count = ++_bufferCount;
+            if (count > MaxBufferCount)
+            {
+                NC_LOG_FATAL("We exceeded the limit of the BufferID type!");
+            }
 
-            BufferID bufferID = BufferID((BufferID::type)_freelistDequeue);
-            const Index& in = _indices[_freelistDequeue];
-            _freelistDequeue = in.next;
-            return bufferID;
+            u64 head = _freelistHead.load(std::memory_order_acquire);
+            u64 newHead;
+            u32 index;
+
+            do
+            {
+                index = static_cast<u32>(head);
+                const u32 next = _indices[index].next.load(std::memory_order_relaxed);
+                const u64 tag = (head >> 32) + 1;
+
+                newHead = (tag << 32) | next;
+            } while (!_freelistHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire));
+
+            return BufferID(static_cast<BufferID::type>(index));
         }
 
         void BufferHandlerVK::ReturnBufferID(BufferID bufferID)
         {
-            _indices[_freelistEnqueue].next = (BufferID::type)bufferID;
-            _freelistEnqueue = (BufferID::type)bufferID;
+            const u32 index = static_cast<BufferID::type>(bufferID);
+
+            u64 head = _freelistHead.load(std::memory_order_acquire);
+            u64 newHead;
+
+            do
+            {
+                _indices[index].next.store(static_cast<u32>(head), std::memory_order_relaxed);
+                const u64 tag = (head >> 32) + 1;
+
+                newHead = (tag << 32) | index;
+            } while (!_freelistHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire));
 
             --_bufferCount;
         }
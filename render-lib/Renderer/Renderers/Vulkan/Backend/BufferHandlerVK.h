@@ -7,6 +7,7 @@
 #include "vulkan/vulkan_core.h"
 
 #include <vector>
+#include <atomic>
 
 namespace Renderer
 {
@@ -43,14 +44,14 @@ namespace Renderer
             };
 
             struct Index {
-                u32 next;
+                std::atomic<u32> next;
             };
 
-            u32 _bufferCount;
+            // The freelist is a lock-free stack, the head packs the index of the first free buffer in the low 32 bits and an ABA tag in the high 32 bits
+            std::atomic<u32> _bufferCount;
             Buffer* _buffers = nullptr;
             Index* _indices = nullptr;
-            u32 _freelistEnqueue;
-            u32 _freelistDequeue;
+            std::atomic<u64> _freelistHead;
 
             friend class RendererVK;
         };
@@ -120,6 +120,7 @@ namespace Renderer
                 submitInfo.signalSemaphoreCount = static_cast<u32>(commandList.signalSemaphores.size());
                 submitInfo.pSignalSemaphores = commandList.signalSemaphores.data();
 
+                std::scoped_lock lock(_device->_queueMutex);
                 vkQueueSubmit(_device->_graphicsQueue, 1, &submitInfo, fence);
             }
 
@@ -0,0 +1,221 @@
+#pragma once
+#include <NovusTypes.h>
+#include <robin_hood.h>
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <cassert>
+
+namespace Renderer
+{
+    namespace Backend
+    {
+        // Append-only storage that hands out stable indices without taking a lock.
+        // Elements are stored in fixed size pages which are never moved once allocated, so a reference returned by Get stays valid while other threads keep adding.
+        // An element only becomes visible to Get and ForEach once the function that fills it in returned, every slot has its own committed flag for that.
+        template <typename T, size_t MaxCount, size_t PageSize = 256>
+        class PagedStorageVK
+        {
+            static constexpr size_t NumPages = (MaxCount + PageSize - 1) / PageSize;
+
+            struct Page
+            {
+                Page()
+                {
+                    for (size_t i = 0; i < PageSize; i++)
+                    {
+                        committed[i].store(false, std::memory_order_relaxed);
+                    }
+                }
+
+                T elements[PageSize];
+                std::atomic<bool> committed[PageSize];
+            };
+
+        public:
+            PagedStorageVK()
+            {
+                for (size_t i = 0; i < NumPages; i++)
+                {
+                    _pages[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+
+            ~PagedStorageVK()
+            {
+                for (size_t i = 0; i < NumPages; i++)
+                {
+                    delete _pages[i].load(std::memory_order_relaxed);
+                }
+            }
+
+            PagedStorageVK(const PagedStorageVK&) = delete;
+            PagedStorageVK& operator=(const PagedStorageVK&) = delete;
+
+            // Reserves a new slot, lets init fill in its default constructed element and only then commits it
+            // Returns false if the storage is full, init isn't called in that case
+            template <typename Func>
+            bool Emplace(size_t& index, Func&& init)
+            {
+                T* element = Reserve(index);
+                if (element == nullptr)
+                    return false;
+
+                init(*element);
+                Commit(index);
+
+                return true;
+            }
+
+            bool IsCommitted(size_t index) const
+            {
+                if (index >= _reserved.load(std::memory_order_acquire))
+                    return false;
+
+                const Page* page = _pages[index / PageSize].load(std::memory_order_acquire);
+                return page != nullptr && page->committed[index % PageSize].load();
+            }
+
+            T& Get(size_t index)
+            {
+                assert(IsCommitted(index));
+                return _pages[index / PageSize].load(std::memory_order_acquire)->elements[index % PageSize];
+            }
+
+            const T& Get(size_t index) const
+            {
+                assert(IsCommitted(index));
+                return _pages[index / PageSize].load(std::memory_order_acquire)->elements[index % PageSize];
+            }
+
+            // Number of slots from the start that are all committed, slots past it can be committed too if an earlier one is still being filled in
+            size_t Size() const { return _committed.load(std::memory_order_acquire); }
+
+            // Visits every committed element, including the ones past Size
+            template <typename Func>
+            void ForEach(Func&& func)
+            {
+                const size_t reserved = _reserved.load(std::memory_order_acquire);
+                for (size_t i = 0; i < reserved; i++)
+                {
+                    if (IsCommitted(i))
+                    {
+                        func(Get(i));
+                    }
+                }
+            }
+
+        private:
+            T* Reserve(size_t& index)
+            {
+                index = _reserved.load(std::memory_order_relaxed);
+                do
+                {
+                    if (index >= MaxCount)
+                        return nullptr;
+                } while (!_reserved.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+                const size_t pageIndex = index / PageSize;
+                Page* page = _pages[pageIndex].load(std::memory_order_acquire);
+
+                if (page == nullptr)
+                {
+                    // Several threads might race to create the same page, only one of them wins and the others throw theirs away
+                    Page* newPage = new Page();
+                    if (_pages[pageIndex].compare_exchange_strong(page, newPage, std::memory_order_acq_rel, std::memory_order_acquire))
+                    {
+                        page = newPage;
+                    }
+                    else
+                    {
+                        delete newPage;
+                    }
+                }
+
+                return &page->elements[index % PageSize];
+            }
+
+            void Commit(size_t index)
+            {
+                _pages[index / PageSize].load(std::memory_order_acquire)->committed[index % PageSize].store(true);
+
+                // Whoever commits the slot the committed count stops at moves it past every slot after it that is already done
+                // The flags and the count are sequentially consistent, with acquire/release two threads committing neighbouring slots could both miss the other's flag and leave the count behind
+                size_t committed = _committed.load();
+                while (IsCommitted(committed))
+                {
+                    if (_committed.compare_exchange_weak(committed, committed + 1))
+                    {
+                        committed++;
+                    }
+                }
+            }
+
+            std::atomic<Page*> _pages[NumPages];
+            std::atomic<size_t> _reserved = 0;
+            std::atomic<size_t> _committed = 0;
+        };
+
+        // Hash map split into NumShards independently locked maps, threads only contend when their keys land in the same shard
+        template <typename Key, typename Value, size_t NumShards = 16>
+        class ShardedHashMapVK
+        {
+            static_assert((NumShards & (NumShards - 1)) == 0, "NumShards needs to be a power of two");
+
+        public:
+            bool TryGet(const Key& key, Value& value)
+            {
+                Shard& shard = GetShard(key);
+                std::shared_lock lock(shard.mutex);
+
+                auto itr = shard.map.find(key);
+                if (itr == shard.map.end())
+                    return false;
+
+                value = itr->second;
+                return true;
+            }
+
+            // Returns false and outputs the already stored value if another thread got there first
+            bool TryEmplace(const Key& key, const Value& value, Value& existingValue)
+            {
+                Shard& shard = GetShard(key);
+                std::unique_lock lock(shard.mutex);
+
+                auto result = shard.map.try_emplace(key, value);
+                if (!result.second)
+                {
+                    existingValue = result.first->second;
+                    return false;
+                }
+
+                return true;
+            }
+
+            void Erase(const Key& key)
+            {
+                Shard& shard = GetShard(key);
+                std::unique_lock lock(shard.mutex);
+
+                shard.map.erase(key);
+            }
+
+        private:
+            struct Shard
+            {
+                std::shared_mutex mutex;
+                robin_hood::unordered_map<Key, Value> map;
+            };
+
+            Shard& GetShard(const Key& key)
+            {
+                // Keys are usually already well distributed hashes, but run them through robin_hood so integer IDs spread out too
+                const size_t hash = robin_hood::hash<Key>{}(key);
+                return _shards[(hash >> 7) & (NumShards - 1)];
+            }
+
+            Shard _shards[NumShards];
+        };
+    }
+}
@@ -191,6 +191,63 @@ namespace Renderer
             }
         }
 
+        void DescriptorSetBuilderVK::BindStorageImage(u32 nameHash, const VkDescriptorImageInfo& imageInfo)
+        {
+            for (auto& bindInfo : _bindInfos)
+            {
+                if (nameHash == bindInfo.nameHash)
+                {
+                    BindImageWrite(bindInfo.set, bindInfo.binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageInfo, nullptr, 0);
+                    return;
+                }
+            }
+        }
+
+        void DescriptorSetBuilderVK::BindStorageImageArray(u32 nameHash, std::vector<VkDescriptorImageInfo>& images)
+        {
+            assert(!images.empty());
+
+            for (auto& bindInfo : _bindInfos)
+            {
+                if (nameHash == bindInfo.nameHash)
+                {
+                    // Every element the shader declares needs a valid descriptor, so we repeat the last one for anything we don't have
+                    if (images.size() < bindInfo.count)
+                    {
+                        images.resize(bindInfo.count, images.back());
+                    }
+
+                    BindImageWrite(bindInfo.set, bindInfo.binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, images[0], images.data(), static_cast<i32>(bindInfo.count));
+                    return;
+                }
+            }
+        }
+
+        void DescriptorSetBuilderVK::BindImageWrite(i32 set, i32 binding, VkDescriptorType descriptorType, const VkDescriptorImageInfo& imageInfo, VkDescriptorImageInfo* imageArray, i32 imageCount)
+        {
+            for (auto& imageWrite : _imageWrites)
+            {
+                if (imageWrite.dstBinding == binding && imageWrite.dstSet == set)
+                {
+                    imageWrite.descriptorType = descriptorType;
+                    imageWrite.imageInfo = imageInfo;
+                    imageWrite.imageArray = imageArray;
+                    imageWrite.imageCount = imageCount;
+                    return;
+                }
+            }
+
+            ImageWriteDescriptor newWrite;
+            newWrite.dstSet = set;
+            newWrite.dstBinding = binding;
+            newWrite.descriptorType = descriptorType;
+            newWrite.imageInfo = imageInfo;
+            newWrite.imageArray = imageArray;
+            newWrite.imageCount = imageCount;
+
+            _imageWrites.push_back(newWrite);
+        }
+
         void DescriptorSetBuilderVK::BindBuffer(i32 set, i32 binding, const VkDescriptorBufferInfo& bufferInfo, VkDescriptorType bufferType)
         {
             for (auto& bufferWrite : _bufferWrites) 
@@ -337,7 +394,7 @@ namespace Renderer
 
             for (const ImageWriteDescriptor& imageWrite : _imageWrites)
             {
-                if (imageWrite.imageArray != nullptr && imageWrite.dstSet == set)
+                if (imageWrite.imageArray != nullptr && imageWrite.dstSet == set && imageWrite.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE)
                 {
                     counts[0] = imageWrite.imageCount;
                     next = &setCounts;
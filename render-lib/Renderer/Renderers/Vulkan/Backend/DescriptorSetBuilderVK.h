@@ -39,6 +39,9 @@ namespace Renderer
             void BindImage(i32 set, i32 binding, const VkDescriptorImageInfo& imageInfo, bool imageWrite = false);
             void BindImage(u32 nameHash, const VkDescriptorImageInfo& imageInfo);
 
+            void BindStorageImage(u32 nameHash, const VkDescriptorImageInfo& imageInfo);
+            void BindStorageImageArray(u32 nameHash, std::vector<VkDescriptorImageInfo>& images); // Pads images with its last element up to the size the shader declares
+
             void BindBuffer(i32 set, i32 binding, const VkDescriptorBufferInfo& bufferInfo, VkDescriptorType bufferType);
             void BindBuffer(u32 nameHash, const VkDescriptorBufferInfo& bufferInfo);
 
@@ -48,6 +51,9 @@ namespace Renderer
             void UpdateDescriptor(i32 set, VkDescriptorSet& descriptor, RenderDeviceVK& device);
             VkDescriptorSet BuildDescriptor(i32 set, DescriptorLifetime lifetime);
 
+        private:
+            void BindImageWrite(i32 set, i32 binding, VkDescriptorType descriptorType, const VkDescriptorImageInfo& imageInfo, VkDescriptorImageInfo* imageArray, i32 imageCount);
+
         private:
             enum class PipelineType
             {
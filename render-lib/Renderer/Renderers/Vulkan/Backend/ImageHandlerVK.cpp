@@ -17,21 +17,20 @@ namespace Renderer
         void ImageHandlerVK::OnWindowResize()
         {
             // Recreate color images
-            for (auto& image : _images)
+            _images.ForEach([&](Image& image)
             {
-                if (image.desc.dimensionType == ImageDimensionType::DIMENSION_SCALE)
+                if (image.desc.dimensionType == ImageDimensionType::DIMENSION_SCALE || image.desc.dimensionType == ImageDimensionType::DIMENSION_PYRAMID)
                 {
                     // Destroy old image
-                    vkDestroyImageView(_device->_device, image.colorView, nullptr);
-                    vmaDestroyImage(_device->_allocator, image.image, image.allocation);
+                    DestroyImage(image);
                     
                     // Create new
                     CreateImage(image);
                 }
-            }
+            });
 
             // Recreate depth images
-            for (auto& image : _depthImages)
+            _depthImages.ForEach([&](DepthImage& image)
             {
                 if (image.desc.dimensionType == ImageDimensionType::DIMENSION_SCALE)
                 {
@@ -42,47 +41,43 @@ namespace Renderer
                     // Create new
                     CreateImage(image);
                 }
-            }
+            });
         }
 
         ImageID ImageHandlerVK::CreateImage(const ImageDesc& desc)
         {
-            size_t nextHandle = _images.size();
-
-            // Make sure we haven't exceeded the limit of the ImageID type, if this hits you need to change type of ImageID to something bigger
-            assert(nextHandle < ImageID::MaxValue());
-            using type = type_safe::underlying_type<ImageID>;
-
-            Image image;
-            image.desc = desc;
-
             assert(desc.dimensions.x > 0); // Make sure the width is valid
             assert(desc.dimensions.y > 0); // Make sure the height is valid
             assert(desc.depth > 0); // Make sure the depth is valid
             assert(desc.format != IMAGE_FORMAT_UNKNOWN); // Make sure the format is valid
 
-            CreateImage(image);
+            size_t nextHandle;
+            const bool didEmplace = _images.Emplace(nextHandle, [&](Image& image)
+            {
+                image.desc = desc;
+                CreateImage(image);
+            });
 
-            _images.push_back(image);
+            // Make sure we haven't exceeded the limit of the ImageID type, if this hits you need to change type of ImageID to something bigger
+            assert(didEmplace);
+            using type = type_safe::underlying_type<ImageID>;
 
             return ImageID(static_cast<type>(nextHandle));
         }
 
         DepthImageID ImageHandlerVK::CreateDepthImage(const DepthImageDesc& desc)
         {
-            size_t nextHandle = _depthImages.size();
+            size_t nextHandle;
+            const bool didEmplace = _depthImages.Emplace(nextHandle, [&](DepthImage& image)
+            {
+                image.desc = desc;
+                CreateImage(image);
+            });
 
             // Make sure we haven't exceeded the limit of the DepthImageID type, if this hits you need to change type of DepthImageID to something bigger
-            assert(nextHandle < DepthImageID::MaxValue());
+            assert(didEmplace);
             using type = type_safe::underlying_type<DepthImageID>;
 
-            DepthImage image;
-            image.desc = desc;
-
-            CreateImage(image);
-
-            _depthImages.push_back(image);
-
             return DepthImageID(static_cast<type>(nextHandle));
         }
 
@@ -91,8 +86,8 @@ namespace Renderer
             using type = type_safe::underlying_type<ImageID>;
 
             // Lets make sure this id exists
-            assert(_images.size() > static_cast<type>(id));
-            return _images[static_cast<type>(id)].desc;
+            assert(_images.IsCommitted(static_cast<type>(id)));
+            return _images.Get(static_cast<type>(id)).desc;
         }
 
         const DepthImageDesc& ImageHandlerVK::GetDepthImageDesc(const DepthImageID id)
@@ -100,8 +95,8 @@ namespace Renderer
             using type = type_safe::underlying_type<DepthImageID>;
 
             // Lets make sure this id exists
-            assert(_depthImages.size() > static_cast<type>(id));
-            return _depthImages[static_cast<type>(id)].desc;
+            assert(_depthImages.IsCommitted(static_cast<type>(id)));
+            return _depthImages.Get(static_cast<type>(id)).desc;
         }
 
         VkImage ImageHandlerVK::GetImage(const ImageID id)
@@ -109,8 +104,8 @@ namespace Renderer
             using type = type_safe::underlying_type<ImageID>;
 
             // Lets make sure this id exists
-            assert(_images.size() > static_cast<type>(id));
-            return _images[static_cast<type>(id)].image;
+            assert(_images.IsCommitted(static_cast<type>(id)));
+            return _images.Get(static_cast<type>(id)).image;
         }
 
         VkImageView ImageHandlerVK::GetColorView(const ImageID id)
@@ -118,8 +113,45 @@ namespace Renderer
             using type = type_safe::underlying_type<ImageID>;
 
             // Lets make sure this id exists
-            assert(_images.size() > static_cast<type>(id));
-            return _images[static_cast<type>(id)].colorView;
+            assert(_images.IsCommitted(static_cast<type>(id)));
+            return _images.Get(static_cast<type>(id)).colorView;
+        }
+
+        VkImageView ImageHandlerVK::GetColorView(const ImageID id, u32 mipLevel)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.IsCommitted(static_cast<type>(id)));
+            const Image& image = _images.Get(static_cast<type>(id));
+
+            // Make sure this mip exists
+            assert(mipLevel < image.numMipLevels);
+
+            if (image.mipViews.empty())
+                return image.colorView;
+
+            return image.mipViews[mipLevel];
+        }
+
+        u32 ImageHandlerVK::GetNumMipLevels(const ImageID id)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.IsCommitted(static_cast<type>(id)));
+            return _images.Get(static_cast<type>(id)).numMipLevels;
+        }
+
+        uvec2 ImageHandlerVK::GetDimensions(const ImageID id, u32 mipLevel)
+        {
+            using type = type_safe::underlying_type<ImageID>;
+
+            // Lets make sure this id exists
+            assert(_images.IsCommitted(static_cast<type>(id)));
+            const Image& image = _images.Get(static_cast<type>(id));
+
+            return glm::max(image.dimensions >> mipLevel, uvec2(1, 1));
         }
 
         VkImage ImageHandlerVK::GetImage(const DepthImageID id)
@@ -127,8 +159,8 @@ namespace Renderer
             using type = type_safe::underlying_type<DepthImageID>;
 
             // Lets make sure this id exists
-            assert(_depthImages.size() > static_cast<type>(id));
-            return _depthImages[static_cast<type>(id)].image;
+            assert(_depthImages.IsCommitted(static_cast<type>(id)));
+            return _depthImages.Get(static_cast<type>(id)).image;
         }
 
         VkImageView ImageHandlerVK::GetDepthView(const DepthImageID id)
@@ -136,8 +168,8 @@ namespace Renderer
             using type = type_safe::underlying_type<DepthImageID>;
 
             // Lets make sure this id exists
-            assert(_depthImages.size() > static_cast<type>(id));
-            return _depthImages[static_cast<type>(id)].depthView;
+            assert(_depthImages.IsCommitted(static_cast<type>(id)));
+            return _depthImages.Get(static_cast<type>(id)).depthView;
         }
 
         void ImageHandlerVK::CreateImage(Image& image)
@@ -161,18 +193,35 @@ namespace Renderer
             f32 height = image.desc.dimensions.y;
 
             // If the supplied dimensions is a % of window size
-            if (image.desc.dimensionType == ImageDimensionType::DIMENSION_SCALE)
+            if (image.desc.dimensionType == ImageDimensionType::DIMENSION_SCALE || image.desc.dimensionType == ImageDimensionType::DIMENSION_PYRAMID)
             {
                 uvec2 windowSize = _device->GetMainWindowSize();
                 width *= windowSize.x;
                 height *= windowSize.y;
             }
 
+            image.dimensions = uvec2(glm::max(static_cast<u32>(width), 1u), glm::max(static_cast<u32>(height), 1u));
+
+            // Round down to the closest power of two so every mip is exactly half of the previous one
+            if (image.desc.dimensionType == ImageDimensionType::DIMENSION_PYRAMID)
+            {
+                image.dimensions.x = 1u << static_cast<u32>(glm::log2(static_cast<f32>(image.dimensions.x)));
+                image.dimensions.y = 1u << static_cast<u32>(glm::log2(static_cast<f32>(image.dimensions.y)));
+            }
+
+            const u32 fullMipChain = static_cast<u32>(glm::log2(static_cast<f32>(glm::max(image.dimensions.x, image.dimensions.y)))) + 1;
+
+            image.numMipLevels = image.desc.mipLevels;
+            if (image.numMipLevels == 0 || image.numMipLevels > fullMipChain)
+            {
+                image.numMipLevels = fullMipChain;
+            }
+
             imageInfo.format = FormatConverterVK::ToVkFormat(image.desc.format);
-            imageInfo.extent.width = static_cast<u32>(width);
-            imageInfo.extent.height = static_cast<u32>(height);
+            imageInfo.extent.width = image.dimensions.x;
+            imageInfo.extent.height = image.dimensions.y;
             imageInfo.extent.depth = image.desc.depth;
-            imageInfo.mipLevels = 1;
+            imageInfo.mipLevels = image.numMipLevels;
             imageInfo.arrayLayers = 1;
             imageInfo.samples = FormatConverterVK::ToVkSampleCount(image.desc.sampleCount);
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -212,7 +261,7 @@ namespace Renderer
             colorViewInfo.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
             colorViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             colorViewInfo.subresourceRange.baseMipLevel = 0;
-            colorViewInfo.subresourceRange.levelCount = 1;
+            colorViewInfo.subresourceRange.levelCount = image.numMipLevels;
             colorViewInfo.subresourceRange.baseArrayLayer = 0;
             colorViewInfo.subresourceRange.layerCount = 1;
 
@@ -223,8 +272,39 @@ namespace Renderer
 
             DebugMarkerUtilVK::SetObjectName(_device->_device, (u64)image.colorView, VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, image.desc.debugName.c_str());
 
+            // Create Mip Views
+            if (image.numMipLevels > 1)
+            {
+                image.mipViews.resize(image.numMipLevels);
+
+                for (u32 i = 0; i < image.numMipLevels; i++)
+                {
+                    colorViewInfo.subresourceRange.baseMipLevel = i;
+                    colorViewInfo.subresourceRange.levelCount = 1;
+
+                    if (vkCreateImageView(_device->_device, &colorViewInfo, nullptr, &image.mipViews[i]) != VK_SUCCESS)
+                    {
+                        NC_LOG_FATAL("Failed to create color image mip view!");
+                    }
+
+                    DebugMarkerUtilVK::SetObjectName(_device->_device, (u64)image.mipViews[i], VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_VIEW_EXT, image.desc.debugName.c_str());
+                }
+            }
+
             // Transition image from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_GENERAL
-            _device->TransitionImageLayout(image.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, image.desc.depth, 1);
+            _device->TransitionImageLayout(image.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, image.desc.depth, image.numMipLevels);
+        }
+
+        void ImageHandlerVK::DestroyImage(Image& image)
+        {
+            for (VkImageView mipView : image.mipViews)
+            {
+                vkDestroyImageView(_device->_device, mipView, nullptr);
+            }
+            image.mipViews.clear();
+
+            vkDestroyImageView(_device->_device, image.colorView, nullptr);
+            vmaDestroyImage(_device->_allocator, image.image, image.allocation);
         }
 
         void ImageHandlerVK::CreateImage(DepthImage& image)
@@ -6,6 +6,7 @@
 
 #include "../../../Descriptors/ImageDesc.h"
 #include "../../../Descriptors/DepthImageDesc.h"
+#include "ConcurrentStorageVK.h"
 
 namespace Renderer
 {
@@ -28,6 +29,9 @@ namespace Renderer
 
             VkImage GetImage(const ImageID id);
             VkImageView GetColorView(const ImageID id);
+            VkImageView GetColorView(const ImageID id, u32 mipLevel);
+            u32 GetNumMipLevels(const ImageID id);
+            uvec2 GetDimensions(const ImageID id, u32 mipLevel);
 
             VkImage GetImage(const DepthImageID id);
             VkImageView GetDepthView(const DepthImageID id);
@@ -39,7 +43,11 @@ namespace Renderer
 
                 VmaAllocation allocation;
                 VkImage image;
-                VkImageView colorView;
+                VkImageView colorView; // Covers all mips, used for sampling
+
+                uvec2 dimensions;
+                u32 numMipLevels;
+                std::vector<VkImageView> mipViews; // One view per mip, only created when we have more than one mip since render targets and storage images can only see a single mip
             };
 
             struct DepthImage
@@ -53,12 +61,14 @@ namespace Renderer
 
             void CreateImage(Image& image);
             void CreateImage(DepthImage& image);
+            void DestroyImage(Image& image);
 
         private:
             RenderDeviceVK* _device;
 
-            std::vector<Image> _images;
-            std::vector<DepthImage> _depthImages;
+            // Images can be created from any thread, lookups by ID never take a lock
+            PagedStorageVK<Image, std::numeric_limits<ImageID::type>::max(), 64> _images;
+            PagedStorageVK<DepthImage, std::numeric_limits<DepthImageID::type>::max(), 64> _depthImages;
         };
     }
 }
\ No newline at end of file
@@ -19,52 +19,52 @@ namespace Renderer
 
         ModelID ModelHandlerVK::CreatePrimitiveModel(const PrimitiveModelDesc& desc)
         {
-            size_t nextHandle = _models.size();
-
-            // Make sure we haven't exceeded the limit of the DepthImageID type, if this hits you need to change type of DepthImageID to something bigger
-            assert(nextHandle < ModelID::MaxValue());
-            using type = type_safe::underlying_type<ModelID>;
+            size_t nextHandle;
+            const bool didEmplace = _models.Emplace(nextHandle, [&](Model& model)
+            {
+                model.debugName = desc.debugName;
 
-            Model model;
-            model.debugName = desc.debugName;
+                TempModelData tempData;
 
-            TempModelData tempData;
+                tempData.indexType = 3; // Triangle list, nothing else is really used these days
+                tempData.vertices = desc.vertices;
+                tempData.indices = desc.indices;
 
-            tempData.indexType = 3; // Triangle list, nothing else is really used these days
-            tempData.vertices = desc.vertices;
-            tempData.indices = desc.indices;
+                InitializeModel(model, tempData);
+            });
 
-            InitializeModel(model, tempData);
+            // Make sure we haven't exceeded the limit of the ModelID type, if this hits you need to change type of ModelID to something bigger
+            assert(didEmplace);
+            using type = type_safe::underlying_type<ModelID>;
 
-            _models.push_back(model);
             return ModelID(static_cast<type>(nextHandle));
         }
 
         void ModelHandlerVK::UpdatePrimitiveModel(ModelID modelID, const PrimitiveModelDesc& desc)
         {
             using type = type_safe::underlying_type<ModelID>;
-            Model& model = _models[static_cast<type>(modelID)];
+            Model& model = _models.Get(static_cast<type>(modelID));
             
             UpdateVertices(model, desc.vertices);
         }
 
         ModelID ModelHandlerVK::LoadModel(const ModelDesc& desc)
         {
-            size_t nextHandle = _models.size();
+            size_t nextHandle;
+            const bool didEmplace = _models.Emplace(nextHandle, [&](Model& model)
+            {
+                model.debugName = desc.path;
 
-            // Make sure we haven't exceeded the limit of the DepthImageID type, if this hits you need to change type of DepthImageID to something bigger
-            assert(nextHandle < ModelID::MaxValue());
-            using type = type_safe::underlying_type<ModelID>;
+                TempModelData tempData;
 
-            Model model;
-            model.debugName = desc.path;
+                LoadFromFile(desc, tempData);
+                InitializeModel(model, tempData);
+            });
 
-            TempModelData tempData;
+            // Make sure we haven't exceeded the limit of the ModelID type, if this hits you need to change type of ModelID to something bigger
+            assert(didEmplace);
+            using type = type_safe::underlying_type<ModelID>;
 
-            LoadFromFile(desc, tempData);
-            InitializeModel(model, tempData);
-                
-            _models.push_back(model);
             return ModelID(static_cast<type>(nextHandle));
         }
 
@@ -73,9 +73,9 @@ namespace Renderer
             using type = type_safe::underlying_type<ModelID>;
 
             // Lets make sure this id exists
-            assert(_models.size() > static_cast<type>(modelID));
+            assert(_models.IsCommitted(static_cast<type>(modelID)));
 
-            Model& model = _models[static_cast<type>(modelID)];
+            Model& model = _models.Get(static_cast<type>(modelID));
             if (model.numVertices == 0)
             {
                 NC_LOG_FATAL("Tried to get the vertex buffer of model (%s) which doesn't have vertices", model.debugName);
@@ -89,9 +89,9 @@ namespace Renderer
             using type = type_safe::underlying_type<ModelID>;
 
             // Lets make sure this id exists
-            assert(_models.size() > static_cast<type>(modelID));
+            assert(_models.IsCommitted(static_cast<type>(modelID)));
 
-            Model& model = _models[static_cast<type>(modelID)];
+            Model& model = _models.Get(static_cast<type>(modelID));
 
             return model.numIndices;
         }
@@ -101,9 +101,9 @@ namespace Renderer
             using type = type_safe::underlying_type<ModelID>;
 
             // Lets make sure this id exists
-            assert(_models.size() > static_cast<type>(modelID));
+            assert(_models.IsCommitted(static_cast<type>(modelID)));
 
-            Model& model = _models[static_cast<type>(modelID)];
+            Model& model = _models.Get(static_cast<type>(modelID));
             if (model.numIndices == 0)
             {
                 NC_LOG_FATAL("Tried to get the index buffer of model (%s) which doesn't have indices", model.debugName);
@@ -7,6 +7,7 @@
 
 #include "../../../Descriptors/ModelDesc.h"
 #include "../../../Descriptors/BufferDesc.h"
+#include "ConcurrentStorageVK.h"
 
 namespace Renderer
 {
@@ -64,7 +65,8 @@ namespace Renderer
             RenderDeviceVK* _device;
             BufferHandlerVK* _bufferHandler;
 
-            std::vector<Model> _models;
+            // Models can be created from any thread, lookups by ID never take a lock
+            PagedStorageVK<Model, std::numeric_limits<ModelID::type>::max()> _models;
         };
     }
 }
\ No newline at end of file
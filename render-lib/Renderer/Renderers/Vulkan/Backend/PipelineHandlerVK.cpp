@@ -118,13 +118,14 @@ namespace Renderer
                 subpass.pDepthStencilAttachment = &depthDescriptionRef;
             }
 
+            // Passes that share a depth buffer (like a depth prepass followed by depth EQUAL shading) need the previous depth writes to be visible
             VkSubpassDependency dependency = {};
             dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
             dependency.dstSubpass = 0;
-            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.srcAccessMask = 0;
-            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
             VkRenderPassCreateInfo renderPassInfo = {};
             renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -234,6 +235,8 @@ namespace Renderer
             }
 
             std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+            SpecializationData vertexSpecialization;
+            SpecializationData pixelSpecialization;
             if (desc.states.vertexShader != VertexShaderID::Invalid())
             {
                 VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
@@ -242,6 +245,7 @@ namespace Renderer
 
                 vertShaderStageInfo.module = _shaderHandler->GetShaderModule(desc.states.vertexShader);
                 vertShaderStageInfo.pName = "main";
+                vertShaderStageInfo.pSpecializationInfo = FillSpecializationData(desc.states.vertexPermutation, vertexSpecialization);
 
                 shaderStages.push_back(vertShaderStageInfo);
             }
@@ -253,6 +257,7 @@ namespace Renderer
 
                 fragShaderStageInfo.module = _shaderHandler->GetShaderModule(desc.states.pixelShader);
                 fragShaderStageInfo.pName = "main";
+                fragShaderStageInfo.pSpecializationInfo = FillSpecializationData(desc.states.pixelPermutation, pixelSpecialization);
 
                 shaderStages.push_back(fragShaderStageInfo);
             }
@@ -487,6 +492,7 @@ namespace Renderer
             pipeline.descriptorSetBuilder = new DescriptorSetBuilderVK(pipelineID, this, _shaderHandler, _device->_descriptorMegaPool);
 
             _graphicsPipelines.push_back(pipeline);
+            _graphicsPipelineHashToID[cacheDescHash] = static_cast<gIDType>(nextID);
 
             pipeline.descriptorSetBuilder->InitReflectData(); // Needs to happen after push_back
 
@@ -553,10 +559,13 @@ namespace Renderer
                 NC_LOG_FATAL("Failed to create pipeline layout!");
             }
 
+            SpecializationData specialization;
+
             VkPipelineShaderStageCreateInfo shaderStage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
             shaderStage.module = _shaderHandler->GetShaderModule(desc.computeShader);
             shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
             shaderStage.pName = "main";
+            shaderStage.pSpecializationInfo = FillSpecializationData(desc.permutation, specialization);
 
             VkComputePipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
             pipelineInfo.stage = shaderStage;
@@ -571,6 +580,7 @@ namespace Renderer
             pipeline.descriptorSetBuilder = new DescriptorSetBuilderVK(pipelineID, this, _shaderHandler, _device->_descriptorMegaPool);
 
             _computePipelines.push_back(pipeline);
+            _computePipelineHashToID[cacheDescHash] = static_cast<cIDType>(nextID);
 
             pipeline.descriptorSetBuilder->InitReflectData(); // Needs to happen after push_back
 
@@ -603,7 +613,9 @@ namespace Renderer
         u64 PipelineHandlerVK::CalculateCacheDescHash(const ComputePipelineDesc& desc)
         {
             ComputePipelineCacheDesc cacheDesc;
+            memset(&cacheDesc, 0, sizeof(cacheDesc)); // We hash the raw bytes, so make sure the padding after shader is zeroed
             cacheDesc.shader = desc.computeShader;
+            cacheDesc.permutation = desc.permutation;
 
             u64 hash = XXHash64::hash(&cacheDesc, sizeof(cacheDesc), 0);
 
@@ -612,34 +624,46 @@ namespace Renderer
 
         bool PipelineHandlerVK::TryFindExistingGPipeline(u64 descHash, size_t& id)
         {
-            id = 0;
-
-            for (auto& pipeline : _graphicsPipelines)
-            {
-                if (descHash == pipeline.cacheDescHash)
-                {
-                    return true;
-                }
-                id++;
-            }
+            auto itr = _graphicsPipelineHashToID.find(descHash);
+            if (itr == _graphicsPipelineHashToID.end())
+                return false;
 
-            return false;
+            id = itr->second;
+            return true;
         }
 
         bool PipelineHandlerVK::TryFindExistingCPipeline(u64 descHash, size_t& id)
         {
-            id = 0;
+            auto itr = _computePipelineHashToID.find(descHash);
+            if (itr == _computePipelineHashToID.end())
+                return false;
 
-            for (auto& pipeline : _computePipelines)
+            id = itr->second;
+            return true;
+        }
+
+        const VkSpecializationInfo* PipelineHandlerVK::FillSpecializationData(const ShaderPermutation& permutation, SpecializationData& data)
+        {
+            // The keyword bitmask always goes in, Vulkan ignores map entries for constant IDs that the shader doesn't declare
+            data.mapEntries[0].constantID = SHADER_KEYWORDS_CONSTANT_ID;
+            data.mapEntries[0].offset = 0;
+            data.mapEntries[0].size = sizeof(u32);
+            data.values[0] = permutation.keywords;
+
+            for (u32 i = 0; i < permutation.numConstants; i++)
             {
-                if (descHash == pipeline.cacheDescHash)
-                {
-                    return true;
-                }
-                id++;
+                data.mapEntries[i + 1].constantID = permutation.constants[i].constantID;
+                data.mapEntries[i + 1].offset = (i + 1) * sizeof(u32);
+                data.mapEntries[i + 1].size = sizeof(u32);
+                data.values[i + 1] = permutation.constants[i].value;
             }
 
-            return false;
+            data.info.mapEntryCount = permutation.numConstants + 1;
+            data.info.pMapEntries = data.mapEntries;
+            data.info.dataSize = data.info.mapEntryCount * sizeof(u32);
+            data.info.pData = data.values;
+
+            return &data.info;
         }
 
         DescriptorSetLayoutData& PipelineHandlerVK::GetDescriptorSet(i32 setNumber, std::vector<DescriptorSetLayoutData>& sets)
@@ -672,7 +696,7 @@ namespace Renderer
             for (u32 i = 0; i < pipeline.numRenderTargets; i++)
             {
                 ImageID imageID = pipeline.desc.MutableResourceToImageID(pipeline.desc.renderTargets[i]);
-                attachmentViews[i] = _imageHandler->GetColorView(imageID);
+                attachmentViews[i] = _imageHandler->GetColorView(imageID, 0); // Attachments can only see a single mip
             }
             // Add depthstencil as attachment
             if (pipeline.desc.depthStencil != RenderPassMutableResource::Invalid())
@@ -91,6 +91,15 @@ namespace Renderer
             struct ComputePipelineCacheDesc
             {
                 ComputeShaderID shader;
+                ShaderPermutation permutation;
+            };
+
+            // Backing storage for the VkSpecializationInfo of one shader stage, needs to outlive the vkCreate*Pipelines call
+            struct SpecializationData
+            {
+                VkSpecializationMapEntry mapEntries[MAX_SPECIALIZATION_CONSTANTS + 1];
+                u32 values[MAX_SPECIALIZATION_CONSTANTS + 1];
+                VkSpecializationInfo info;
             };
 
             struct ComputePipeline
@@ -113,6 +122,7 @@ namespace Renderer
             bool TryFindExistingGPipeline(u64 descHash, size_t& id);
             bool TryFindExistingCPipeline(u64 descHash, size_t& id);
             DescriptorSetLayoutData& GetDescriptorSet(i32 setNumber, std::vector<DescriptorSetLayoutData>& sets);
+            const VkSpecializationInfo* FillSpecializationData(const ShaderPermutation& permutation, SpecializationData& data);
             
             void CreateFramebuffer(GraphicsPipeline& pipeline);
 
@@ -123,6 +133,9 @@ namespace Renderer
 
             std::vector<GraphicsPipeline> _graphicsPipelines;
             std::vector<ComputePipeline> _computePipelines;
+
+            robin_hood::unordered_map<u64, gIDType> _graphicsPipelineHashToID;
+            robin_hood::unordered_map<u64, cIDType> _computePipelineHashToID;
         };
     }
 }
\ No newline at end of file
@@ -1167,6 +1167,9 @@ namespace Renderer
 
         VkCommandBuffer RenderDeviceVK::BeginSingleTimeCommands()
         {
+            // Recording into a command buffer counts as using its pool, so we keep the pool locked until EndSingleTimeCommands
+            _commandPoolMutex.lock();
+
             VkCommandBufferAllocateInfo allocInfo = {};
             allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
             allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -1194,10 +1197,15 @@ namespace Renderer
             submitInfo.commandBufferCount = 1;
             submitInfo.pCommandBuffers = &commandBuffer;
 
-            vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-            vkQueueWaitIdle(_graphicsQueue);
+            {
+                std::scoped_lock lock(_queueMutex);
+                vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+                vkQueueWaitIdle(_graphicsQueue);
+            }
 
             vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+
+            _commandPoolMutex.unlock();
         }
 
         void RenderDeviceVK::CopyBuffer(VkBuffer dstBuffer, u64 dstOffset, VkBuffer srcBuffer, u64 srcOffset, u64 range)
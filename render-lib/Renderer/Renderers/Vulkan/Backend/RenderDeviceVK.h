@@ -2,6 +2,7 @@
 #include <NovusTypes.h>
 #include <vector>
 #include <optional>
+#include <mutex>
 #include <vulkan/vulkan.h>
 #include "vk_mem_alloc.h"
 
@@ -104,6 +105,10 @@ namespace Renderer
             VkQueue _graphicsQueue = VK_NULL_HANDLE;
             VkQueue _presentQueue = VK_NULL_HANDLE;
 
+            // Handlers can create resources from worker threads, the command pool and queues need external synchronization
+            std::mutex _commandPoolMutex; // Held from BeginSingleTimeCommands until EndSingleTimeCommands
+            std::mutex _queueMutex;
+
             std::vector<SwapChainVK*> _swapChains;
 
             VmaAllocator _allocator;
@@ -3,29 +3,350 @@
 #include <Utils/StringUtils.h>
 #include "RenderDeviceVK.h"
 #include <fstream>
+#include <filesystem>
 
 namespace Renderer
 {
     namespace Backend
     {
+        const std::string SHADER_PACK_PATH = "Data/shaders/shaders.nshaderpack";
+        constexpr u32 SHADER_PACK_TOKEN = 1263555406; // "NSPK"
+        constexpr u32 SHADER_PACK_VERSION = 1;
+
+        // Small helpers for (de)serializing the shader pack, reads are bounds checked so a truncated pack is discarded rather than crashing
+        struct ShaderPackWriter
+        {
+            std::vector<char> data;
+
+            template <typename T>
+            void Put(const T& value)
+            {
+                const char* bytes = reinterpret_cast<const char*>(&value);
+                data.insert(data.end(), bytes, bytes + sizeof(T));
+            }
+
+            void PutBytes(const char* bytes, size_t size)
+            {
+                Put(static_cast<u32>(size));
+                data.insert(data.end(), bytes, bytes + size);
+            }
+        };
+
+        struct ShaderPackReader
+        {
+            const char* data;
+            size_t size;
+            size_t offset = 0;
+
+            template <typename T>
+            bool Get(T& value)
+            {
+                if (offset + sizeof(T) > size)
+                    return false;
+
+                memcpy(&value, data + offset, sizeof(T));
+                offset += sizeof(T);
+                return true;
+            }
+
+            bool GetBytes(const char*& bytes, u32& numBytes)
+            {
+                if (!Get(numBytes) || offset + numBytes > size)
+                    return false;
+
+                bytes = data + offset;
+                offset += numBytes;
+                return true;
+            }
+        };
+
         void ShaderHandlerVK::Init(RenderDeviceVK* device)
         {
             _device = device;
+
+            LoadShaderPack();
         }
 
         VertexShaderID ShaderHandlerVK::LoadShader(const VertexShaderDesc& desc)
         {
-            return LoadShader<VertexShaderID>(desc.path, _vertexShaders);
+            return LoadShader<VertexShaderID>(desc.path, _vertexShaders, _vertexShaderPathHashToID);
         }
 
         PixelShaderID ShaderHandlerVK::LoadShader(const PixelShaderDesc& desc)
         {
-            return LoadShader<PixelShaderID>(desc.path, _pixelShaders);
+            return LoadShader<PixelShaderID>(desc.path, _pixelShaders, _pixelShaderPathHashToID);
         }
 
         ComputeShaderID ShaderHandlerVK::LoadShader(const ComputeShaderDesc& desc)
         {
-            return LoadShader<ComputeShaderID>(desc.path, _computeShaders);
+            return LoadShader<ComputeShaderID>(desc.path, _computeShaders, _computeShaderPathHashToID);
+        }
+
+        void ShaderHandlerVK::LoadShaderPack()
+        {
+            std::ifstream file(SHADER_PACK_PATH, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                _shaderPackDirty = true; // There is no pack yet, make sure we write one
+                return;
+            }
+
+            // Read the whole pack in one go
+            std::vector<char> packData(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(packData.data(), packData.size());
+            file.close();
+
+            ShaderPackReader reader{ packData.data(), packData.size() };
+
+            u32 token = 0;
+            u32 version = 0;
+            u32 numShaders = 0;
+            if (!reader.Get(token) || !reader.Get(version) || !reader.Get(numShaders) || token != SHADER_PACK_TOKEN || version != SHADER_PACK_VERSION)
+            {
+                NC_LOG_ERROR("Shader pack %s has an invalid header, falling back to loose shaders", SHADER_PACK_PATH.c_str());
+                _shaderPackDirty = true;
+                return;
+            }
+
+            _shaderPack.reserve(numShaders);
+
+            for (u32 i = 0; i < numShaders; i++)
+            {
+                u32 pathHash;
+                PackedShader packedShader;
+
+                const char* bytes;
+                u32 numBytes;
+                bool success = reader.Get(pathHash) && reader.GetBytes(bytes, numBytes);
+
+                if (success)
+                {
+                    packedShader.path.assign(bytes, numBytes);
+                    success = reader.Get(packedShader.lastWriteTime) && reader.GetBytes(bytes, numBytes);
+                }
+
+                if (success)
+                {
+                    packedShader.spirv.assign(bytes, bytes + numBytes);
+
+                    u32 numDataBindings = 0;
+                    success = reader.Get(numDataBindings);
+
+                    for (u32 j = 0; success && j < numDataBindings; j++)
+                    {
+                        BindInfo& bindInfo = packedShader.bindReflection.dataBindings.emplace_back();
+
+                        success = reader.GetBytes(bytes, numBytes);
+                        if (success)
+                        {
+                            bindInfo.name.assign(bytes, numBytes);
+                            success = reader.Get(bindInfo.nameHash) && reader.Get(bindInfo.descriptorType) && reader.Get(bindInfo.set) && reader.Get(bindInfo.binding) && reader.Get(bindInfo.count) && reader.Get(bindInfo.stageFlags);
+                        }
+                    }
+                }
+
+                if (success)
+                {
+                    u32 numPushConstants = 0;
+                    success = reader.Get(numPushConstants);
+
+                    for (u32 j = 0; success && j < numPushConstants; j++)
+                    {
+                        BindInfoPushConstant& pushConstant = packedShader.bindReflection.pushConstants.emplace_back();
+                        success = reader.Get(pushConstant.stageFlags) && reader.Get(pushConstant.offset) && reader.Get(pushConstant.size);
+                    }
+                }
+
+                if (!success)
+                {
+                    NC_LOG_ERROR("Shader pack %s is truncated, falling back to loose shaders", SHADER_PACK_PATH.c_str());
+                    _shaderPack.clear();
+                    _shaderPackDirty = true;
+                    return;
+                }
+
+                _shaderPack[pathHash] = std::move(packedShader);
+            }
+        }
+
+        void ShaderHandlerVK::SaveShaderPack()
+        {
+            if (!_shaderPackDirty)
+                return;
+
+            ShaderPackWriter writer;
+
+            auto writeShader = [&](u32 pathHash, const std::string& path, u64 lastWriteTime, const ShaderBinary& spirv, const BindReflection& bindReflection)
+            {
+                writer.Put(pathHash);
+                writer.PutBytes(path.c_str(), path.length());
+                writer.Put(lastWriteTime);
+                writer.PutBytes(spirv.data(), spirv.size());
+
+                writer.Put(static_cast<u32>(bindReflection.dataBindings.size()));
+                for (const BindInfo& bindInfo : bindReflection.dataBindings)
+                {
+                    writer.PutBytes(bindInfo.name.c_str(), bindInfo.name.length());
+                    writer.Put(bindInfo.nameHash);
+                    writer.Put(bindInfo.descriptorType);
+                    writer.Put(bindInfo.set);
+                    writer.Put(bindInfo.binding);
+                    writer.Put(bindInfo.count);
+                    writer.Put(bindInfo.stageFlags);
+                }
+
+                writer.Put(static_cast<u32>(bindReflection.pushConstants.size()));
+                for (const BindInfoPushConstant& pushConstant : bindReflection.pushConstants)
+                {
+                    writer.Put(pushConstant.stageFlags);
+                    writer.Put(pushConstant.offset);
+                    writer.Put(pushConstant.size);
+                }
+            };
+
+            u32 numShaders = static_cast<u32>(_vertexShaders.size() + _pixelShaders.size() + _computeShaders.size() + _shaderPack.size());
+
+            writer.Put(SHADER_PACK_TOKEN);
+            writer.Put(SHADER_PACK_VERSION);
+            writer.Put(numShaders);
+
+            for (const std::vector<Shader>* shaders : { &_vertexShaders, &_pixelShaders, &_computeShaders })
+            {
+                for (const Shader& shader : *shaders)
+                {
+                    writeShader(shader.pathHash, shader.path, shader.lastWriteTime, shader.spirv, shader.bindReflection);
+                }
+            }
+
+            // Keep the entries we didn't use this session so we don't lose them
+            for (const auto& [pathHash, packedShader] : _shaderPack)
+            {
+                writeShader(pathHash, packedShader.path, packedShader.lastWriteTime, packedShader.spirv, packedShader.bindReflection);
+            }
+
+            std::ofstream file(SHADER_PACK_PATH, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                NC_LOG_ERROR("Failed to write shader pack %s", SHADER_PACK_PATH.c_str());
+                return;
+            }
+
+            file.write(writer.data.data(), writer.data.size());
+            file.close();
+
+            _shaderPackDirty = false;
+        }
+
+        bool ShaderHandlerVK::TryLoadFromShaderPack(Shader& shader)
+        {
+            auto itr = _shaderPack.find(shader.pathHash);
+            if (itr == _shaderPack.end())
+                return false;
+
+            PackedShader& packedShader = itr->second;
+
+            // If the loose .spv is newer than what we cooked, it has been recompiled since and the pack entry is stale
+            // If it doesn't exist at all we are running from the pack alone which is fine
+            u64 lastWriteTime = GetLastWriteTime(shader.path);
+            if (lastWriteTime != 0 && lastWriteTime != packedShader.lastWriteTime)
+            {
+                _shaderPack.erase(itr);
+                return false;
+            }
+
+            shader.lastWriteTime = packedShader.lastWriteTime;
+            shader.spirv = std::move(packedShader.spirv);
+            shader.bindReflection = std::move(packedShader.bindReflection);
+
+            _shaderPack.erase(itr);
+            return true;
+        }
+
+        void ShaderHandlerVK::ReflectShader(Shader& shader)
+        {
+            // Reflect descriptor sets
+            SpvReflectShaderModule reflectModule;
+            SpvReflectResult result = spvReflectCreateShaderModule(shader.spirv.size(), shader.spirv.data(), &reflectModule);
+
+            if (result != SPV_REFLECT_RESULT_SUCCESS)
+            {
+                NC_LOG_FATAL("We failed to reflect the spirv of %s", shader.path.c_str());
+            }
+
+            uint32_t descriptorSetCount = 0;
+            result = spvReflectEnumerateDescriptorSets(&reflectModule, &descriptorSetCount, NULL);
+
+            if (result != SPV_REFLECT_RESULT_SUCCESS)
+            {
+                NC_LOG_FATAL("We failed to reflect the spirv descriptor set count of %s", shader.path.c_str());
+            }
+
+            if (descriptorSetCount > 0)
+            {
+                std::vector<SpvReflectDescriptorSet*> descriptorSets(descriptorSetCount);
+
+                result = spvReflectEnumerateDescriptorSets(&reflectModule, &descriptorSetCount, descriptorSets.data());
+
+                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                {
+                    NC_LOG_FATAL("We failed to reflect the spirv descriptor sets of %s", shader.path.c_str());
+                }
+
+                for (auto* descriptorSet : descriptorSets)
+                {
+                    for (uint32_t binding = 0; binding < descriptorSet->binding_count; binding++)
+                    {
+                        const SpvReflectDescriptorBinding* reflectionBinding = descriptorSet->bindings[binding];
+                        BindInfo bindInfo;
+                        bindInfo.descriptorType = static_cast<VkDescriptorType>(reflectionBinding->descriptor_type);
+                        bindInfo.set = descriptorSet->set;
+                        bindInfo.binding = reflectionBinding->binding;
+                        bindInfo.count = reflectionBinding->count;
+                        bindInfo.stageFlags = static_cast<VkShaderStageFlagBits>(reflectModule.shader_stage);
+
+                        bindInfo.name = reflectionBinding->name;
+                        bindInfo.nameHash = StringUtils::fnv1a_32(bindInfo.name.c_str(), bindInfo.name.length());
+
+                        shader.bindReflection.dataBindings.push_back(bindInfo);
+                    }
+                }
+            }
+
+            uint32_t pushConstantCount = 0;
+            result = spvReflectEnumeratePushConstantBlocks(&reflectModule, &pushConstantCount, NULL);
+
+            if (result != SPV_REFLECT_RESULT_SUCCESS)
+            {
+                NC_LOG_FATAL("We failed to reflect the spirv push constant count of %s", shader.path.c_str());
+            }
+
+            if (pushConstantCount > 0)
+            {
+                std::vector<SpvReflectBlockVariable*> blockVariables(pushConstantCount);
+
+                result = spvReflectEnumeratePushConstantBlocks(&reflectModule, &pushConstantCount, blockVariables.data());
+
+                for (SpvReflectBlockVariable* variable : blockVariables)
+                {
+                    BindInfoPushConstant& pushConstant = shader.bindReflection.pushConstants.emplace_back();
+                    pushConstant.offset = variable->offset;
+                    pushConstant.size = variable->size;
+                    pushConstant.stageFlags = static_cast<VkShaderStageFlagBits>(reflectModule.shader_stage);
+                }
+            }
+
+            spvReflectDestroyShaderModule(&reflectModule);
+        }
+
+        u64 ShaderHandlerVK::GetLastWriteTime(const std::string& path)
+        {
+            std::error_code errorCode;
+            std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(path, errorCode);
+            if (errorCode)
+                return 0;
+
+            return static_cast<u64>(lastWriteTime.time_since_epoch().count());
         }
 
         void ShaderHandlerVK::ReadFile(const std::string& filename, ShaderBinary& binary)
@@ -61,22 +382,5 @@ namespace Renderer
 
             return shaderModule;
         }
-
-        bool ShaderHandlerVK::TryFindExistingShader(const std::string& shaderPath, std::vector<Shader>& shaders, size_t& id)
-        {
-            u32 shaderPathHash = StringUtils::fnv1a_32(shaderPath.c_str(), shaderPath.length());
-
-            id = 0;
-            for (Shader& existingShader : shaders)
-            {
-                if (StringUtils::fnv1a_32(existingShader.path.c_str(), existingShader.path.length()) == shaderPathHash)
-                {
-                    return true;
-                }
-                id++;
-            }
-
-            return false;
-        }
     }
-}
\ No newline at end of file
+}
@@ -3,12 +3,14 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <unordered_map>
+#include <robin_hood.h>
 #include <cassert>
 #include "../../../Descriptors/VertexShaderDesc.h"
 #include "../../../Descriptors/PixelShaderDesc.h"
 #include "../../../Descriptors/ComputeShaderDesc.h"
 #include "SpirvReflect.h"
 #include <Utils/DebugHandler.h>
+#include <Utils/StringUtils.h>
 
 namespace Renderer
 {
@@ -52,6 +54,10 @@ namespace Renderer
         public:
             void Init(RenderDeviceVK* device);
 
+            // The shader pack holds the SPIR-V and reflection data of every shader keyed by path hash, it gets loaded with a single read on Init
+            // and rewritten by SaveShaderPack whenever a shader had to be loaded and reflected from its loose .spv file
+            void SaveShaderPack();
+
             VertexShaderID LoadShader(const VertexShaderDesc& desc);
             PixelShaderID LoadShader(const PixelShaderDesc& desc);
             ComputeShaderID LoadShader(const ComputeShaderDesc& desc);
@@ -77,6 +83,9 @@ namespace Renderer
             struct Shader
             {
                 std::string path;
+                u32 pathHash;
+                u64 lastWriteTime = 0;
+
                 VkShaderModule module;
                 ShaderBinary spirv;
 
@@ -85,104 +94,57 @@ namespace Renderer
 
         private:
             template <typename T>
-            T LoadShader(const std::string& shaderPath, std::vector<Shader>& shaders)
+            T LoadShader(const std::string& shaderPath, std::vector<Shader>& shaders, robin_hood::unordered_map<u32, type_safe::underlying_type<T>>& pathHashToID)
             {
-                size_t id;
                 using idType = type_safe::underlying_type<T>;
+                u32 pathHash = StringUtils::fnv1a_32(shaderPath.c_str(), shaderPath.length());
 
                 // If shader is already loaded, return ID of already loaded version
-                if (TryFindExistingShader(shaderPath, shaders, id))
+                auto itr = pathHashToID.find(pathHash);
+                if (itr != pathHashToID.end())
                 {
-                    return T(static_cast<idType>(id));
+                    return T(itr->second);
                 }
 
-                id = shaders.size();
+                size_t id = shaders.size();
                 assert(id < T::MaxValue());
 
-                shaders.emplace_back();
-                Shader& shader = shaders.back();
-                ReadFile(shaderPath, shader.spirv);
+                Shader& shader = shaders.emplace_back();
                 shader.path = shaderPath;
-                shader.module = CreateShaderModule(shader.spirv);
-
-                // Reflect descriptor sets
-                SpvReflectShaderModule reflectModule;
-                SpvReflectResult result = spvReflectCreateShaderModule(shader.spirv.size(), shader.spirv.data(), &reflectModule);
+                shader.pathHash = pathHash;
 
-                if (result != SPV_REFLECT_RESULT_SUCCESS)
+                // Prefer the cooked shader pack, it already contains the reflection data so we only need to fall back to the loose .spv and spirv_reflect on a miss
+                if (!TryLoadFromShaderPack(shader))
                 {
-                    NC_LOG_FATAL("We failed to reflect the spirv of %s", shaderPath.c_str());
-                }
-
-                uint32_t descriptorSetCount = 0;
-                result = spvReflectEnumerateDescriptorSets(&reflectModule, &descriptorSetCount, NULL);
+                    ReadFile(shaderPath, shader.spirv);
+                    ReflectShader(shader);
+                    shader.lastWriteTime = GetLastWriteTime(shaderPath);
 
-                if (result != SPV_REFLECT_RESULT_SUCCESS)
-                {
-                    NC_LOG_FATAL("We failed to reflect the spirv descriptor set count of %s", shaderPath.c_str());
+                    _shaderPackDirty = true;
                 }
 
-                
-                if (descriptorSetCount > 0)
-                {
-                    std::vector<SpvReflectDescriptorSet*> descriptorSets(descriptorSetCount);
-                    
-                    result = spvReflectEnumerateDescriptorSets(&reflectModule, &descriptorSetCount, descriptorSets.data());
-
-                    if (result != SPV_REFLECT_RESULT_SUCCESS)
-                    {
-                        NC_LOG_FATAL("We failed to reflect the spirv descriptor sets of %s", shaderPath.c_str());
-                    }
-
-                    for (auto* descriptorSet : descriptorSets)
-                    {
-                        for (uint32_t binding = 0; binding < descriptorSet->binding_count; binding++)
-                        {
-                            const SpvReflectDescriptorBinding* reflectionBinding = descriptorSet->bindings[binding];
-                            BindInfo bindInfo;
-                            bindInfo.descriptorType = static_cast<VkDescriptorType>(reflectionBinding->descriptor_type);
-                            bindInfo.set = descriptorSet->set;
-                            bindInfo.binding = reflectionBinding->binding;
-                            bindInfo.count = reflectionBinding->count;
-                            bindInfo.stageFlags = static_cast<VkShaderStageFlagBits>(reflectModule.shader_stage);
-
-                            bindInfo.name = reflectionBinding->name;
-                            bindInfo.nameHash = StringUtils::fnv1a_32(bindInfo.name.c_str(), bindInfo.name.length());
-
-                            shader.bindReflection.dataBindings.push_back(bindInfo);
-                        }
-                    }
-                }
-
-                uint32_t pushConstantCount = 0;
-                result = spvReflectEnumeratePushConstantBlocks(&reflectModule, &pushConstantCount, NULL);
-
-                if (result != SPV_REFLECT_RESULT_SUCCESS)
-                {
-                    NC_LOG_FATAL("We failed to reflect the spirv push constant count of %s", shaderPath.c_str());
-                }
-
-                if (pushConstantCount > 0)
-                {
-                    std::vector<SpvReflectBlockVariable*> blockVariables(pushConstantCount);
-
-                    result = spvReflectEnumeratePushConstantBlocks(&reflectModule, &pushConstantCount, blockVariables.data());
+                shader.module = CreateShaderModule(shader.spirv);
 
-                    for (SpvReflectBlockVariable* variable : blockVariables)
-                    {
-                        BindInfoPushConstant& pushConstant = shader.bindReflection.pushConstants.emplace_back();
-                        pushConstant.offset = variable->offset;
-                        pushConstant.size = variable->size;
-                        pushConstant.stageFlags = static_cast<VkShaderStageFlagBits>(reflectModule.shader_stage);
-                    }
-                }
-                
+                pathHashToID[pathHash] = static_cast<idType>(id);
                 return T(static_cast<idType>(id));
             }
-            
+
+            void LoadShaderPack();
+            bool TryLoadFromShaderPack(Shader& shader);
+            void ReflectShader(Shader& shader);
+            u64 GetLastWriteTime(const std::string& path);
+
             void ReadFile(const std::string& filename, ShaderBinary& binary);
             VkShaderModule CreateShaderModule(const ShaderBinary& binary);
-            bool TryFindExistingShader(const std::string& shaderPath, std::vector<Shader>& shaders, size_t& id);
+
+        private:
+            struct PackedShader
+            {
+                std::string path;
+                u64 lastWriteTime;
+                ShaderBinary spirv;
+                BindReflection bindReflection;
+            };
 
         private:
             RenderDeviceVK* _device;
@@ -190,6 +152,13 @@ namespace Renderer
             std::vector<Shader> _vertexShaders;
             std::vector<Shader> _pixelShaders;
             std::vector<Shader> _computeShaders;
+
+            robin_hood::unordered_map<u32, vsIDType> _vertexShaderPathHashToID;
+            robin_hood::unordered_map<u32, psIDType> _pixelShaderPathHashToID;
+            robin_hood::unordered_map<u32, csIDType> _computeShaderPathHashToID;
+
+            robin_hood::unordered_map<u32, PackedShader> _shaderPack; // Entries are moved out of here once they get loaded
+            bool _shaderPackDirty = false;
         };
     }
 }
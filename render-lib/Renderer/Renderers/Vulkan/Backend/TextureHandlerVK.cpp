@@ -43,45 +43,52 @@ namespace Renderer
         TextureID TextureHandlerVK::LoadTexture(const TextureDesc& desc)
         {
             // Check the cache, we only want to do this for LOADED textures though, never CREATED data textures
-            size_t nextID;
+            TextureID existingID;
             u64 cacheDescHash = CalculateDescHash(desc);
-            if (TryFindExistingTexture(cacheDescHash, nextID))
+            if (TryFindExistingTexture(cacheDescHash, existingID))
             {
-                TextureID::type id = static_cast<TextureID::type>(nextID);
-                Texture& texture = _textures[id];
-                if (texture.loaded)
-                {
-                    return TextureID(id); // We already loaded this texture
-                }
+                return existingID; // We already loaded this texture
             }
 
             // TODO: Check the clearlist before allocating a new one
 
-            size_t nextHandle = _textures.size();
+            size_t nextHandle;
+            const bool didEmplace = _textures.Emplace(nextHandle, [&](Texture& texture)
+            {
+                texture.loaded = true;
+                texture.hash = cacheDescHash;
+                texture.debugName = desc.path;
+
+                texture.textureIndex = static_cast<TextureID::type>(nextHandle);
 
-            // Make sure we haven't exceeded the limit of the ImageID type, if this hits you need to change type of ImageID to something bigger
-            if (nextHandle >= TextureID::MaxValue())
+                u8* pixels;
+                pixels = ReadFile(desc.path, texture.width, texture.height, texture.layers, texture.mipLevels, texture.format, texture.fileSize);
+                if (!pixels)
+                {
+                    NC_LOG_FATAL("Failed to load texture! (%s)", desc.path.c_str());
+                }
+
+                CreateTexture(texture, pixels);
+            });
+
+            // Make sure we haven't exceeded the limit of the TextureID type, if this hits you need to change type of TextureID to something bigger
+            if (!didEmplace)
             {
                 NC_LOG_FATAL("We exceeded the limit of the TextureID type!");
             }
-            
-            Texture texture;
-            texture.hash = cacheDescHash;
-            texture.debugName = desc.path;
 
-            texture.textureIndex = static_cast<TextureID::type>(nextHandle);
+            TextureID textureID = TextureID(static_cast<TextureID::type>(nextHandle));
 
-            u8* pixels;
-            pixels = ReadFile(desc.path, texture.width, texture.height, texture.layers, texture.mipLevels, texture.format, texture.fileSize);
-            if (!pixels)
+            // Another thread might have loaded the same texture while we were busy, if so we throw ours away and use theirs
+            if (!_textureHashToID.TryEmplace(cacheDescHash, textureID, existingID))
             {
-                NC_LOG_FATAL("Failed to load texture! (%s)", desc.path.c_str());
-            }
+                _textures.Get(nextHandle).hash = 0;
+                UnloadTexture(textureID);
 
-            CreateTexture(texture, pixels);
+                return existingID;
+            }
 
-            _textures.push_back(texture);
-            return TextureID(static_cast<TextureID::type>(nextHandle));
+            return textureID;
         }
 
         TextureID TextureHandlerVK::LoadTextureIntoArray(const TextureDesc& desc, TextureArrayID textureArrayID, u32& arrayIndex)
@@ -103,35 +110,42 @@ namespace Renderer
                 return textureID; // This texture already exists in this array
             }
 
-            TextureArrayID::type id = static_cast<TextureArrayID::type>(textureArrayID);
+            // Otherwise load it, this happens outside of the array lock so loads into the same array don't serialize on file IO
+            textureID = LoadTexture(desc);
 
-            // Otherwise load it
-            if (id >= _textureArrays.size())
+            TextureArray& textureArray = _textureArrays.Get(static_cast<TextureArrayID::type>(textureArrayID));
+            std::scoped_lock lock(textureArray.mutex);
+
+            // Another thread might have added it while we were loading
+            auto itr = textureArray.hashToArrayIndex.find(descHash);
+            if (itr != textureArray.hashToArrayIndex.end())
             {
-                NC_LOG_FATAL("Tried to load into a TextureArrayID which doesn't exist! (%u)", id);
+                arrayIndex = itr->second;
+                return textureArray.textures[arrayIndex];
             }
 
-            textureID = LoadTexture(desc);
-
-            Texture& texture = _textures[static_cast<TextureID::type>(textureID)];
-
-            TextureArray& textureArray = _textureArrays[static_cast<TextureArrayID::type>(textureArrayID)];
             arrayIndex = static_cast<u32>(textureArray.textures.size());
             textureArray.textures.push_back(textureID);
             textureArray.textureHashes.push_back(descHash);
+            textureArray.hashToArrayIndex[descHash] = arrayIndex;
 
             return textureID;
         }
 
         void TextureHandlerVK::UnloadTexture(const TextureID textureID)
         {
-            Texture& texture = _textures[static_cast<TextureID::type>(textureID)];
+            Texture& texture = _textures.Get(static_cast<TextureID::type>(textureID));
 
             if (!texture.loaded)
             {
                 return;
             }
 
+            if (texture.hash != 0)
+            {
+                _textureHashToID.Erase(texture.hash);
+            }
+
             texture.loaded = false;
             texture.hash = 0;
 
@@ -139,16 +153,19 @@ namespace Renderer
             vkDestroyImage(_device->_device, texture.image, nullptr);
             vkDestroyImageView(_device->_device, texture.imageView, nullptr);
 
+            std::scoped_lock lock(_freeTextureMutex);
             _freeTextureQueue.push(&texture);
         }
 
         void TextureHandlerVK::UnloadTexturesInArray(const TextureArrayID textureArrayID, u32 unloadStartIndex)
         {
-            TextureArray& textureArray = _textureArrays[static_cast<TextureArrayID::type>(textureArrayID)];
+            TextureArray& textureArray = _textureArrays.Get(static_cast<TextureArrayID::type>(textureArrayID));
+            std::scoped_lock lock(textureArray.mutex);
 
             for (u32 i = unloadStartIndex; i < textureArray.textures.size(); i++)
             {
                 UnloadTexture(textureArray.textures[i]);
+                textureArray.hashToArrayIndex.erase(textureArray.textureHashes[i]);
             }
 
             textureArray.textureHashes.resize(unloadStartIndex);
@@ -162,19 +179,21 @@ namespace Renderer
                 NC_LOG_FATAL("Tried to create a texture array with a size of zero!");
             }
 
-            size_t nextHandle = _textureArrays.size();
+            size_t nextHandle;
+            const bool didEmplace = _textureArrays.Emplace(nextHandle, [&](TextureArray& textureArray)
+            {
+                textureArray.textures.reserve(desc.size);
+                textureArray.textureHashes.reserve(desc.size);
+                textureArray.hashToArrayIndex.reserve(desc.size);
+                textureArray.size = desc.size;
+            });
 
             // Make sure we haven't exceeded the limit of the TextureArrayID type, if this hits you need to change type of TextureArrayID to something bigger
-            if (nextHandle >= TextureArrayID::MaxValue())
+            if (!didEmplace)
             {
                 NC_LOG_FATAL("We exceeded the limit of the TextureArrayID type!");
             }
 
-            TextureArray textureArray;
-            textureArray.textures.reserve(desc.size);
-            textureArray.size = desc.size;
-
-            _textureArrays.push_back(textureArray);
             return TextureArrayID(static_cast<TextureArrayID::type>(nextHandle));
         }
 
@@ -190,41 +209,44 @@ namespace Renderer
                 NC_LOG_FATAL("Tried to create a DataTexture with the data being a nullptr! (%s)", desc.debugName.c_str());
             }
 
-            size_t nextHandle = _textures.size();
-
-            if (nextHandle >= TextureID::MaxValue())
+            size_t nextHandle;
+            const bool didEmplace = _textures.Emplace(nextHandle, [&](Texture& texture)
+            {
+                texture.loaded = true;
+                texture.hash = 0;
+                texture.debugName = desc.debugName;
+                texture.textureIndex = static_cast<TextureID::type>(nextHandle);
+
+                texture.width = desc.width;
+                texture.height = desc.height;
+                texture.layers = desc.layers;
+                texture.mipLevels = 1;
+                texture.format = FormatConverterVK::ToVkFormat(desc.format);
+                texture.fileSize = Math::RoofToInt(static_cast<f64>(texture.width) * static_cast<f64>(texture.height) * static_cast<f64>(texture.layers) * FormatTexelSize(texture.format));
+
+                CreateTexture(texture, desc.data);
+            });
+
+            if (!didEmplace)
             {
                 NC_LOG_FATAL("We exceeded the limit of the TextureID type!");
             }
 
-            Texture texture;
-            texture.debugName = desc.debugName;
-
-            texture.width = desc.width;
-            texture.height = desc.height;
-            texture.layers = desc.layers;
-            texture.mipLevels = 1;
-            texture.format = FormatConverterVK::ToVkFormat(desc.format);
-            texture.fileSize = Math::RoofToInt(static_cast<f64>(texture.width) * static_cast<f64>(texture.height) * static_cast<f64>(texture.layers) * FormatTexelSize(texture.format));
-
-            CreateTexture(texture, desc.data);
-
-            _textures.push_back(texture);
             return TextureID(static_cast<TextureID::type>(nextHandle));
         }
 
         TextureID TextureHandlerVK::CreateDataTextureIntoArray(const DataTextureDesc& desc, TextureArrayID textureArrayID, u32& arrayIndex)
         {
-            if (static_cast<TextureArrayID::type>(textureArrayID) >= _textureArrays.size())
+            if (!_textureArrays.IsCommitted(static_cast<TextureArrayID::type>(textureArrayID)))
             {
                 NC_LOG_FATAL("Tried to create DataTexture (%s) into invalid array", desc.debugName.c_str());
             }
 
             TextureID textureID = CreateDataTexture(desc);
 
-            Texture& texture = _textures[static_cast<TextureID::type>(textureID)];
+            TextureArray& textureArray = _textureArrays.Get(static_cast<TextureArrayID::type>(textureArrayID));
+            std::scoped_lock lock(textureArray.mutex);
 
-            TextureArray& textureArray = _textureArrays[static_cast<TextureArrayID::type>(textureArrayID)];
             arrayIndex = static_cast<u32>(textureArray.textures.size());
             textureArray.textures.push_back(textureID);
             textureArray.textureHashes.push_back(0);
@@ -232,17 +254,21 @@ namespace Renderer
             return textureID;
         }
 
-        const std::vector<TextureID>& TextureHandlerVK::GetTextureIDsInArray(const TextureArrayID textureArrayID)
+        std::vector<TextureID> TextureHandlerVK::GetTextureIDsInArray(const TextureArrayID textureArrayID)
         {
             TextureArrayID::type id = static_cast<TextureArrayID::type>(textureArrayID);
 
             // Lets make sure this id exists
-            if (_textureArrays.size() <= id)
+            if (!_textureArrays.IsCommitted(id))
             {
                 NC_LOG_FATAL("Tried to access invalid TextureArrayID: %u", id);
             }
 
-            return _textureArrays[static_cast<TextureArrayID::type>(textureArrayID)].textures;
+            // Loader threads keep adding to the array, so the caller gets a copy of how it looks right now
+            TextureArray& textureArray = _textureArrays.Get(id);
+            std::scoped_lock lock(textureArray.mutex);
+
+            return textureArray.textures;
         }
 
         bool TextureHandlerVK::IsOnionTexture(const TextureID textureID)
@@ -250,12 +276,12 @@ namespace Renderer
             TextureID::type id = static_cast<TextureID::type>(textureID);
 
             // Lets make sure this id exists
-            if (_textures.size() <= id)
+            if (!_textures.IsCommitted(id))
             {
                 NC_LOG_FATAL("Tried to access invalid TextureID: %u", id);
             }
 
-            return _textures[static_cast<TextureID::type>(textureID)].layers != 1;
+            return _textures.Get(id).layers != 1;
         }
 
         VkImageView TextureHandlerVK::GetImageView(const TextureID textureID)
@@ -263,12 +289,12 @@ namespace Renderer
             TextureID::type id = static_cast<TextureID::type>(textureID);
 
             // Lets make sure this id exists
-            if (_textures.size() <= id)
+            if (!_textures.IsCommitted(id))
             {
                 NC_LOG_FATAL("Tried to access invalid TextureID: %u", id);
             }
 
-            return _textures[static_cast<TextureID::type>(textureID)].imageView;
+            return _textures.Get(id).imageView;
         }
 
         VkImageView TextureHandlerVK::GetDebugTextureImageView()
@@ -286,12 +312,12 @@ namespace Renderer
             TextureArrayID::type id = static_cast<TextureArrayID::type>(textureArrayID);
 
             // Lets make sure this id exists
-            if (_textureArrays.size() <= id)
+            if (!_textureArrays.IsCommitted(id))
             {
                 NC_LOG_FATAL("Tried to access invalid TextureArrayID: %u", id);
             }
 
-            return _textureArrays[static_cast<TextureArrayID::type>(textureArrayID)].size;
+            return _textureArrays.Get(id).size;
         }
 
         u64 TextureHandlerVK::CalculateDescHash(const TextureDesc& desc)
@@ -300,42 +326,29 @@ namespace Renderer
             return hash;
         }
 
-        bool TextureHandlerVK::TryFindExistingTexture(u64 descHash, size_t& id)
+        bool TextureHandlerVK::TryFindExistingTexture(u64 descHash, TextureID& textureID)
         {
-            id = 0;
-
-            for (auto& texture : _textures)
-            {
-                if (descHash == texture.hash)
-                {
-                    return true;
-                }
-                id++;
-            }
-
-            return false;
+            return _textureHashToID.TryGet(descHash, textureID);
         }
 
         bool TextureHandlerVK::TryFindExistingTextureInArray(TextureArrayID textureArrayID, u64 descHash, size_t& arrayIndex, TextureID& textureID)
         {
             TextureArrayID::type id = static_cast<TextureArrayID::type>(textureArrayID);
-            if (_textureArrays.size() <= id)
+            if (!_textureArrays.IsCommitted(id))
             {
                 NC_LOG_FATAL("Tried to access invalid TextureArrayID: %u", id);
             }
 
-            TextureArray& array = _textureArrays[id];
+            TextureArray& array = _textureArrays.Get(id);
+            std::scoped_lock lock(array.mutex);
 
-            for (arrayIndex = 0; arrayIndex < array.textureHashes.size(); arrayIndex++)
-            {
-                if (descHash == array.textureHashes[arrayIndex])
-                {
-                    textureID = array.textures[arrayIndex];
-                    return true;
-                }
-            }
+            auto itr = array.hashToArrayIndex.find(descHash);
+            if (itr == array.hashToArrayIndex.end())
+                return false;
 
-            return false;
+            arrayIndex = itr->second;
+            textureID = array.textures[arrayIndex];
+            return true;
         }
 
         u8* TextureHandlerVK::ReadFile(const std::string& filename, i32& width, i32& height, i32& layers, i32& mipLevels, VkFormat& format, size_t& fileSize)
@@ -2,12 +2,14 @@
 #include <NovusTypes.h>
 #include <vector>
 #include <queue>
+#include <mutex>
 
 #include <vulkan/vulkan.h>
 #include "vk_mem_alloc.h"
 
 #include "../../../Descriptors/TextureDesc.h"
 #include "../../../Descriptors/TextureArrayDesc.h"
+#include "ConcurrentStorageVK.h"
 
 namespace Renderer
 {
@@ -34,7 +36,7 @@ namespace Renderer
             TextureID CreateDataTexture(const DataTextureDesc& desc);
             TextureID CreateDataTextureIntoArray(const DataTextureDesc& desc, TextureArrayID textureArrayID, u32& arrayIndex);
 
-            const std::vector<TextureID>& GetTextureIDsInArray(const TextureArrayID textureID);
+            std::vector<TextureID> GetTextureIDsInArray(const TextureArrayID textureID);
 
             bool IsOnionTexture(const TextureID textureID);
 
@@ -69,14 +71,16 @@ namespace Renderer
 
             struct TextureArray
             {
+                std::mutex mutex; // Guards textures and textureHashes, loaders add textures to the same arrays from several threads
                 u32 size;
                 std::vector<TextureID> textures;
                 std::vector<u64> textureHashes;
+                robin_hood::unordered_map<u64, u32> hashToArrayIndex;
             };
 
         private:
             u64 CalculateDescHash(const TextureDesc& desc);
-            bool TryFindExistingTexture(u64 descHash, size_t& id);
+            bool TryFindExistingTexture(u64 descHash, TextureID& textureID);
             bool TryFindExistingTextureInArray(TextureArrayID textureArrayID, u64 descHash, size_t& arrayIndex, TextureID& textureID);
 
             u8* ReadFile(const std::string& filename, i32& width, i32& height, i32& layers, i32& mipLevels, VkFormat& format, size_t& fileSize);
@@ -89,10 +93,14 @@ namespace Renderer
             TextureID _debugTexture;
             TextureID _debugOnionTexture; // "TextureArrays" using texture layers rather than arrays of descriptors are now called Onion Textures to make it possible to differentiate between them...
 
-            std::vector<Texture> _textures;
+            // Textures and texture arrays can be created from any thread, lookups by ID never take a lock
+            PagedStorageVK<Texture, std::numeric_limits<TextureID::type>::max()> _textures;
+            ShardedHashMapVK<u64, TextureID> _textureHashToID;
+
+            std::mutex _freeTextureMutex;
             std::queue<Texture*> _freeTextureQueue;
 
-            std::vector<TextureArray> _textureArrays;
+            PagedStorageVK<TextureArray, std::numeric_limits<TextureArrayID::type>::max(), 64> _textureArrays;
         };
     }
 }
\ No newline at end of file
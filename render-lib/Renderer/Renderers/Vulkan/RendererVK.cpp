@@ -72,6 +72,8 @@ namespace Renderer
     {
         _device->FlushGPU(); // Make sure it has finished rendering
 
+        _shaderHandler->SaveShaderPack(); // Cook any shaders we had to load from loose files into the pack for next startup
+
         delete(_device);
         delete(_bufferHandler);
         delete(_imageHandler);
@@ -91,6 +93,7 @@ namespace Renderer
 
     void RendererVK::QueueDestroyBuffer(BufferID buffer)
     {
+        std::scoped_lock lock(_destroyListMutex);
         _destroyLists[_destroyListIndex].buffers.push_back(buffer);
     }
 
@@ -624,7 +627,7 @@ namespace Renderer
         }
         else if (descriptor.descriptorType == DescriptorType::DESCRIPTOR_TYPE_TEXTURE_ARRAY)
         {
-            const std::vector<TextureID>& textureIDs = _textureHandler->GetTextureIDsInArray(descriptor.textureArrayID);
+            const std::vector<TextureID> textureIDs = _textureHandler->GetTextureIDsInArray(descriptor.textureArrayID);
             std::vector<VkDescriptorImageInfo>& imageInfos = imageInfosArrays.emplace_back();
 
             u32 textureArraySize = _textureHandler->GetTextureArraySize(descriptor.textureArrayID);
@@ -674,6 +677,47 @@ namespace Renderer
 
             builder->BindBuffer(descriptor.nameHash, bufferInfo);
         }
+        else if (descriptor.descriptorType == DescriptorType::DESCRIPTOR_TYPE_IMAGE)
+        {
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL; // Color images live in GENERAL outside of renderpasses
+            imageInfo.imageView = _imageHandler->GetColorView(descriptor.imageID);
+
+            builder->BindImage(descriptor.nameHash, imageInfo);
+        }
+        else if (descriptor.descriptorType == DescriptorType::DESCRIPTOR_TYPE_DEPTH_IMAGE)
+        {
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = _imageHandler->GetDepthView(descriptor.depthImageID);
+
+            builder->BindImage(descriptor.nameHash, imageInfo);
+        }
+        else if (descriptor.descriptorType == DescriptorType::DESCRIPTOR_TYPE_STORAGE_IMAGE)
+        {
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            imageInfo.imageView = _imageHandler->GetColorView(descriptor.imageID, descriptor.imageMipLevel);
+
+            builder->BindStorageImage(descriptor.nameHash, imageInfo);
+        }
+        else if (descriptor.descriptorType == DescriptorType::DESCRIPTOR_TYPE_STORAGE_IMAGE_ARRAY)
+        {
+            std::vector<VkDescriptorImageInfo>& imageInfos = imageInfosArrays.emplace_back();
+
+            u32 numMipLevels = _imageHandler->GetNumMipLevels(descriptor.imageID);
+            imageInfos.reserve(numMipLevels);
+
+            for (u32 i = 0; i < numMipLevels; i++)
+            {
+                VkDescriptorImageInfo& imageInfo = imageInfos.emplace_back();
+                imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                imageInfo.imageView = _imageHandler->GetColorView(descriptor.imageID, i);
+                imageInfo.sampler = VK_NULL_HANDLE;
+            }
+
+            builder->BindStorageImageArray(descriptor.nameHash, imageInfos);
+        }
     }
 
     void RendererVK::RecreateSwapChain(Backend::SwapChainVK* swapChain)
@@ -685,6 +729,8 @@ namespace Renderer
 
     void RendererVK::DestroyObjects(ObjectDestroyList& destroyList)
     {
+        std::scoped_lock lock(_destroyListMutex);
+
         for (const BufferID buffer : destroyList.buffers)
         {
             _bufferHandler->DestroyBuffer(buffer);
@@ -880,11 +926,136 @@ namespace Renderer
             bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
             bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
             break;
+
+        case PipelineBarrierType::ShaderReadToTransferDest:
+            srcStageMask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            bufferBarrier.srcAccessMask = 0; // Reads don't need to be made visible, the execution dependency is enough
+            bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            break;
+
+        case PipelineBarrierType::TransferDestToShaderRead:
+            srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            break;
+
+        case PipelineBarrierType::ComputeWriteToTransferSource:
+            srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            break;
+
+        case PipelineBarrierType::TransferDestToHostRead:
+            srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_HOST_BIT;
+            bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            break;
+
+        default:
+            NC_LOG_FATAL("Tried to use an unsupported PipelineBarrierType on a buffer");
+            return;
         }
 
         vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
     }
 
+    void RendererVK::PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, ImageID image)
+    {
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+
+        VkPipelineStageFlags srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        VkPipelineStageFlags dstStageMask;
+
+        // Color images stay in GENERAL so this never needs a layout transition
+        VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        imageBarrier.image = _imageHandler->GetImage(image);
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        switch (type)
+        {
+        case PipelineBarrierType::ComputeWriteToVertexShaderRead:
+            dstStageMask = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+            break;
+
+        case PipelineBarrierType::ComputeWriteToPixelShaderRead:
+            dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            break;
+
+        case PipelineBarrierType::ComputeWriteToComputeShaderRead:
+            dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            break;
+
+        case PipelineBarrierType::PixelShaderReadToComputeWrite:
+            srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            imageBarrier.srcAccessMask = 0; // Reads don't need to be made visible, the execution dependency is enough
+            imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            break;
+
+        default:
+            NC_LOG_FATAL("Tried to use an unsupported PipelineBarrierType on an image");
+            return;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+    }
+
+    void RendererVK::PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, DepthImageID image)
+    {
+        VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
+
+        VkPipelineStageFlags srcStageMask;
+        VkPipelineStageFlags dstStageMask;
+
+        VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        imageBarrier.image = _imageHandler->GetImage(image);
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.layerCount = 1;
+
+        switch (type)
+        {
+        case PipelineBarrierType::DepthWriteToComputeShaderRead:
+            srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            imageBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            imageBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            imageBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            break;
+
+        case PipelineBarrierType::ComputeShaderReadToDepthWrite:
+            srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            imageBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            imageBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            imageBarrier.srcAccessMask = 0; // Reads don't need to be made visible, the execution dependency is enough
+            imageBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            break;
+
+        default:
+            NC_LOG_FATAL("Tried to use an unsupported PipelineBarrierType on a depth image");
+            return;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+    }
+
     void RendererVK::PushConstant(CommandListID commandListID, void* data, u32 offset, u32 size)
     {
         VkCommandBuffer commandBuffer = _commandListHandler->GetCommandBuffer(commandListID);
@@ -1030,7 +1201,10 @@ namespace Renderer
         presentInfo.pImageIndices = &frameIndex;
         presentInfo.pResults = nullptr; // Optional
 
-        result = vkQueuePresentKHR(_device->_presentQueue, &presentInfo);
+        {
+            std::scoped_lock lock(_device->_queueMutex);
+            result = vkQueuePresentKHR(_device->_presentQueue, &presentInfo);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
         {
@@ -1047,7 +1221,10 @@ namespace Renderer
         // Flip frameIndex between 0 and 1
         swapChain->frameIndex = !swapChain->frameIndex;
 
-        _destroyListIndex = (_destroyListIndex + 1) % _destroyLists.size();
+        {
+            std::scoped_lock lock(_destroyListMutex);
+            _destroyListIndex = (_destroyListIndex + 1) % _destroyLists.size();
+        }
         DestroyObjects(_destroyLists[_destroyListIndex]);
     }
 
@@ -1062,7 +1239,22 @@ namespace Renderer
         VkBuffer vkSrcBuffer = _bufferHandler->GetBuffer(srcBuffer);
         _device->CopyBuffer(vkDstBuffer, dstOffset, vkSrcBuffer, srcOffset, range);
 
-        DestroyObjects(_destroyLists[_destroyListIndex]);
+        // The copy has finished at this point, so if the source was a staging buffer queued for destruction we can free it right away.
+        // We only touch our own source buffer since other threads might still be waiting to copy from theirs
+        std::scoped_lock lock(_destroyListMutex);
+
+        std::vector<BufferID>& buffers = _destroyLists[_destroyListIndex].buffers;
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            if (buffers[i] == srcBuffer)
+            {
+                _bufferHandler->DestroyBuffer(srcBuffer);
+
+                buffers[i] = buffers.back();
+                buffers.pop_back();
+                break;
+            }
+        }
     }
 
     void* RendererVK::MapBuffer(BufferID buffer)
@@ -1081,6 +1273,16 @@ namespace Renderer
         vmaUnmapMemory(_device->_allocator, _bufferHandler->GetBufferAllocation(buffer));
     }
 
+    uvec2 RendererVK::GetImageDimensions(ImageID imageID, u32 mipLevel)
+    {
+        return _imageHandler->GetDimensions(imageID, mipLevel);
+    }
+
+    u32 RendererVK::GetImageNumMipLevels(ImageID imageID)
+    {
+        return _imageHandler->GetNumMipLevels(imageID);
+    }
+
     size_t RendererVK::GetVRAMUsage()
     {
         size_t usage = sBudgets[0].usage;
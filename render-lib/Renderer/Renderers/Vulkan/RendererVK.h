@@ -2,6 +2,7 @@
 #include "../../Renderer.h"
 
 #include <array>
+#include <mutex>
 
 struct VkDescriptorSetLayoutBinding;
 
@@ -102,6 +103,8 @@ namespace Renderer
         void AddWaitSemaphore(CommandListID commandListID, GPUSemaphoreID semaphoreID) override;
         void CopyBuffer(CommandListID commandListID, BufferID dstBuffer, u64 dstOffset, BufferID srcBuffer, u64 srcOffset, u64 range) override;
         void PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, BufferID buffer) override;
+        void PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, ImageID image) override;
+        void PipelineBarrier(CommandListID commandListID, PipelineBarrierType type, DepthImageID image) override;
         void PushConstant(CommandListID commandListID, void* data, u32 offset, u32 size) override;
 
         // Non-commandlist based present functions
@@ -115,6 +118,9 @@ namespace Renderer
         void* MapBuffer(BufferID buffer) override;
         void UnmapBuffer(BufferID buffer) override;
 
+        uvec2 GetImageDimensions(ImageID imageID, u32 mipLevel = 0) override;
+        u32 GetImageNumMipLevels(ImageID imageID) override;
+
         size_t GetVRAMUsage() override;
         size_t GetVRAMBudget() override;
 
@@ -152,6 +158,7 @@ namespace Renderer
 
         std::array<ObjectDestroyList, 4> _destroyLists;
         size_t _destroyListIndex = 0;
+        std::mutex _destroyListMutex; // Buffers can be queued for destruction from loader threads
 
         void DestroyObjects(ObjectDestroyList& destroyList);
     };
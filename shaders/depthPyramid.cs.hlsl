@@ -0,0 +1,188 @@
+#include "depthPyramid.inc.hlsl"
+
+// Builds the whole min/max pyramid in a single dispatch
+// Every group reduces a 64x64 tile of mip 0 down to mip 6, the last group to finish then reduces mip 6 down to the last mip
+#define TILE_SIZE 64
+#define NUM_THREADS 256
+
+struct Constants
+{
+    uint numMips;
+    uint numWorkGroups;
+};
+
+[[vk::binding(0, PER_PASS)]] Texture2D<float> _depth;
+[[vk::binding(1, PER_PASS)]] globallycoherent RWTexture2D<float2> _pyramid[DEPTH_PYRAMID_MAX_MIPS];
+[[vk::binding(2, PER_PASS)]] globallycoherent RWByteAddressBuffer _atomicCounter;
+[[vk::binding(3, PER_PASS)]] ConstantBuffer<Constants> _constants;
+
+groupshared float2 _intermediate[16][16];
+groupshared uint _isLastGroup;
+
+// Texels outside of the image use (1, 0) which leaves both min and max untouched
+static const float2 NEUTRAL_DEPTH = float2(1.0f, 0.0f);
+
+float2 Reduce(float2 a, float2 b, float2 c, float2 d)
+{
+    return float2(min(min(a.x, b.x), min(c.x, d.x)), max(max(a.y, b.y), max(c.y, d.y)));
+}
+
+uint2 GetMipSize(uint2 baseSize, uint mip)
+{
+    return max(baseSize >> mip, uint2(1, 1));
+}
+
+void StoreMip(uint mip, uint2 texel, float2 value, uint2 baseSize)
+{
+    if (mip < _constants.numMips && all(texel < GetMipSize(baseSize, mip)))
+    {
+        _pyramid[mip][texel] = value;
+    }
+}
+
+float2 LoadMip(uint mip, uint2 texel, uint2 baseSize)
+{
+    if (all(texel < GetMipSize(baseSize, mip)))
+    {
+        return _pyramid[mip][texel];
+    }
+
+    return NEUTRAL_DEPTH;
+}
+
+// Mip 0 is smaller than the depth buffer so a texel covers between 1 and 2 depth texels per axis, walk the whole footprint to stay conservative
+float2 LoadDepthFootprint(uint2 texel, uint2 depthSize, uint2 baseSize)
+{
+    const uint2 start = (texel * depthSize) / baseSize;
+    const uint2 end = min(((texel + 1) * depthSize + baseSize - 1) / baseSize, depthSize);
+
+    float2 result = NEUTRAL_DEPTH;
+    for (uint y = start.y; y < end.y; y++)
+    {
+        for (uint x = start.x; x < end.x; x++)
+        {
+            const float depth = _depth.Load(int3(x, y, 0));
+            result = float2(min(result.x, depth), max(result.y, depth));
+        }
+    }
+
+    return result;
+}
+
+// _intermediate holds a 16x16 block of mip (firstMip - 1), reduce it through groupshared memory into the next four mips
+void DownsampleGroupShared(uint firstMip, uint2 groupID, uint2 threadCoord, uint2 baseSize)
+{
+    uint size = 8;
+
+    [unroll]
+    for (uint i = 0; i < 4; i++)
+    {
+        const uint mip = firstMip + i;
+        const bool active = all(threadCoord < size);
+
+        float2 value = NEUTRAL_DEPTH;
+        if (active)
+        {
+            const uint2 src = threadCoord * 2;
+            value = Reduce(_intermediate[src.y][src.x], _intermediate[src.y][src.x + 1], _intermediate[src.y + 1][src.x], _intermediate[src.y + 1][src.x + 1]);
+
+            StoreMip(mip, groupID * (TILE_SIZE >> mip) + threadCoord, value, baseSize);
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        if (active)
+        {
+            _intermediate[threadCoord.y][threadCoord.x] = value;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        size /= 2;
+    }
+}
+
+[numthreads(NUM_THREADS, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint localIndex : SV_GroupIndex)
+{
+    uint2 baseSize;
+    _pyramid[0].GetDimensions(baseSize.x, baseSize.y);
+
+    uint2 depthSize;
+    _depth.GetDimensions(depthSize.x, depthSize.y);
+
+    // Every thread owns a 4x4 block of mip 0 which it reduces to mip 2 in registers
+    const uint2 threadCoord = uint2(localIndex % 16, localIndex / 16);
+    const uint2 tileOrigin = groupID.xy * TILE_SIZE;
+
+    float2 mip1[4];
+
+    [unroll]
+    for (uint quad = 0; quad < 4; quad++)
+    {
+        const uint2 quadOffset = uint2(quad & 1, quad >> 1);
+
+        float2 mip0[4];
+
+        [unroll]
+        for (uint i = 0; i < 4; i++)
+        {
+            const uint2 texel = tileOrigin + threadCoord * 4 + quadOffset * 2 + uint2(i & 1, i >> 1);
+
+            mip0[i] = LoadDepthFootprint(texel, depthSize, baseSize);
+            StoreMip(0, texel, mip0[i], baseSize);
+        }
+
+        mip1[quad] = Reduce(mip0[0], mip0[1], mip0[2], mip0[3]);
+        StoreMip(1, tileOrigin / 2 + threadCoord * 2 + quadOffset, mip1[quad], baseSize);
+    }
+
+    const float2 mip2 = Reduce(mip1[0], mip1[1], mip1[2], mip1[3]);
+    StoreMip(2, tileOrigin / 4 + threadCoord, mip2, baseSize);
+
+    _intermediate[threadCoord.y][threadCoord.x] = mip2;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Mips 3 to 6
+    DownsampleGroupShared(3, groupID.xy, threadCoord, baseSize);
+
+    if (_constants.numMips <= 7)
+        return;
+
+    // Make our mip 6 texel visible to the other groups before we report in
+    DeviceMemoryBarrierWithGroupSync();
+
+    if (localIndex == 0)
+    {
+        uint finishedGroups;
+        _atomicCounter.InterlockedAdd(0, 1, finishedGroups);
+
+        _isLastGroup = (finishedGroups == _constants.numWorkGroups - 1) ? 1 : 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (_isLastGroup == 0)
+        return;
+
+    // Reset the counter for the next time the pyramid is built
+    if (localIndex == 0)
+    {
+        _atomicCounter.Store(0, 0);
+    }
+
+    // The remaining mips are at most 32x32 for a 4096 wide pyramid, so the last group walks them one mip at a time straight through memory
+    for (uint mip = 7; mip < _constants.numMips; mip++)
+    {
+        const uint2 mipSize = GetMipSize(baseSize, mip);
+        const uint numTexels = mipSize.x * mipSize.y;
+
+        for (uint texelIndex = localIndex; texelIndex < numTexels; texelIndex += NUM_THREADS)
+        {
+            const uint2 texel = uint2(texelIndex % mipSize.x, texelIndex / mipSize.x);
+            const uint2 src = texel * 2;
+
+            const float2 value = Reduce(LoadMip(mip - 1, src, baseSize), LoadMip(mip - 1, src + uint2(1, 0), baseSize), LoadMip(mip - 1, src + uint2(0, 1), baseSize), LoadMip(mip - 1, src + uint2(1, 1), baseSize));
+            _pyramid[mip][texel] = value;
+        }
+
+        DeviceMemoryBarrierWithGroupSync();
+    }
+}
@@ -0,0 +1,82 @@
+// Hierarchical depth (Hi-Z) pyramid built by render-lib's DepthPyramid, .x holds the nearest and .y the farthest depth of every texel
+// Mip 0 is the depth buffer rounded down to a power of two, so every following mip is exactly half of the previous one
+#define DEPTH_PYRAMID_MAX_MIPS 13
+
+// Returns the min/max depth covered by a screen rect, uvRect is (minX, minY, maxX, maxY) in 0-1 uv space
+// Returns false if the rect is too large for the pyramid to answer with a 2x2 footprint
+bool SampleDepthPyramid(Texture2D<float2> depthPyramid, float4 uvRect, out float2 minMaxDepth)
+{
+    minMaxDepth = float2(0.0f, 1.0f);
+
+    uint2 baseSize;
+    uint numMips;
+    depthPyramid.GetDimensions(0, baseSize.x, baseSize.y, numMips);
+
+    // Pick the mip where the rect covers at most two texels on each axis
+    const float2 rectSize = (uvRect.zw - uvRect.xy) * float2(baseSize);
+    const uint mip = (uint)ceil(log2(max(max(rectSize.x, rectSize.y), 1.0f)));
+    if (mip >= numMips)
+        return false;
+
+    const uint2 mipSize = max(baseSize >> mip, uint2(1, 1));
+    const uint2 minTexel = min(uint2(uvRect.xy * float2(mipSize)), mipSize - 1);
+    const uint2 maxTexel = min(uint2(uvRect.zw * float2(mipSize)), mipSize - 1);
+
+    const float2 a = depthPyramid.Load(int3(minTexel.x, minTexel.y, mip));
+    const float2 b = depthPyramid.Load(int3(maxTexel.x, minTexel.y, mip));
+    const float2 c = depthPyramid.Load(int3(minTexel.x, maxTexel.y, mip));
+    const float2 d = depthPyramid.Load(int3(maxTexel.x, maxTexel.y, mip));
+
+    minMaxDepth.x = min(min(a.x, b.x), min(c.x, d.x));
+    minMaxDepth.y = max(max(a.y, b.y), max(c.y, d.y));
+    return true;
+}
+
+// Projects an AABB into a uv rect and its nearest depth, returns false if any corner is behind the camera
+bool ProjectAABB(float4x4 viewProjectionMatrix, float3 aabbMin, float3 aabbMax, out float4 uvRect, out float nearestDepth)
+{
+    uvRect = float4(1.0f, 1.0f, 0.0f, 0.0f);
+    nearestDepth = 1.0f;
+
+    [unroll]
+    for (uint i = 0; i < 8; i++)
+    {
+        const float3 corner = float3((i & 1) ? aabbMax.x : aabbMin.x, (i & 2) ? aabbMax.y : aabbMin.y, (i & 4) ? aabbMax.z : aabbMin.z);
+        const float4 clipPos = mul(float4(corner, 1.0f), viewProjectionMatrix);
+
+        if (clipPos.w <= 0.0f)
+            return false;
+
+        const float3 ndc = clipPos.xyz / clipPos.w;
+
+        // Our viewport is flipped, so +Y in NDC is the top of the screen
+        const float2 uv = saturate(ndc.xy * float2(0.5f, -0.5f) + 0.5f);
+
+        uvRect.xy = min(uvRect.xy, uv);
+        uvRect.zw = max(uvRect.zw, uv);
+        nearestDepth = min(nearestDepth, ndc.z);
+    }
+
+    return true;
+}
+
+// An AABB is occluded if its nearest point is behind the farthest depth of everything it covers on screen
+bool IsAABBOccluded(Texture2D<float2> depthPyramid, float4x4 viewProjectionMatrix, float3 aabbMin, float3 aabbMax)
+{
+    float4 uvRect;
+    float nearestDepth;
+    if (!ProjectAABB(viewProjectionMatrix, aabbMin, aabbMax, uvRect, nearestDepth))
+        return false;
+
+    float2 minMaxDepth;
+    if (!SampleDepthPyramid(depthPyramid, uvRect, minMaxDepth))
+        return false;
+
+    return nearestDepth > minMaxDepth.y;
+}
+
+bool IsSphereOccluded(Texture2D<float2> depthPyramid, float4x4 viewProjectionMatrix, float3 center, float radius)
+{
+    // The box around the sphere is conservative, if the box is hidden so is the sphere
+    return IsAABBOccluded(depthPyramid, viewProjectionMatrix, center - radius, center + radius);
+}
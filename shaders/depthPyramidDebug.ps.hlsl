@@ -0,0 +1,36 @@
+struct Constants
+{
+    uint mipLevel;
+    uint showMinDepth; // 0 shows the farthest depth which is what occlusion tests compare against
+    float depthScale;
+    uint padding;
+};
+
+[[vk::binding(0, PER_PASS)]] Texture2D<float2> _depthPyramid;
+[[vk::binding(1, PER_PASS)]] ConstantBuffer<Constants> _constants;
+
+struct VSOutput
+{
+    float2 uv : TEXCOORD0;
+};
+
+float4 main(VSOutput input) : SV_Target
+{
+    uint2 mipSize;
+    uint numMips;
+    _depthPyramid.GetDimensions(0, mipSize.x, mipSize.y, numMips);
+
+    const uint mip = min(_constants.mipLevel, numMips - 1);
+    _depthPyramid.GetDimensions(mip, mipSize.x, mipSize.y, numMips);
+
+    // The blit vertex shader puts uv (0, 0) in the bottom left corner with our flipped viewport, while texel (0, 0) is the top left
+    const float2 uv = float2(input.uv.x, 1.0f - input.uv.y);
+    const uint2 texel = min(uint2(uv * float2(mipSize)), mipSize - 1);
+
+    const float2 minMaxDepth = _depthPyramid.Load(int3(texel, mip));
+    const float depth = (_constants.showMinDepth != 0) ? minMaxDepth.x : minMaxDepth.y;
+
+    // Depth is mostly packed close to 1, scale the distance to the far plane so it becomes visible
+    const float brightness = saturate((1.0f - depth) * _constants.depthScale);
+    return float4(brightness, brightness, brightness, 1.0f);
+}
@@ -1,23 +1,5 @@
 #include "globalData.inc.hlsl"
-
-[[vk::binding(4, PER_PASS)]] SamplerState _sampler;
-[[vk::binding(5, PER_PASS)]] ByteAddressBuffer _materialParams;
-[[vk::binding(6, PER_PASS)]] ByteAddressBuffer _materialData;
-[[vk::binding(7, PER_PASS)]] Texture2D<float4> _textures[4096];
-
-struct MaterialParam
-{
-    uint materialID;
-    uint exteriorLit;
-};
-
-struct Material
-{
-    uint textureIDs[3];
-    float alphaTestVal;
-    uint materialType;
-    uint isUnlit;
-};
+#include "mapObjectMaterial.inc.hlsl"
 
 struct PSInput
 {
@@ -33,24 +15,6 @@ struct PSOutput
     float4 color : SV_Target0;
 };
 
-MaterialParam LoadMaterialParam(uint materialParamID)
-{
-    MaterialParam materialParam;
-    
-    materialParam = _materialParams.Load<MaterialParam>(materialParamID * 8); // 8 = sizeof(MaterialParam)
-    
-    return materialParam;
-}
-
-Material LoadMaterial(uint materialID)
-{
-    Material material;
-
-    material = _materialData.Load<Material>(materialID * 24); // 24 = sizeof(Material)
-
-    return material;
-}
-
 float3 Lighting(float3 baseColor, float4 vertexColor, float3 normal, Material material, MaterialParam materialParam)
 {
     float3 currColor;
@@ -0,0 +1,22 @@
+#include "globalData.inc.hlsl"
+#include "mapObjectMaterial.inc.hlsl"
+
+struct PSInput
+{
+    float2 uv0 : TEXCOORD0;
+    uint materialParamID : TEXCOORD1;
+};
+
+// Depth only, the pixel shader is just here to alpha test the same way mapObject.ps.hlsl does
+void main(PSInput input)
+{
+    MaterialParam materialParam = LoadMaterialParam(input.materialParamID);
+    Material material = LoadMaterial(materialParam.materialID);
+
+    float4 tex0 = _textures[material.textureIDs[0]].Sample(_sampler, input.uv0);
+
+    if (tex0.a < material.alphaTestVal)
+    {
+        discard;
+    }
+}
\ No newline at end of file
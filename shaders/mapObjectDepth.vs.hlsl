@@ -0,0 +1,31 @@
+#include "globalData.inc.hlsl"
+#include "mapObjectVertex.inc.hlsl"
+
+struct VSInput
+{
+    uint vertexID : SV_VertexID;
+    uint instanceID : SV_InstanceID;
+};
+
+struct VSOutput
+{
+    precise float4 position : SV_Position;
+    float2 uv0 : TEXCOORD0; // Only needed for alpha testing
+    uint materialParamID : TEXCOORD1;
+};
+
+VSOutput main(VSInput input)
+{
+    VSOutput output;
+
+    InstanceLookupData lookupData = LoadInstanceLookupData(input.instanceID);
+
+    InstanceData instanceData = LoadInstanceData(lookupData.instanceID);
+    PackedVertex packedVertex = LoadPackedVertex(input.vertexID);
+
+    output.position = GetMapObjectClipPosition(packedVertex, instanceData);
+    output.uv0 = UnpackUVs(packedVertex).xy;
+    output.materialParamID = lookupData.materialParamID;
+
+    return output;
+}
\ No newline at end of file
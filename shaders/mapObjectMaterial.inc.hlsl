@@ -0,0 +1,37 @@
+// Shared by mapObject.ps.hlsl and mapObjectDepth.ps.hlsl
+[[vk::binding(4, PER_PASS)]] SamplerState _sampler;
+[[vk::binding(5, PER_PASS)]] ByteAddressBuffer _materialParams;
+[[vk::binding(6, PER_PASS)]] ByteAddressBuffer _materialData;
+[[vk::binding(7, PER_PASS)]] Texture2D<float4> _textures[4096];
+
+struct MaterialParam
+{
+    uint materialID;
+    uint exteriorLit;
+};
+
+struct Material
+{
+    uint textureIDs[3];
+    float alphaTestVal;
+    uint materialType;
+    uint isUnlit;
+};
+
+MaterialParam LoadMaterialParam(uint materialParamID)
+{
+    MaterialParam materialParam;
+    
+    materialParam = _materialParams.Load<MaterialParam>(materialParamID * 8); // 8 = sizeof(MaterialParam)
+    
+    return materialParam;
+}
+
+Material LoadMaterial(uint materialID)
+{
+    Material material;
+
+    material = _materialData.Load<Material>(materialID * 24); // 24 = sizeof(Material)
+
+    return material;
+}
\ No newline at end of file
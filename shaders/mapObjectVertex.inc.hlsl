@@ -0,0 +1,92 @@
+// Shared by mapObject.vs.hlsl and mapObjectDepth.vs.hlsl, the depth prepass relies on both computing bit identical positions so keep all position math in here
+[[vk::binding(0, PER_PASS)]] ByteAddressBuffer _vertices;
+[[vk::binding(1, PER_PASS)]] ByteAddressBuffer _instanceData;
+[[vk::binding(2, PER_PASS)]] ByteAddressBuffer _instanceLookup;
+
+struct InstanceLookupData
+{
+    uint16_t instanceID;
+    uint16_t materialParamID;
+    uint16_t vertexColorTextureID0;
+    uint16_t vertexColorTextureID1;
+    uint vertexOffset;
+    uint padding1;
+};
+
+struct InstanceData
+{
+    float4x4 instanceMatrix;
+};
+
+struct PackedVertex
+{
+    uint data0;
+    uint data1;
+    uint data2;
+    uint data3;
+};
+
+// PackedVertex is packed like this:
+// data0
+//  half positionX
+//  half positionY
+// data1
+//  half positionZ
+//  u8 octNormalX
+//  u8 octNormalY
+// data2
+//  half uvX
+//  half uvY
+// data3
+//  half uvZ
+//  half uvW
+
+InstanceLookupData LoadInstanceLookupData(uint instanceID)
+{
+    return _instanceLookup.Load<InstanceLookupData>(instanceID * 16); // 16 = sizeof(InstanceLookupData)
+}
+
+InstanceData LoadInstanceData(uint instanceID)
+{
+    InstanceData instanceData;
+
+    instanceData = _instanceData.Load<InstanceData>(instanceID * 64); // 64 = sizeof(InstanceData)
+
+    return instanceData;
+}
+
+PackedVertex LoadPackedVertex(uint vertexID)
+{
+    return _vertices.Load<PackedVertex>(vertexID * 16); // 16 = sizeof(PackedVertex)
+}
+
+float3 UnpackPosition(PackedVertex packedVertex)
+{
+    float3 position;
+    
+    position.x = f16tof32(packedVertex.data0);
+    position.y = f16tof32(packedVertex.data0 >> 16);
+    position.z = f16tof32(packedVertex.data1);
+    
+    return position;
+}
+
+float4 UnpackUVs(PackedVertex packedVertex)
+{
+    float4 uvs;
+    
+    uvs.x = f16tof32(packedVertex.data2);
+    uvs.y = f16tof32(packedVertex.data2 >> 16);
+    uvs.z = f16tof32(packedVertex.data3);
+    uvs.w = f16tof32(packedVertex.data3 >> 16);
+
+    return uvs;
+}
+
+float4 GetMapObjectClipPosition(PackedVertex packedVertex, InstanceData instanceData)
+{
+    float4 position = float4(UnpackPosition(packedVertex), 1.0f);
+    position = mul(position, instanceData.instanceMatrix);
+
+    return mul(position, _viewData.viewProjectionMatrix);
+}
\ No newline at end of file
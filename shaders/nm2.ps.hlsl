@@ -38,6 +38,8 @@ Material LoadMaterial()
     return material;
 }
 
+// Nothing in here discards or writes depth, so force the depth test to happen before shading
+[earlydepthstencil]
 PSOutput main(PSInput input)
 {
     PSOutput output;
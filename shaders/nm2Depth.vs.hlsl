@@ -0,0 +1,23 @@
+#include "globalData.inc.hlsl"
+#include "nm2Vertex.inc.hlsl"
+
+struct VSInput
+{
+    uint vertexID : SV_VertexID;
+    uint instanceID : SV_InstanceID;
+};
+
+struct VSOutput
+{
+    precise float4 position : SV_Position;
+};
+
+VSOutput main(VSInput input)
+{
+    VSOutput output;
+
+    InstanceData instanceData = LoadInstanceData(input.instanceID);
+    output.position = GetNM2ClipPosition(input.vertexID, instanceData);
+
+    return output;
+}
\ No newline at end of file
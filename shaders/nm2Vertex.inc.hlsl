@@ -0,0 +1,34 @@
+// Shared by nm2.vs.hlsl and nm2Depth.vs.hlsl, the depth prepass relies on both computing bit identical positions so keep all position math in here
+[[vk::binding(0, PER_PASS)]] ByteAddressBuffer _instanceData;
+
+[[vk::binding(0, PER_DRAW)]] ByteAddressBuffer _vertexPositions;
+
+struct InstanceData
+{
+    float4x4 instanceMatrix;
+};
+
+InstanceData LoadInstanceData(uint instanceID)
+{
+    InstanceData instanceData;
+
+    instanceData = _instanceData.Load<InstanceData>(instanceID * 24); // 24 = sizeof(InstanceData)
+
+    return instanceData;
+}
+
+float3 LoadVertexPosition(uint vertexID)
+{
+    float3 position = _vertexPositions.Load<float3>(vertexID * 12); // 12 = sizeof(float3)
+
+    // TODO: Remove this from the shader, we want to do this in the dataextractor instead
+    return float3(-position.x, position.z, -position.y);
+}
+
+float4 GetNM2ClipPosition(uint vertexID, InstanceData instanceData)
+{
+    float4 position = float4(LoadVertexPosition(vertexID), 1.0f);
+    position = mul(position, instanceData.instanceMatrix);
+
+    return mul(position, _viewData.viewProjectionMatrix);
+}
\ No newline at end of file
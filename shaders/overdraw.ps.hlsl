@@ -0,0 +1,8 @@
+// Drawn with additive blending instead of the real pixel shader, every shaded pixel adds one step
+// Red saturates after 8 layers, green after 16 and blue after 32, so the view goes from dark red over yellow to white as overdraw grows
+#define OVERDRAW_STEP float4(1.0f / 8.0f, 1.0f / 16.0f, 1.0f / 32.0f, 0.0f)
+
+float4 main() : SV_Target
+{
+    return OVERDRAW_STEP;
+}
@@ -0,0 +1,8 @@
+// Keyword bitmask set through ShaderPermutation::keywords, constant_id 0 matches SHADER_KEYWORDS_CONSTANT_ID
+// Since this is a specialization constant the driver folds HasKeyword() to a constant and strips the untaken branches when building the pipeline
+[[vk::constant_id(0)]] const uint _permutationKeywords = 0;
+
+bool HasKeyword(uint keyword)
+{
+    return (_permutationKeywords & keyword) != 0;
+}
@@ -11,6 +11,55 @@
 
 #define HALF_WORLD_SIZE (17066.66656f)
 
+// Permutation keywords, these need to match TerrainRenderer.h
+#define TERRAIN_KEYWORD_SINGLE_LAYER (1 << 0)
+#define TERRAIN_KEYWORD_PACKED_HEIGHT_RANGE (1 << 1)
+#define TERRAIN_KEYWORD_OCCLUSION_CULLING (1 << 2)
+#define TERRAIN_KEYWORD_OCCLUSION_PASS (1 << 3)
+#define TERRAIN_KEYWORD_CLIPMAP (1 << 4)
+#define TERRAIN_KEYWORD_DERIVED_NORMALS (1 << 5)
+#define TERRAIN_KEYWORD_TWO_LAYERS (1 << 6)
+#define TERRAIN_KEYWORD_DEPTH_SORT (1 << 7)
+
+// Depth sorting splits the instances of every draw into distance bands, this needs to match TerrainRenderer.h
+#define NUM_CELL_DISTANCE_BANDS (16)
+#define CELL_SORT_KEY_INVALID (0xFFFFFFFF)
+#define CELL_SORT_KEY_DRAW_SHIFT (24)
+#define CELL_SORT_KEY_BAND_SHIFT (20)
+#define CELL_SORT_KEY_RANK_MASK (0xFFFFF)
+
+// Cells are drawn in buckets by how many layers they blend, this needs to match Terrain::CellLayerClass
+#define CELL_LAYER_CLASS_SINGLE (0)
+#define CELL_LAYER_CLASS_TWO (1)
+#define CELL_LAYER_CLASS_FULL (2)
+#define NUM_CELL_LAYER_CLASSES (3)
+
+// Albedo clipmap layout, these need to match TerrainClipmap.h
+#define CLIPMAP_NUM_LEVELS (5)
+#define CLIPMAP_LEVEL0_TEXELS_PER_CELL (64)
+#define CLIPMAP_PAGE_SIZE (128)
+#define CLIPMAP_PAGE_BORDER (1)
+#define CLIPMAP_PHYSICAL_PAGE_SIZE (CLIPMAP_PAGE_SIZE + CLIPMAP_PAGE_BORDER * 2)
+#define CLIPMAP_PAGES_PER_LEVEL_SIDE (8)
+#define CLIPMAP_PAGES_PER_LEVEL (CLIPMAP_PAGES_PER_LEVEL_SIDE * CLIPMAP_PAGES_PER_LEVEL_SIDE)
+#define CLIPMAP_NUM_PAGES (CLIPMAP_PAGES_PER_LEVEL * CLIPMAP_NUM_LEVELS)
+#define CLIPMAP_ATLAS_PAGES_PER_ROW (16)
+#define CLIPMAP_MAX_BAKES_PER_FRAME (32)
+
+// Chunk slot table entry for chunks that aren't resident, this needs to match TerrainRenderer.h
+#define TERRAIN_CHUNK_SLOT_INVALID (0xFFFFFFFF)
+
+// CellInstance.instanceID packs the cell index with the LOD of the cell and of its 4 neighbours, this needs to match TerrainLod.h
+#define NUM_CELL_LODS (4)
+#define CELL_INSTANCE_INDEX_MASK (0xFFFFF)
+#define CELL_INSTANCE_LOD_SHIFT (20)
+
+// Neighbours are stored in the order of the edges they share, top is the first outer row and right the last outer column
+#define CELL_EDGE_TOP (0)
+#define CELL_EDGE_RIGHT (1)
+#define CELL_EDGE_BOTTOM (2)
+#define CELL_EDGE_LEFT (3)
+
 struct PackedCellData
 {
     uint packedDiffuseIDs1;
@@ -24,6 +73,12 @@ struct CellData
     uint holes;
 };
 
+// The layer class is picked when the chunk is loaded and stored next to the holes
+uint GetCellLayerClass(PackedCellData cellData)
+{
+    return cellData.packedHoles >> 16;
+}
+
 struct ChunkData
 {
     uint alphaID;
@@ -41,6 +96,27 @@ struct AABB
     float3 max;
 };
 
+uint GetCellIndex(uint instanceID)
+{
+    return instanceID & CELL_INSTANCE_INDEX_MASK;
+}
+
+uint GetCellLod(uint instanceID)
+{
+    return (instanceID >> CELL_INSTANCE_LOD_SHIFT) & 3;
+}
+
+uint GetNeighbourCellLod(uint instanceID, uint edge)
+{
+    return (instanceID >> (CELL_INSTANCE_LOD_SHIFT + 2 + (edge * 2))) & 3;
+}
+
+uint PackCellInstanceID(uint cellIndex, uint lod, uint4 neighbourLods)
+{
+    const uint packed = lod | (neighbourLods.x << 2) | (neighbourLods.y << 4) | (neighbourLods.z << 6) | (neighbourLods.w << 8);
+    return cellIndex | (packed << CELL_INSTANCE_LOD_SHIFT);
+}
+
 uint GetGlobalCellID(uint chunkID, uint cellID)
 {
     return (chunkID * NUM_CELLS_PER_CHUNK) + cellID;
@@ -91,6 +167,25 @@ AABB GetCellAABB(uint chunkID, uint cellID, float2 heightRange)
     return boundingBox;
 }
 
+// Position in cells from the map origin, the space the clipmap is laid out in, uv is the 0 to 8 position within the cell
+float2 GetMapCellPosition(uint chunkID, uint cellID, float2 uv)
+{
+    const uint2 chunkPos = uint2(chunkID % NUM_CHUNKS_PER_MAP_SIDE, chunkID / NUM_CHUNKS_PER_MAP_SIDE);
+    const uint2 cellPos = uint2(cellID % NUM_CELLS_PER_CHUNK_SIDE, cellID / NUM_CELLS_PER_CHUNK_SIDE);
+
+    return float2((chunkPos * NUM_CELLS_PER_CHUNK_SIDE) + cellPos) + (uv / 8.0f);
+}
+
+uint GetClipmapSlot(uint level, uint2 page)
+{
+    return (level * CLIPMAP_PAGES_PER_LEVEL) + ((page.y % CLIPMAP_PAGES_PER_LEVEL_SIDE) * CLIPMAP_PAGES_PER_LEVEL_SIDE) + (page.x % CLIPMAP_PAGES_PER_LEVEL_SIDE);
+}
+
+uint2 GetClipmapAtlasOrigin(uint slot)
+{
+    return uint2(slot % CLIPMAP_ATLAS_PAGES_PER_ROW, slot / CLIPMAP_ATLAS_PAGES_PER_ROW) * CLIPMAP_PHYSICAL_PAGE_SIZE;
+}
+
 float2 GetCellSpaceVertexPosition(uint vertexID)
 {
     float vertexX = vertexID % 17.0f;
@@ -1,14 +1,15 @@
 #include "globalData.inc.hlsl"
 #include "terrain.inc.hlsl"
+#include "permutation.inc.hlsl"
+#include "terrainMaterial.inc.hlsl"
 
-[[vk::binding(2, PER_PASS)]] ByteAddressBuffer _cellData;
-[[vk::binding(3, PER_PASS)]] ByteAddressBuffer _chunkData;
-
-[[vk::binding(4, PER_PASS)]] SamplerState _alphaSampler;
-[[vk::binding(5, PER_PASS)]] SamplerState _colorSampler;
+struct ClipmapPageTable
+{
+    uint4 pages[CLIPMAP_NUM_PAGES / 4]; // Which page every slot holds as x | (y << 16), see TerrainClipmap.h
+};
 
-[[vk::binding(6, PER_PASS)]] Texture2D<float4> _terrainColorTextures[4096];
-[[vk::binding(7, PER_PASS)]] Texture2DArray<float4> _terrainAlphaTextures[NUM_CHUNKS_PER_MAP_SIDE * NUM_CHUNKS_PER_MAP_SIDE];
+[[vk::binding(8, PER_PASS)]] Texture2D<float4> _clipmapAtlas;
+[[vk::binding(9, PER_PASS)]] ConstantBuffer<ClipmapPageTable> _clipmapPages;
 
 struct PSInput
 {
@@ -24,24 +25,44 @@ struct PSOutput
     float4 color : SV_Target0;
 };
 
-CellData LoadCellData(uint globalCellID)
+// Returns false if the pixel is too close for the clipmap or none of the levels that could shade it have its page baked
+bool TrySampleClipmap(float2 cellPosition, float cellsPerPixel, out float4 color)
 {
-    const PackedCellData rawCellData = _cellData.Load<PackedCellData>(globalCellID * 12); // sizeof(PackedCellData) = 12
+    color = float4(0, 0, 0, 0);
+
+    // The finest level with texels that aren't bigger than the pixel, there are no mips so finer levels would alias
+    const int firstLevel = int(floor(log2(CLIPMAP_LEVEL0_TEXELS_PER_CELL * cellsPerPixel)));
+    if (firstLevel < 0)
+    {
+        return false;
+    }
+
+    [loop]
+    for (uint level = uint(firstLevel); level < CLIPMAP_NUM_LEVELS; level++)
+    {
+        const float2 texel = cellPosition * float(CLIPMAP_LEVEL0_TEXELS_PER_CELL >> level);
+        const uint2 page = uint2(texel / CLIPMAP_PAGE_SIZE);
+
+        const uint slot = GetClipmapSlot(level, page);
+        if (_clipmapPages.pages[slot / 4][slot % 4] != (page.x | (page.y << 16)))
+        {
+            continue;
+        }
 
-    CellData cellData;
+        uint2 atlasSize;
+        _clipmapAtlas.GetDimensions(atlasSize.x, atlasSize.y);
 
-    // Unpack diffuse IDs
-    cellData.diffuseIDs.x = (rawCellData.packedDiffuseIDs1 >> 0)  & 0xffff;
-    cellData.diffuseIDs.y = (rawCellData.packedDiffuseIDs1 >> 16)  & 0xffff;
-    cellData.diffuseIDs.z = (rawCellData.packedDiffuseIDs2 >> 0) & 0xffff;
-    cellData.diffuseIDs.w = (rawCellData.packedDiffuseIDs2 >> 16) & 0xffff;
+        const float2 atlasTexel = GetClipmapAtlasOrigin(slot) + CLIPMAP_PAGE_BORDER + (texel - (page * CLIPMAP_PAGE_SIZE));
+        color = _clipmapAtlas.SampleLevel(_alphaSampler, atlasTexel / atlasSize, 0);
 
-    // Unpack holes
-    cellData.holes = rawCellData.packedHoles & 0xffff;
+        return true;
+    }
 
-    return cellData;
+    return false;
 }
 
+// Nothing in here discards or writes depth, so force the depth test to happen before shading
+[earlydepthstencil]
 PSOutput main(PSInput input)
 {
     PSOutput output;
@@ -52,36 +73,26 @@ PSOutput main(PSInput input)
     // Our UVs currently go between 0 and 8, with wrapping. This is correct for terrain color textures
     float2 uv = input.uv; // [0.0 .. 8.0]
 
-    // However the alpha needs to be between 0 and 1, so lets convert it
-    float3 alphaUV = float3(uv / 8.0f, float(cellID));
-
-    const CellData cellData = LoadCellData(input.cellIndex);
-
-    const uint chunkIndex = input.cellIndex / NUM_CELLS_PER_CHUNK;
-    const ChunkData chunkData = _chunkData.Load<ChunkData>(chunkIndex * 4); // sizeof(ChunkData) = 4
-
-    // We have 4 uints per chunk for our diffuseIDs, this gives us a size and alignment of 16 bytes which is exactly what GPUs want
-    // However, we need a fifth uint for alphaID, so we decided to pack it into the LAST diffuseID, which gets split into two uint16s
-    // This is what it looks like
-    // [1111] diffuseIDs.x
-    // [2222] diffuseIDs.y
-    // [3333] diffuseIDs.z
-    // [AA44] diffuseIDs.w Alpha is read from the most significant bits, the fourth diffuseID read from the least 
-    uint diffuse0ID = cellData.diffuseIDs.x;
-    uint diffuse1ID = cellData.diffuseIDs.y;
-    uint diffuse2ID = cellData.diffuseIDs.z;
-    uint diffuse3ID = cellData.diffuseIDs.w;
-    uint alphaID = chunkData.alphaID;
-
-    float3 alpha = _terrainAlphaTextures[alphaID].Sample(_alphaSampler, alphaUV).rgb;
-    float4 diffuse0 = _terrainColorTextures[diffuse0ID].Sample(_colorSampler, uv);
-    float4 diffuse1 = _terrainColorTextures[diffuse1ID].Sample(_colorSampler, uv);
-    float4 diffuse2 = _terrainColorTextures[diffuse2ID].Sample(_colorSampler, uv);
-    float4 diffuse3 = _terrainColorTextures[diffuse3ID].Sample(_colorSampler, uv);
-    float4 color = diffuse0;
-    color = (diffuse1 * alpha.x) + (color * (1.0f - alpha.x));
-    color = (diffuse2 * alpha.y) + (color * (1.0f - alpha.y));
-    color = (diffuse3 * alpha.z) + (color * (1.0f - alpha.z));
+    const float2 uvDdx = ddx(uv);
+    const float2 uvDdy = ddy(uv);
+
+    float4 color;
+    bool isShaded = false;
+
+    if (HasKeyword(TERRAIN_KEYWORD_CLIPMAP))
+    {
+        // uv spans 8 units per cell
+        const float2 cellPosition = GetMapCellPosition(chunkID, cellID, uv);
+        const float cellsPerPixel = max(length(uvDdx), length(uvDdy)) / 8.0f;
+
+        isShaded = TrySampleClipmap(cellPosition, cellsPerPixel, color);
+    }
+
+    if (!isShaded)
+    {
+        const TerrainLayers layers = LoadTerrainLayers(input.cellIndex);
+        color = SampleTerrainAlbedo(layers, cellID, uv, uvDdx, uvDdy, HasKeyword(TERRAIN_KEYWORD_SINGLE_LAYER), HasKeyword(TERRAIN_KEYWORD_TWO_LAYERS));
+    }
 
     // Apply lighting
     float3 normal = normalize(input.normal);
@@ -93,4 +104,4 @@ PSOutput main(PSInput input)
     output.color = color;
 
     return output;
-}
\ No newline at end of file
+}
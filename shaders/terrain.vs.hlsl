@@ -1,19 +1,20 @@
 #include "globalData.inc.hlsl"
+#include "permutation.inc.hlsl"
 #include "terrain.inc.hlsl"
+#include "terrainVertex.inc.hlsl"
 
-[[vk::binding(0, PER_PASS)]] ByteAddressBuffer _vertices;
-[[vk::binding(1, PER_PASS)]] ByteAddressBuffer _cellDataVS;
+[[vk::binding(10, PER_PASS)]] ByteAddressBuffer _chunkSlots;
 
 struct VSInput
 {
     uint vertexID : SV_VertexID;
     uint packedChunkCellID : TEXCOORD0;
-    uint cellIndex : TEXCOORD1;
+    uint instanceID : TEXCOORD1; // Packed cell index and LODs, see terrain.inc.hlsl
 };
 
 struct VSOutput
 {
-    float4 position : SV_Position;
+    precise float4 position : SV_Position; // precise since the depth prepass needs to match this exactly
     uint packedChunkCellID : TEXCOORD0;
     float2 uv : TEXCOORD1;
     float3 normal : TEXCOORD2;
@@ -21,15 +22,8 @@ struct VSOutput
     uint cellIndex : TEXCOORD4;
 };
 
-struct PackedVertex
-{
-    uint data0;
-    uint data1;
-};
-
 struct Vertex
 {
-    float3 position;
     float3 normal;
     float3 color;
     float2 uv;
@@ -54,9 +48,84 @@ float3 UnpackColor(uint encoded)
     return float3(r, g, b) / 127.0f;
 }
 
-float UnpackHalf(uint encoded)
+// Height of an outer vertex by its position on the outer grid of the whole map, which has 8 steps per cell
+// Returns false for chunks that aren't resident, height is left as it is then
+bool TryLoadOuterHeight(int2 gridPosition, inout float height)
+{
+    const uint numMapCells = NUM_CHUNKS_PER_MAP_SIDE * NUM_CELLS_PER_CHUNK_SIDE;
+    if (any(gridPosition < 0) || any(gridPosition > int(numMapCells * 8)))
+    {
+        return false;
+    }
+
+    // The last outer vertex of a cell is the first one of the next cell, only the far edge of the map has to use the last one
+    const uint2 mapCell = min(uint2(gridPosition) / 8, numMapCells - 1);
+    const uint2 vertexPosition = uint2(gridPosition) - (mapCell * 8);
+
+    const uint2 chunkPos = mapCell / NUM_CELLS_PER_CHUNK_SIDE;
+    const uint2 cellPos = mapCell % NUM_CELLS_PER_CHUNK_SIDE;
+
+    const uint chunkID = chunkPos.x + (chunkPos.y * NUM_CHUNKS_PER_MAP_SIDE);
+    const uint chunkSlot = _chunkSlots.Load(chunkID * 4);
+    if (chunkSlot == TERRAIN_CHUNK_SLOT_INVALID)
+    {
+        return false;
+    }
+
+    const uint cellIndex = (chunkSlot * NUM_CELLS_PER_CHUNK) + cellPos.x + (cellPos.y * NUM_CELLS_PER_CHUNK_SIDE);
+    const uint vertexID = (vertexPosition.y * 17) + vertexPosition.x;
+
+    height = GetVertexHeight(LoadPackedVertex(cellIndex * NUM_VERTICES_PER_CELL, vertexID));
+    return true;
+}
+
+// Height change per outer grid step, one sided where a neighbouring chunk isn't resident
+float GetOuterSlope(int2 gridPosition, int2 direction, float height)
 {
-    return f16tof32(encoded);
+    float next = height;
+    float previous = height;
+    float distance = 0.0f;
+
+    distance += TryLoadOuterHeight(gridPosition + direction, next) ? 1.0f : 0.0f;
+    distance += TryLoadOuterHeight(gridPosition - direction, previous) ? 1.0f : 0.0f;
+
+    return distance > 0.0f ? (next - previous) / distance : 0.0f;
+}
+
+// Central differences of the unstitched heights around the vertex
+// Outer vertices look up their neighbours on the map wide grid, so a vertex shared by two cells or chunks gets the same normal in both
+float3 DeriveNormal(uint chunkID, uint cellID, uint cellIndex, uint vertexID, float height)
+{
+    const uint row = vertexID / 17;
+    const uint column = vertexID % 17;
+
+    float2 slope;
+    if (column > 8)
+    {
+        // Inner vertices are in the middle of 4 outer vertices of their own cell
+        const uint vertexBaseOffset = cellIndex * NUM_VERTICES_PER_CELL;
+        const uint topLeft = (row * 17) + (column - 9);
+
+        const float topLeftHeight = GetVertexHeight(LoadPackedVertex(vertexBaseOffset, topLeft));
+        const float topRightHeight = GetVertexHeight(LoadPackedVertex(vertexBaseOffset, topLeft + 1));
+        const float bottomLeftHeight = GetVertexHeight(LoadPackedVertex(vertexBaseOffset, topLeft + 17));
+        const float bottomRightHeight = GetVertexHeight(LoadPackedVertex(vertexBaseOffset, topLeft + 18));
+
+        slope.x = ((topRightHeight + bottomRightHeight) - (topLeftHeight + bottomLeftHeight)) * 0.5f;
+        slope.y = ((bottomLeftHeight + bottomRightHeight) - (topLeftHeight + topRightHeight)) * 0.5f;
+    }
+    else
+    {
+        const uint2 chunkPos = uint2(chunkID % NUM_CHUNKS_PER_MAP_SIDE, chunkID / NUM_CHUNKS_PER_MAP_SIDE);
+        const uint2 cellPos = uint2(cellID % NUM_CELLS_PER_CHUNK_SIDE, cellID / NUM_CELLS_PER_CHUNK_SIDE);
+        const int2 gridPosition = int2((((chunkPos * NUM_CELLS_PER_CHUNK_SIDE) + cellPos) * 8) + uint2(column, row));
+
+        slope.x = GetOuterSlope(gridPosition, int2(1, 0), height);
+        slope.y = GetOuterSlope(gridPosition, int2(0, 1), height);
+    }
+
+    // Grid x runs along -z in world space and grid y along -x, see GetVertexPosition
+    return normalize(float3(slope.y, CELL_SIDE_SIZE / 8.0f, slope.x));
 }
 
 Vertex UnpackVertex(const PackedVertex packedVertex)
@@ -71,90 +140,51 @@ Vertex UnpackVertex(const PackedVertex packedVertex)
     // data1 contains, in order:
     // u8 color.g
     // u8 color.b
-    // half height, 2 bytes
+    // half height, 2 bytes, which GetVertexPosition in terrainVertex.inc.hlsl unpacks
     
-    // Unpack normal, color and height
+    // Unpack normal and color
     uint normal = packedVertex.data0;// & 0x00FFFFFFu;
     uint color = ((packedVertex.data1 & 0x0000FFFFu) << 8u) | (packedVertex.data0 >> 24u);
-    uint height = packedVertex.data1 >> 16u;
     
     Vertex vertex;
-    vertex.normal = UnpackNormal(normal);
-    vertex.color = UnpackColor(color);
-    vertex.position.y = UnpackHalf(height);
-    
-    return vertex;
-}
-
-Vertex LoadVertex(uint chunkID, uint cellID, uint vertexBaseOffset, uint vertexID)
-{
-    // Load height
-    const uint vertexIndex = vertexBaseOffset + vertexID;
-    const PackedVertex packedVertex = _vertices.Load<PackedVertex>(vertexIndex * 8); // 8 = sizeof(PackedVertex)
+    if (HasKeyword(TERRAIN_KEYWORD_DERIVED_NORMALS))
+    {
+        // The normal gets filled in by DeriveNormal
+        vertex.normal = float3(0, 1, 0);
+    }
+    else
+    {
+        vertex.normal = UnpackNormal(normal);
+    }
 
-    Vertex vertex = UnpackVertex(packedVertex);
+    vertex.color = UnpackColor(color);
     
-    // Set remaining vertex parameters which are based on vertexID
-    float2 cellPos = GetCellPosition(chunkID, cellID);
-    float2 vertexPos = GetCellSpaceVertexPosition(vertexID);
-
-    const float CELL_PRECISION = CELL_SIDE_SIZE / 8.0f;
-
-    vertex.position.x = -((-vertexPos.x) * CELL_PRECISION + cellPos.x);
-    vertex.position.z = (-vertexPos.y) * CELL_PRECISION + cellPos.y;
-    vertex.uv = vertexPos;
-
-    vertex.position = mul(float3x3(
-        0, 0, 1,
-        0, 1, 0,
-    -1, 0, 0
-    ), vertex.position);
-
     return vertex;
 }
 
-CellData LoadCellData(uint globalCellID)
-{
-    const PackedCellData rawCellData = _cellDataVS.Load<PackedCellData>(globalCellID * 12); // sizeof(PackedCellData) = 12
-
-    CellData cellData;
-
-    // Unpack diffuse IDs
-    cellData.diffuseIDs.x = (rawCellData.packedDiffuseIDs1 >> 0) & 0xffff;
-    cellData.diffuseIDs.y = (rawCellData.packedDiffuseIDs1 >> 16) & 0xffff;
-    cellData.diffuseIDs.z = (rawCellData.packedDiffuseIDs2 >> 0) & 0xffff;
-    cellData.diffuseIDs.w = (rawCellData.packedDiffuseIDs2 >> 16) & 0xffff;
-
-    // Unpack holes
-    cellData.holes = rawCellData.packedHoles & 0xffff;
-
-    return cellData;
-}
-
 VSOutput main(VSInput input)
 {
     VSOutput output;
 
-    CellData cellData = LoadCellData(input.cellIndex);
-    if (IsHoleVertex(input.vertexID, cellData.holes))
-    {
-        const float NaN = asfloat(0b01111111100000000000000000000000);
-        output.position = float4(NaN, NaN, NaN, NaN);
-        return output;
-    }
+    const uint cellIndex = GetCellIndex(input.instanceID);
+    const uint vertexBaseOffset = cellIndex * NUM_VERTICES_PER_CELL;
+    const PackedVertex packedVertex = LoadPackedVertex(vertexBaseOffset, input.vertexID);
 
-    const uint cellID = input.packedChunkCellID & 0xffff;
-    const uint chunkID = input.packedChunkCellID >> 16;
+    output.position = GetTerrainClipPosition(input.packedChunkCellID, input.instanceID, input.vertexID, packedVertex);
 
-    uint vertexBaseOffset = input.cellIndex * NUM_VERTICES_PER_CELL;
-    Vertex vertex = LoadVertex(chunkID, cellID, vertexBaseOffset, input.vertexID);
-
-    output.position = mul(float4(vertex.position, 1.0f), _viewData.viewProjectionMatrix);
-    output.uv = vertex.uv;
+    Vertex vertex = UnpackVertex(packedVertex);
+    output.uv = GetCellSpaceVertexPosition(input.vertexID);
     output.packedChunkCellID = input.packedChunkCellID;
     output.normal = vertex.normal;
+
+    if (HasKeyword(TERRAIN_KEYWORD_DERIVED_NORMALS))
+    {
+        const uint chunkID = input.packedChunkCellID >> 16;
+        const uint cellID = input.packedChunkCellID & 0xffff;
+        output.normal = DeriveNormal(chunkID, cellID, cellIndex, input.vertexID, GetVertexHeight(packedVertex));
+    }
     output.color = vertex.color;
-    output.cellIndex = input.cellIndex;
+    output.cellIndex = cellIndex;
 
     return output;
 }
\ No newline at end of file
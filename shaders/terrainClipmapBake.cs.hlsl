@@ -0,0 +1,65 @@
+#include "globalData.inc.hlsl"
+#include "terrain.inc.hlsl"
+#include "terrainMaterial.inc.hlsl"
+
+struct BakeRequest
+{
+	uint level;
+	uint slot;
+	uint2 page;
+};
+
+struct Constants
+{
+	BakeRequest requests[CLIPMAP_MAX_BAKES_PER_FRAME];
+};
+
+[[vk::binding(0, PER_PASS)]] ByteAddressBuffer _chunkSlots;
+[[vk::binding(1, PER_PASS)]] ConstantBuffer<Constants> _constants;
+[[vk::binding(8, PER_PASS)]] RWTexture2D<float4> _atlas;
+
+// Every z workgroup bakes one page, including its border
+[numthreads(8, 8, 1)]
+void main(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	const uint2 pageTexel = dispatchThreadId.xy;
+	if (any(pageTexel >= CLIPMAP_PHYSICAL_PAGE_SIZE))
+	{
+		return;
+	}
+
+	const BakeRequest request = _constants.requests[dispatchThreadId.z];
+	const uint texelsPerCell = CLIPMAP_LEVEL0_TEXELS_PER_CELL >> request.level;
+	const uint2 atlasTexel = GetClipmapAtlasOrigin(request.slot) + pageTexel;
+
+	// The border reaches one texel into the neighbouring pages, which can be outside of the map on its edges
+	const float2 texel = float2(request.page * CLIPMAP_PAGE_SIZE) + float2(pageTexel) - CLIPMAP_PAGE_BORDER + 0.5f;
+	const float2 cellPosition = texel / texelsPerCell;
+
+	const uint2 mapCell = uint2(clamp(floor(cellPosition), 0.0f, float(NUM_CHUNKS_PER_MAP_SIDE * NUM_CELLS_PER_CHUNK_SIDE - 1)));
+	const uint2 chunkPos = mapCell / NUM_CELLS_PER_CHUNK_SIDE;
+	const uint2 cellPos = mapCell % NUM_CELLS_PER_CHUNK_SIDE;
+
+	const uint chunkID = chunkPos.x + (chunkPos.y * NUM_CHUNKS_PER_MAP_SIDE);
+	const uint chunkSlot = _chunkSlots.Load(chunkID * 4);
+
+	// Chunks that aren't resident aren't drawn either, the page gets baked again once they load
+	if (chunkSlot == TERRAIN_CHUNK_SLOT_INVALID)
+	{
+		_atlas[atlasTexel] = float4(0, 0, 0, 1);
+		return;
+	}
+
+	const uint cellID = cellPos.x + (cellPos.y * NUM_CELLS_PER_CHUNK_SIDE);
+	const uint cellIndex = (chunkSlot * NUM_CELLS_PER_CHUNK) + cellID;
+	const float2 uv = (cellPosition - float2(mapCell)) * 8.0f;
+
+	// The color textures repeat 8 times per cell, pick the mip that has about one texel per clipmap texel
+	const TerrainLayers layers = LoadTerrainLayers(cellIndex);
+
+	uint2 colorTextureSize;
+	_terrainColorTextures[layers.diffuseIDs.x].GetDimensions(colorTextureSize.x, colorTextureSize.y);
+	const float colorMip = max(log2((float(colorTextureSize.x) * 8.0f) / float(texelsPerCell)), 0.0f);
+
+	_atlas[atlasTexel] = SampleTerrainAlbedoLevel(layers, cellID, uv, colorMip);
+}
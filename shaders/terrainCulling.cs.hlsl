@@ -1,11 +1,24 @@
 #include "globalData.inc.hlsl"
 #include "terrain.inc.hlsl"
+#include "permutation.inc.hlsl"
+#include "depthPyramid.inc.hlsl"
 
-#define USE_PACKED_HEIGHT_RANGE 1
+// Byte offsets into _counters, this needs to match TerrainRenderer::CullingCounters
+#define COUNTER_DRAW_COUNTS_OFFSET (0)
+#define COUNTER_FRUSTUM_CULLED_OFFSET (24)
+#define COUNTER_OCCLUSION_CULLED_OFFSET (28)
+#define COUNTER_DRAWN_CELLS_OFFSET (32)
+#define COUNTER_LAYER_CLASS_CELLS_OFFSET (40)
 
 struct Constants
 {
 	float4 frustumPlanes[6];
+	float3 cameraPosition;
+	float lodErrorScale; // Size of a yard in pixels at a distance of 1 divided by the allowed error in pixels
+	int forcedLod; // Ignored when negative
+	uint culledInstanceCapacity; // Every cell is drawn once at most, so the draws of both lists share a range of one instance per loaded cell
+	uint2 padding;
+	float4x4 viewProjectionMatrix; // Not locked with the frustum, the depth pyramid always comes from the real camera
 };
 
 [[vk::binding(0, PER_PASS)]] ByteAddressBuffer _instances;
@@ -13,18 +26,47 @@ struct Constants
 [[vk::binding(2, PER_PASS)]] RWByteAddressBuffer _culledInstances;
 [[vk::binding(3, PER_PASS)]] RWByteAddressBuffer _argumentBuffer;
 [[vk::binding(4, PER_PASS)]] ConstantBuffer<Constants> _constants;
+[[vk::binding(5, PER_PASS)]] ByteAddressBuffer _chunkSlots;
+[[vk::binding(6, PER_PASS)]] ByteAddressBuffer _cellLodData;
+[[vk::binding(7, PER_PASS)]] RWByteAddressBuffer _cellVisibility; // One bit per cell, set if the cell passed the last occlusion test it got
+[[vk::binding(8, PER_PASS)]] RWByteAddressBuffer _counters;
+[[vk::binding(9, PER_PASS)]] Texture2D<float2> _depthPyramid;
+[[vk::binding(10, PER_PASS)]] ByteAddressBuffer _cellData;
+[[vk::binding(11, PER_PASS)]] RWByteAddressBuffer _unsortedInstances;
+[[vk::binding(12, PER_PASS)]] RWByteAddressBuffer _sortKeys;
+[[vk::binding(13, PER_PASS)]] RWByteAddressBuffer _bandCounts; // Per draw of the list being culled, reset before every phase
+
+struct CellLodData
+{
+	float3 errors; // Largest height difference to LOD 0 in yards for LOD 1 and up
+	uint maxLod;
+};
+
+CellLodData LoadCellLodData(uint cellIndex)
+{
+	const uint4 packed = _cellLodData.Load4(cellIndex * 16); // sizeof(CellLodData) = 16
+
+	CellLodData lodData;
+	lodData.errors = asfloat(packed.xyz);
+	lodData.maxLod = packed.w;
+
+	return lodData;
+}
 
 float2 ReadHeightRange(uint instanceIndex)
 {
-#if USE_PACKED_HEIGHT_RANGE
-	const uint packed = _heightRanges.Load(instanceIndex * 4);
-	const float min = f16tof32(packed >> 16);
-	const float max = f16tof32(packed);
-	return float2(min, max);
-#else
-	const float2 minmax = asfloat(_heightRanges.Load2(instanceIndex * 8));
-	return minmax;
-#endif
+	if (HasKeyword(TERRAIN_KEYWORD_PACKED_HEIGHT_RANGE))
+	{
+		const uint packed = _heightRanges.Load(instanceIndex * 4);
+		const float min = f16tof32(packed >> 16);
+		const float max = f16tof32(packed);
+		return float2(min, max);
+	}
+	else
+	{
+		const float2 minmax = asfloat(_heightRanges.Load2(instanceIndex * 8));
+		return minmax;
+	}
 }
 
 bool IsAABBInsideFrustum(float4 frustum[6], AABB aabb)
@@ -81,34 +123,183 @@ bool IsAABBInsideFrustum(float4 frustum[6], AABB aabb)
 	return true;
 }
 
-[numthreads(32, 1, 1)]
-void main(uint3 dispatchThreadId : SV_DispatchThreadID)
+// Half an octave per band starting at 16 yards, the LOD already orders the draws by distance so the bands only need to be coarse
+uint GetDistanceBand(AABB aabb)
+{
+	const float3 boxMin = min(aabb.min, aabb.max);
+	const float3 boxMax = max(aabb.min, aabb.max);
+	const float distanceToCell = distance(_constants.cameraPosition, clamp(_constants.cameraPosition, boxMin, boxMax));
+
+	const float band = log2(max(distanceToCell, 16.0f) / 16.0f) * 2.0f;
+	return min(uint(band), NUM_CELL_DISTANCE_BANDS - 1);
+}
+
+// This needs to match Terrain::Lod::SelectCellLod
+uint SelectCellLod(uint chunkID, uint cellID, uint cellIndex)
+{
+	const CellLodData lodData = LoadCellLodData(cellIndex);
+
+	if (_constants.forcedLod >= 0)
+	{
+		return min(uint(_constants.forcedLod), lodData.maxLod);
+	}
+
+	// Cell bounding boxes don't keep min and max in order
+	const AABB aabb = GetCellAABB(chunkID, cellID, ReadHeightRange(cellIndex));
+	const float3 boxMin = min(aabb.min, aabb.max);
+	const float3 boxMax = max(aabb.min, aabb.max);
+	const float distanceToCell = distance(_constants.cameraPosition, clamp(_constants.cameraPosition, boxMin, boxMax));
+
+	uint lod = 0;
+	while (lod < lodData.maxLod && lodData.errors[lod] * _constants.lodErrorScale <= distanceToCell)
+	{
+		lod++;
+	}
+
+	return lod;
+}
+
+// Neighbours that are outside of the map or not resident fall back to our own LOD, which leaves that edge as it is
+uint SelectNeighbourCellLod(uint chunkID, uint cellID, uint edge, uint cellLod)
 {
-	// todo: initialize the draw arguments before dispatch
-	if (dispatchThreadId.x == 0)
+	const int2 offsets[4] = { int2(0, -1), int2(1, 0), int2(0, 1), int2(-1, 0) };
+
+	int2 chunkPos = int2(chunkID % NUM_CHUNKS_PER_MAP_SIDE, chunkID / NUM_CHUNKS_PER_MAP_SIDE);
+	int2 cellPos = int2(cellID % NUM_CELLS_PER_CHUNK_SIDE, cellID / NUM_CELLS_PER_CHUNK_SIDE) + offsets[edge];
+
+	const int2 chunkOffset = int2(floor(float2(cellPos) / NUM_CELLS_PER_CHUNK_SIDE));
+	chunkPos += chunkOffset;
+	cellPos -= chunkOffset * NUM_CELLS_PER_CHUNK_SIDE;
+
+	if (any(chunkPos < 0) || any(chunkPos >= NUM_CHUNKS_PER_MAP_SIDE))
 	{
-		// indexCount, instanceCount, indexOffset, vertexOffset
-		_argumentBuffer.Store4(0, uint4(NUM_INDICES_PER_CELL, 0, 0, 0));
-		// instanceOffset
-		_argumentBuffer.Store(16, 0);
+		return cellLod;
 	}
 
+	const uint neighbourChunkID = chunkPos.x + (chunkPos.y * NUM_CHUNKS_PER_MAP_SIDE);
+	const uint neighbourCellID = cellPos.x + (cellPos.y * NUM_CELLS_PER_CHUNK_SIDE);
+
+	const uint neighbourChunkSlot = _chunkSlots.Load(neighbourChunkID * 4);
+	if (neighbourChunkSlot == TERRAIN_CHUNK_SLOT_INVALID)
+	{
+		return cellLod;
+	}
+
+	const uint neighbourCellIndex = (neighbourChunkSlot * NUM_CELLS_PER_CHUNK) + neighbourCellID;
+	return SelectCellLod(neighbourChunkID, neighbourCellID, neighbourCellIndex);
+}
+
+[numthreads(32, 1, 1)]
+void main(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	// The draw arguments and counters get reset by TerrainRenderer before the first phase
 	const uint instanceIndex = dispatchThreadId.x;
 	CellInstance instance = _instances.Load<CellInstance>(instanceIndex * 8);
 
+	// Every instance gets a key, the compaction pass skips the ones that don't get drawn in this phase
+	_sortKeys.Store(instanceIndex * 4, CELL_SORT_KEY_INVALID);
+
 	const uint cellID = instance.packedChunkCellID & 0xffff;
 	const uint chunkID = instance.packedChunkCellID >> 16;
 
-	const float2 heightRange = ReadHeightRange(instanceIndex);
+	// Chunks are found through the slot table, an instance of a chunk that got unloaded since it was written is simply skipped
+	const uint chunkSlot = _chunkSlots.Load(chunkID * 4);
+	if (chunkSlot == TERRAIN_CHUNK_SLOT_INVALID)
+	{
+		return;
+	}
+
+	const uint cellIndex = (chunkSlot * NUM_CELLS_PER_CHUNK) + cellID;
+
+	const float2 heightRange = ReadHeightRange(cellIndex);
 	const AABB aabb = GetCellAABB(chunkID, cellID, heightRange);
 
+	const bool isOcclusionPass = HasKeyword(TERRAIN_KEYWORD_OCCLUSION_PASS);
+	const uint visibilityOffset = (cellIndex / 32) * 4;
+	const uint visibilityMask = 1u << (cellIndex % 32);
+
     if (!IsAABBInsideFrustum(_constants.frustumPlanes, aabb))
     {
+		if (isOcclusionPass)
+		{
+			// Cells coming back into view get tested again instead of being drawn in the first phase right away
+			_cellVisibility.InterlockedAnd(visibilityOffset, ~visibilityMask);
+		}
+		else
+		{
+			_counters.InterlockedAdd(COUNTER_FRUSTUM_CULLED_OFFSET, 1);
+		}
+
         return;
     }
 
+	if (isOcclusionPass)
+	{
+		// The pyramid holds the depth of every cell drawn in the first phase, so this sees what those hide
+		const bool isOccluded = IsAABBOccluded(_depthPyramid, _constants.viewProjectionMatrix, aabb.min, aabb.max);
+
+		uint previousVisibility;
+		if (isOccluded)
+		{
+			_cellVisibility.InterlockedAnd(visibilityOffset, ~visibilityMask, previousVisibility);
+			_counters.InterlockedAdd(COUNTER_OCCLUSION_CULLED_OFFSET, 1);
+			return;
+		}
+
+		_cellVisibility.InterlockedOr(visibilityOffset, visibilityMask, previousVisibility);
+
+		// Visible last frame means it was drawn in the first phase already
+		if (previousVisibility & visibilityMask)
+		{
+			return;
+		}
+	}
+	else if (HasKeyword(TERRAIN_KEYWORD_OCCLUSION_CULLING))
+	{
+		// Only the cells that were visible last frame are drawn before the depth pyramid gets built
+		if ((_cellVisibility.Load(visibilityOffset) & visibilityMask) == 0)
+		{
+			return;
+		}
+	}
+
+	const uint lod = SelectCellLod(chunkID, cellID, cellIndex);
+
+	uint4 neighbourLods;
+	neighbourLods.x = SelectNeighbourCellLod(chunkID, cellID, CELL_EDGE_TOP, lod);
+	neighbourLods.y = SelectNeighbourCellLod(chunkID, cellID, CELL_EDGE_RIGHT, lod);
+	neighbourLods.z = SelectNeighbourCellLod(chunkID, cellID, CELL_EDGE_BOTTOM, lod);
+	neighbourLods.w = SelectNeighbourCellLod(chunkID, cellID, CELL_EDGE_LEFT, lod);
+
+	instance.instanceID = PackCellInstanceID(cellIndex, lod, neighbourLods);
+
+	// Without occlusion culling everything goes into the main list, the occlusion pass writes the cells it finds newly visible into the second one
+	// Every list is split by layer class, which picks the pixel shader, and every LOD of those has its own draw
+	// instanceCount is the second u32 of its 20 byte arguments
+	const uint drawList = isOcclusionPass ? 1 : 0;
+	const uint layerClass = GetCellLayerClass(_cellData.Load<PackedCellData>(cellIndex * 12)); // sizeof(PackedCellData) = 12
+	const uint drawBucket = (drawList * NUM_CELL_LAYER_CLASSES) + layerClass;
+	const uint drawIndex = (drawBucket * NUM_CELL_LODS) + lod;
+
 	uint outInstanceIndex;
-	_argumentBuffer.InterlockedAdd(4, 1, outInstanceIndex);
+	_argumentBuffer.InterlockedAdd((drawIndex * 20) + 4, 1, outInstanceIndex);
+
+	// The draw count only covers the LODs up to the coarsest one that got a cell, a bucket without cells issues no draws at all
+	_counters.InterlockedMax(COUNTER_DRAW_COUNTS_OFFSET + (drawBucket * 4), lod + 1);
+	_counters.InterlockedAdd(COUNTER_DRAWN_CELLS_OFFSET + (drawList * 4), 1);
+	_counters.InterlockedAdd(COUNTER_LAYER_CLASS_CELLS_OFFSET + (layerClass * 4), 1);
+
+	// Where a draw starts is only known once every draw of the list is counted, so terrainCullingCompaction.cs.hlsl writes the instance
+	// Without depth sorting everything goes into the first band in the order it was counted
+	uint band = 0;
+	uint rank = outInstanceIndex;
+	if (HasKeyword(TERRAIN_KEYWORD_DEPTH_SORT))
+	{
+		band = GetDistanceBand(aabb);
+		const uint listDrawIndex = (layerClass * NUM_CELL_LODS) + lod;
+		_bandCounts.InterlockedAdd(((listDrawIndex * NUM_CELL_DISTANCE_BANDS) + band) * 4, 1, rank);
+	}
 
-	_culledInstances.Store<CellInstance>(outInstanceIndex * 8, instance);
+	_unsortedInstances.Store<CellInstance>(instanceIndex * 8, instance);
+	_sortKeys.Store(instanceIndex * 4, (drawIndex << CELL_SORT_KEY_DRAW_SHIFT) | (band << CELL_SORT_KEY_BAND_SHIFT) | rank);
 }
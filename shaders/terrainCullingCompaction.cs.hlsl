@@ -0,0 +1,50 @@
+#include "globalData.inc.hlsl"
+#include "terrain.inc.hlsl"
+
+// Shares its descriptor set with terrainCulling.cs.hlsl, so this needs to match the bindings and constants there
+struct Constants
+{
+	float4 frustumPlanes[6];
+	float3 cameraPosition;
+	float lodErrorScale;
+	int forcedLod;
+	uint culledInstanceCapacity;
+	uint2 padding;
+	float4x4 viewProjectionMatrix;
+};
+
+[[vk::binding(2, PER_PASS)]] RWByteAddressBuffer _culledInstances;
+[[vk::binding(4, PER_PASS)]] ConstantBuffer<Constants> _constants;
+[[vk::binding(11, PER_PASS)]] RWByteAddressBuffer _unsortedInstances;
+[[vk::binding(12, PER_PASS)]] RWByteAddressBuffer _sortKeys;
+[[vk::binding(13, PER_PASS)]] RWByteAddressBuffer _bandCounts; // Where every band starts, written by terrainCullingOffsets.cs.hlsl
+
+// Moves every instance the culling drew into its draw and distance band, the nearer bands of a draw come first so its instances go front to back
+[numthreads(32, 1, 1)]
+void main(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	const uint instanceIndex = dispatchThreadId.x;
+
+	const uint sortKey = _sortKeys.Load(instanceIndex * 4);
+	if (sortKey == CELL_SORT_KEY_INVALID)
+	{
+		return;
+	}
+
+	const uint drawIndex = sortKey >> CELL_SORT_KEY_DRAW_SHIFT;
+	const uint band = (sortKey >> CELL_SORT_KEY_BAND_SHIFT) & (NUM_CELL_DISTANCE_BANDS - 1);
+	const uint rank = sortKey & CELL_SORT_KEY_RANK_MASK;
+
+	const uint listDrawIndex = drawIndex % (NUM_CELL_LAYER_CLASSES * NUM_CELL_LODS);
+	const uint bandOffset = _bandCounts.Load(((listDrawIndex * NUM_CELL_DISTANCE_BANDS) + band) * 4);
+
+	// Both draw lists together draw every cell once at most, which keeps this within the buffer
+	const uint outInstanceIndex = bandOffset + rank;
+	if (outInstanceIndex >= _constants.culledInstanceCapacity)
+	{
+		return;
+	}
+
+	const CellInstance instance = _unsortedInstances.Load<CellInstance>(instanceIndex * 8);
+	_culledInstances.Store<CellInstance>(outInstanceIndex * 8, instance);
+}
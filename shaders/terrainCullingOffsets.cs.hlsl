@@ -0,0 +1,42 @@
+#include "globalData.inc.hlsl"
+#include "terrain.inc.hlsl"
+#include "permutation.inc.hlsl"
+
+// Shares its descriptor set with terrainCulling.cs.hlsl, so this needs to match the bindings there
+[[vk::binding(3, PER_PASS)]] RWByteAddressBuffer _argumentBuffer;
+[[vk::binding(13, PER_PASS)]] RWByteAddressBuffer _bandCounts;
+
+// Every draw of both draw lists shares one range of _culledInstances, once the culling has counted the draws of a list this places them back to back
+// The band counts of those draws are turned into where every band starts, terrainCullingCompaction.cs.hlsl moves the instances there
+[numthreads(1, 1, 1)]
+void main()
+{
+	const uint numDrawsPerList = NUM_CELL_LAYER_CLASSES * NUM_CELL_LODS;
+	const uint firstDraw = HasKeyword(TERRAIN_KEYWORD_OCCLUSION_PASS) ? numDrawsPerList : 0;
+
+	// The newly visible cells go after the main list, which the first phase already counted
+	// instanceCount is the second and firstInstance the fifth u32 of the 20 byte arguments
+	uint offset = 0;
+	for (uint drawIndex = 0; drawIndex < firstDraw; drawIndex++)
+	{
+		offset += _argumentBuffer.Load((drawIndex * 20) + 4);
+	}
+
+	for (uint bucket = 0; bucket < numDrawsPerList; bucket++)
+	{
+		const uint drawIndex = firstDraw + bucket;
+		_argumentBuffer.Store((drawIndex * 20) + 16, offset);
+
+		uint bandOffset = offset;
+		for (uint band = 0; band < NUM_CELL_DISTANCE_BANDS; band++)
+		{
+			const uint countOffset = ((bucket * NUM_CELL_DISTANCE_BANDS) + band) * 4;
+			const uint count = _bandCounts.Load(countOffset);
+
+			_bandCounts.Store(countOffset, bandOffset);
+			bandOffset += count;
+		}
+
+		offset += _argumentBuffer.Load((drawIndex * 20) + 4);
+	}
+}
@@ -0,0 +1,29 @@
+#include "globalData.inc.hlsl"
+#include "permutation.inc.hlsl"
+#include "terrain.inc.hlsl"
+#include "terrainVertex.inc.hlsl"
+
+struct VSInput
+{
+    uint vertexID : SV_VertexID;
+    uint packedChunkCellID : TEXCOORD0;
+    uint instanceID : TEXCOORD1; // Packed cell index and LODs, see terrain.inc.hlsl
+};
+
+struct VSOutput
+{
+    precise float4 position : SV_Position;
+};
+
+VSOutput main(VSInput input)
+{
+    VSOutput output;
+
+    const uint cellIndex = GetCellIndex(input.instanceID);
+    const uint vertexBaseOffset = cellIndex * NUM_VERTICES_PER_CELL;
+    const PackedVertex packedVertex = LoadPackedVertex(vertexBaseOffset, input.vertexID);
+
+    output.position = GetTerrainClipPosition(input.packedChunkCellID, input.instanceID, input.vertexID, packedVertex);
+
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+// Shared by terrain.ps.hlsl and terrainClipmapBake.cs.hlsl, the clipmap only matches the terrain it replaces if both blend the layers the same way
+[[vk::binding(2, PER_PASS)]] ByteAddressBuffer _cellData;
+[[vk::binding(3, PER_PASS)]] ByteAddressBuffer _chunkData;
+
+[[vk::binding(4, PER_PASS)]] SamplerState _alphaSampler;
+[[vk::binding(5, PER_PASS)]] SamplerState _colorSampler;
+
+[[vk::binding(6, PER_PASS)]] Texture2D<float4> _terrainColorTextures[4096];
+// BC4 and BC5 alpha maps only have the channels of the layers their chunk uses, the missing ones read as 0 which leaves those layers out of the blend
+[[vk::binding(7, PER_PASS)]] Texture2DArray<float4> _terrainAlphaTextures[NUM_CHUNKS_PER_MAP_SIDE * NUM_CHUNKS_PER_MAP_SIDE];
+
+struct TerrainLayers
+{
+    uint4 diffuseIDs;
+    uint alphaID;
+};
+
+CellData LoadCellData(uint globalCellID)
+{
+    const PackedCellData rawCellData = _cellData.Load<PackedCellData>(globalCellID * 12); // sizeof(PackedCellData) = 12
+
+    CellData cellData;
+
+    // Unpack diffuse IDs
+    cellData.diffuseIDs.x = (rawCellData.packedDiffuseIDs1 >> 0)  & 0xffff;
+    cellData.diffuseIDs.y = (rawCellData.packedDiffuseIDs1 >> 16)  & 0xffff;
+    cellData.diffuseIDs.z = (rawCellData.packedDiffuseIDs2 >> 0) & 0xffff;
+    cellData.diffuseIDs.w = (rawCellData.packedDiffuseIDs2 >> 16) & 0xffff;
+
+    // Unpack holes
+    cellData.holes = rawCellData.packedHoles & 0xffff;
+
+    return cellData;
+}
+
+TerrainLayers LoadTerrainLayers(uint cellIndex)
+{
+    const CellData cellData = LoadCellData(cellIndex);
+
+    const uint chunkIndex = cellIndex / NUM_CELLS_PER_CHUNK;
+    const ChunkData chunkData = _chunkData.Load<ChunkData>(chunkIndex * 4); // sizeof(ChunkData) = 4
+
+    // We have 4 uints per chunk for our diffuseIDs, this gives us a size and alignment of 16 bytes which is exactly what GPUs want
+    // However, we need a fifth uint for alphaID, so we decided to pack it into the LAST diffuseID, which gets split into two uint16s
+    // This is what it looks like
+    // [1111] diffuseIDs.x
+    // [2222] diffuseIDs.y
+    // [3333] diffuseIDs.z
+    // [AA44] diffuseIDs.w Alpha is read from the most significant bits, the fourth diffuseID read from the least
+    TerrainLayers layers;
+    layers.diffuseIDs = cellData.diffuseIDs;
+    layers.alphaID = chunkData.alphaID;
+
+    return layers;
+}
+
+float4 BlendTerrainLayers(float4 color, float4 diffuse1, float4 diffuse2, float4 diffuse3, float3 alpha)
+{
+    color = (diffuse1 * alpha.x) + (color * (1.0f - alpha.x));
+    color = (diffuse2 * alpha.y) + (color * (1.0f - alpha.y));
+    color = (diffuse3 * alpha.z) + (color * (1.0f - alpha.z));
+
+    return color;
+}
+
+// uv goes between 0 and 8 over the cell, which is what the color textures wrap with, the alpha map covers the whole cell once
+// The gradients are passed in since the caller might only get here for some pixels of a quad
+float4 SampleTerrainAlbedo(TerrainLayers layers, uint cellID, float2 uv, float2 uvDdx, float2 uvDdy, bool singleLayer, bool twoLayers)
+{
+    float4 color = _terrainColorTextures[layers.diffuseIDs.x].SampleGrad(_colorSampler, uv, uvDdx, uvDdy);
+
+    // Cells with a single layer don't need the alpha map or the other three diffuse samples
+    if (singleLayer)
+    {
+        return color;
+    }
+
+    // Cells with two layers only blend with the first alpha channel, the layers they don't have would blend with 0 anyway
+    if (twoLayers)
+    {
+        float alpha = _terrainAlphaTextures[layers.alphaID].SampleGrad(_alphaSampler, float3(uv / 8.0f, float(cellID)), uvDdx / 8.0f, uvDdy / 8.0f).r;
+        float4 diffuse1 = _terrainColorTextures[layers.diffuseIDs.y].SampleGrad(_colorSampler, uv, uvDdx, uvDdy);
+        color = (diffuse1 * alpha) + (color * (1.0f - alpha));
+    }
+    else
+    {
+        float3 alpha = _terrainAlphaTextures[layers.alphaID].SampleGrad(_alphaSampler, float3(uv / 8.0f, float(cellID)), uvDdx / 8.0f, uvDdy / 8.0f).rgb;
+        float4 diffuse1 = _terrainColorTextures[layers.diffuseIDs.y].SampleGrad(_colorSampler, uv, uvDdx, uvDdy);
+        float4 diffuse2 = _terrainColorTextures[layers.diffuseIDs.z].SampleGrad(_colorSampler, uv, uvDdx, uvDdy);
+        float4 diffuse3 = _terrainColorTextures[layers.diffuseIDs.w].SampleGrad(_colorSampler, uv, uvDdx, uvDdy);
+        color = BlendTerrainLayers(color, diffuse1, diffuse2, diffuse3, alpha);
+    }
+
+    return color;
+}
+
+// Same as SampleTerrainAlbedo for shaders without derivatives, colorMip is the mip of the color textures to sample
+float4 SampleTerrainAlbedoLevel(TerrainLayers layers, uint cellID, float2 uv, float colorMip)
+{
+    float4 color = _terrainColorTextures[layers.diffuseIDs.x].SampleLevel(_colorSampler, uv, colorMip);
+
+    float3 alpha = _terrainAlphaTextures[layers.alphaID].SampleLevel(_alphaSampler, float3(uv / 8.0f, float(cellID)), 0).rgb;
+    float4 diffuse1 = _terrainColorTextures[layers.diffuseIDs.y].SampleLevel(_colorSampler, uv, colorMip);
+    float4 diffuse2 = _terrainColorTextures[layers.diffuseIDs.z].SampleLevel(_colorSampler, uv, colorMip);
+    float4 diffuse3 = _terrainColorTextures[layers.diffuseIDs.w].SampleLevel(_colorSampler, uv, colorMip);
+
+    return BlendTerrainLayers(color, diffuse1, diffuse2, diffuse3, alpha);
+}
@@ -0,0 +1,188 @@
+// Shared by terrain.vs.hlsl and terrainDepth.vs.hlsl, the depth prepass relies on both computing bit identical positions so keep all position math in here
+[[vk::binding(0, PER_PASS)]] ByteAddressBuffer _vertices;
+[[vk::binding(1, PER_PASS)]] ByteAddressBuffer _cellDataVS;
+
+struct PackedVertex
+{
+    uint data0;
+    uint data1;
+};
+
+float UnpackHalf(uint encoded)
+{
+    return f16tof32(encoded);
+}
+
+PackedVertex LoadPackedVertex(uint vertexBaseOffset, uint vertexID)
+{
+    const uint vertexIndex = vertexBaseOffset + vertexID;
+
+    // Without the normal a vertex is 6 bytes, color, the half height and a byte of padding, which get moved to where they are in the full vertex
+    // Every other vertex starts halfway into a u32, the buffer always holds an even number of vertices so loading two u32s never reads past its end
+    if (HasKeyword(TERRAIN_KEYWORD_DERIVED_NORMALS))
+    {
+        const uint byteOffset = vertexIndex * 6;
+        const uint2 words = _vertices.Load2(byteOffset & ~3u);
+        const bool isHalfway = (byteOffset & 3u) != 0;
+
+        const uint colorAndHeightLow = isHalfway ? (words.x >> 16u) | (words.y << 16u) : words.x;
+        const uint heightHigh = isHalfway ? (words.y >> 16u) : words.y;
+
+        PackedVertex packedVertex;
+        packedVertex.data0 = colorAndHeightLow << 24u;
+        packedVertex.data1 = (colorAndHeightLow >> 8u) | (heightHigh << 24u);
+
+        return packedVertex;
+    }
+
+    return _vertices.Load<PackedVertex>(vertexIndex * 8); // 8 = sizeof(PackedVertex)
+}
+
+float GetVertexHeight(PackedVertex packedVertex)
+{
+    // The height is stored as a half in the upper 16 bits of data1
+    return UnpackHalf(packedVertex.data1 >> 16u);
+}
+
+// Vertices on an edge shared with a coarser neighbour are moved onto the neighbour's edge, this is what keeps neighbouring LODs from cracking
+float GetStitchedVertexHeight(uint vertexBaseOffset, uint instanceID, uint vertexID, float height)
+{
+    const uint row = vertexID / 17;
+    const uint column = vertexID % 17;
+
+    // Inner vertices are never on an edge
+    if (column > 8)
+    {
+        return height;
+    }
+
+    uint edge;
+    uint positionOnEdge;
+    if (row == 0)
+    {
+        edge = CELL_EDGE_TOP;
+        positionOnEdge = column;
+    }
+    else if (column == 8)
+    {
+        edge = CELL_EDGE_RIGHT;
+        positionOnEdge = row;
+    }
+    else if (row == 8)
+    {
+        edge = CELL_EDGE_BOTTOM;
+        positionOnEdge = column;
+    }
+    else if (column == 0)
+    {
+        edge = CELL_EDGE_LEFT;
+        positionOnEdge = row;
+    }
+    else
+    {
+        return height;
+    }
+
+    // Corners are a multiple of every stride, so they never move and it doesn't matter which of their two edges got picked
+    const uint edgeStride = 1u << max(GetCellLod(instanceID), GetNeighbourCellLod(instanceID, edge));
+    const uint offset = positionOnEdge % edgeStride;
+    if (offset == 0)
+    {
+        return height;
+    }
+
+    const uint start = positionOnEdge - offset;
+    const uint end = start + edgeStride;
+
+    const bool isRow = (edge == CELL_EDGE_TOP) || (edge == CELL_EDGE_BOTTOM);
+    const uint startVertexID = isRow ? (row * 17) + start : (start * 17) + column;
+    const uint endVertexID = isRow ? (row * 17) + end : (end * 17) + column;
+
+    const float startHeight = GetVertexHeight(LoadPackedVertex(vertexBaseOffset, startVertexID));
+    const float endHeight = GetVertexHeight(LoadPackedVertex(vertexBaseOffset, endVertexID));
+
+    return lerp(startHeight, endHeight, float(offset) / float(edgeStride));
+}
+
+float3 GetVertexPosition(uint chunkID, uint cellID, uint vertexID, float height)
+{
+    // Everything but the height is based on vertexID
+    float3 position;
+    position.y = height;
+
+    float2 cellPos = GetCellPosition(chunkID, cellID);
+    float2 vertexPos = GetCellSpaceVertexPosition(vertexID);
+
+    const float CELL_PRECISION = CELL_SIDE_SIZE / 8.0f;
+
+    position.x = -((-vertexPos.x) * CELL_PRECISION + cellPos.x);
+    position.z = (-vertexPos.y) * CELL_PRECISION + cellPos.y;
+
+    position = mul(float3x3(
+        0, 0, 1,
+        0, 1, 0,
+    -1, 0, 0
+    ), position);
+
+    return position;
+}
+
+CellData LoadCellData(uint globalCellID)
+{
+    const PackedCellData rawCellData = _cellDataVS.Load<PackedCellData>(globalCellID * 12); // sizeof(PackedCellData) = 12
+
+    CellData cellData;
+
+    // Unpack diffuse IDs
+    cellData.diffuseIDs.x = (rawCellData.packedDiffuseIDs1 >> 0) & 0xffff;
+    cellData.diffuseIDs.y = (rawCellData.packedDiffuseIDs1 >> 16) & 0xffff;
+    cellData.diffuseIDs.z = (rawCellData.packedDiffuseIDs2 >> 0) & 0xffff;
+    cellData.diffuseIDs.w = (rawCellData.packedDiffuseIDs2 >> 16) & 0xffff;
+
+    // Unpack holes
+    cellData.holes = rawCellData.packedHoles & 0xffff;
+
+    return cellData;
+}
+
+// Coarser LODs use the outer vertex in the middle of a hole block as the center of its quad
+bool IsHoleQuadCenter(uint vertexID, uint holes)
+{
+    const uint row = vertexID / 17;
+    const uint column = vertexID % 17;
+
+    if (holes == 0 || column > 8 || (row % 2) == 0 || (column % 2) == 0)
+    {
+        return false;
+    }
+
+    const uint blockRow = row / 2;
+    const uint blockColumn = column / 2;
+
+    return ((holes >> (blockRow * 4)) & (1u << blockColumn)) != 0;
+}
+
+// Returns the clip space position of a terrain vertex, hole vertices return NaN which makes the rasterizer drop their triangles
+float4 GetTerrainClipPosition(uint packedChunkCellID, uint instanceID, uint vertexID, PackedVertex packedVertex)
+{
+    const uint cellIndex = GetCellIndex(instanceID);
+    const uint lod = GetCellLod(instanceID);
+
+    // Cells with holes are never drawn coarser than LOD 1, see CELL_MAX_LOD_WITH_HOLES
+    CellData cellData = LoadCellData(cellIndex);
+    const bool isHole = (lod == 0) ? IsHoleVertex(vertexID, cellData.holes) : IsHoleQuadCenter(vertexID, cellData.holes);
+    if (isHole)
+    {
+        const float NaN = asfloat(0b01111111100000000000000000000000);
+        return float4(NaN, NaN, NaN, NaN);
+    }
+
+    const uint cellID = packedChunkCellID & 0xffff;
+    const uint chunkID = packedChunkCellID >> 16;
+
+    const uint vertexBaseOffset = cellIndex * NUM_VERTICES_PER_CELL;
+    const float height = GetStitchedVertexHeight(vertexBaseOffset, instanceID, vertexID, GetVertexHeight(packedVertex));
+
+    const float3 position = GetVertexPosition(chunkID, cellID, vertexID, height);
+    return mul(float4(position, 1.0f), _viewData.viewProjectionMatrix);
+}